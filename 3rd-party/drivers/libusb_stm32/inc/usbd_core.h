@@ -256,6 +256,8 @@ typedef void (*usbd_hw_setaddr)(uint8_t address);
  * \param ep endpoint address. Use USB_EPDIR_ macros to set endpoint direction
  * \param eptype endpoint type. Use USB_EPTYPE_* macros.
  * \param epsize endpoint size in bytes
+ * \note For the high-bandwidth endpoint of the high-speed device, bits 12:11
+ * of epsize are the number of additional transactions per microframe (as in wMaxPacketSize).
  * \return TRUE if success
  */
 typedef bool (*usbd_hw_ep_config)(uint8_t ep, uint8_t eptype, uint16_t epsize);
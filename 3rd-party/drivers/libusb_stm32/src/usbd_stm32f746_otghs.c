@@ -254,15 +254,19 @@ static bool ep_config(uint8_t ep, uint8_t eptype, uint16_t epsize) {
         EPOUT(ep)->DOEPCTL = mpsize | USB_OTG_DOEPCTL_EPENA | USB_OTG_DOEPCTL_CNAK;
         return true;
     }
+    /* high-bandwidth endpoint: epsize bits 12:11 are the number of */
+    /* additional transactions per microframe (as in wMaxPacketSize) */
+    uint16_t fifosize = (epsize & USB_OTG_DIEPCTL_MPSIZ) * (1 + ((epsize >> 11) & 0x03));
+    epsize &= USB_OTG_DIEPCTL_MPSIZ;
     if (ep & 0x80) {
         ep &= 0x7F;
         USB_OTG_INEndpointTypeDef* epi = EPIN(ep);
         /* configuring TX endpoint */
         /* setting up TX fifo and size register */
         if (eptype & USB_EPTYPE_DBLBUF) {
-            if (!set_tx_fifo(ep, epsize << 1)) return false;
+            if (!set_tx_fifo(ep, fifosize << 1)) return false;
         } else {
-            if (!set_tx_fifo(ep, epsize)) return false;
+            if (!set_tx_fifo(ep, fifosize)) return false;
         }
         /* enabling EP TX interrupt */
         OTGD->DAINTMSK |= (0x0001UL << ep);
@@ -364,7 +368,7 @@ static int32_t ep_read(uint8_t ep, void* buf, uint16_t blen) {
 }
 
 static int32_t ep_write(uint8_t ep, void *buf, uint16_t blen) {
-    uint32_t len, tmp;
+    uint32_t len, tmp, pktcnt;
     ep &= 0x7F;
     volatile uint32_t* fifo = EPFIFO(ep);
     USB_OTG_INEndpointTypeDef* epi = EPIN(ep);
@@ -375,9 +379,18 @@ static int32_t ep_write(uint8_t ep, void *buf, uint16_t blen) {
     if (ep != 0 && epi->DIEPCTL & USB_OTG_DIEPCTL_EPENA) {
         return -1;
     }
+    /* high-bandwidth isochronous endpoint: up to 3 packets per microframe */
+    /* bulk and interrupt endpoints: a single packet */
+    pktcnt = 1;
+    if (ep != 0 && (epi->DIEPCTL & USB_OTG_DIEPCTL_EPTYP) == USB_OTG_DIEPCTL_EPTYP_0) {
+        uint32_t mpsize = _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, epi->DIEPCTL);
+        if (blen > mpsize) {
+            pktcnt = (blen + mpsize - 1) / mpsize;
+        }
+    }
     _BMD(epi->DIEPTSIZ,
          USB_OTG_DIEPTSIZ_PKTCNT | USB_OTG_DIEPTSIZ_MULCNT | USB_OTG_DIEPTSIZ_XFRSIZ,
-         _VAL2FLD(USB_OTG_DIEPTSIZ_PKTCNT, 1) | _VAL2FLD(USB_OTG_DIEPTSIZ_MULCNT, 1 ) | _VAL2FLD(USB_OTG_DIEPTSIZ_XFRSIZ, blen));
+         _VAL2FLD(USB_OTG_DIEPTSIZ_PKTCNT, pktcnt) | _VAL2FLD(USB_OTG_DIEPTSIZ_MULCNT, pktcnt) | _VAL2FLD(USB_OTG_DIEPTSIZ_XFRSIZ, blen));
     _BMD(epi->DIEPCTL, USB_OTG_DIEPCTL_STALL, USB_OTG_DOEPCTL_CNAK);
     _BST(epi->DIEPCTL, USB_OTG_DOEPCTL_EPENA);
     /* push data to FIFO */
@@ -16,9 +16,17 @@
 #--------------------------------------------------------------
 
 apps_makefiles=(
+    "examples/audio/audio-analyzer/gcc-stm32f746ig"
+    "examples/audio/audio-conv/gcc-stm32f407zg"
+    "examples/audio/audio-conv/gcc-stm32f746ig"
+    "examples/audio/audio-fx/gcc-stm32f407zg"
+    "examples/audio/audio-fx/gcc-stm32f746ig"
     "examples/audio/audio-in/gcc-stm32f746ig"
     "examples/audio/audio-out/gcc-stm32f746ig"
+    "examples/audio/audio-src/gcc-stm32f407zg"
+    "examples/audio/audio-src/gcc-stm32f746ig"
     "examples/audio/fatfs+sd-card+i2s/gcc-stm32f746ig"
+    "examples/audio/wav-recorder/gcc-stm32f746ig"
     "examples/camera/ov2640/gcc-stm32f407zg"
     "examples/camera/ov2640/gcc-stm32f746ig"
     "examples/camera/ov7670/gcc-stm32f407zg"
@@ -37,6 +45,8 @@ apps_makefiles=(
     "examples/file-system/fatfs+sd-card/gcc-stm32f407zg"
     "examples/file-system/fatfs+sd-card/gcc-stm32f746ig"
     "examples/file-system/spiffs+spi-flash/gcc-stm32f407zg"
+    "examples/image/img-conv/gcc-stm32f407zg"
+    "examples/image/img-conv/gcc-stm32f746ig"
     "examples/rtc/internal/gcc-stm32f407zg"
     "examples/sd-card/sd-card/gcc-stm32f407zg"
     "examples/sd-card/sd-card/gcc-stm32f746ig"
@@ -16,13 +16,19 @@
 #define AUDIO_IN_DRV_H_
 
 typedef void (*read_dma_rxbuf_complete_callback)(void);
+// Circular DMA: half = 0 - the first half of the buffer is received, 1 - the second one
+typedef void (*read_dma_rxbuf_half_callback)(uint8_t half);
 
 typedef struct audio_in_drv
 {
 	void (*init)(void);
 	void (*init_dma_rxbuf)(read_dma_rxbuf_complete_callback callback);
 	void (*read_dma_rxbuf)(void *rxbuf, uint32_t length);
-	void (*convert)(uint32_t *in, uint32_t *out);
+	void (*init_dma_rxbuf_cycle)(read_dma_rxbuf_half_callback callback);
+	uint32_t (*get_dma_rxbuf_remain)(void);
+	void (*stop_dma_rxbuf)(void);
+	// Converts the received samples to the 32-bit (24-bit MSB aligned) CPU order ones (in may be out)
+	void (*convert)(const uint32_t *in, uint32_t *out, uint32_t samples);
 } audio_in_drv_t;
 
 #endif // AUDIO_IN_DRV_H_
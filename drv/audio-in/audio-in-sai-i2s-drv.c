@@ -15,8 +15,11 @@
 #include "platform.h"
 #include "hal-sai-i2s.h"
 #include "audio-in-drv.h"
+#include <stddef.h>
+#include <string.h>
 
 static read_dma_rxbuf_complete_callback rx_irq_tcif_callback;
+static read_dma_rxbuf_half_callback rx_irq_half_callback;
 
 //--------------------------------------------
 static void init(void)
@@ -29,12 +32,34 @@ static void init(void)
 static void init_dma_rxbuf(read_dma_rxbuf_complete_callback callback)
 {
 	rx_irq_tcif_callback = callback;
+	rx_irq_half_callback = NULL;
 	hal_sai_i2s_init_dma_rx_buf();
 }
 
+//--------------------------------------------
+static void init_dma_rxbuf_cycle(read_dma_rxbuf_half_callback callback)
+{
+	rx_irq_half_callback = callback;
+	hal_sai_i2s_init_dma_rx_buf_cycle();
+}
+
+//--------------------------------------------
+void hal_sai_i2s_irq_htif_callback(void)
+{
+	if (rx_irq_half_callback)
+	{
+		rx_irq_half_callback(0);
+	}
+}
+
 //--------------------------------------------
 void hal_sai_i2s_irq_tcif_callback(void)
 {
+	if (rx_irq_half_callback)
+	{
+		rx_irq_half_callback(1);
+		return;
+	}
 	rx_irq_tcif_callback();
 }
 
@@ -42,9 +67,12 @@ void hal_sai_i2s_irq_tcif_callback(void)
 // Byte sequence in I2S wire (32-bit, MSB first):            B1 B2 B3 B4
 // Byte sequence after SAI-I2S conversion and DMA transfer:  B4 B3 B2 B1
 // Byte sequence after this function (32-bit, LSB first):    B4 B3 B2 B1
-static void convert32to32(uint32_t *in, uint32_t *out)
+static void convert32to32(const uint32_t *in, uint32_t *out, uint32_t samples)
 {
-	*out = *in;
+	if (in != out)
+	{
+		memcpy(out, in, samples * sizeof(uint32_t));
+	}
 }
 
 //--------------------------------------------
@@ -53,5 +81,8 @@ const audio_in_drv_t audio_in_drv =
 	init,
 	init_dma_rxbuf,
 	hal_sai_i2s_read_dma_buf,
+	init_dma_rxbuf_cycle,
+	hal_sai_i2s_get_dma_remain,
+	hal_sai_i2s_stop_dma,
 	convert32to32,
 };
@@ -15,6 +15,7 @@
 #include "platform.h"
 #include "hal-spi-i2s.h"
 #include "uac-adc-drv.h"
+#include "audio-conv.h"
 
 static read_dma_rxbuf_complete_callback rx_irq_tcif_callback;
 
@@ -47,10 +48,10 @@ void hal_spi_i2s_rx_irq_tcif_callback(void)
 //--------------------------------------------
 // Byte sequence in I2S wire (32-bit, MSB first):            B1 B2 B3 B4
 // Byte sequence after SPI-I2S conversion and DMA transfer:  B2 B1 B4 B3
-// Byte sequence after this function (16-bit, LSB first):    B2 B1
-static void convert32to16(uint32_t *in, uint16_t *out)
+// Byte sequence after this function (32-bit, LSB first):    B4 B3 B2 B1
+static void convert32to32(const uint32_t *in, uint32_t *out, uint32_t samples)
 {
-	*out = (uint16_t)(*in);
+	audio_conv_swap16(in, out, samples);
 }
 
 //--------------------------------------------
@@ -60,5 +61,5 @@ const audio_in_drv_t audio_in_drv =
 	config,
 	init_dma_rxbuf,
 	hal_spi_i2s_read_dma_buf,
-	convert32to16,
+	convert32to32,
 };
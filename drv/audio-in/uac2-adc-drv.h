@@ -23,7 +23,8 @@ typedef struct audio_in_drv
 	void (*config)(void);
 	void (*init_dma_rxbuf)(read_dma_rxbuf_complete_callback callback);
 	void (*read_dma_rxbuf)(void *rxbuf, uint32_t length);
-	void (*convert)(uint32_t *in, uint32_t *out);
+	// Converts the received samples to the 32-bit (24-bit MSB aligned) CPU order ones (in may be out)
+	void (*convert)(const uint32_t *in, uint32_t *out, uint32_t samples);
 } audio_in_drv_t;
 
 #endif // UAC2_ADC_DRV_H_
@@ -15,6 +15,7 @@
 #include "platform.h"
 #include "hal-sai-i2s.h"
 #include "uac2-adc-drv.h"
+#include <string.h>
 
 static read_dma_rxbuf_complete_callback rx_irq_tcif_callback;
 
@@ -47,9 +48,12 @@ void hal_sai_i2s_irq_tcif_callback(void)
 // Byte sequence in I2S wire (32-bit, MSB first):            B1 B2 B3 B4
 // Byte sequence after SAI-I2S conversion and DMA transfer:  B4 B3 B2 B1
 // Byte sequence after this function (32-bit, LSB first):    B4 B3 B2 B1
-static void convert32to32(uint32_t *in, uint32_t *out)
+static void convert32to32(const uint32_t *in, uint32_t *out, uint32_t samples)
 {
-	*out = *in;
+	if (in != out)
+	{
+		memcpy(out, in, samples * sizeof(uint32_t));
+	}
 }
 
 //--------------------------------------------
@@ -16,12 +16,21 @@
 #define AUDIO_IN_DRV_H_
 
 typedef void (*write_dma_txbuf_complete_callback)(void);
+// Circular DMA: half = 0 - the first half of the buffer is transferred, 1 - the second one
+typedef void (*write_dma_txbuf_half_callback)(uint8_t half);
 
 typedef struct audio_out_drv
 {
 	void (*init)(void);
 	void (*init_dma_txbuf)(write_dma_txbuf_complete_callback callback);
 	void (*write_dma_txbuf)(void *txbuf, uint32_t length);
+	void (*init_dma_txbuf_cycle)(write_dma_txbuf_half_callback callback);
+	uint32_t (*get_dma_txbuf_remain)(void);
+	void (*stop_dma_txbuf)(void);
+	// Changes the sampling rate and the resolution (the DMA must be stopped), returns 0 on success
+	uint8_t (*set_format)(uint32_t fclk, uint8_t bitres);
+	// Prepares the 32-bit (24-bit MSB aligned) samples for the DMA transfer (in may be out)
+	void (*convert)(const uint32_t *in, uint32_t *out, uint32_t samples);
 } audio_out_drv_t;
 
 #endif // AUDIO_IN_DRV_H_
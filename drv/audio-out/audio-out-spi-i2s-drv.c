@@ -15,8 +15,11 @@
 #include "platform.h"
 #include "hal-spi-i2s.h"
 #include "audio-out-drv.h"
+#include "audio-conv.h"
+#include <stddef.h>
 
 static write_dma_txbuf_complete_callback tx_irq_tcif_callback;
+static write_dma_txbuf_half_callback tx_irq_half_callback;
 
 //--------------------------------------------
 static void init(void)
@@ -29,19 +32,55 @@ static void init(void)
 static void init_dma_txbuf(write_dma_txbuf_complete_callback callback)
 {
 	tx_irq_tcif_callback = callback;
+	tx_irq_half_callback = NULL;
 	hal_spi_i2s_init_dma_tx_buf();
 }
 
+//--------------------------------------------
+static void init_dma_txbuf_cycle(write_dma_txbuf_half_callback callback)
+{
+	tx_irq_half_callback = callback;
+	hal_spi_i2s_init_dma_tx_buf_cycle();
+}
+
+//--------------------------------------------
+void hal_spi_i2s_tx_irq_htif_callback(void)
+{
+	if (tx_irq_half_callback)
+	{
+		tx_irq_half_callback(0);
+	}
+}
+
 //--------------------------------------------
 void hal_spi_i2s_tx_irq_tcif_callback(void)
 {
+	if (tx_irq_half_callback)
+	{
+		tx_irq_half_callback(1);
+		return;
+	}
 	tx_irq_tcif_callback();
 }
 
+//--------------------------------------------
+// Byte sequence in memory (32-bit, LSB first):              B1 B2 B3 B4
+// Byte sequence after this function before DMA transfer:    B3 B4 B1 B2
+// Byte sequence in I2S wire (32-bit, MSB first):            B4 B3 B2 B1
+static void convert32to32(const uint32_t *in, uint32_t *out, uint32_t samples)
+{
+	audio_conv_swap16(in, out, samples);
+}
+
 //--------------------------------------------
 const audio_out_drv_t audio_out_drv =
 {
 	init,
 	init_dma_txbuf,
 	hal_spi_i2s_write_dma_buf,
+	init_dma_txbuf_cycle,
+	hal_spi_i2s_get_dma_tx_remain,
+	hal_spi_i2s_stop_dma_tx,
+	hal_spi_i2s_set_format,
+	convert32to32,
 };
@@ -16,6 +16,8 @@
 #define UAC_DAC_DRV_H_
 
 typedef void (*write_dma_txbuf_complete_callback)(void);
+// Circular DMA: half = 0 - the first half of the buffer is transferred, 1 - the second one
+typedef void (*write_dma_txbuf_half_callback)(uint8_t half);
 typedef void (*mclk_count_complete_callback)(uint32_t mclk);
 
 typedef struct audio_out_drv
@@ -23,11 +25,15 @@ typedef struct audio_out_drv
 	void (*init)(void);
 	void (*init_dma_txbuf)(write_dma_txbuf_complete_callback callback);
 	void (*write_dma_txbuf)(void *txbuf, uint32_t length);
+	void (*init_dma_txbuf_cycle)(write_dma_txbuf_half_callback callback);
+	uint32_t (*get_dma_txbuf_remain)(void);
+	void (*stop_dma_txbuf)(void);
 	double (*get_mclk)(void);
 	void (*mclk_set_sof)(uint32_t sof);
 	void (*mclk_start_count)(mclk_count_complete_callback callback);
 	void (*mclk_stop_count)(void);
-	void (*convert)(uint32_t *in, uint32_t *out);
+	// Prepares the 32-bit (24-bit MSB aligned) samples for the DMA transfer (in may be out)
+	void (*convert)(const uint32_t *in, uint32_t *out, uint32_t samples);
 } audio_out_drv_t;
 
 #endif // UAC_DAC_DRV_H_
@@ -16,17 +16,28 @@
 #include "hal-sai-i2s.h"
 #include "hal-i2s-mclk.h"
 #include "uac-dac-drv.h"
+#include <stddef.h>
+#include <string.h>
 
 static write_dma_txbuf_complete_callback tx_irq_tcif_callback;
+static write_dma_txbuf_half_callback tx_irq_half_callback;
 static mclk_count_complete_callback mclk_callback;
 
 //--------------------------------------------
 static void init_dma_txbuf(write_dma_txbuf_complete_callback callback)
 {
 	tx_irq_tcif_callback = callback;
+	tx_irq_half_callback = NULL;
 	hal_sai_i2s_init_dma_tx_buf();
 }
 
+//--------------------------------------------
+static void init_dma_txbuf_cycle(write_dma_txbuf_half_callback callback)
+{
+	tx_irq_half_callback = callback;
+	hal_sai_i2s_init_dma_tx_buf_cycle();
+}
+
 //--------------------------------------------
 static void init(void)
 {
@@ -35,9 +46,23 @@ static void init(void)
 	hal_i2s_mclk_init();
 }
 
+//--------------------------------------------
+void hal_sai_i2s_irq_htif_callback(void)
+{
+	if (tx_irq_half_callback)
+	{
+		tx_irq_half_callback(0);
+	}
+}
+
 //--------------------------------------------
 void hal_sai_i2s_irq_tcif_callback(void)
 {
+	if (tx_irq_half_callback)
+	{
+		tx_irq_half_callback(1);
+		return;
+	}
 	tx_irq_tcif_callback();
 }
 
@@ -58,9 +83,12 @@ void mclk_irq_callback(uint32_t mclk)
 // Byte sequence in USB wire (32-bit, LSB first):            B1 B2 B3 B4
 // Byte sequence after this function before DMA transfer:    B1 B2 B3 B4
 // Byte sequence in I2S wire (32-bit, MSB first):            B4 B3 B2 B1
-static void convert32to32(uint32_t *in, uint32_t *out)
+static void convert32to32(const uint32_t *in, uint32_t *out, uint32_t samples)
 {
-	*out = *in;
+	if (in != out)
+	{
+		memcpy(out, in, samples * sizeof(uint32_t));
+	}
 }
 
 //--------------------------------------------
@@ -69,6 +97,9 @@ const audio_out_drv_t audio_out_drv =
 	init,
 	init_dma_txbuf,
 	hal_sai_i2s_write_dma_buf,
+	init_dma_txbuf_cycle,
+	hal_sai_i2s_get_dma_remain,
+	hal_sai_i2s_stop_dma,
 	hal_sai_i2s_get_mclk,
 	hal_i2s_mclk_set_sof,
 	mclk_start_count,
@@ -15,6 +15,42 @@
 #ifndef IMGSENSOR_DRV_H_
 #define IMGSENSOR_DRV_H_
 
+#define IMGSENSOR_SUCCESS    0
+#define IMGSENSOR_FAIL       1
+
+// Uncompressed output formats (2 bytes per pixel)
+#define IMGSENSOR_FORMAT_RGB565    0
+#define IMGSENSOR_FORMAT_YUV422    1
+
+#define IMGSENSOR_LATENCY_BINS     8
+
+// Capture statistics since the start,
+// the timestamps are DWT cycle counter values
+typedef struct imgsensor_stat
+{
+	uint32_t vsyncs;               // VSYNC interrupts
+	uint32_t frames;               // frames captured
+	uint32_t consumed_frames;      // frames taken by the reader
+	uint32_t skipped_frames;       // frames not captured: no free frame buffer or the read timed out
+	uint32_t recaptured_frames;    // incomplete frames (DMA out of sync with the frame) captured again
+	uint32_t dropped_frames;       // JPEG frames without SOI or overflowed the frame buffer
+	uint32_t overwritten_frames;   // frames replaced with the next one before they were taken
+	uint32_t overruns;             // DCMI overrun errors
+	uint32_t sync_errors;          // DCMI embedded synchronization (line) errors
+	uint32_t dma_errors;           // DMA transfer and direct mode errors
+	uint32_t fifo_errors;          // DMA FIFO errors
+	uint32_t vsync_time;           // the latest VSYNC
+	uint32_t frame_time;           // the latest frame end
+	uint32_t frame_period;         // CPU cycles between the latest two frame ends
+	uint32_t fps_x10;              // frames per second * 10 since the previous call
+	// capture (frame end) to consume (get_frame) latency histogram:
+	// 0-1, 1-2, 2-4, 4-8, 8-16, 16-32, 32-64, 64- ms
+	uint32_t latency[IMGSENSOR_LATENCY_BINS];
+} imgsensor_stat_t;
+
+typedef void (*read_dma_line_complete_callback)(uint8_t *line);
+typedef void (*read_dma_frame_complete_callback)(void);
+
 typedef struct imgsensor_drv
 {
 	void (*init)(uint8_t little_endian);
@@ -30,6 +66,17 @@ typedef struct imgsensor_drv
 	uint32_t (*read_fifo)(void);
 	void (*start_capture)(void);
 	void (*stop_capture)(void);
+	void (*init_dma_lines)(read_dma_line_complete_callback line_callback, read_dma_frame_complete_callback frame_callback);
+	void (*start_dma_lines)(uint8_t *buf, uint32_t line_length, uint8_t lines);
+	void (*init_dma_frames)(read_dma_frame_complete_callback frame_callback);
+	uint8_t (*start_dma_frames)(uint8_t *buf, uint32_t frame_length, uint8_t frames); // 0 if frame_length is not supported
+	uint8_t *(*get_frame)(uint32_t *length);
+	void (*release_frame)(void);
+	uint8_t (*set_jpeg)(uint16_t width, uint16_t height, uint8_t quality); // NULL if JPEG is not supported
+	uint8_t (*set_format)(uint16_t width, uint16_t height, uint8_t format);
+	uint8_t (*set_scale)(uint16_t width, uint16_t height); // sensor side downscaling, the format is kept
+	uint8_t (*set_window)(uint16_t x, uint16_t y, uint16_t width, uint16_t height); // ROI of the scaled image, 0 x 0 - full image
+	void (*get_stat)(imgsensor_stat_t *stat);
 } imgsensor_drv_t;
 
 #endif // IMAGE_SENSOR_DRV_H_
@@ -16,6 +16,44 @@
 #include "hal-imgsensor-dcmi.h"
 #include "ov2640.h"
 #include "imgsensor-drv.h"
+#include <stddef.h>
+
+static read_dma_line_complete_callback line_irq_callback;
+static read_dma_frame_complete_callback frame_irq_callback;
+
+//--------------------------------------------
+static void init_dma_lines(read_dma_line_complete_callback line_callback, read_dma_frame_complete_callback frame_callback)
+{
+	line_irq_callback = line_callback;
+	frame_irq_callback = frame_callback;
+	hal_imgsensor_init_dma_lines();
+}
+
+//--------------------------------------------
+static void init_dma_frames(read_dma_frame_complete_callback frame_callback)
+{
+	line_irq_callback = NULL;
+	frame_irq_callback = frame_callback;
+	hal_imgsensor_init_dma_frames();
+}
+
+//--------------------------------------------
+void hal_imgsensor_irq_line_callback(uint8_t *line)
+{
+	if (line_irq_callback)
+	{
+		line_irq_callback(line);
+	}
+}
+
+//--------------------------------------------
+void hal_imgsensor_irq_frame_callback(void)
+{
+	if (frame_irq_callback)
+	{
+		frame_irq_callback();
+	}
+}
 
 //--------------------------------------------
 const imgsensor_drv_t cam_drv =
@@ -32,5 +70,16 @@ const imgsensor_drv_t cam_drv =
 	hal_imgsensor_wait_hsync,
 	hal_imgsensor_read_fifo,
 	hal_imgsensor_start_capture,
-	hal_imgsensor_stop_capture
+	hal_imgsensor_stop_capture,
+	init_dma_lines,
+	hal_imgsensor_start_dma_lines,
+	init_dma_frames,
+	hal_imgsensor_start_dma_frames,
+	hal_imgsensor_get_frame,
+	hal_imgsensor_release_frame,
+	ov2640_set_jpeg,
+	ov2640_set_format,
+	ov2640_set_scale,
+	ov2640_set_window,
+	hal_imgsensor_get_stat
 };
@@ -15,6 +15,7 @@
 #include "hal-imgsensor-dcmi.h"
 #include "hal-imgsensor-i2c.h"
 #include "ov2640-cmds.h"
+#include "imgsensor-drv.h"
 #include <stdio.h>
 
 //--------------------------------------------
@@ -98,6 +99,64 @@ static const uint8_t ov2640_ext_init_regs[][2] =
 	{ 0x50, 0x9C },
 };
 
+//--------------------------------------------
+// The DSP input is the full UXGA sensor image,
+// the output image size is set by the DSP zoom (see ov2640_sizes)
+static const uint8_t ov2640_size_regs[][2] =
+{
+	{ BANK_SEL, BANK_SEL_DSP },
+	{ RESET, RESET_DVP },
+	{ SIZEL, SIZEL_HSIZE8_11_SET(1600) | SIZEL_HSIZE8_SET(1600) | SIZEL_VSIZE8_SET(1200) },
+	{ HSIZE8, HSIZE8_SET(1600) },
+	{ VSIZE8, VSIZE8_SET(1200) },
+	{ CTRL2, CTRL2_DCW_EN | CTRL2_SDE_EN | CTRL2_UV_AVG_EN | CTRL2_CMX_EN | CTRL2_UV_ADJ_EN },
+	{ HSIZE, HSIZE_SET(1600) },
+	{ VSIZE, VSIZE_SET(1200) },
+	{ XOFFL, XOFFL_SET(0) },
+	{ YOFFL, YOFFL_SET(0) },
+	{ VHYX, VHYX_HSIZE_SET(1600) | VHYX_VSIZE_SET(1200) | VHYX_XOFF_SET(0) | VHYX_YOFF_SET(0) },
+	{ TEST, TEST_HSIZE_SET(1600) },
+};
+
+//--------------------------------------------
+// JPEG output
+static const uint8_t ov2640_jpeg_regs[][2] =
+{
+	{ BANK_SEL, BANK_SEL_DSP },
+	{ RESET, RESET_JPEG | RESET_DVP },
+	{ IMAGE_MODE, IMAGE_MODE_JPEG_EN | IMAGE_MODE_HREF_VSYNC }, // HREF is active during the whole frame
+	{ 0xD7, 0x03 },
+	{ 0xE1, 0x77 },
+	{ 0xE5, 0x1F },
+	{ 0xD9, 0x10 },
+	{ 0xDF, 0x80 },
+	{ 0x33, 0x80 },
+	{ 0x3C, 0x10 },
+	{ 0xEB, 0x30 },
+	{ 0xDD, 0x7F },
+	{ RESET, 0x00 },
+};
+
+//--------------------------------------------
+// Image sizes:
+// width, height, vertical and horizontal DCW divider, DVP PCLK divider
+static const uint16_t ov2640_sizes[][5] =
+{
+	{  160,  120, 3, 3, 8 }, // QQVGA
+	{  176,  144, 3, 3, 4 }, // QCIF
+	{  320,  240, 2, 2, 4 }, // QVGA
+	{  352,  288, 2, 2, 8 }, // CIF
+	{  640,  480, 0, 0, 2 }, // VGA
+	{  800,  600, 1, 1, 2 }, // SVGA
+	{ 1024,  768, 0, 0, 2 }, // XGA
+	{ 1280, 1024, 0, 0, 0 }, // SXGA
+	{ 1600, 1200, 0, 0, 0 }, // UXGA
+};
+
+static uint16_t out_width;
+static uint16_t out_height;
+static uint8_t jpeg_mode;
+
 #if 0
 static void read_registers(void)
 {
@@ -213,3 +272,165 @@ uint32_t ov2640_read_dma_buf(uint8_t *rxbuf, uint32_t length)
 	hal_imgsensor_stop_dma();
 	return res;
 }
+
+//--------------------------------------------
+static uint8_t set_size(uint16_t width, uint16_t height)
+{
+	uint32_t cnt;
+	const uint16_t *size;
+
+	for (cnt = 0; cnt < (sizeof(ov2640_sizes) / sizeof(ov2640_sizes[0])); cnt++)
+	{
+		if (ov2640_sizes[cnt][0] == width && ov2640_sizes[cnt][1] == height)
+		{
+			break;
+		}
+	}
+	if (cnt == (sizeof(ov2640_sizes) / sizeof(ov2640_sizes[0])))
+	{
+		return IMGSENSOR_FAIL;
+	}
+	size = ov2640_sizes[cnt];
+
+	for (cnt = 0; cnt < (sizeof(ov2640_size_regs) / sizeof(ov2640_size_regs[0])); cnt++)
+	{
+		hal_imgsensor_write_register(ov2640_size_regs[cnt][0], ov2640_size_regs[cnt][1]);
+	}
+	hal_imgsensor_write_register(CTRLI, CTRLI_LP_DP | CTRLI_V_DIV_SET(size[2]) | CTRLI_H_DIV_SET(size[3]));
+	hal_imgsensor_write_register(ZMOW, ZMOW_OUTW_SET(width));
+	hal_imgsensor_write_register(ZMOH, ZMOH_OUTH_SET(height));
+	hal_imgsensor_write_register(ZMHH, ZMHH_OUTW_SET(width) | ZMHH_OUTH_SET(height));
+	hal_imgsensor_write_register(R_DVP_SP, size[4]);
+	hal_imgsensor_write_register(RESET, 0x00);
+	hal_imgsensor_set_crop(0, 0, 0, 0);
+	out_width = width;
+	out_height = height;
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Switches the sensor to the JPEG output
+// width, height: one of the ov2640_sizes
+// quality: quantization scale, the lower the value
+//          the better the quality and the bigger the frame (typically 4...30)
+uint8_t ov2640_set_jpeg(uint16_t width, uint16_t height, uint8_t quality)
+{
+	uint8_t reg;
+	uint32_t cnt;
+
+	// Image size
+	if (set_size(width, height))
+	{
+		return IMGSENSOR_FAIL;
+	}
+
+	// The JPEG encoder input is YUV422
+	hal_imgsensor_read_register(CTRL0, &reg);
+	reg |= CTRL0_YUV422 | CTRL0_YUV_EN;
+	hal_imgsensor_write_register(CTRL0, reg);
+	for (cnt = 0; cnt < (sizeof(ov2640_jpeg_regs) / sizeof(ov2640_jpeg_regs[0])); cnt++)
+	{
+		hal_imgsensor_write_register(ov2640_jpeg_regs[cnt][0], ov2640_jpeg_regs[cnt][1]);
+	}
+	hal_imgsensor_write_register(QS, quality);
+
+	// DCMI JPEG mode (ov2640_set_format() returns to the uncompressed mode)
+	hal_imgsensor_set_jpeg(1);
+	jpeg_mode = 1;
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Changes the output image size and format
+// width, height: one of the ov2640_sizes
+// format: IMGSENSOR_FORMAT_RGB565 or IMGSENSOR_FORMAT_YUV422
+uint8_t ov2640_set_format(uint16_t width, uint16_t height, uint8_t format)
+{
+	uint8_t reg;
+
+	// Image size
+	if (set_size(width, height))
+	{
+		return IMGSENSOR_FAIL;
+	}
+
+	// Output format, the byte order is kept
+	hal_imgsensor_write_register(RESET, RESET_DVP);
+	hal_imgsensor_read_register(IMAGE_MODE, &reg);
+	reg &= IMAGE_MODE_LBYTE_FIRST;
+	reg |= (format == IMGSENSOR_FORMAT_RGB565) ? IMAGE_MODE_RGB565 : IMAGE_MODE_YUV422;
+	hal_imgsensor_write_register(IMAGE_MODE, reg);
+	hal_imgsensor_write_register(RESET, 0x00);
+
+	// DCMI uncompressed mode
+	hal_imgsensor_set_jpeg(0);
+	jpeg_mode = 0;
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Changes the output image size, the format is kept
+// width, height: one of the ov2640_sizes
+uint8_t ov2640_set_scale(uint16_t width, uint16_t height)
+{
+	return set_size(width, height);
+}
+
+//--------------------------------------------
+// Captures only the window of the output image (set by ov2640_set_format() or ov2640_set_scale()):
+// the DSP input window is narrowed to the part of the UXGA image covering it and zoomed
+// with the same ratio to the 4 pixel aligned window, DCMI crops the rest.
+// width = 0 or height = 0: the full image
+// Not available in the JPEG mode (DCMI crop must be disabled).
+uint8_t ov2640_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	uint16_t x4, y4, width4, height4;
+	uint16_t dsp_x, dsp_y, dsp_width, dsp_height;
+
+	if (jpeg_mode || !out_width || x + width > out_width || y + height > out_height)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	if (!width || !height)
+	{
+		x4 = 0;
+		y4 = 0;
+		width4 = out_width;
+		height4 = out_height;
+	}
+	else
+	{
+		// The zoom output size is set in 4 pixel units
+		x4 = x & ~3;
+		y4 = y & ~3;
+		width4 = ((x + width + 3) & ~3) - x4;
+		height4 = ((y + height + 3) & ~3) - y4;
+	}
+	dsp_x = (uint32_t)x4 * 1600 / out_width;
+	dsp_y = (uint32_t)y4 * 1200 / out_height;
+	dsp_width = ((uint32_t)width4 * 1600 / out_width) & ~3;
+	dsp_height = ((uint32_t)height4 * 1200 / out_height) & ~3;
+
+	hal_imgsensor_write_register(BANK_SEL, BANK_SEL_DSP);
+	hal_imgsensor_write_register(RESET, RESET_DVP);
+	hal_imgsensor_write_register(HSIZE, HSIZE_SET(dsp_width));
+	hal_imgsensor_write_register(VSIZE, VSIZE_SET(dsp_height));
+	hal_imgsensor_write_register(XOFFL, XOFFL_SET(dsp_x));
+	hal_imgsensor_write_register(YOFFL, YOFFL_SET(dsp_y));
+	hal_imgsensor_write_register(VHYX, VHYX_HSIZE_SET(dsp_width) | VHYX_VSIZE_SET(dsp_height) | VHYX_XOFF_SET(dsp_x) | VHYX_YOFF_SET(dsp_y));
+	hal_imgsensor_write_register(TEST, TEST_HSIZE_SET(dsp_width));
+	hal_imgsensor_write_register(ZMOW, ZMOW_OUTW_SET(width4));
+	hal_imgsensor_write_register(ZMOH, ZMOH_OUTH_SET(height4));
+	hal_imgsensor_write_register(ZMHH, ZMHH_OUTW_SET(width4) | ZMHH_OUTH_SET(height4));
+	hal_imgsensor_write_register(RESET, 0x00);
+
+	if (!width || !height)
+	{
+		hal_imgsensor_set_crop(0, 0, 0, 0);
+	}
+	else
+	{
+		hal_imgsensor_set_crop(x - x4, y - y4, width, height);
+	}
+	return IMGSENSOR_SUCCESS;
+}
@@ -17,5 +17,9 @@
 
 void ov2640_init(uint8_t little_endian);
 uint32_t ov2640_read_dma_buf(uint8_t *rxbuf, uint32_t length);
+uint8_t ov2640_set_jpeg(uint16_t width, uint16_t height, uint8_t quality);
+uint8_t ov2640_set_format(uint16_t width, uint16_t height, uint8_t format);
+uint8_t ov2640_set_scale(uint16_t width, uint16_t height);
+uint8_t ov2640_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 
 #endif // OV2640_H_
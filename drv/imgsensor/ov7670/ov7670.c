@@ -15,6 +15,8 @@
 #include "hal-imgsensor-dcmi.h"
 #include "hal-imgsensor-i2c.h"
 #include "ov7670-cmds.h"
+#include "imgsensor-drv.h"
+#include <stddef.h>
 #include <stdio.h>
 
 //--------------------------------------------
@@ -214,6 +216,26 @@ static const uint8_t ov7670_ext_init_regs[][2] =
 	{ REG_COM13, COM13_GAMMA | COM13_UVSAT },
 };
 
+//--------------------------------------------
+// Image sizes (the VGA window is downsampled by DCW, the PCLK is divided accordingly):
+// width, height, COM3, COM14, DCW control, PCLK divider
+static const uint16_t ov7670_sizes[][6] =
+{
+	{ 640, 480, 0x00,       0x00, 0x11, 0xF0 }, // VGA
+	{ 320, 240, COM3_DCWEN, 0x19, 0x11, 0xF1 }, // QVGA
+	{ 160, 120, COM3_DCWEN, 0x1A, 0x22, 0xF2 }, // QQVGA
+};
+
+//--------------------------------------------
+// The VGA sensor window (the default HSTART/HSTOP/HREF, VSTART/VSTOP/VREF),
+// the horizontal counter wraps around at OV7670_HTOTAL
+#define OV7670_HSTART    158
+#define OV7670_VSTART    10
+#define OV7670_HTOTAL    784
+
+static uint16_t out_width;
+static uint16_t out_height;
+
 //--------------------------------------------
 #if 0
 static void read_registers(void)
@@ -298,3 +320,130 @@ uint32_t ov7670_read_dma_buf(uint8_t *rxbuf, uint32_t length)
 	hal_imgsensor_stop_dma();
 	return res;
 }
+
+//--------------------------------------------
+static const uint16_t *find_size(uint16_t width, uint16_t height)
+{
+	uint32_t cnt;
+
+	for (cnt = 0; cnt < (sizeof(ov7670_sizes) / sizeof(ov7670_sizes[0])); cnt++)
+	{
+		if (ov7670_sizes[cnt][0] == width && ov7670_sizes[cnt][1] == height)
+		{
+			return ov7670_sizes[cnt];
+		}
+	}
+	return NULL;
+}
+
+//--------------------------------------------
+// Sets the sensor window
+// hstart, width: in pixels, vstart, height: in lines
+static void set_sensor_window(uint16_t hstart, uint16_t vstart, uint16_t width, uint16_t height)
+{
+	uint8_t reg;
+	uint16_t hstop;
+	uint16_t vstop;
+
+	hstop = (hstart + width) % OV7670_HTOTAL;
+	vstop = vstart + height;
+	hal_imgsensor_write_register(REG_HSTART, (uint8_t)(hstart >> 3));
+	hal_imgsensor_write_register(REG_HSTOP, (uint8_t)(hstop >> 3));
+	hal_imgsensor_read_register(REG_HREF, &reg);
+	reg = (reg & 0xC0) | ((hstop & 0x07) << 3) | (hstart & 0x07);
+	hal_imgsensor_write_register(REG_HREF, reg);
+	hal_imgsensor_write_register(REG_VSTART, (uint8_t)(vstart >> 2));
+	hal_imgsensor_write_register(REG_VSTOP, (uint8_t)(vstop >> 2));
+	hal_imgsensor_read_register(REG_VREF, &reg);
+	reg = (reg & 0xF0) | ((vstop & 0x03) << 2) | (vstart & 0x03);
+	hal_imgsensor_write_register(REG_VREF, reg);
+}
+
+//--------------------------------------------
+// Sets the image size, the sensor window is reset to the full VGA window
+static void set_size(const uint16_t *size)
+{
+	hal_imgsensor_write_register(REG_COM3, (uint8_t)size[2]);
+	hal_imgsensor_write_register(REG_COM14, (uint8_t)size[3]);
+	hal_imgsensor_write_register(0x72, (uint8_t)size[4]); // DCW control
+	hal_imgsensor_write_register(0x73, (uint8_t)size[5]); // PCLK divider
+	set_sensor_window(OV7670_HSTART, OV7670_VSTART, 640, 480);
+	hal_imgsensor_set_crop(0, 0, 0, 0);
+	out_width = size[0];
+	out_height = size[1];
+}
+
+//--------------------------------------------
+// Changes the output image size and format
+// width, height: one of the ov7670_sizes
+// format: IMGSENSOR_FORMAT_RGB565 or IMGSENSOR_FORMAT_YUV422
+uint8_t ov7670_set_format(uint16_t width, uint16_t height, uint8_t format)
+{
+	const uint16_t *size;
+
+	size = find_size(width, height);
+	if (!size)
+	{
+		return IMGSENSOR_FAIL;
+	}
+
+	// COM7 is written first, it resets the format dependent registers
+	if (format == IMGSENSOR_FORMAT_RGB565)
+	{
+		hal_imgsensor_write_register(REG_COM7, COM7_FMT_VGA | COM7_RGB);
+		hal_imgsensor_write_register(REG_COM15, COM15_RGB565 | COM15_R00FF);
+	}
+	else
+	{
+		hal_imgsensor_write_register(REG_COM7, COM7_FMT_VGA | COM7_YUV);
+		hal_imgsensor_write_register(REG_COM15, COM15_R00FF);
+	}
+	set_size(size);
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Changes the output image size, the format is kept
+// width, height: one of the ov7670_sizes
+uint8_t ov7670_set_scale(uint16_t width, uint16_t height)
+{
+	const uint16_t *size;
+
+	size = find_size(width, height);
+	if (!size)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	set_size(size);
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Captures only the window of the output image (set by ov7670_set_format() or ov7670_set_scale()):
+// the sensor window is narrowed to the pixel pairs covering it (the image is downsampled
+// from the narrowed window), DCMI crops the rest.
+// width = 0 or height = 0: the full image
+uint8_t ov7670_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	uint16_t scale;
+	uint16_t x_pair;
+	uint16_t width_pair;
+
+	if (!out_width || x + width > out_width || y + height > out_height)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	scale = 640 / out_width;
+	if (!width || !height)
+	{
+		set_sensor_window(OV7670_HSTART, OV7670_VSTART, 640, 480);
+		hal_imgsensor_set_crop(0, 0, 0, 0);
+		return IMGSENSOR_SUCCESS;
+	}
+	// The YUV422 sensor output starts with the whole pixel pair
+	x_pair = x & ~1;
+	width_pair = ((x + width + 1) & ~1) - x_pair;
+	set_sensor_window(OV7670_HSTART + x_pair * scale, OV7670_VSTART + y * scale, width_pair * scale, height * scale);
+	hal_imgsensor_set_crop(x - x_pair, 0, width, height);
+	return IMGSENSOR_SUCCESS;
+}
@@ -15,6 +15,7 @@
 #include "hal-imgsensor-dcmi.h"
 #include "hal-imgsensor-i2c.h"
 #include "ov7725-cmds.h"
+#include "imgsensor-drv.h"
 #include <stdio.h>
 
 //--------------------------------------------
@@ -186,3 +187,155 @@ uint32_t ov7725_read_dma_buf(uint8_t *rxbuf, uint32_t length)
 	hal_imgsensor_stop_dma();
 	return res;
 }
+
+//--------------------------------------------
+// The sensor windows (HSTART, VSTART in pixels and lines):
+// QVGA - up to 320 x 240, scaled down by the DSP
+// VGA - up to 640 x 480, not scaled
+#define OV7725_QVGA_HSTART    252
+#define OV7725_QVGA_VSTART    6
+#define OV7725_VGA_HSTART     140
+#define OV7725_VGA_VSTART     14
+
+static uint16_t out_width;
+static uint16_t out_height;
+static uint16_t sensor_hstart;
+static uint16_t sensor_vstart;
+static uint16_t sensor_width;
+static uint16_t sensor_height;
+
+//--------------------------------------------
+static void set_sensor_window(uint16_t hstart, uint16_t vstart, uint16_t width, uint16_t height)
+{
+	uint8_t reg;
+
+	hal_imgsensor_write_register(HSTART, (uint8_t)(hstart >> 2));
+	hal_imgsensor_write_register(HSIZE, (uint8_t)(width >> 2));
+	hal_imgsensor_write_register(VSTART, (uint8_t)(vstart >> 1));
+	hal_imgsensor_write_register(VSIZE, (uint8_t)(height >> 1));
+	hal_imgsensor_read_register(HREF, &reg);
+	reg &= 0x80;
+	reg |= ((vstart & 0x01) << HREF_VSTART_SHIFT) | ((hstart & 0x03) << HREF_HSTART_SHIFT);
+	reg |= ((height & 0x01) << HREF_VSIZE_SHIFT) | ((width & 0x03) << HREF_HSIZE_SHIFT);
+	hal_imgsensor_write_register(HREF, reg);
+}
+
+//--------------------------------------------
+static void set_output_size(uint16_t width, uint16_t height)
+{
+	uint8_t reg;
+
+	hal_imgsensor_write_register(HOUTSIZE, (uint8_t)(width >> 2));
+	hal_imgsensor_write_register(VOUTSIZE, (uint8_t)(height >> 1));
+	hal_imgsensor_read_register(EXHCH, &reg);
+	reg &= ~((0x01 << EXHCH_VSIZE_SHIFT) | (0x03 << EXHCH_HSIZE_SHIFT));
+	reg |= ((height & 0x01) << EXHCH_VSIZE_SHIFT) | ((width & 0x03) << EXHCH_HSIZE_SHIFT);
+	hal_imgsensor_write_register(EXHCH, reg);
+}
+
+//--------------------------------------------
+// Changes the output image size, the format is kept
+// width, height: up to 640 x 480, the QVGA or VGA sensor window is scaled down by the DSP
+uint8_t ov7725_set_scale(uint16_t width, uint16_t height)
+{
+	uint8_t reg;
+
+	if (!width || !height || width > 640 || height > 480)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	hal_imgsensor_read_register(COM7, &reg);
+	reg &= ~SLCT_MASK;
+	if (width <= 320 && height <= 240)
+	{
+		// QVGA window, auto scaling
+		hal_imgsensor_write_register(COM7, reg | SLCT_QVGA);
+		sensor_hstart = OV7725_QVGA_HSTART;
+		sensor_vstart = OV7725_QVGA_VSTART;
+		sensor_width = 320;
+		sensor_height = 240;
+		set_sensor_window(sensor_hstart, sensor_vstart, sensor_width, sensor_height);
+		hal_imgsensor_read_register(DSPAUTO, &reg);
+		hal_imgsensor_write_register(DSPAUTO, reg | SCAL0_ACTRL | SCAL1_2_ACTRL);
+	}
+	else
+	{
+		// VGA window, no scaling
+		hal_imgsensor_write_register(COM7, reg | SLCT_VGA);
+		sensor_hstart = OV7725_VGA_HSTART;
+		sensor_vstart = OV7725_VGA_VSTART;
+		sensor_width = 640;
+		sensor_height = 480;
+		set_sensor_window(sensor_hstart, sensor_vstart, sensor_width, sensor_height);
+		hal_imgsensor_read_register(DSPAUTO, &reg);
+		hal_imgsensor_write_register(DSPAUTO, reg & ~(SCAL0_ACTRL | SCAL1_2_ACTRL));
+		hal_imgsensor_write_register(SCAL0, 0x00);
+		hal_imgsensor_write_register(SCAL1, 0x40);
+		hal_imgsensor_write_register(SCAL2, 0x40);
+	}
+	set_output_size(width, height);
+	hal_imgsensor_set_crop(0, 0, 0, 0);
+	out_width = width;
+	out_height = height;
+	return IMGSENSOR_SUCCESS;
+}
+
+//--------------------------------------------
+// Changes the output image size and format
+// width, height: up to 640 x 480, the QVGA or VGA sensor window is scaled down by the DSP
+// format: IMGSENSOR_FORMAT_RGB565 or IMGSENSOR_FORMAT_YUV422
+uint8_t ov7725_set_format(uint16_t width, uint16_t height, uint8_t format)
+{
+	uint8_t reg;
+
+	if (!width || !height || width > 640 || height > 480)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	hal_imgsensor_read_register(COM7, &reg);
+	reg &= ~(FMT_MASK | OFMT_MASK);
+	if (format == IMGSENSOR_FORMAT_RGB565)
+	{
+		reg |= FMT_RGB565 | OFMT_RGB;
+	}
+	else
+	{
+		reg |= OFMT_YUV;
+	}
+	hal_imgsensor_write_register(COM7, reg);
+	return ov7725_set_scale(width, height);
+}
+
+//--------------------------------------------
+// Captures only the window of the output image (set by ov7725_set_format() or ov7725_set_scale()):
+// the sensor window and the output size are narrowed to the pixel pairs covering it
+// (the scaling ratio is kept), DCMI crops the rest.
+// width = 0 or height = 0: the full image
+uint8_t ov7725_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	uint16_t x_pair;
+	uint16_t width_pair;
+	uint16_t hstart;
+	uint16_t vstart;
+
+	if (!out_width || x + width > out_width || y + height > out_height)
+	{
+		return IMGSENSOR_FAIL;
+	}
+	if (!width || !height)
+	{
+		set_sensor_window(sensor_hstart, sensor_vstart, sensor_width, sensor_height);
+		set_output_size(out_width, out_height);
+		hal_imgsensor_set_crop(0, 0, 0, 0);
+		return IMGSENSOR_SUCCESS;
+	}
+	// The YUV422 output starts with the whole pixel pair
+	x_pair = x & ~1;
+	width_pair = ((x + width + 1) & ~1) - x_pair;
+	hstart = sensor_hstart + (uint32_t)x_pair * sensor_width / out_width;
+	vstart = sensor_vstart + (uint32_t)y * sensor_height / out_height;
+	set_sensor_window(hstart, vstart, (uint32_t)width_pair * sensor_width / out_width, (uint32_t)height * sensor_height / out_height);
+	set_output_size(width_pair, height);
+	hal_imgsensor_set_crop(x - x_pair, 0, width, height);
+	return IMGSENSOR_SUCCESS;
+}
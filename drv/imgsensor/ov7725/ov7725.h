@@ -17,5 +17,8 @@
 
 void ov7725_init(uint8_t little_endian);
 uint32_t ov7725_read_dma_buf(uint8_t *rxbuf, uint32_t length);
+uint8_t ov7725_set_format(uint16_t width, uint16_t height, uint8_t format);
+uint8_t ov7725_set_scale(uint16_t width, uint16_t height);
+uint8_t ov7725_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 
 #endif // OV7725_H_
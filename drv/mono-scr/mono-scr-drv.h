@@ -21,6 +21,7 @@ typedef struct mono_scr_drv
 	uint8_t* (*buf) (void);
 	void (*init) (void);
 	void (*flush) (void);
+	void (*flush_area) (uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last);
 } mono_scr_drv_t;
 
 #endif // MONO_SCR_DRV_H_
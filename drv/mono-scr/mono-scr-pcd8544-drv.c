@@ -24,5 +24,6 @@ const mono_scr_drv_t scr_drv =
 	PCD8544_SCR_H,
 	pcd8544_getbufaddr,
 	pcd8544_init,
-	pcd8544_flush
+	pcd8544_flush,
+	pcd8544_flush_area
 };
@@ -24,5 +24,6 @@ const mono_scr_drv_t scr_drv =
 	SSD1306_SCR_H,
 	ssd1306_getbufaddr,
 	ssd1306_init,
-	ssd1306_flush
+	ssd1306_flush,
+	ssd1306_flush_area
 };
@@ -49,28 +49,24 @@ void pcd8544_init(void)
 }
 
 //--------------------------------------------
-void pcd8544_flush(void)
+void pcd8544_flush_area(uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last)
 {
-	uint8_t col;
 	uint8_t bank;
 
 	hal_pcd8544_select();
 
-	for (bank = 0; bank < 6; bank++)
+	for (bank = page_first; bank <= page_last; bank++)
 	{
 		// Set Y address of RAM (0 <= Y <= 5)
 		pcd8544_command(PCD8544_SETYADDR | bank);
 		// Set X address of RAM (0 <= X <= 83)
-		pcd8544_command(PCD8544_SETXADDR | 0x00);
+		pcd8544_command(PCD8544_SETXADDR | col_first);
 
 		// waiting for the end of the transfer
 		delay_us(3);
 		hal_pcd8544_data();
 
-		for (col = 0; col < PCD8544_SCR_W; col++)
-		{
-			hal_pcd8544_tx(buf[(PCD8544_SCR_W * bank) + col]);
-		}
+		hal_pcd8544_tx_block(&buf[(PCD8544_SCR_W * bank) + col_first], col_last - col_first + 1);
 	}
 	pcd8544_command(PCD8544_SETYADDR);
 
@@ -79,6 +75,12 @@ void pcd8544_flush(void)
 	hal_pcd8544_release();
 }
 
+//--------------------------------------------
+void pcd8544_flush(void)
+{
+	pcd8544_flush_area(0, PCD8544_SCR_W - 1, 0, (PCD8544_SCR_H / 8) - 1);
+}
+
 //--------------------------------------------
 uint8_t* pcd8544_getbufaddr(void)
 {
@@ -17,6 +17,7 @@
 
 void pcd8544_init(void);
 void pcd8544_flush(void);
+void pcd8544_flush_area(uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last);
 uint8_t* pcd8544_getbufaddr(void);
 
 #endif // PCD8544_H_
@@ -97,27 +97,42 @@ void ssd1306_init(void)
 }
 
 //--------------------------------------------
-void ssd1306_flush(void)
+void ssd1306_flush_area(uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last)
 {
-	uint16_t cnt;
+	uint8_t page;
 
 	// 10.1.4 Set Column Address (21h)
 	hal_ssd1306_command(SSD1306_SET_COL);
-	hal_ssd1306_command(0x00);
-	hal_ssd1306_command(SSD1306_SCR_W - 1);
+	hal_ssd1306_command(col_first);
+	hal_ssd1306_command(col_last);
 	// 10.1.5 Set Page Address (22h)
 	hal_ssd1306_command(SSD1306_SET_PAGE);
-	hal_ssd1306_command(0x00);
-	hal_ssd1306_command((SSD1306_SCR_H / 8) - 1);
+	hal_ssd1306_command(page_first);
+	hal_ssd1306_command(page_last);
 
+	// Horizontal addressing mode: the column address wraps to col_first
+	// and the page address is incremented at the end of every window row
 	hal_ssd1306_startdata();
-	for (cnt = 0; cnt < sizeof(buf); cnt++)
+	if ((col_first == 0) && (col_last == SSD1306_SCR_W - 1))
+	{
+		hal_ssd1306_data_block(&buf[page_first * SSD1306_SCR_W], (page_last - page_first + 1) * SSD1306_SCR_W);
+	}
+	else
 	{
-		hal_ssd1306_data(buf[cnt]);
+		for (page = page_first; page <= page_last; page++)
+		{
+			hal_ssd1306_data_block(&buf[page * SSD1306_SCR_W + col_first], col_last - col_first + 1);
+		}
 	}
 	hal_ssd1306_stopdata();
 }
 
+//--------------------------------------------
+void ssd1306_flush(void)
+{
+	ssd1306_flush_area(0, SSD1306_SCR_W - 1, 0, (SSD1306_SCR_H / 8) - 1);
+}
+
 //--------------------------------------------
 uint8_t* ssd1306_getbufaddr(void)
 {
@@ -17,6 +17,7 @@
 
 void ssd1306_init(void);
 void ssd1306_flush(void);
+void ssd1306_flush_area(uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last);
 uint8_t* ssd1306_getbufaddr(void);
 
 #endif // SSD1306_H_
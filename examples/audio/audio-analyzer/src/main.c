@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-in-drv.h"
+#include "audio-analyzer.h"
+#include <stdio.h>
+#include <math.h>
+
+//--------------------------------------------
+// The FFT is checked against the double precision DFT of the test frame first,
+// then the I2S input is metered and analyzed: the peak and RMS levels of both channels,
+// the octave bands of the left channel and the CPU load are printed twice per second.
+
+//--------------------------------------------
+#if I2S_BITRES == 16
+#error "The analyzer takes the 32-bit samples, use I2S_BITRES 24 or 32."
+#endif
+#define AUDIO_SAMPLE_RATE               I2S_FCLK
+#define AUDIO_CHANNELS                  2
+// 2 x 1 ms of the 32-bit stereo samples
+#define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000)
+#define DMA_BUFFER_SIZE                 (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * 4 * 2)
+#define FFT_SIZE                        1024
+#define CHECK_SIZE                      256
+#define PRINT_PERIOD                    500
+#define PI                              3.14159265358979
+
+//--------------------------------------------
+extern const audio_in_drv_t audio_in_drv;
+
+//--------------------------------------------
+static uint32_t dma_buff[DMA_BUFFER_SIZE / 4];
+static uint32_t analyzer_buff[AUDIO_ANALYZER_BUF_SIZE(FFT_SIZE) / 4];
+static int32_t check_frame[CHECK_SIZE];
+// The octave band centers, Hz
+static const uint16_t bands[] = { 31, 63, 125, 250, 500, 1000, 2000, 4000, 8000, 16000 };
+
+//--------------------------------------------
+static void rx_half_callback(uint8_t half)
+{
+	uint32_t *buf;
+
+	buf = dma_buff + half * DMA_BUFFER_SIZE / 2 / 4;
+	audio_in_drv.convert(buf, buf, DMA_BUFFER_SIZE / 2 / 4);
+	audio_analyzer_put(buf, DMA_BUFFER_SIZE / 2 / 4 / AUDIO_CHANNELS);
+}
+
+//--------------------------------------------
+// Returns the largest error of the power spectrum relative to the peak power, 0.1 dB
+static int16_t check_fft(void)
+{
+	const float *power;
+	double re, im, w, err, err_max, peak;
+	uint16_t n, k;
+
+	audio_analyzer_init(analyzer_buff, CHECK_SIZE, AUDIO_SAMPLE_RATE, 1);
+	// -6 dBFS on the bin 10 and -20 dBFS between the bins 40 and 41
+	for (n = 0; n < CHECK_SIZE; n++)
+	{
+		check_frame[n] = (int32_t)(1073741824.0 * cos(2 * PI * 10 * n / CHECK_SIZE) +
+			214748364.0 * sin(2 * PI * 40.5 * n / CHECK_SIZE));
+	}
+	power = audio_analyzer_transform(check_frame);
+	for (k = 0, err_max = 0, peak = 0; k <= CHECK_SIZE / 2; k++)
+	{
+		for (n = 0, re = 0, im = 0; n < CHECK_SIZE; n++)
+		{
+			w = (0.5 - 0.5 * cos(2 * PI * n / CHECK_SIZE)) * 4 / CHECK_SIZE / 2147483648.0 * check_frame[n];
+			re += w * cos(2 * PI * k * n / CHECK_SIZE);
+			im -= w * sin(2 * PI * k * n / CHECK_SIZE);
+		}
+		err = fabs((double)power[k] - (re * re + im * im));
+		if (err > err_max)
+		{
+			err_max = err;
+		}
+		if (re * re + im * im > peak)
+		{
+			peak = re * re + im * im;
+		}
+	}
+	return (err_max > 0) ? (int16_t)(100 * log10(err_max / peak)) : AUDIO_ANALYZER_LEVEL_MIN;
+}
+
+//--------------------------------------------
+void main(void)
+{
+	audio_analyzer_stats_t stats;
+	uint32_t start;
+	int16_t peak, rms;
+	uint8_t cnt;
+
+	platform_init();
+
+	printf("FFT error: %d dB of the peak (double precision DFT)\n", check_fft() / 10);
+
+	audio_analyzer_init(analyzer_buff, FFT_SIZE, AUDIO_SAMPLE_RATE, AUDIO_CHANNELS);
+	audio_in_drv.init();
+	audio_in_drv.init_dma_rxbuf_cycle(rx_half_callback);
+	audio_in_drv.read_dma_rxbuf(dma_buff, sizeof(dma_buff));
+	start = get_platform_counter();
+	while (1)
+	{
+		// one FFT pass per call
+		audio_analyzer_process();
+		if (get_platform_counter() - start < PRINT_PERIOD)
+		{
+			continue;
+		}
+		start += PRINT_PERIOD;
+		for (cnt = 0; cnt < AUDIO_CHANNELS; cnt++)
+		{
+			audio_analyzer_get_levels(cnt, &peak, &rms);
+			printf("%c: peak %4d rms %4d  ", cnt ? 'R' : 'L', peak / 10, rms / 10);
+		}
+		printf("dBFS\n");
+		for (cnt = 0; cnt < sizeof(bands) / sizeof(bands[0]); cnt++)
+		{
+			// the octave: center / sqrt(2) ... center * sqrt(2)
+			printf("%6d", audio_analyzer_get_band(bands[cnt] * 181 / 256, bands[cnt] * 181 / 128) / 10);
+		}
+		printf("\n");
+		audio_analyzer_get_stats(&stats);
+		printf("put: %lu.%02lu cycles/frame, fft: %lu cycles, spectra: %lu, skipped: %lu, load: %lu.%02lu %%\n",
+			stats.put_cycles / 100, stats.put_cycles % 100, stats.fft_cycles, stats.spectra, stats.skipped,
+			stats.load / 100, stats.load % 100);
+	}
+}
@@ -0,0 +1,188 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-conv.h"
+#include <string.h>
+#include <stdio.h>
+
+//--------------------------------------------
+// Every 16-bit kernel is run on the same random samples by the reference and the DSP implementations,
+// the results are compared and the number of CPU cycles per sample (DWT cycle counter) is printed.
+// The CPU cycles of the 32-bit and 24-bit kernels are printed after them.
+
+//--------------------------------------------
+// 1 ms of the 48 kHz stereo stream
+#define SAMPLES  96
+#define RUNS     64
+// The Q15 gain of the volume kernels (-6 dB)
+#define GAIN     16423
+
+//--------------------------------------------
+static uint32_t src_buf[SAMPLES];
+static uint32_t ref_buf[SAMPLES * 2];
+static uint32_t dsp_buf[SAMPLES * 2];
+
+//--------------------------------------------
+static void conv_32to16_ref(void)
+{
+	audio_conv_32to16_ref(src_buf, (int16_t *)ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void conv_32to16_dsp(void)
+{
+	audio_conv_32to16_dsp(src_buf, (int16_t *)dsp_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void mono_to_stereo16_ref(void)
+{
+	audio_conv_mono_to_stereo16_ref((const int16_t *)src_buf, (int16_t *)ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void mono_to_stereo16_dsp(void)
+{
+	audio_conv_mono_to_stereo16_dsp((const int16_t *)src_buf, (int16_t *)dsp_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void stereo_to_mono16_ref(void)
+{
+	audio_conv_stereo_to_mono16_ref((const int16_t *)src_buf, (int16_t *)ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void stereo_to_mono16_dsp(void)
+{
+	audio_conv_stereo_to_mono16_dsp((const int16_t *)src_buf, (int16_t *)dsp_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void volume16_ref(void)
+{
+	audio_conv_volume16_ref((const int16_t *)src_buf, (int16_t *)ref_buf, SAMPLES, GAIN);
+}
+
+//--------------------------------------------
+static void volume16_dsp(void)
+{
+	audio_conv_volume16_dsp((const int16_t *)src_buf, (int16_t *)dsp_buf, SAMPLES, GAIN);
+}
+
+//--------------------------------------------
+static void swap16(void)
+{
+	audio_conv_swap16(src_buf, ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void conv_16to32(void)
+{
+	audio_conv_16to32((const int16_t *)src_buf, ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void conv_32to24(void)
+{
+	audio_conv_32to24(src_buf, (uint8_t *)ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void conv_24to32(void)
+{
+	audio_conv_24to32((const uint8_t *)src_buf, ref_buf, SAMPLES);
+}
+
+//--------------------------------------------
+static void volume32(void)
+{
+	audio_conv_volume32(src_buf, ref_buf, SAMPLES, GAIN);
+}
+
+//--------------------------------------------
+typedef struct kernel
+{
+	const char *name;
+	void (*ref)(void);
+	void (*dsp)(void);
+	uint32_t dst_size;
+} kernel_t;
+
+static const kernel_t kernels[] =
+{
+	{ "32 -> 16", conv_32to16_ref, conv_32to16_dsp, SAMPLES * 2 },
+	{ "mono -> stereo 16", mono_to_stereo16_ref, mono_to_stereo16_dsp, SAMPLES * 4 },
+	{ "stereo -> mono 16", stereo_to_mono16_ref, stereo_to_mono16_dsp, SAMPLES },
+	{ "volume 16", volume16_ref, volume16_dsp, SAMPLES * 2 },
+	{ "swap16", swap16, NULL, 0 },
+	{ "16 -> 32", conv_16to32, NULL, 0 },
+	{ "32 -> 24", conv_32to24, NULL, 0 },
+	{ "24 -> 32", conv_24to32, NULL, 0 },
+	{ "volume 32", volume32, NULL, 0 },
+};
+
+//--------------------------------------------
+// returns: CPU cycles per sample * 100
+static uint32_t bench(void (*kernel)(void))
+{
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t cnt;
+
+	kernel(); // the code and data are in the cache
+	start = DWT->CYCCNT;
+	for (cnt = 0; cnt < RUNS; cnt++)
+	{
+		kernel();
+	}
+	cycles = DWT->CYCCNT - start;
+	return cycles * 100 / (RUNS * SAMPLES);
+}
+
+//--------------------------------------------
+int main(void)
+{
+	uint32_t cnt;
+	uint32_t seed;
+	uint32_t ref, dsp;
+	uint8_t exact;
+
+	platform_init();
+
+	for (cnt = 0, seed = 1; cnt < SAMPLES; cnt++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		src_buf[cnt] = seed;
+	}
+
+	printf("%d samples, CPU cycles per sample:\n", SAMPLES);
+	for (cnt = 0; cnt < sizeof(kernels) / sizeof(kernels[0]); cnt++)
+	{
+		memset(ref_buf, 0, sizeof(ref_buf));
+		memset(dsp_buf, 0xFF, sizeof(dsp_buf));
+		ref = bench(kernels[cnt].ref);
+		if (!kernels[cnt].dsp)
+		{
+			printf("%-20s %lu.%02lu\n", kernels[cnt].name, ref / 100, ref % 100);
+			continue;
+		}
+		dsp = bench(kernels[cnt].dsp);
+		exact = !memcmp(ref_buf, dsp_buf, kernels[cnt].dst_size);
+		printf("%-20s ref: %lu.%02lu, dsp: %lu.%02lu, %s\n", kernels[cnt].name,
+			ref / 100, ref % 100, dsp / 100, dsp % 100, exact ? "bit-exact" : "MISMATCH");
+	}
+
+	for (;;);
+}
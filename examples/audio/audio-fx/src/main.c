@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-fx.h"
+#include <stdio.h>
+
+//--------------------------------------------
+// The effects chain is run on the random stereo samples with 0 ... AUDIO_FX_BANDS EQ bands,
+// the CPU cycles per frame of every stage (DWT cycle counter) are printed
+// with the number of the bands fitting the frame budget of the 48 kHz and 192 kHz streams.
+
+//--------------------------------------------
+// 1 ms of the 48 kHz stereo stream
+#define FRAMES   48
+#define CHANNELS 2
+#define RUNS     64
+
+//--------------------------------------------
+static int32_t buf[FRAMES * CHANNELS];
+static audio_fx_t fx;
+
+//--------------------------------------------
+static void fill(void)
+{
+	static uint32_t seed = 1;
+	uint32_t cnt;
+
+	for (cnt = 0; cnt < FRAMES * CHANNELS; cnt++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		// -6 dBFS noise, so the boosted bands drive the limiter
+		buf[cnt] = (int32_t)seed >> 1;
+	}
+}
+
+//--------------------------------------------
+int main(void)
+{
+	uint32_t cnt;
+	uint32_t total;
+	uint32_t gain, eq, limiter;
+	uint8_t bands;
+
+	platform_init();
+
+	audio_fx_init(&fx, 48000, CHANNELS);
+	for (cnt = 0; cnt < AUDIO_FX_BANDS; cnt++)
+	{
+		audio_fx_set_band(&fx, (uint8_t)cnt, AUDIO_FX_PEAK, 50.0f * (2 << cnt), 1.0f, 3.0f);
+	}
+	audio_fx_set_volume(&fx, -3 * 256);
+	audio_fx_set_limiter(&fx, -256, 50);
+
+	printf("%d frames, CPU cycles per frame (%lu MHz):\n", FRAMES, SystemCoreClock / 1000000);
+	printf("bands     gain      eq   limiter     total\n");
+	for (bands = 0; bands <= AUDIO_FX_BANDS; bands++)
+	{
+		audio_fx_set_bands(&fx, bands);
+		audio_fx_reset(&fx);
+		fill();
+		audio_fx_process(&fx, buf, FRAMES); // the code and data are in the cache
+		audio_fx_reset_cycles(&fx);
+		for (cnt = 0; cnt < RUNS; cnt++)
+		{
+			fill();
+			audio_fx_process(&fx, buf, FRAMES);
+		}
+		gain = audio_fx_get_cycles(&fx, AUDIO_FX_STAGE_GAIN);
+		eq = audio_fx_get_cycles(&fx, AUDIO_FX_STAGE_EQ);
+		limiter = audio_fx_get_cycles(&fx, AUDIO_FX_STAGE_LIMITER);
+		total = gain + eq + limiter;
+		printf("%5u %5lu.%02lu %5lu.%02lu %5lu.%02lu %5lu.%02lu\n", bands,
+			gain / 100, gain % 100, eq / 100, eq % 100,
+			limiter / 100, limiter % 100, total / 100, total % 100);
+	}
+	// The last row: all the bands
+	eq = eq / AUDIO_FX_BANDS;
+	total = gain + limiter;
+	printf("CPU cycles per frame: 48 kHz: %lu, 192 kHz: %lu\n", SystemCoreClock / 48000, SystemCoreClock / 192000);
+	printf("bands per full CPU load: 48 kHz: %lu, 192 kHz: %lu\n",
+		(SystemCoreClock / 48000 * 100 > total) ? (SystemCoreClock / 48000 * 100 - total) / eq : 0,
+		(SystemCoreClock / 192000 * 100 > total) ? (SystemCoreClock / 192000 * 100 - total) / eq : 0);
+
+	for (;;);
+}
@@ -14,6 +14,8 @@
 
 #include "platform.h"
 #include "audio-in-drv.h"
+#include "audio-ring.h"
+#include "audio-conv.h"
 
 //--------------------------------------------
 extern const audio_in_drv_t audio_in_drv;
@@ -29,52 +31,50 @@ extern const audio_in_drv_t audio_in_drv;
 #define AUDIO_CHANNELS                  1
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000)
 #define BYTES_PER_AUDIO_FRAME           (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE)
-#define AUDIO_FRAMES_IN_BUFFER          2
+#define AUDIO_FRAMES_IN_BUFFER          4
 
 #define SOUND_SIZE                      60000
 
 //--------------------------------------------
-static uint8_t i2s_cnt;
 static uint32_t total_i2s_cnt;
-static uint32_t buff[AUDIO_FRAMES_IN_BUFFER][BYTES_PER_AUDIO_FRAME / 4];
+static uint32_t buff[AUDIO_FRAMES_IN_BUFFER * BYTES_PER_AUDIO_FRAME / 4];
 static uint32_t sound[SOUND_SIZE];
+static audio_ring_t ring;
 
 //--------------------------------------------
-static void rx_complete_callback(void);
-
-//--------------------------------------------
-void main(void)
+static void rx_half_callback(uint8_t half)
 {
-	platform_init();
-	audio_in_drv.init();
-	audio_in_drv.init_dma_rxbuf(rx_complete_callback);
-	audio_in_drv.read_dma_rxbuf(&buff[i2s_cnt][0], BYTES_PER_AUDIO_FRAME);
-	while (1);
+	audio_ring_dma_callback(&ring, half);
 }
 
 //--------------------------------------------
-static void rx_complete_callback(void)
+void main(void)
 {
-	static int stop;
 	uint32_t *buf32;
-	buf32 = (uint32_t *)&buff[i2s_cnt][0];
-	++i2s_cnt;
-	if (i2s_cnt == AUDIO_FRAMES_IN_BUFFER)
-	{
-		i2s_cnt = 0;
-	}
-	if (!stop)
+	uint32_t length;
+	uint32_t frames;
+
+	platform_init();
+	audio_in_drv.init();
+	audio_in_drv.init_dma_rxbuf_cycle(rx_half_callback);
+	audio_ring_init(&ring, AUDIO_RING_RX, buff, sizeof(buff), audio_in_drv.get_dma_rxbuf_remain);
+	audio_in_drv.read_dma_rxbuf(buff, sizeof(buff));
+	while (total_i2s_cnt < SOUND_SIZE)
 	{
-		audio_in_drv.read_dma_rxbuf(&buff[i2s_cnt][0], BYTES_PER_AUDIO_FRAME);
-		for (uint32_t cnt = 0; cnt < BYTES_PER_AUDIO_FRAME / sizeof(uint32_t); cnt += 2)
+		// the received halves are read in place
+		buf32 = (uint32_t *)audio_ring_get_read_ptr(&ring, &length);
+		length -= length % (2 * sizeof(uint32_t));
+		// the left channel
+		frames = length / (2 * sizeof(uint32_t));
+		if (frames > SOUND_SIZE - total_i2s_cnt)
 		{
-			audio_in_drv.convert(&buf32[cnt], &sound[total_i2s_cnt]);
-			if (total_i2s_cnt == SOUND_SIZE)
-			{
-				stop = 1;
-				return;
-			}
-			++total_i2s_cnt;
+			frames = SOUND_SIZE - total_i2s_cnt;
 		}
+		audio_conv_stereo_to_mono32(buf32, &sound[total_i2s_cnt], frames);
+		audio_in_drv.convert(&sound[total_i2s_cnt], &sound[total_i2s_cnt], frames);
+		total_i2s_cnt += frames;
+		audio_ring_commit_read(&ring, length);
 	}
+	audio_in_drv.stop_dma_rxbuf();
+	while (1);
 }
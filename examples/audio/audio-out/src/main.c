@@ -14,7 +14,7 @@
 
 #include "platform.h"
 #include "audio-out-drv.h"
-#include <string.h>
+#include "audio-ring.h"
 #include <math.h>
 
 //--------------------------------------------
@@ -31,7 +31,7 @@ extern const audio_out_drv_t audio_out_drv;
 #define AUDIO_CHANNELS                  2
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000)
 #define BYTES_PER_AUDIO_FRAME           (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE)
-#define AUDIO_FRAMES_IN_BUFFER          2
+#define AUDIO_FRAMES_IN_BUFFER          4
 
 //--------------------------------------------
 #define SOUND_SIZE_32                  (AUDIO_SAMPLE_RATE * BYTES_PER_AUDIO_SAMPLE / sizeof(uint32_t))
@@ -41,20 +41,35 @@ extern const audio_out_drv_t audio_out_drv;
 #define FREQ_HZ                        2000.0
 
 //--------------------------------------------
-static uint8_t i2s_cnt;
-static uint32_t total_i2s_cnt;
-static uint32_t buff[AUDIO_FRAMES_IN_BUFFER][BYTES_PER_AUDIO_FRAME / 4];
+static uint32_t sound_pos;
+static uint32_t buff[AUDIO_FRAMES_IN_BUFFER * BYTES_PER_AUDIO_FRAME / 4];
 static uint32_t sound[SOUND_SIZE_32];
+static audio_ring_t ring;
 
 //--------------------------------------------
-static void tx_complete_callback(void);
+static void tx_half_callback(uint8_t half)
+{
+	audio_ring_dma_callback(&ring, half);
+}
+
+//--------------------------------------------
+// The ring is filled up to the DMA position
+static void sound_write(void)
+{
+	sound_pos += audio_ring_write(&ring, (uint8_t *)sound + sound_pos, sizeof(sound) - sound_pos);
+	if (sound_pos == sizeof(sound))
+	{
+		sound_pos = 0;
+	}
+}
 
 //--------------------------------------------
 void main(void)
 {
 	platform_init();
 	audio_out_drv.init();
-	audio_out_drv.init_dma_txbuf(tx_complete_callback);
+	audio_out_drv.init_dma_txbuf_cycle(tx_half_callback);
+	audio_ring_init(&ring, AUDIO_RING_TX, buff, sizeof(buff), audio_out_drv.get_dma_txbuf_remain);
 
 #if BYTES_PER_AUDIO_SAMPLE == 2
 	uint16_t *buf16 = (uint16_t *)sound;
@@ -73,24 +88,10 @@ void main(void)
     }
 #endif
 
-	memcpy(&buff[i2s_cnt][0], &sound[0], BYTES_PER_AUDIO_FRAME);
-	tx_complete_callback();
-	while (1);
-}
-
-//--------------------------------------------
-static void tx_complete_callback(void)
-{
-	audio_out_drv.write_dma_txbuf(&buff[i2s_cnt][0], BYTES_PER_AUDIO_FRAME);
-	++i2s_cnt;
-	if (i2s_cnt == AUDIO_FRAMES_IN_BUFFER)
-	{
-		i2s_cnt = 0;
-	}
-	total_i2s_cnt += BYTES_PER_AUDIO_FRAME;
-	if (total_i2s_cnt == sizeof(sound))
+	sound_write();
+	audio_out_drv.write_dma_txbuf(buff, sizeof(buff));
+	while (1)
 	{
-		total_i2s_cnt = 0;
+		sound_write();
 	}
-	memcpy(&buff[i2s_cnt][0], &sound[total_i2s_cnt / sizeof(uint32_t)], BYTES_PER_AUDIO_FRAME);
 }
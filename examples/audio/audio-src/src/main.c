@@ -0,0 +1,171 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "audio-ring.h"
+#include "audio-src.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+//--------------------------------------------
+// The -1 dBFS sine is converted by the reference and the DSP implementations
+// for every rate pair, the results are compared, the number of CPU cycles
+// per output frame (DWT cycle counter) and THD+N of the output are printed.
+
+//--------------------------------------------
+#define TONE         1000
+#define AMPLITUDE    29204.0f
+#define IN_FRAMES    2048
+#define OUT_FRAMES   2048
+// The output frames of the filter transient
+#define SKIP         (AUDIO_SRC_TAPS * 2)
+#define RUNS         4
+// 2 pi / 2^32
+#define PHASE_TO_RAD 1.4629180792671596e-9f
+
+//--------------------------------------------
+// Interleaved L/R samples
+static int16_t in_buf[IN_FRAMES * 2];
+static int16_t ref_buf[OUT_FRAMES * 2];
+static int16_t dsp_buf[OUT_FRAMES * 2];
+static audio_src_t src;
+
+//--------------------------------------------
+typedef struct conversion
+{
+	uint32_t rate_in;
+	uint32_t rate_out;
+	int32_t ppm;
+} conversion_t;
+
+static const conversion_t conversions[] =
+{
+	{ 44100, 48000, 0 },
+	{ 48000, 44100, 0 },
+	{ 48000, 48000, 100 },
+	{ 44100, 44100, -300 },
+};
+
+typedef uint32_t (*process_t)(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames);
+
+//--------------------------------------------
+static void generate(uint32_t rate)
+{
+	uint32_t phase;
+	uint32_t inc;
+	uint32_t cnt;
+
+	inc = (uint32_t)(((uint64_t)TONE << 32) / rate);
+	for (cnt = 0, phase = 0; cnt < IN_FRAMES; cnt++, phase += inc)
+	{
+		in_buf[cnt * 2] = (int16_t)lrintf(AMPLITUDE * sinf((float)phase * PHASE_TO_RAD));
+		in_buf[cnt * 2 + 1] = -in_buf[cnt * 2];
+	}
+}
+
+//--------------------------------------------
+// returns: CPU cycles per output frame * 100
+static uint32_t bench(const conversion_t *conv, process_t process, int16_t *out, uint32_t *frames)
+{
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t used;
+	uint32_t cnt;
+
+	for (cycles = 0, cnt = 0; cnt < RUNS; cnt++)
+	{
+		audio_src_init(&src, conv->rate_in, conv->rate_out);
+		audio_src_trim(&src, conv->ppm);
+		used = IN_FRAMES;
+		start = DWT->CYCCNT;
+		*frames = process(&src, in_buf, &used, out, OUT_FRAMES);
+		cycles += DWT->CYCCNT - start;
+	}
+	return cycles * 100 / (RUNS * *frames);
+}
+
+//--------------------------------------------
+// The left channel is fitted by the sine of the tone frequency (least squares),
+// the output rate is the one of the converter step.
+// returns: THD+N in dB * 10
+static int32_t thdn(const conversion_t *conv, const int16_t *out, uint32_t frames)
+{
+	float sum_ss, sum_cc, sum_sc, sum_ys, sum_yc;
+	float a, b, d, s, c, e;
+	float signal, noise;
+	uint32_t phase;
+	uint32_t inc;
+	uint32_t cnt;
+
+	// the tone phase increment per output frame
+	inc = (uint32_t)(((uint64_t)TONE * src.step << 8) / conv->rate_in);
+
+	sum_ss = sum_cc = sum_sc = sum_ys = sum_yc = 0;
+	for (cnt = SKIP, phase = SKIP * inc; cnt < frames; cnt++, phase += inc)
+	{
+		s = sinf((float)phase * PHASE_TO_RAD);
+		c = cosf((float)phase * PHASE_TO_RAD);
+		sum_ss += s * s;
+		sum_cc += c * c;
+		sum_sc += s * c;
+		sum_ys += out[cnt * 2] * s;
+		sum_yc += out[cnt * 2] * c;
+	}
+	d = sum_ss * sum_cc - sum_sc * sum_sc;
+	a = (sum_ys * sum_cc - sum_yc * sum_sc) / d;
+	b = (sum_yc * sum_ss - sum_ys * sum_sc) / d;
+
+	signal = noise = 0;
+	for (cnt = SKIP, phase = SKIP * inc; cnt < frames; cnt++, phase += inc)
+	{
+		s = a * sinf((float)phase * PHASE_TO_RAD) +
+			b * cosf((float)phase * PHASE_TO_RAD);
+		e = out[cnt * 2] - s;
+		signal += s * s;
+		noise += e * e;
+	}
+	return (int32_t)lrintf(100.0f * log10f(noise / signal));
+}
+
+//--------------------------------------------
+int main(void)
+{
+	const conversion_t *conv;
+	uint32_t ref_frames, dsp_frames;
+	uint32_t ref, dsp;
+	int32_t db;
+	uint32_t cnt;
+	uint8_t exact;
+
+	platform_init();
+
+	printf("%d Hz sine, CPU cycles per output frame:\n", TONE);
+	for (cnt = 0; cnt < sizeof(conversions) / sizeof(conversions[0]); cnt++)
+	{
+		conv = &conversions[cnt];
+		generate(conv->rate_in);
+		memset(ref_buf, 0, sizeof(ref_buf));
+		memset(dsp_buf, 0xFF, sizeof(dsp_buf));
+		ref = bench(conv, audio_src_process_ref, ref_buf, &ref_frames);
+		dsp = bench(conv, audio_src_process_dsp, dsp_buf, &dsp_frames);
+		exact = ref_frames == dsp_frames && !memcmp(ref_buf, dsp_buf, ref_frames * 4);
+		db = thdn(conv, dsp_buf, dsp_frames);
+		printf("%lu -> %lu (%+ld ppm) ref: %lu.%02lu, dsp: %lu.%02lu, %s, THD+N: %s%ld.%ld dB\n",
+			conv->rate_in, conv->rate_out, conv->ppm, ref / 100, ref % 100, dsp / 100, dsp % 100,
+			exact ? "bit-exact" : "MISMATCH", (db < 0) ? "-" : "", ((db < 0) ? -db : db) / 10, ((db < 0) ? -db : db) % 10);
+	}
+
+	for (;;);
+}
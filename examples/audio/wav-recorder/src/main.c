@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include <stdio.h>
+#include "ff.h"
+#include "audio-in-drv.h"
+#include "wav-recorder.h"
+
+//--------------------------------------------
+// The I2S input is recorded to the SD card for RECORD_TIME seconds,
+// the progress is printed every second while recording
+// (the terminal output is the other work of the main loop).
+
+//--------------------------------------------
+#define RECORD_TIME                     60
+#define CHANNELS                        2
+// 2 x 1 ms of the 32-bit stereo samples
+#define DMA_BUFFER_SIZE                 (I2S_FCLK / 1000 * 2 * 4 * 2)
+// 128 KB: 227 ms of 96 kHz 24-bit stereo
+#define RING_BUFFER_SIZE                (128 * 1024)
+
+//--------------------------------------------
+extern const audio_in_drv_t audio_in_drv;
+
+//--------------------------------------------
+FATFS fatfs;
+static uint32_t dma_buff[DMA_BUFFER_SIZE / 4];
+static uint32_t ring_buff[RING_BUFFER_SIZE / 4];
+
+//--------------------------------------------
+void error(void)
+{
+	printf("Sorry! The test was failed.\n");
+	while(1);
+}
+
+//--------------------------------------------
+int recordWavFile(const char* fname)
+{
+	wav_recorder_stats_t stats;
+	uint32_t start;
+	uint32_t seconds;
+	uint8_t res;
+
+	printf("Recording %s...\r\n", fname);
+	res = wav_recorder_start(fname, I2S_FCLK, CHANNELS, I2S_BITRES, RECORD_TIME);
+	if (res != WAV_RECORDER_SUCCESS)
+	{
+		printf("wav_recorder_start() failed, res = %d\r\n", res);
+		return -1;
+	}
+
+	// the ring is written while the DMA interrupt fills it
+	start = get_platform_counter();
+	seconds = 0;
+	while (wav_recorder_process() != WAV_RECORDER_STOPPED)
+	{
+		if (get_platform_counter() - start >= (seconds + 1) * 1000)
+		{
+			seconds++;
+			wav_recorder_get_stats(&stats);
+			printf("%lu s: %lu bytes, max ring fill: %lu, overruns: %lu\r\n",
+				seconds, stats.data_size, stats.fill_max, stats.overruns);
+		}
+	}
+	res = wav_recorder_stop();
+
+	wav_recorder_get_stats(&stats);
+	printf(
+		"Write unit: %lu\r\n"
+		"Writes: %lu\r\n"
+		"Max write time: %lu ms\r\n"
+		"Max ring fill: %lu of %lu\r\n"
+		"Overruns: %lu\r\n"
+		"Data size: %lu\r\n",
+		stats.write_unit, stats.writes, stats.write_max_time, stats.fill_max, stats.ring_size,
+		stats.overruns, stats.data_size);
+	if (res != WAV_RECORDER_SUCCESS)
+	{
+		printf("Recording failed, res = %d\r\n", res);
+		return -2;
+	}
+
+	return 0;
+}
+
+//--------------------------------------------
+void main(void)
+{
+	int res;
+
+	platform_init();
+	audio_in_drv.init();
+	wav_recorder_init(dma_buff, sizeof(dma_buff), ring_buff, sizeof(ring_buff));
+
+	if (f_mount(&fatfs, "", 0) != FR_OK)
+	{
+		error();
+	}
+	else
+	{
+		printf("The SD card was successfully mounted.\n");
+	}
+
+	res = recordWavFile("record.wav");
+
+	if (res)
+	{
+		error();
+	}
+	else
+	{
+		printf("Congratulations! The test was passed.\n");
+	}
+
+	while (1);
+}
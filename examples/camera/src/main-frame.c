@@ -19,6 +19,9 @@
 #include "rgb565-colors.h"
 #include "color-scr-drv.h"
 #include "imgsensor-drv.h"
+#if defined CAM_MOTION_THRESHOLD
+#include "img-motion.h"
+#endif
 #include <stdio.h>
 
 //--------------------------------------------
@@ -33,6 +36,30 @@ extern const imgsensor_drv_t cam_drv;
 
 //--------------------------------------------
 static uint32_t buf[SIZE_IN_BYTES / sizeof(uint32_t)];
+#if defined CAM_MOTION_THRESHOLD
+static uint32_t motion_buf[IMG_MOTION_BUF_SIZE(HLINE, VLINE) / sizeof(uint32_t)];
+#endif
+
+//--------------------------------------------
+static void print_cam_stat(void)
+{
+	imgsensor_stat_t stat;
+	uint8_t bin;
+
+	cam_drv.get_stat(&stat);
+	printf("camera fps: %lu.%lu, period: %lu us, frames: %lu, consumed: %lu, skipped: %lu, recaptured: %lu, dropped: %lu, overwritten: %lu\n",
+		stat.fps_x10 / 10, stat.fps_x10 % 10, stat.frame_period / (SystemCoreClock / 1000000),
+		stat.frames, stat.consumed_frames, stat.skipped_frames, stat.recaptured_frames, stat.dropped_frames, stat.overwritten_frames);
+	printf("overruns: %lu, sync errors: %lu, dma errors: %lu, fifo errors: %lu\n",
+		stat.overruns, stat.sync_errors, stat.dma_errors, stat.fifo_errors);
+	// the latency histogram bins: 0-1, 1-2, 2-4, 4-8, 8-16, 16-32, 32-64, 64- ms
+	printf("latency, ms <1 <2 <4 <8 <16 <32 <64 >=64:");
+	for (bin = 0; bin < IMGSENSOR_LATENCY_BINS; bin++)
+	{
+		printf(" %lu", stat.latency[bin]);
+	}
+	printf("\n");
+}
 
 //--------------------------------------------
 void color_scr_test(void)
@@ -70,6 +97,8 @@ void color_scr_test(void)
 //--------------------------------------------
 int main(void)
 {
+	uint32_t time;
+
 	platform_init();
 
 #if 1
@@ -96,10 +125,15 @@ int main(void)
 	cam_drv.init(1);
 	cam_drv.init_dma_buf();
 	scr_drv.init_dma();
-	while (1)
+	for (time = get_platform_counter();;)
 	{
 		// camera => (by DMA) => memory frame buffer
 		cam_drv.read_dma_buf((uint8_t *)&buf[0], SIZE_IN_BYTES);
+		if (get_platform_counter() - time >= 1000)
+		{
+			time = get_platform_counter();
+			print_cam_stat();
+		}
 
 #if 0
 		// memory frame buffer => (by DMA) => screen
@@ -139,12 +173,48 @@ int main(void)
 	cam_drv.init(1);
 	cam_drv.init_dma_buf();
 	scr_drv.init_dma();
-	while (1)
+#if defined CAM_MOTION_THRESHOLD
+	img_motion_init((uint8_t *)motion_buf, HLINE, VLINE, IMG_MOTION_FORMAT_RGB565, CAM_MOTION_THRESHOLD);
+#endif
+	for (time = get_platform_counter();;)
 	{
 		// camera => (by DMA) => memory frame buffer
 		cam_drv.read_dma_buf((uint8_t *)&buf[0], SIZE_IN_BYTES);
+		if (get_platform_counter() - time >= 1000)
+		{
+			time = get_platform_counter();
+			print_cam_stat();
+#if defined CAM_MOTION_THRESHOLD
+			printf("motion score: %u%%\n", img_motion_get_score());
+#endif
+		}
 
-#if 1
+#if defined CAM_MOTION_THRESHOLD
+		// changed region of memory frame buffer => (by DMA) => screen
+		// Only the tiles changed since the previous frame are sent,
+		// the SPI transfer of the whole frame limits the frame rate.
+		uint16_t x, y, width, height;
+		uint32_t row;
+		uint32_t cnt;
+		uint16_t *buf16 = (uint16_t *)&buf[0];
+		if (!img_motion_process((uint8_t *)&buf[0]) || !img_motion_get_roi(&x, &y, &width, &height))
+		{
+			continue;
+		}
+		for (row = y; row < (uint32_t)y + height; row++)
+		{
+			for (cnt = row * HLINE + x; cnt < row * HLINE + x + width; cnt++)
+			{
+				buf16[cnt] = buf16[cnt] << 8 | buf16[cnt] >> 8;
+			}
+		}
+		scr_drv.set_bound_rect(x, y, x + width - 1, y + height - 1);
+		scr_drv.start_memory_write();
+		for (row = y; row < (uint32_t)y + height; row++)
+		{
+			scr_drv.write_dma((uint8_t *)&buf16[row * HLINE + x], width * 2);
+		}
+#elif 1
 		// memory frame buffer => (by DMA) => screen
 		// All pixels in the internal capture buffer is in the Little Endian format.
 		// The display ILI9341 in SPI-mode does not support the Little Endian format.
@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "scr.h"
+#include "color-scr.h"
+#include "rgb565-colors.h"
+#include "cam-pipe.h"
+#include "imgsensor-drv.h"
+#include <stdio.h>
+
+//--------------------------------------------
+extern const imgsensor_drv_t cam_drv;
+
+//--------------------------------------------
+#define HLINE 320
+#define VLINE 240
+#define LINES 4
+
+//--------------------------------------------
+static uint32_t lines_buf[CAM_PIPE_BUF_SIZE(HLINE, LINES) / sizeof(uint32_t)];
+
+//--------------------------------------------
+static void print_cam_stat(void)
+{
+	imgsensor_stat_t stat;
+	uint8_t bin;
+
+	cam_drv.get_stat(&stat);
+	printf("camera fps: %lu.%lu, period: %lu us, frames: %lu, consumed: %lu, skipped: %lu, recaptured: %lu, dropped: %lu, overwritten: %lu\n",
+		stat.fps_x10 / 10, stat.fps_x10 % 10, stat.frame_period / (SystemCoreClock / 1000000),
+		stat.frames, stat.consumed_frames, stat.skipped_frames, stat.recaptured_frames, stat.dropped_frames, stat.overwritten_frames);
+	printf("overruns: %lu, sync errors: %lu, dma errors: %lu, fifo errors: %lu\n",
+		stat.overruns, stat.sync_errors, stat.dma_errors, stat.fifo_errors);
+	// the latency histogram bins: 0-1, 1-2, 2-4, 4-8, 8-16, 16-32, 32-64, 64- ms
+	printf("latency, ms <1 <2 <4 <8 <16 <32 <64 >=64:");
+	for (bin = 0; bin < IMGSENSOR_LATENCY_BINS; bin++)
+	{
+		printf(" %lu", stat.latency[bin]);
+	}
+	printf("\n");
+}
+
+//--------------------------------------------
+int main(void)
+{
+	uint32_t time;
+	cam_pipe_stat_t stat;
+
+	platform_init();
+
+	color_scr_init(RGB565);
+	color_scr_setorientation(SCR_ORIENT_270);
+	delay_ms(25);
+	color_scr_fillscreen(RGB565_YELLOW);
+	delay_ms(25);
+
+#ifdef ILI9341_SPI
+	// The display ILI9341 in SPI-mode does not support the Little Endian format
+	// and DMA cannot swap bytes during transfer operation,
+	// so video is captured in the Big Endian format
+	cam_drv.init(0);
+#else
+	cam_drv.init(1);
+#endif
+
+	// camera => (by DMA) => line buffers => (by DMA) => screen
+	cam_pipe_init((uint8_t *)lines_buf, HLINE, VLINE, LINES);
+	cam_pipe_start(0, 0);
+
+	for (time = get_platform_counter();;)
+	{
+		cam_pipe_process();
+		if (get_platform_counter() - time >= 1000)
+		{
+			time = get_platform_counter();
+			cam_pipe_get_stat(&stat);
+			printf("fps: %lu.%lu, frames: %lu, lines: %lu, dropped lines: %lu\n",
+				stat.fps_x10 / 10, stat.fps_x10 % 10, stat.frames, stat.lines, stat.dropped_lines);
+			print_cam_stat();
+		}
+	}
+}
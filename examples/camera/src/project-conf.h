@@ -15,5 +15,10 @@
 #ifndef PROJECT_CONF_H_
 #define PROJECT_CONF_H_
 
+// The SPI display is updated with the tiles changed since the previous frame only
+// (main-frame.c, lib/image/img-motion),
+// the value is the mean absolute luma difference of the changed tile
+#define CAM_MOTION_THRESHOLD 8
+
 #endif /* PROJECT_CONF_H_ */
 
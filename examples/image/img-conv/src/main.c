@@ -0,0 +1,149 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "img-conv.h"
+#include <string.h>
+#include <stdio.h>
+
+//--------------------------------------------
+// Every kernel is run on the same random image by the reference and the DSP implementations,
+// the results are compared and the number of CPU cycles per source pixel
+// (DWT cycle counter) is printed.
+
+//--------------------------------------------
+#define WIDTH    320
+#define HEIGHT   16
+#define PIXELS   ((uint32_t)WIDTH * HEIGHT)
+#define RUNS     16
+
+//--------------------------------------------
+// 2 bytes per pixel
+static uint32_t src_buf[PIXELS / 2];
+static uint32_t ref_buf[PIXELS / 2];
+static uint32_t dsp_buf[PIXELS / 2];
+
+//--------------------------------------------
+static void yuv422_to_rgb565_ref(void)
+{
+	img_yuv422_to_rgb565_ref((const uint8_t *)src_buf, (uint16_t *)ref_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void yuv422_to_rgb565_dsp(void)
+{
+	img_yuv422_to_rgb565_dsp((const uint8_t *)src_buf, (uint16_t *)dsp_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void rgb565_swap_ref(void)
+{
+	img_rgb565_swap_ref((const uint16_t *)src_buf, (uint16_t *)ref_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void rgb565_swap_dsp(void)
+{
+	img_rgb565_swap_dsp((const uint16_t *)src_buf, (uint16_t *)dsp_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void yuv422_to_gray_ref(void)
+{
+	img_yuv422_to_gray_ref((const uint8_t *)src_buf, (uint8_t *)ref_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void yuv422_to_gray_dsp(void)
+{
+	img_yuv422_to_gray_dsp((const uint8_t *)src_buf, (uint8_t *)dsp_buf, PIXELS);
+}
+
+//--------------------------------------------
+static void downscale2x_rgb565_ref(void)
+{
+	img_downscale2x_rgb565_ref((const uint16_t *)src_buf, (uint16_t *)ref_buf, WIDTH, HEIGHT);
+}
+
+//--------------------------------------------
+static void downscale2x_rgb565_dsp(void)
+{
+	img_downscale2x_rgb565_dsp((const uint16_t *)src_buf, (uint16_t *)dsp_buf, WIDTH, HEIGHT);
+}
+
+//--------------------------------------------
+typedef struct kernel
+{
+	const char *name;
+	void (*ref)(void);
+	void (*dsp)(void);
+	uint32_t dst_size;
+} kernel_t;
+
+static const kernel_t kernels[] =
+{
+	{ "yuv422 -> rgb565", yuv422_to_rgb565_ref, yuv422_to_rgb565_dsp, PIXELS * 2 },
+	{ "rgb565 swap", rgb565_swap_ref, rgb565_swap_dsp, PIXELS * 2 },
+	{ "yuv422 -> gray", yuv422_to_gray_ref, yuv422_to_gray_dsp, PIXELS },
+	{ "rgb565 downscale 2x", downscale2x_rgb565_ref, downscale2x_rgb565_dsp, PIXELS / 2 },
+};
+
+//--------------------------------------------
+// returns: CPU cycles per pixel * 100
+static uint32_t bench(void (*kernel)(void))
+{
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t cnt;
+
+	kernel(); // the code and data are in the cache
+	start = DWT->CYCCNT;
+	for (cnt = 0; cnt < RUNS; cnt++)
+	{
+		kernel();
+	}
+	cycles = DWT->CYCCNT - start;
+	return cycles * 100 / (RUNS * PIXELS);
+}
+
+//--------------------------------------------
+int main(void)
+{
+	uint32_t cnt;
+	uint32_t seed;
+	uint32_t ref, dsp;
+	uint8_t exact;
+
+	platform_init();
+
+	for (cnt = 0, seed = 1; cnt < PIXELS / 2; cnt++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		src_buf[cnt] = seed;
+	}
+
+	printf("%d x %d pixels, CPU cycles per pixel:\n", WIDTH, HEIGHT);
+	for (cnt = 0; cnt < sizeof(kernels) / sizeof(kernels[0]); cnt++)
+	{
+		memset(ref_buf, 0, sizeof(ref_buf));
+		memset(dsp_buf, 0xFF, sizeof(dsp_buf));
+		ref = bench(kernels[cnt].ref);
+		dsp = bench(kernels[cnt].dsp);
+		exact = !memcmp(ref_buf, dsp_buf, kernels[cnt].dst_size);
+		printf("%-20s ref: %lu.%02lu, dsp: %lu.%02lu, %s\n", kernels[cnt].name,
+			ref / 100, ref % 100, dsp / 100, dsp % 100, exact ? "bit-exact" : "MISMATCH");
+	}
+
+	for (;;);
+}
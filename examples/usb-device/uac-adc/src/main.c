@@ -19,5 +19,8 @@ void main(void)
 {
 	platform_init();
 	usb_uac_i2s_init();
+#if !defined USBD_FULL_SPEED && defined UAC_LOW_LATENCY
+	usb_uac_i2s_set_profile(USB_UAC_PROFILE_LOW_LATENCY);
+#endif
 	usb_uac_i2s_loop();
 }
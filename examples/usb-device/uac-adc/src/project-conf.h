@@ -29,8 +29,10 @@
 #define USBD_VBUS_DETECT
 #endif
 
-// 1, 2?(not tested yet)
+// 1, 2?(not tested yet), 4, 8 (UAC 2.0 with the SAI TDM)
 #define I2S_CHANNELS      1
+// The SAI TDM slots: 2 (I2S), 4, 8, the first I2S_CHANNELS slots are captured
+//#define I2S_SLOTS         8
 #ifdef USBD_FULL_SPEED
 // 44100, 48000
 #define I2S_FCLK          48000
@@ -47,4 +49,13 @@
 #define UAC_BITRES        32
 #endif
 
+#ifndef USBD_FULL_SPEED
+// UAC2: the low latency profile (8 audio frames buffer) with 125 us packets (bInterval = 1),
+// the latency is returned by usb_uac_i2s_get_latency
+//#define UAC_LOW_LATENCY
+#ifdef UAC_LOW_LATENCY
+#define UAC_USB_FRAMES_PER_AUDIO_FRAME   1
+#endif
+#endif
+
 #endif /* PROJECT_CONF_H_ */
\ No newline at end of file
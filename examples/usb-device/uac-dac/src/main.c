@@ -13,11 +13,22 @@
 */
 
 #include "platform.h"
+#include "audio-fx.h"
 #include "usb-uac-i2s.h"
 
 void main(void)
 {
 	platform_init();
 	usb_uac_i2s_init();
+#ifdef UAC_EQ
+	// Loudness-like EQ with the limiter preventing the clipping of the boosted bands
+	audio_fx_set_band(usb_uac_i2s_get_fx(), 0, AUDIO_FX_LOW_SHELF, 100, 0.707f, 6.0f);
+	audio_fx_set_band(usb_uac_i2s_get_fx(), 1, AUDIO_FX_PEAK, 3000, 1.0f, -2.0f);
+	audio_fx_set_band(usb_uac_i2s_get_fx(), 2, AUDIO_FX_HIGH_SHELF, 10000, 0.707f, 4.0f);
+	audio_fx_set_limiter(usb_uac_i2s_get_fx(), -256, 50);
+#endif
+#if !defined USBD_FULL_SPEED && defined UAC_LOW_LATENCY
+	usb_uac_i2s_set_profile(USB_UAC_PROFILE_LOW_LATENCY);
+#endif
 	usb_uac_i2s_loop();
 }
@@ -29,8 +29,10 @@
 #define USBD_VBUS_DETECT
 #endif
 
-// 1?(not tested yet), 2
+// 1?(not tested yet), 2, 4, 8 (UAC 2.0 with the SAI TDM)
 #define I2S_CHANNELS      2
+// The SAI TDM slots: 2 (I2S), 4, 8, I2S_SLOTS = I2S_CHANNELS
+//#define I2S_SLOTS         8
 #ifdef USBD_FULL_SPEED
 // 44100, 48000
 #define I2S_FCLK          48000
@@ -45,4 +47,18 @@
 #define UAC_BITRES        I2S_BITRES
 #endif
 
+// The effects chain: the volume, the mute, the EQ and the limiter
+#define AUDIO_FX_CHANNELS I2S_CHANNELS
+// The EQ bands and the limiter are set by main
+//#define UAC_EQ
+
+#ifndef USBD_FULL_SPEED
+// UAC2: the low latency profile (8 audio frames buffer) with 125 us packets (bInterval = 1),
+// the latency is returned by usb_uac_i2s_get_latency
+//#define UAC_LOW_LATENCY
+#ifdef UAC_LOW_LATENCY
+#define UAC_USB_FRAMES_PER_AUDIO_FRAME   1
+#endif
+#endif
+
 #endif /* PROJECT_CONF_H_ */
\ No newline at end of file
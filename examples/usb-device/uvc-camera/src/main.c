@@ -14,10 +14,17 @@
 
 #include "platform.h"
 #include "uvc-camera.h"
+#if defined UVC_FRAMEBUF_POOL
+#include "fb-pool.h"
+#endif
 
 void main(void)
 {
 	platform_init();
+#if defined UVC_FRAMEBUF_POOL
+	// the external SDRAM is divided into the VGA (YUY2, RGB565) frame buffers
+	fb_pool_init((uint8_t *)EXT_SDRAM_ADDR, EXT_SDRAM_SIZE, FB_POOL_BLOCK_SIZE(640 * 480 * 2));
+#endif
 	usb_uvc_camera_init();
 	usb_uvc_camera_loop();
 }
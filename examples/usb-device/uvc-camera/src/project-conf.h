@@ -21,6 +21,9 @@
 
 #define USBD_SOF_DISABLED
 
+// The streaming and camera statistics are printed every 5 s
+#define UVC_STAT_PERIOD 5000
+
 #ifdef USBD_ULPI
 #define USBD_VBUS_DETECT
 #endif
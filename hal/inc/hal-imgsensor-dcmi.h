@@ -16,6 +16,7 @@
 #define HAL_OV7670_DCMI_H_
 
 #include "platform.h"
+#include "imgsensor-drv.h"
 
 void hal_imgsensor_init_capture(void);
 void hal_imgsensor_init_clock(void);
@@ -31,5 +32,16 @@ void hal_imgsensor_wait_hsync(void);
 uint32_t hal_imgsensor_read_fifo(void);
 void hal_imgsensor_start_capture(void);
 void hal_imgsensor_stop_capture(void);
+void hal_imgsensor_set_jpeg(uint8_t jpeg);
+void hal_imgsensor_set_crop(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+void hal_imgsensor_init_dma_lines(void);
+void hal_imgsensor_start_dma_lines(uint8_t *buf, uint32_t line_length, uint8_t lines);
+void hal_imgsensor_init_dma_frames(void);
+uint8_t hal_imgsensor_start_dma_frames(uint8_t *buf, uint32_t frame_length, uint8_t frames);
+uint8_t *hal_imgsensor_get_frame(uint32_t *length);
+void hal_imgsensor_release_frame(void);
+void hal_imgsensor_get_stat(imgsensor_stat_t *stat);
+void hal_imgsensor_irq_line_callback(uint8_t *line);
+void hal_imgsensor_irq_frame_callback(void);
 
 #endif // HAL_OV7670_DCMI_H_
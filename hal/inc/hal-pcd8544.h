@@ -21,5 +21,6 @@ void hal_pcd8544_release(void);
 void hal_pcd8544_command(void);
 void hal_pcd8544_data(void);
 void hal_pcd8544_tx(uint8_t data);
+void hal_pcd8544_tx_block(const uint8_t *data, uint16_t length);
 
 #endif // HAL_PCD8544_H_
@@ -17,13 +17,16 @@
 
 void hal_sai_i2s_init(void);
 void hal_sai_i2s_config(uint8_t master_transmit);
+uint8_t hal_sai_i2s_set_format(uint32_t fclk, uint8_t bitres);
 double hal_sai_i2s_get_mclk(void);
 void hal_sai_i2s_init_dma_tx_buf(void);
 void hal_sai_i2s_init_dma_rx_buf(void);
 void hal_sai_i2s_init_dma_tx_buf_cycle(void);
+void hal_sai_i2s_init_dma_rx_buf_cycle(void);
 void hal_sai_i2s_write_dma_buf(void *txbuf, uint32_t length);
 #define hal_sai_i2s_read_dma_buf hal_sai_i2s_write_dma_buf
 void hal_sai_i2s_write_dma_buf_stop(void *txbuf, uint32_t length, uint32_t timeout);
 void hal_sai_i2s_stop_dma(void);
+uint32_t hal_sai_i2s_get_dma_remain(void);
 
 #endif // HAL_SAI_I2S_H_
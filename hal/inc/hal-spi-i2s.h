@@ -18,6 +18,7 @@
 void hal_spi_i2s_init(void);
 void hal_spi_i2s_config(uint8_t master_transmit);
 void hal_spi_i2s_reset(void);
+uint8_t hal_spi_i2s_set_format(uint32_t fclk, uint8_t bitres);
 double hal_spi_i2s_get_mclk(void);
 void hal_spi_i2s_init_dma_tx_buf(void);
 void hal_spi_i2s_init_dma_rx_buf(void);
@@ -27,5 +28,8 @@ void hal_spi_i2s_write_dma_buf(void *txbuf, uint32_t length);
 void hal_spi_i2s_read_dma_buf(void *rxbuf, uint32_t length);
 void hal_spi_i2s_write_dma_buf_stop(void *txbuf, uint32_t length, uint32_t timeout);
 void hal_spi_i2s_stop_dma_tx(void);
+void hal_spi_i2s_stop_dma_rx(void);
+uint32_t hal_spi_i2s_get_dma_tx_remain(void);
+uint32_t hal_spi_i2s_get_dma_rx_remain(void);
 
 #endif // HAL_SPI_I2S_H_
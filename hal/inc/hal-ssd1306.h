@@ -23,6 +23,9 @@ void hal_ssd1306_init(void);
 void hal_ssd1306_command(uint8_t cmd);
 void hal_ssd1306_startdata(void);
 void hal_ssd1306_data(uint8_t data);
+void hal_ssd1306_data_block(const uint8_t *data, uint16_t length);
 void hal_ssd1306_stopdata(void);
+uint8_t hal_ssd1306_busy(void);
+uint8_t hal_ssd1306_error(void);
 
 #endif // HAL_SSD1306_H_
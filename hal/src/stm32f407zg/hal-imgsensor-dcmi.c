@@ -13,7 +13,9 @@
 */
 
 #include "platform.h"
+#include "imgsensor-drv.h"
 #include "stm32f4xx-hw.h"
+#include <stddef.h>
 
 //--------------------------------------------
 // DCMI(AHB2)
@@ -73,10 +75,8 @@
 #define	PIN_TIM1_CH1    8
 
 
-#if 0
 #define DCMI_IRQ_PREEMPT_PRIORITY        1
 #define DMA_DCMI_IRQ_PREEMPT_PRIORITY    0
-#endif
 
 //--------------------------------------------
 void hal_imgsensor_init_capture(void)
@@ -231,6 +231,88 @@ void hal_imgsensor_init_dma_cycle(void)
 #endif
 }
 
+//--------------------------------------------
+// Capture statistics, the timestamps are DWT cycle counter values
+static imgsensor_stat_t stat;
+static uint32_t stat_latest_time;      // the completion time of the latest frame
+static uint32_t fps_frames;
+static uint32_t fps_time;
+
+//--------------------------------------------
+static void stat_frame_end(void)
+{
+	uint32_t time = DWT->CYCCNT;
+
+	if (stat.frames)
+	{
+		stat.frame_period = time - stat.frame_time;
+	}
+	stat.frame_time = time;
+	stat.frames++;
+}
+
+//--------------------------------------------
+// The frame has been taken by the reader
+static void stat_frame_consumed(uint32_t time)
+{
+	uint32_t ms;
+	uint8_t bin;
+
+	ms = (DWT->CYCCNT - time) / (SystemCoreClock / 1000);
+	for (bin = 0; ms && bin < IMGSENSOR_LATENCY_BINS - 1; bin++)
+	{
+		ms >>= 1;
+	}
+	stat.latency[bin]++;
+	stat.consumed_frames++;
+}
+
+//--------------------------------------------
+// The blocking read is complete or timed out,
+// the DMA interrupts are disabled, so the error flags are polled
+static void stat_read_complete(uint8_t complete)
+{
+	if (complete)
+	{
+		stat_frame_end();
+		stat_frame_consumed(stat.frame_time);
+	}
+	else
+	{
+		stat.skipped_frames++;
+	}
+	if (DMA2->LISR & (DMA_LISR_TEIF1 | DMA_LISR_DMEIF1))
+	{
+		stat.dma_errors++;
+	}
+	if (DMA2->LISR & DMA_LISR_FEIF1)
+	{
+		stat.fifo_errors++;
+	}
+	if (DCMI->RISR & DCMI_RIS_OVR_RIS)
+	{
+		DCMI->ICR = DCMI_ICR_OVR_ISC;
+		stat.overruns++;
+	}
+}
+
+//--------------------------------------------
+void hal_imgsensor_get_stat(imgsensor_stat_t *stat_out)
+{
+	uint32_t time;
+
+	NVIC_DisableIRQ(DMA2_Stream1_IRQn);
+	NVIC_DisableIRQ(DCMI_IRQn);
+	*stat_out = stat;
+	NVIC_EnableIRQ(DCMI_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+
+	time = get_platform_counter();
+	stat_out->fps_x10 = (time != fps_time) ? (stat_out->frames - fps_frames) * 10000 / (time - fps_time) : 0;
+	fps_frames = stat_out->frames;
+	fps_time = time;
+}
+
 //--------------------------------------------
 void hal_imgsensor_init_dma_buf(void)
 {
@@ -345,15 +427,23 @@ uint32_t hal_imgsensor_read_dma_buf(uint8_t *buf, uint32_t length, uint32_t time
 	for (start = get_platform_counter();;)
 	{
 		if ((get_platform_counter() - start) >= timeout)
+		{
+			stat_read_complete(0);
 			return DMA2_Stream1->NDTR;
+		}
 		if (!(DMA2_Stream1->CR & DMA_SxCR_EN))
+		{
+			stat_read_complete(1);
 			return 0;
+		}
 	}
 }
 
 //--------------------------------------------
 void hal_imgsensor_stop_dma(void)
 {
+	// VSYNC, overrun and synchronization error interrupts disable
+	DCMI->IER &= ~(DCMI_IER_VSYNC_IE | DCMI_IER_OVR_IE | DCMI_IER_ERR_IE);
 	// Capture disabled
 	DCMI->CR &= ~DCMI_CR_CAPTURE;
 	while (DCMI->CR & DCMI_CR_CAPTURE);
@@ -404,55 +494,535 @@ void hal_imgsensor_stop_capture(void)
 	DCMI->CR &= ~DCMI_CR_ENABLE;
 }
 
-#if 0
+//--------------------------------------------
+// jpeg = 1: JPEG mode - the frames have variable length,
+//           the end of the frame is detected by VSYNC
+void hal_imgsensor_set_jpeg(uint8_t jpeg)
+{
+	if (jpeg)
+	{
+		// JPEG = 1: Compressed data (JPEG).
+		//           HSYNC is used as data enable, CROP must be disabled
+		DCMI->CR |= DCMI_CR_JPEG;
+	}
+	else
+	{
+		DCMI->CR &= ~DCMI_CR_JPEG;
+	}
+}
+
+//--------------------------------------------
+// Crop window, the capture must be stopped
+// x, y, width, height: in pixels of the sensor output image (2 bytes per pixel),
+//                      the number of bytes in the window should be a multiple of 4
+// width = 0 or height = 0: the full image is captured
+void hal_imgsensor_set_crop(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	if (!width || !height)
+	{
+		DCMI->CR &= ~DCMI_CR_CROP;
+		return;
+	}
+	// VST[12:0]: vertical start line count
+	// HOFFCNT[13:0]: horizontal offset count (the number of pixel clocks)
+	DCMI->CWSTRTR = ((uint32_t)y << DCMI_CWSTRT_VST_Pos) | ((uint32_t)x * 2);
+	// VLINE[13:0]: vertical line count (the number of lines - 1)
+	// CAPCNT[13:0]: capture count (the number of pixel clocks - 1)
+	DCMI->CWSIZER = ((uint32_t)(height - 1) << DCMI_CWSIZE_VLINE_Pos) | ((uint32_t)width * 2 - 1);
+	// CROP = 1: Only the data inside the window is captured
+	DCMI->CR |= DCMI_CR_CROP;
+}
+
+//--------------------------------------------
+// Line ring mode:
+// the lines are captured to the ring of line buffers by DMA in the double buffer mode.
+// At the end of every line the idle memory address register is set to the next
+// ring buffer and hal_imgsensor_irq_line_callback() is called with the completed line.
+// At the beginning of the vertical blanking (VSYNC interrupt) DMA is restarted,
+// so every frame starts from the line boundary even after a DCMI overrun,
+// and hal_imgsensor_irq_frame_callback() is called.
+//
+// Frame ring mode:
+// the frames are captured to the ring of frame buffers by DMA in the double buffer mode.
+// At the end of every frame the completed frame becomes the latest one,
+// hal_imgsensor_irq_frame_callback() is called and the idle memory address register
+// is set to a free frame buffer (neither captured, nor latest, nor held by the reader).
+// The frame that does not fit into a single DMA transfer (65535 32-bit words)
+// is captured as several equal parts, the idle memory address register
+// is set to the next part of the frame at the end of every part.
+// hal_imgsensor_get_frame() takes the latest frame and holds it
+// until hal_imgsensor_release_frame() or the next successful hal_imgsensor_get_frame().
+// If there is no free frame buffer, DMA stops at the end of the frame
+// and is restarted at the next VSYNC interrupt when a frame buffer is released,
+// so neither capture nor reader ever waits for each other.
+// In the JPEG mode the frame ends at VSYNC: DMA is stopped to flush its FIFO,
+// the frame length is calculated from NDTR and DMA is restarted to a free frame buffer.
+// The frame that overflows the frame buffer or does not begin with
+// the JPEG SOI marker (the first frame after start) is dropped.
+#define FRAME_NONE      0xFF
+#define DMA_MAX_LENGTH  (65535 * sizeof(uint32_t))
+#define FRAME_PARTS_MAX 16
+
+static uint8_t *ring_buf;
+static uint32_t ring_length;           // the length of a line or frame buffer
+static uint8_t ring_count;
+static uint8_t ring_frames;            // 0 - line ring mode, 1 - frame ring mode
+static uint8_t ring_line;              // the ring buffer of the line being captured
+static uint32_t ring_part_length;      // the DMA transfer length: a line or a part of a frame
+static uint8_t ring_parts;             // the number of parts of a frame
+static uint8_t ring_part;              // the part of the frame being captured
+static uint8_t frame_current;          // the frame being captured, FRAME_NONE - DMA is stopped
+static uint8_t frame_next;             // the frame in the idle memory, FRAME_NONE - no free frame
+static volatile uint8_t frame_latest;  // the latest completed frame not taken by the reader
+static volatile uint8_t frame_held;    // the frame held by the reader
+static volatile uint32_t frame_latest_length;
+static uint8_t frame_overflow;         // the JPEG frame has overflowed the frame buffer
+
+//--------------------------------------------
+void hal_imgsensor_init_dma_lines(void)
+{
+	// DMA2 clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+	// DMA stream disabled
+	DMA2_Stream1->CR &= ~DMA_SxCR_EN;
+	while (DMA2_Stream1->CR & DMA_SxCR_EN);
+
+	DMA2_Stream1->CR =  DMA_SxCR_CHSEL_0  | // Channel selection: (001) channel 1
+	                                        // Memory burst transfer configuration: (00) single transfer
+	                                        // Peripheral burst transfer configuration: (00) single transfer
+	                                        // Current target: (0) memory 0
+	                    DMA_SxCR_DBM      | // Double buffer mode: (1) Memory target switched at the end of the DMA transfer
+	                    DMA_SxCR_PL_0 | DMA_SxCR_PL_1 | // Priority level: (11) Very high
+	                                        // Peripheral increment offset size: (0) ignored
+	                    DMA_SxCR_MSIZE_1  | // Memory data size: (10) 32-bit
+	                    DMA_SxCR_PSIZE_1  | // Peripheral data size: (10) 32-bit
+	                    DMA_SxCR_MINC     | // Memory address pointer is incremented after each data transfer
+	                                        // Peripheral increment mode: (0) Peripheral address pointer is fixed
+	                                        // Circular mode: (0) forced by the double buffer mode
+	                                        // Data transfer direction: (00) Peripheral-to-memory
+	                                        // Peripheral flow controller: (0) The DMA is the flow controller
+	                    DMA_SxCR_TCIE     ; // Transfer complete interrupt enable: (1) enabled
+
+	DMA2_Stream1->FCR =                     // FIFO error interrupt: (0) disabled
+	                                        // FIFO status: These bits are read-only
+	                    DMA_SxFCR_DMDIS   | // Direct mode: (1) disable
+	                    DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1; // FIFO threshold selection: (11) full FIFO
+
+	// set dcmi dma global interrupt priority
+	NVIC_SetPriority(DMA2_Stream1_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), DMA_DCMI_IRQ_PREEMPT_PRIORITY, 0));
+	// enable dcmi dma global interrupt
+	NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+	// set dcmi global interrupt priority
+	NVIC_SetPriority(DCMI_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), DCMI_IRQ_PREEMPT_PRIORITY, 0));
+	// enable dcmi global interrupt
+	NVIC_EnableIRQ(DCMI_IRQn);
+}
+
+//--------------------------------------------
+void hal_imgsensor_init_dma_frames(void)
+{
+	// The frame ring uses the same DMA configuration as the line ring
+	hal_imgsensor_init_dma_lines();
+}
+
+//--------------------------------------------
+// Disabling the stream sets TCIF again once the stream has stopped,
+// the flags are cleared afterwards so that the interrupt is not raised twice
+static void dma_stream_stop(void)
+{
+	// DMA stream disabled
+	DMA2_Stream1->CR &= ~DMA_SxCR_EN;
+	while (DMA2_Stream1->CR & DMA_SxCR_EN);
+
+	// Clear all the interrupt flags
+	DMA2->LIFCR = DMA_LIFCR_CTCIF1 | DMA_LIFCR_CTEIF1 | DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CFEIF1 | DMA_LIFCR_CHTIF1;
+	NVIC_ClearPendingIRQ(DMA2_Stream1_IRQn);
+}
+
+//--------------------------------------------
+// m0: the buffer to capture to, m1: the buffer to capture to after it
+static void dma_ring_restart(uint8_t *m0, uint8_t *m1)
+{
+	NVIC_DisableIRQ(DMA2_Stream1_IRQn);
+	dma_stream_stop();
+	frame_overflow = 0;
+
+	// Set the DMA addresses
+	DMA2_Stream1->CR &= ~DMA_SxCR_CT;
+	DMA2_Stream1->M0AR = (uint32_t)m0;
+	DMA2_Stream1->M1AR = (uint32_t)m1;
+
+	// Set the number of 32-bit words to transfer
+	DMA2_Stream1->NDTR = ring_part_length / sizeof(uint32_t);
+
+	// DMA stream enabled
+	DMA2_Stream1->CR |= DMA_SxCR_EN;
+
+	NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+}
+
+//--------------------------------------------
+static void dma_lines_restart(void)
+{
+	// the current line buffer and the next one
+	dma_ring_restart(&ring_buf[ring_line * ring_length], &ring_buf[((ring_line + 1) % ring_count) * ring_length]);
+}
+
+//--------------------------------------------
+static void dma_ring_start(uint8_t *buf, uint32_t length, uint8_t count, uint8_t frames, uint8_t parts)
+{
+	ring_buf = buf;
+	ring_length = length;
+	ring_count = count;
+	ring_frames = frames;
+	ring_line = 0;
+	ring_part_length = length / parts;
+	ring_parts = parts;
+	ring_part = 0;
+	frame_current = 0;
+	frame_next = 1;
+	frame_latest = FRAME_NONE;
+	frame_held = FRAME_NONE;
+
+	// Continuous grab mode
+	DCMI->CR &= ~DCMI_CR_CM;
+
+	// DCMI enabled
+	// The DCMI configuration registers should be 
+	// programmed correctly before enabling this bit.
+	DCMI->CR |= DCMI_CR_ENABLE;
+
+	DMA2_Stream1->PAR = (uint32_t)&(DCMI->DR);
+	dma_ring_restart(&ring_buf[0], &ring_buf[ring_part_length]);
+
+	// VSYNC interrupt enable
+	DCMI->ICR = DCMI_ICR_VSYNC_ISC | DCMI_ICR_OVR_ISC | DCMI_ICR_ERR_ISC;
+	DCMI->IER |= DCMI_IER_VSYNC_IE | DCMI_IER_OVR_IE | DCMI_IER_ERR_IE;
+
+	// CAPTURE = 1: Capture enabled
+	//              The DMA controller and all DCMI configuration registers
+	//              should be programmed correctly before enabling this bit.
+	DCMI->CR |= DCMI_CR_CAPTURE;
+}
+
+//--------------------------------------------
+// buf: lines * line_length bytes, line_length must be a multiple of 4, lines >= 2
+void hal_imgsensor_start_dma_lines(uint8_t *buf, uint32_t line_length, uint8_t lines)
+{
+	dma_ring_start(buf, line_length, lines, 0, 1);
+}
+
+//--------------------------------------------
+// buf: frames * frame_length bytes, frame_length must be a multiple of 4,
+// frames >= 2 (3 frames never skip a frame as long as the reader releases
+// the held frame within the frame period).
+// The uncompressed frame is split into up to FRAME_PARTS_MAX equal parts
+// of 65535 * 4 bytes at most, the JPEG frame buffer must not exceed 65535 * 4 bytes.
+// Returns 0 if frame_length is not supported, DMA is not started then.
+uint8_t hal_imgsensor_start_dma_frames(uint8_t *buf, uint32_t frame_length, uint8_t frames)
+{
+	uint8_t parts;
+
+	for (parts = 1; parts <= FRAME_PARTS_MAX; parts++)
+	{
+		if (!(frame_length % (parts * sizeof(uint32_t))) && frame_length / parts <= DMA_MAX_LENGTH)
+		{
+			break;
+		}
+	}
+	if (!frame_length || parts > FRAME_PARTS_MAX || (parts > 1 && (DCMI->CR & DCMI_CR_JPEG)))
+	{
+		return 0;
+	}
+	dma_ring_start(buf, frame_length, frames, 1, parts);
+	return 1;
+}
+
+//--------------------------------------------
+// Returns the frame buffer that is neither captured, nor latest, nor held
+static uint8_t frame_free(void)
+{
+	uint8_t cnt;
+
+	for (cnt = 0; cnt < ring_count; cnt++)
+	{
+		if (cnt != frame_current && cnt != frame_latest && cnt != frame_held)
+		{
+			return cnt;
+		}
+	}
+	return FRAME_NONE;
+}
+
+//--------------------------------------------
+// Returns the buffer to capture to after the current part of the frame:
+// the next part or the next frame (the current one if there is no free frame)
+static uint8_t *frame_part_next(void)
+{
+	if (ring_part + 1 < ring_parts)
+	{
+		return &ring_buf[frame_current * ring_length + (ring_part + 1) * ring_part_length];
+	}
+	return &ring_buf[(frame_next == FRAME_NONE ? frame_current : frame_next) * ring_length];
+}
+
+//--------------------------------------------
+// The current target has been switched,
+// the idle memory is replaced with the buffer after the current one
+static void dma_set_idle(uint8_t *buf)
+{
+	if (DMA2_Stream1->CR & DMA_SxCR_CT)
+	{
+		DMA2_Stream1->M0AR = (uint32_t)buf;
+	}
+	else
+	{
+		DMA2_Stream1->M1AR = (uint32_t)buf;
+	}
+}
+
+//--------------------------------------------
+static void dma_frames_complete(void)
+{
+	if (++ring_part < ring_parts)
+	{
+		// The current target has been switched to the next part of the frame
+		dma_set_idle(frame_part_next());
+		return;
+	}
+	ring_part = 0;
+	stat_frame_end();
+	if (frame_latest != FRAME_NONE)
+	{
+		stat.overwritten_frames++;
+	}
+	stat_latest_time = stat.frame_time;
+	frame_latest = frame_current;
+	frame_latest_length = ring_length;
+	if (frame_next == FRAME_NONE)
+	{
+		// No free frame buffer: DMA stream disabled
+		// until the next VSYNC (blanking), nothing is captured meanwhile
+		dma_stream_stop();
+		frame_current = FRAME_NONE;
+	}
+	else
+	{
+		// The current target has been switched to the next frame,
+		// the idle memory is replaced with its second part or a free frame buffer
+		frame_current = frame_next;
+		frame_next = frame_free();
+		if (ring_parts > 1 || frame_next != FRAME_NONE)
+		{
+			dma_set_idle(frame_part_next());
+		}
+	}
+	hal_imgsensor_irq_frame_callback();
+}
+
+//--------------------------------------------
+static void dma_frames_resync(void)
+{
+	if (frame_current == FRAME_NONE)
+	{
+		// DMA is stopped: restart it if a frame buffer has been released
+		frame_current = frame_free();
+		if (frame_current == FRAME_NONE)
+		{
+			stat.skipped_frames++;
+			return;
+		}
+	}
+	else if (ring_part == 0 && DMA2_Stream1->NDTR == ring_part_length / sizeof(uint32_t))
+	{
+		// DMA is synchronized with the frame
+		return;
+	}
+	else
+	{
+		stat.recaptured_frames++;
+	}
+	// The incomplete frame (DCMI overrun) is captured again
+	frame_next = frame_free();
+	ring_part = 0;
+	dma_ring_restart(&ring_buf[frame_current * ring_length], frame_part_next());
+}
+
+//--------------------------------------------
+static void dma_frames_jpeg_complete(void)
+{
+	uint8_t *frame;
+	uint32_t length;
+
+	if (frame_current != FRAME_NONE)
+	{
+		// DMA stream disabled,
+		// the data remaining in the FIFO is transferred to the memory
+		dma_stream_stop();
+		length = ring_length - DMA2_Stream1->NDTR * sizeof(uint32_t);
+		frame = &ring_buf[frame_current * ring_length];
+		if (!frame_overflow && length > 2 && frame[0] == 0xFF && frame[1] == 0xD8)
+		{
+			stat_frame_end();
+			if (frame_latest != FRAME_NONE)
+			{
+				stat.overwritten_frames++;
+			}
+			stat_latest_time = stat.frame_time;
+			frame_latest = frame_current;
+			frame_latest_length = length;
+			hal_imgsensor_irq_frame_callback();
+		}
+		else
+		{
+			stat.dropped_frames++;
+		}
+	}
+	// The next frame is captured to a free frame buffer
+	frame_current = frame_free();
+	if (frame_current == FRAME_NONE)
+	{
+		stat.skipped_frames++;
+		return;
+	}
+	frame_next = frame_free();
+	ring_part = 0;
+	dma_ring_restart(&ring_buf[frame_current * ring_length], frame_part_next());
+}
+
+//--------------------------------------------
+// Returns the latest completed frame and its length in bytes
+// or NULL if there is no new frame,
+// the previously held frame is released if there is a new frame
+uint8_t *hal_imgsensor_get_frame(uint32_t *length)
+{
+	uint8_t *frame = NULL;
+
+	NVIC_DisableIRQ(DMA2_Stream1_IRQn);
+	NVIC_DisableIRQ(DCMI_IRQn);
+	if (frame_latest != FRAME_NONE)
+	{
+		frame_held = frame_latest;
+		frame_latest = FRAME_NONE;
+		frame = &ring_buf[frame_held * ring_length];
+		*length = frame_latest_length;
+		stat_frame_consumed(stat_latest_time);
+	}
+	NVIC_EnableIRQ(DCMI_IRQn);
+	NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+	return frame;
+}
+
+//--------------------------------------------
+void hal_imgsensor_release_frame(void)
+{
+	frame_held = FRAME_NONE;
+}
+
 //--------------------------------------------
 void DMA2_Stream1_IRQHandler(void)
 {
+	uint8_t *line;
+
 	if (DMA2->LISR & DMA_LISR_TCIF1)
 	{
-		DMA2->LIFCR |= DMA_LIFCR_CTCIF1;
+		DMA2->LIFCR = DMA_LIFCR_CTCIF1;
+		if (DMA2_Stream1->CR & DMA_SxCR_DBM)
+		{
+			if (ring_frames)
+			{
+				if (DCMI->CR & DCMI_CR_JPEG)
+				{
+					// The JPEG frame has overflowed the frame buffer:
+					// DMA stream disabled, the frame is dropped at VSYNC
+					dma_stream_stop();
+					frame_overflow = 1;
+				}
+				else
+				{
+					dma_frames_complete();
+				}
+			}
+			else
+			{
+				// The current target has been switched,
+				// the completed line is in the idle memory,
+				// it is replaced with the line after the current one
+				ring_line = (ring_line + 1) % ring_count;
+				if (DMA2_Stream1->CR & DMA_SxCR_CT)
+				{
+					line = (uint8_t *)DMA2_Stream1->M0AR;
+					DMA2_Stream1->M0AR = (uint32_t)&ring_buf[((ring_line + 1) % ring_count) * ring_length];
+				}
+				else
+				{
+					line = (uint8_t *)DMA2_Stream1->M1AR;
+					DMA2_Stream1->M1AR = (uint32_t)&ring_buf[((ring_line + 1) % ring_count) * ring_length];
+				}
+				hal_imgsensor_irq_line_callback(line);
+			}
+		}
 	}
 	if (DMA2->LISR & DMA_LISR_HTIF1)
 	{
-		DMA2->LIFCR |= DMA_LIFCR_CHTIF1;
+		DMA2->LIFCR = DMA_LIFCR_CHTIF1;
 	}
 	if (DMA2->LISR & DMA_LISR_TEIF1)
 	{
-		DMA2->LIFCR |= DMA_LIFCR_CTEIF1;
+		DMA2->LIFCR = DMA_LIFCR_CTEIF1;
+		stat.dma_errors++;
 	}
 	if (DMA2->LISR & DMA_LISR_DMEIF1)
 	{
-		DMA2->LIFCR |= DMA_LIFCR_CDMEIF1;
+		DMA2->LIFCR = DMA_LIFCR_CDMEIF1;
+		stat.dma_errors++;
 	}
 	if (DMA2->LISR & DMA_LISR_FEIF1)
 	{
-		DMA2->LIFCR |= DMA_LIFCR_CFEIF1;
+		DMA2->LIFCR = DMA_LIFCR_CFEIF1;
+		stat.fifo_errors++;
 	}
 }
-#endif
-#if 0
+
 //--------------------------------------------
 void DCMI_IRQHandler(void)
 {
-	if (DCMI->MISR & DCMI_MISR_LINE_MIS)
-	{
-		DCMI->ICR |= DCMI_ICR_LINE_ISC;
-	}
 	if (DCMI->MISR & DCMI_MISR_VSYNC_MIS)
 	{
-		DCMI->ICR |= DCMI_ICR_VSYNC_ISC;
-	}
-	if (DCMI->MISR & DCMI_MISR_ERR_MIS)
-	{
-		DCMI->ICR |= DCMI_ICR_ERR_ISC;
+		DCMI->ICR = DCMI_ICR_VSYNC_ISC;
+		stat.vsync_time = DWT->CYCCNT;
+		stat.vsyncs++;
+		// Vertical blanking: resynchronize DMA with the frame
+		if (DMA2_Stream1->CR & DMA_SxCR_DBM)
+		{
+			if (ring_frames)
+			{
+				if (DCMI->CR & DCMI_CR_JPEG)
+				{
+					dma_frames_jpeg_complete();
+				}
+				else
+				{
+					dma_frames_resync();
+				}
+			}
+			else
+			{
+				stat_frame_end();
+				dma_lines_restart();
+				hal_imgsensor_irq_frame_callback();
+			}
+		}
 	}
 	if (DCMI->MISR & DCMI_MISR_OVR_MIS)
 	{
-		DCMI->ICR |= DCMI_ICR_OVR_ISC;
+		DCMI->ICR = DCMI_ICR_OVR_ISC;
+		stat.overruns++;
 	}
-	if (DCMI->MISR & DCMI_MISR_FRAME_MIS)
+	if (DCMI->MISR & DCMI_MISR_ERR_MIS)
 	{
-		DCMI->ICR |= DCMI_ICR_FRAME_ISC;
+		DCMI->ICR = DCMI_ICR_ERR_ISC;
+		stat.sync_errors++;
 	}
-}
-#endif
\ No newline at end of file
+}
\ No newline at end of file
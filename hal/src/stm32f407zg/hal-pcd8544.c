@@ -46,6 +46,10 @@
 // SPI1_CK = PCLK2(84MHz) / 32 = 2.625MHz
 #define SPI_CLK_DIV      SPI_CR1_BR_2
 
+//--------------------------------------------
+// Shorter blocks are sent without DMA (the stream setup takes longer)
+#define DMA_MIN_LENGTH   8
+
 //--------------------------------------------
 void hal_pcd8544_init(void)
 {
@@ -71,6 +75,34 @@ void hal_pcd8544_init(void)
 	// MSTR = 1: Master configuration
 	SPI1->CR1 = SPI_CR1_BIDIMODE | SPI_CR1_BIDIOE | SPI_CR1_SSM | SPI_CR1_SSI | SPI_CR1_SPE | SPI_CLK_DIV | SPI_CR1_MSTR;
 
+	// DMA2 clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+	// DMA stream disabled
+	DMA2_Stream3->CR &= ~DMA_SxCR_EN;
+	while (DMA2_Stream3->CR & DMA_SxCR_EN);
+
+	DMA2_Stream3->CR =  DMA_SxCR_CHSEL_0 | DMA_SxCR_CHSEL_1 | // Channel selection: (011) channel 3 (SPI1_TX)
+	                                        // Memory burst transfer configuration: (00) single transfer
+	                                        // Peripheral burst transfer configuration: (00) single transfer
+	                                        // Current target: (0) ignored
+	                                        // Double buffer mode: (0) No buffer switching at the end of transfer
+	                                        // Priority level: (00) Low
+	                                        // Peripheral increment offset size: (0) ignored
+	                                        // Memory data size: (00) 8-bit
+	                                        // Peripheral data size: (00) 8-bit
+	                    DMA_SxCR_MINC     | // Memory increment mode: (1) incremented after each data transfer
+	                                        // Peripheral increment mode: (0) Peripheral address pointer is fixed
+	                                        // Circular mode: (0) disabled
+	                    DMA_SxCR_DIR_0      // Data transfer direction: (01) Memory-to-peripheral
+	                                      ; // Peripheral flow controller: (0) DMA is the flow controller
+
+	DMA2_Stream3->FCR =                     // FIFO error interrupt: (0) disabled
+	                                        // FIFO status: These bits are read-only
+	                    DMA_SxFCR_DMDIS   | // Direct mode: (1) disable
+	                    DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1; // FIFO threshold selection: (11) full FIFO
+	DMA2_Stream3->PAR = (uint32_t)&(SPI1->DR);
+
 	hw_set_pin(GPIOx(PORT_CS), PIN_CS, 1);        // CS = 1
 	hw_set_pin(GPIOx(PORT_RESET), PIN_RESET, 1);  // RST = 1
 	delay_ms(1);
@@ -114,3 +146,47 @@ void hal_pcd8544_tx(uint8_t data)
 	while ((SPI1->SR & SPI_SR_BSY));
 #endif
 }
+
+//--------------------------------------------
+// The buffer must not be placed in the CCM RAM (it is not accessible by DMA)
+static void spi_tx_dma(const uint8_t *data, uint16_t length)
+{
+	if (length < DMA_MIN_LENGTH)
+	{
+		for (; length; length--)
+		{
+			hal_pcd8544_tx(*data++);
+		}
+		return;
+	}
+
+	// DMA stream disabled
+	DMA2_Stream3->CR &= ~DMA_SxCR_EN;
+	while (DMA2_Stream3->CR & DMA_SxCR_EN);
+
+	// Clear all the interrupt flags
+	DMA2->LIFCR = DMA_LIFCR_CTCIF3 | DMA_LIFCR_CTEIF3 | DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CFEIF3 | DMA_LIFCR_CHTIF3;
+
+	// Set the memory address and the number of 8-bit words to transfer
+	DMA2_Stream3->M0AR = (uint32_t)data;
+	DMA2_Stream3->NDTR = length;
+
+	// SPI1 DMA enable
+	SPI1->CR2 |= SPI_CR2_TXDMAEN;
+
+	// DMA stream enabled
+	DMA2_Stream3->CR |= DMA_SxCR_EN;
+	while ((DMA2_Stream3->CR & DMA_SxCR_EN));
+
+	// the last byte must be sent before the DC line is changed
+	while (!(SPI1->SR & SPI_SR_TXE));
+	while ((SPI1->SR & SPI_SR_BSY));
+
+	SPI1->CR2 &= ~SPI_CR2_TXDMAEN;
+}
+
+//--------------------------------------------
+void hal_pcd8544_tx_block(const uint8_t *data, uint16_t length)
+{
+	spi_tx_dma(data, length);
+}
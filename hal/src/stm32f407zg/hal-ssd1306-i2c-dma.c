@@ -0,0 +1,419 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "stm32f4xx-hw.h"
+
+//--------------------------------------------
+// GPIO_AF4_I2C1:
+// I2C1 SCL:   PB6    PB8
+// I2C1 SDA:   PB7    PB9
+// I2C1 SMBA:  PB5
+// GPIO_AF4_I2C2:
+// I2C2 SCL:   PB10   PF1    PH4
+// I2C2 SDA:   PB11   PF0    PH5
+// I2C2 SMBA:  PB12   PF2    PH6
+// GPIO_AF4_I2C3:
+// I2C3 SCL:   PA8    PH7
+// I2C3 SDA:   PC9    PH8
+// I2C3 SMBA:  PA9    PH9
+
+//--------------------------------------------
+// DMA1 request mapping:
+// I2C1_TX:    Stream6 Channel1   Stream7 Channel1
+
+//--------------------------------------------
+// Display data is sent by DMA in the background:
+// hal_ssd1306_data_block() queues the block and returns immediately,
+// hal_ssd1306_stopdata() returns immediately too, the stop condition
+// is generated from the interrupt after the last byte has been sent.
+// The next command waits for the end of the previous transfer,
+// hal_ssd1306_busy() can be used to check it.
+// A failed transfer (DMA error, timeout) is aborted: the queue is dropped
+// and the stop condition is generated, hal_ssd1306_error() reports it.
+// The queued blocks are not copied, so they must stay unchanged
+// until the transfer is complete (the mono-scr buffer changes are
+// allowed: they are marked dirty and sent by the next flush).
+// The buffers must not be placed in the CCM RAM (it is not accessible by DMA).
+
+//--------------------------------------------
+#define	PORT_SCL        GPIO_B   // PB8 --> SCK
+#define	PIN_SCL         8
+#define	PORT_SDA        GPIO_B   // PB9 <-> SDA
+#define	PIN_SDA         9
+
+//--------------------------------------------
+#define I2C_SUCCESS         0
+#define I2C_FAIL            1
+#define I2C_WAIT            50000
+#define I2C_ADDR_WRITE      0x78
+#define I2C_CTRLBYTE_CMD    0x00
+#define I2C_CTRLBYTE_DATA   0x40
+
+//--------------------------------------------
+// The STM32F4 I2C peripheral supports Standard and Fast modes only (400kHz max).
+// Most SSD1306 panels work with higher SCL frequency (with strong enough pull-ups),
+// I2C_OVERCLOCK = 1 selects 840kHz SCL out of the I2C peripheral specification.
+#ifndef I2C_OVERCLOCK
+#define I2C_OVERCLOCK       0
+#endif
+
+//--------------------------------------------
+// Time limit of the transfer completion waiting in ms
+// (full screen transfer takes ~25ms at 400kHz)
+#define I2C_TRANSFER_WAIT   100
+
+//--------------------------------------------
+#define TRANSFER_IDLE       0
+#define TRANSFER_DATA       1
+#define TRANSFER_STOP       2
+
+//--------------------------------------------
+#define DMA_QUEUE_SIZE                  8
+// The display traffic is not time-critical: a low priority, so the camera,
+// audio and USB interrupts are not delayed by the queue handling.
+// Both handlers share the queue state, so the priorities are equal.
+#ifdef configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+// = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY in FreeRTOSConfig.h
+#define I2C_DMA_IRQ_PREEMPT_PRIORITY    (configLIBRARY_LOWEST_INTERRUPT_PRIORITY - 1)
+#define I2C_EV_IRQ_PREEMPT_PRIORITY     (configLIBRARY_LOWEST_INTERRUPT_PRIORITY - 1)
+#else
+#define I2C_DMA_IRQ_PREEMPT_PRIORITY    14
+#define I2C_EV_IRQ_PREEMPT_PRIORITY     14
+#endif
+
+//--------------------------------------------
+static const uint8_t *queue_data[DMA_QUEUE_SIZE];
+static uint16_t queue_length[DMA_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile uint8_t dma_active;
+static volatile uint8_t transfer_state;
+static volatile uint8_t transfer_error;
+
+//--------------------------------------------
+void hal_ssd1306_init(void)
+{
+	// IO port B clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
+	// DMA1 clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	// I2C1 clock enable
+	RCC->APB1ENR |= RCC_APB1ENR_I2C1EN;
+
+	hw_cfg_pin(GPIOx(PORT_SCL),   PIN_SCL,   GPIOCFG_MODE_ALT | GPIO_AF4_I2C1 | GPIOCFG_OSPEED_HIGH | GPIOCFG_OTYPE_OPEN | GPIOCFG_PUPD_NONE);
+	hw_cfg_pin(GPIOx(PORT_SDA),   PIN_SDA,   GPIOCFG_MODE_ALT | GPIO_AF4_I2C1 | GPIOCFG_OSPEED_HIGH | GPIOCFG_OTYPE_OPEN | GPIOCFG_PUPD_NONE);
+
+	// I2C_CR1:
+	// PE = 0: Peripheral disable
+	I2C1->CR1 &= ~I2C_CR1_PE;
+
+	// I2C_CR2:
+	// FREQ = 42: PCLK1 in MHz
+	I2C1->CR2 = 42;
+
+	// I2C_TRISE:
+	// In Fm mode, the maximum allowed SCL rise time is 300 ns
+	// TRISE = 42 * 0.3 + 1: PCLK1 in MHz * 0.3 + 1
+	I2C1->TRISE = 13;
+
+	// I2C_CCR:
+	// F/S = 1: Fm mode I2C
+#if I2C_OVERCLOCK
+	// DUTY = 1: Fm mode tlow/thigh = 16/9
+	// CCR = 2: PCLK1 / 840kHz / 25
+	I2C1->CCR = I2C_CCR_FS | I2C_CCR_DUTY | 2;
+#else
+	// DUTY = 0: Fm mode tlow/thigh = 2
+	// CCR = 35: PCLK1 / 400kHz / 3
+	I2C1->CCR = I2C_CCR_FS | 35;
+#endif
+
+	// I2C_CR1:
+	// PE = 1: Peripheral enable
+	I2C1->CR1 |= I2C_CR1_PE;
+
+	// DMA stream disabled
+	DMA1_Stream6->CR &= ~DMA_SxCR_EN;
+	while (DMA1_Stream6->CR & DMA_SxCR_EN);
+
+	DMA1_Stream6->CR =  DMA_SxCR_CHSEL_0  | // Channel selection: (001) channel 1 (I2C1_TX)
+	                                        // Memory burst transfer configuration: (00) single transfer
+	                                        // Peripheral burst transfer configuration: (00) single transfer
+	                                        // Current target: (0) ignored
+	                                        // Double buffer mode: (0) No buffer switching at the end of transfer
+	                                        // Priority level: (00) Low
+	                                        // Peripheral increment offset size: (0) ignored
+	                                        // Memory data size: (00) 8-bit
+	                                        // Peripheral data size: (00) 8-bit
+	                    DMA_SxCR_MINC     | // Memory increment mode: (1) incremented after each data transfer
+	                                        // Peripheral increment mode: (0) Peripheral address pointer is fixed
+	                                        // Circular mode: (0) disabled
+	                    DMA_SxCR_DIR_0    | // Data transfer direction: (01) Memory-to-peripheral
+	                                        // Peripheral flow controller: (0) DMA is the flow controller
+	                    DMA_SxCR_TCIE     | // Transfer complete interrupt enable: (1) enabled
+	                    DMA_SxCR_TEIE     ; // Transfer error interrupt enable: (1) enabled
+
+	DMA1_Stream6->FCR =                     // FIFO error interrupt: (0) disabled
+	                                        // FIFO status: These bits are read-only
+	                    DMA_SxFCR_DMDIS   | // Direct mode: (1) disable
+	                    DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1; // FIFO threshold selection: (11) full FIFO
+	DMA1_Stream6->PAR = (uint32_t)&(I2C1->DR);
+
+	// set i2c1 dma global interrupt priority
+	NVIC_SetPriority(DMA1_Stream6_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), I2C_DMA_IRQ_PREEMPT_PRIORITY, 0));
+	// enable i2c1 dma global interrupt
+	NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+	// set i2c1 event interrupt priority
+	NVIC_SetPriority(I2C1_EV_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), I2C_EV_IRQ_PREEMPT_PRIORITY, 0));
+	// enable i2c1 event interrupt
+	NVIC_EnableIRQ(I2C1_EV_IRQn);
+}
+
+//--------------------------------------------
+static uint8_t i2c_start(uint8_t addr)
+{
+	uint32_t cnt;
+
+	I2C1->CR1 |= I2C_CR1_START;
+	for (cnt = 0; (cnt < I2C_WAIT) && !(I2C1->SR1 & I2C_SR1_SB); cnt++);
+	if (cnt == I2C_WAIT)
+	{
+		return I2C_FAIL;
+	}
+	I2C1->DR = addr;
+	for (cnt = 0; (cnt < I2C_WAIT) && !(I2C1->SR1 & I2C_SR1_ADDR); cnt++);
+	if (cnt == I2C_WAIT)
+	{
+		return I2C_FAIL;
+	}
+	I2C1->SR2;
+	return I2C_SUCCESS;
+}
+
+//--------------------------------------------
+static inline void i2c_stop(void)
+{
+	I2C1->CR1 |= I2C_CR1_STOP;
+}
+
+//--------------------------------------------
+static uint8_t i2c_writebyte(uint8_t data)
+{
+	uint32_t cnt;
+
+	I2C1->DR = data;
+	for (cnt = 0; (cnt < I2C_WAIT) && !(I2C1->SR1 & I2C_SR1_TXE); cnt++);
+	if (cnt == I2C_WAIT)
+	{
+		return I2C_FAIL;
+	}
+	return I2C_SUCCESS;
+}
+
+//--------------------------------------------
+// Must be called with the DMA interrupt disabled or from the DMA interrupt
+static void dma_next(void)
+{
+	if (queue_head == queue_tail)
+	{
+		dma_active = 0;
+		return;
+	}
+	dma_active = 1;
+
+	// Clear all the interrupt flags
+	DMA1->HIFCR = DMA_HIFCR_CTCIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6 | DMA_HIFCR_CHTIF6;
+
+	// Set the memory address and the number of 8-bit words to transfer
+	DMA1_Stream6->M0AR = (uint32_t)queue_data[queue_head];
+	DMA1_Stream6->NDTR = queue_length[queue_head];
+	queue_head = (queue_head + 1) % DMA_QUEUE_SIZE;
+
+	// DMA stream enabled
+	DMA1_Stream6->CR |= DMA_SxCR_EN;
+}
+
+//--------------------------------------------
+// Abort the hung transfer (no acknowledge from the display, bus error)
+static void i2c_abort(void)
+{
+	NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+	DMA1_Stream6->CR &= ~DMA_SxCR_EN;
+	while (DMA1_Stream6->CR & DMA_SxCR_EN);
+	I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_ITEVTEN);
+	I2C1->SR1 &= ~I2C_SR1_AF;
+	i2c_stop();
+	queue_head = queue_tail = 0;
+	dma_active = 0;
+	transfer_state = TRANSFER_IDLE;
+	transfer_error = 1;
+	NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+//--------------------------------------------
+static void i2c_wait_transfer(void)
+{
+	uint32_t start;
+
+	start = get_platform_counter();
+	while (transfer_state != TRANSFER_IDLE)
+	{
+		if (get_platform_counter() - start > I2C_TRANSFER_WAIT)
+		{
+			i2c_abort();
+			break;
+		}
+	}
+}
+
+//--------------------------------------------
+void hal_ssd1306_command(uint8_t cmd)
+{
+	i2c_wait_transfer();
+	i2c_start(I2C_ADDR_WRITE);
+	i2c_writebyte(I2C_CTRLBYTE_CMD);
+	i2c_writebyte(cmd);
+	i2c_stop();
+}
+
+//--------------------------------------------
+void hal_ssd1306_startdata(void)
+{
+	i2c_wait_transfer();
+	transfer_state = TRANSFER_DATA;
+	i2c_start(I2C_ADDR_WRITE);
+	i2c_writebyte(I2C_CTRLBYTE_DATA);
+	// I2C_CR2:
+	// DMAEN = 1: DMA request enabled when TxE = 1
+	I2C1->CR2 |= I2C_CR2_DMAEN;
+}
+
+//--------------------------------------------
+void hal_ssd1306_data_block(const uint8_t *data, uint16_t length)
+{
+	uint32_t start;
+
+	if (!length)
+	{
+		return;
+	}
+	start = get_platform_counter();
+	while (((queue_tail + 1) % DMA_QUEUE_SIZE) == queue_head)
+	{
+		if (get_platform_counter() - start > I2C_TRANSFER_WAIT)
+		{
+			i2c_abort();
+			return;
+		}
+	}
+
+	queue_data[queue_tail] = data;
+	queue_length[queue_tail] = length;
+
+	NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+	queue_tail = (queue_tail + 1) % DMA_QUEUE_SIZE;
+	if (!dma_active)
+	{
+		dma_next();
+	}
+	NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+//--------------------------------------------
+void hal_ssd1306_data(uint8_t data)
+{
+	uint32_t start;
+
+	hal_ssd1306_data_block(&data, 1);
+	// the byte is on the stack
+	start = get_platform_counter();
+	while (dma_active)
+	{
+		if (get_platform_counter() - start > I2C_TRANSFER_WAIT)
+		{
+			i2c_abort();
+			break;
+		}
+	}
+}
+
+//--------------------------------------------
+void hal_ssd1306_stopdata(void)
+{
+	NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+	if (!dma_active)
+	{
+		// I2C_CR2:
+		// ITEVTEN = 1: Event interrupt enabled (BTF)
+		I2C1->CR2 |= I2C_CR2_ITEVTEN;
+	}
+	else
+	{
+		// the event interrupt is enabled at the end of the last DMA transfer
+		transfer_state = TRANSFER_STOP;
+	}
+	NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+//--------------------------------------------
+uint8_t hal_ssd1306_busy(void)
+{
+	return (transfer_state != TRANSFER_IDLE) ? 1 : 0;
+}
+
+//--------------------------------------------
+// Returns 1 if a transfer has failed since the previous call
+uint8_t hal_ssd1306_error(void)
+{
+	uint8_t error;
+
+	error = transfer_error;
+	transfer_error = 0;
+	return error;
+}
+
+//--------------------------------------------
+void DMA1_Stream6_IRQHandler(void)
+{
+	if (DMA1->HISR & DMA_HISR_TEIF6)
+	{
+		DMA1->HIFCR = DMA_HIFCR_CTEIF6 | DMA_HIFCR_CTCIF6;
+		// The stream is disabled by the hardware on the transfer error:
+		// the rest of the queue is dropped, the bus is released
+		i2c_abort();
+		return;
+	}
+	if (DMA1->HISR & DMA_HISR_TCIF6)
+	{
+		DMA1->HIFCR = DMA_HIFCR_CTCIF6;
+		dma_next();
+		if (!dma_active && (transfer_state == TRANSFER_STOP))
+		{
+			I2C1->CR2 |= I2C_CR2_ITEVTEN;
+		}
+	}
+}
+
+//--------------------------------------------
+void I2C1_EV_IRQHandler(void)
+{
+	// The last byte has been sent
+	if (I2C1->SR1 & I2C_SR1_BTF)
+	{
+		I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_ITEVTEN);
+		i2c_stop();
+		transfer_state = TRANSFER_IDLE;
+	}
+}
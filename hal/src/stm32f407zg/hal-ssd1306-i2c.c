@@ -43,6 +43,10 @@
 #define I2C_CTRLBYTE_CMD    0x00
 #define I2C_CTRLBYTE_DATA   0x40
 
+//--------------------------------------------
+// Shorter blocks are sent without DMA (the stream setup takes longer)
+#define DMA_MIN_LENGTH      8
+
 //--------------------------------------------
 void hal_ssd1306_init(void)
 {
@@ -75,6 +79,34 @@ void hal_ssd1306_init(void)
 	// I2C_CR1:
 	// PE = 1: Peripheral enable
 	I2C1->CR1 |= I2C_CR1_PE;
+
+	// DMA1 clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+	// DMA stream disabled
+	DMA1_Stream6->CR &= ~DMA_SxCR_EN;
+	while (DMA1_Stream6->CR & DMA_SxCR_EN);
+
+	DMA1_Stream6->CR =  DMA_SxCR_CHSEL_0  | // Channel selection: (001) channel 1 (I2C1_TX)
+	                                        // Memory burst transfer configuration: (00) single transfer
+	                                        // Peripheral burst transfer configuration: (00) single transfer
+	                                        // Current target: (0) ignored
+	                                        // Double buffer mode: (0) No buffer switching at the end of transfer
+	                                        // Priority level: (00) Low
+	                                        // Peripheral increment offset size: (0) ignored
+	                                        // Memory data size: (00) 8-bit
+	                                        // Peripheral data size: (00) 8-bit
+	                    DMA_SxCR_MINC     | // Memory increment mode: (1) incremented after each data transfer
+	                                        // Peripheral increment mode: (0) Peripheral address pointer is fixed
+	                                        // Circular mode: (0) disabled
+	                    DMA_SxCR_DIR_0      // Data transfer direction: (01) Memory-to-peripheral
+	                                      ; // Peripheral flow controller: (0) DMA is the flow controller
+
+	DMA1_Stream6->FCR =                     // FIFO error interrupt: (0) disabled
+	                                        // FIFO status: These bits are read-only
+	                    DMA_SxFCR_DMDIS   | // Direct mode: (1) disable
+	                    DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1; // FIFO threshold selection: (11) full FIFO
+	DMA1_Stream6->PAR = (uint32_t)&(I2C1->DR);
 }
 
 //--------------------------------------------
@@ -118,6 +150,59 @@ static uint8_t i2c_writebyte(uint8_t data)
 	return I2C_SUCCESS;
 }
 
+//--------------------------------------------
+// The buffer must not be placed in the CCM RAM (it is not accessible by DMA)
+static uint8_t i2c_writeblock(const uint8_t *data, uint16_t length)
+{
+	uint32_t cnt;
+
+	if (length < DMA_MIN_LENGTH)
+	{
+		for (; length; length--)
+		{
+			if (i2c_writebyte(*data++) != I2C_SUCCESS)
+			{
+				return I2C_FAIL;
+			}
+		}
+		return I2C_SUCCESS;
+	}
+
+	// DMA stream disabled
+	DMA1_Stream6->CR &= ~DMA_SxCR_EN;
+	while (DMA1_Stream6->CR & DMA_SxCR_EN);
+
+	// Clear all the interrupt flags
+	DMA1->HIFCR = DMA_HIFCR_CTCIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6 | DMA_HIFCR_CHTIF6;
+
+	// Set the memory address and the number of 8-bit words to transfer
+	DMA1_Stream6->M0AR = (uint32_t)data;
+	DMA1_Stream6->NDTR = length;
+
+	// I2C_CR2:
+	// DMAEN = 1: DMA request enabled when TxE = 1
+	I2C1->CR2 |= I2C_CR2_DMAEN;
+
+	// DMA stream enabled
+	DMA1_Stream6->CR |= DMA_SxCR_EN;
+	for (cnt = 0; (cnt < (uint32_t)I2C_WAIT * length) && (DMA1_Stream6->CR & DMA_SxCR_EN); cnt++);
+	if (DMA1_Stream6->CR & DMA_SxCR_EN)
+	{
+		DMA1_Stream6->CR &= ~DMA_SxCR_EN;
+		I2C1->CR2 &= ~I2C_CR2_DMAEN;
+		return I2C_FAIL;
+	}
+
+	// the stop condition must not be generated before the last byte is sent
+	for (cnt = 0; (cnt < I2C_WAIT) && !(I2C1->SR1 & I2C_SR1_BTF); cnt++);
+	I2C1->CR2 &= ~I2C_CR2_DMAEN;
+	if (cnt == I2C_WAIT)
+	{
+		return I2C_FAIL;
+	}
+	return I2C_SUCCESS;
+}
+
 //--------------------------------------------
 static inline void i2c_slow(void)
 {
@@ -157,9 +242,27 @@ void hal_ssd1306_data(uint8_t data)
 	i2c_writebyte(data);
 }
 
+//--------------------------------------------
+void hal_ssd1306_data_block(const uint8_t *data, uint16_t length)
+{
+	i2c_writeblock(data, length);
+}
+
 //--------------------------------------------
 void hal_ssd1306_stopdata(void)
 {
 	i2c_stop();
 	i2c_slow();
 }
+
+//--------------------------------------------
+uint8_t hal_ssd1306_busy(void)
+{
+	return 0;
+}
+
+//--------------------------------------------
+uint8_t hal_ssd1306_error(void)
+{
+	return 0;
+}
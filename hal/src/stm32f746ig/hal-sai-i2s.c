@@ -74,6 +74,13 @@
 // 16, 24, 32 are allowed
 #define I2S_BITRES     16
 #endif
+#ifndef I2S_SLOTS
+// 2 (I2S), 4, 8 (TDM) are allowed
+#define I2S_SLOTS      2
+#endif
+#if I2S_SLOTS != 2 && I2S_SLOTS != 4 && I2S_SLOTS != 8
+#error "I2S_SLOTS: 2, 4 or 8 are allowed."
+#endif
 // For compatibility with the SPI-I2S interface, only 16 and 32-bit audio samples are used:
 #if I2S_BITRES == 16
 #define BYTES_PER_AUDIO_SAMPLE    2
@@ -91,6 +98,8 @@
 // fPLLI2SQ - I2S PLL clock
 // fSCLK - Sample clock, fSCLK = fFCLK * 'bits per frame' * 2, where 2 -> two channels (stereo)
 // fMCLK - Master clock, fMCLK = fFCLK * 256
+// TDM (I2S_SLOTS = 4 or 8): fSCLK = fFCLK * 'bits per slot' * I2S_SLOTS,
+// 8 slots of 32 bits: fSCLK = fMCLK
 // Base clocks in Hz:
 // +--------+-------------+-------------------+-----------------------+----------+
 // | fFCLK  |  fPLLSAIQ   |       fSCLK       |        fSCLK          |  fMCLK   |
@@ -123,6 +132,43 @@
 
 //--------------------------------------------
 static double i2s_mclk;
+// The DMA data size, changed by hal_sai_i2s_set_format()
+static uint8_t bytes_per_sample = BYTES_PER_AUDIO_SAMPLE;
+
+//--------------------------------------------
+// The audio frame of I2S_SLOTS slots of the sample size:
+// 2 slots - I2S, FS is the channel side,
+// 4 or 8 slots - TDM, FS is the one bit pulse before the first bit of the slot 0.
+// The frame is 32 ... 256 bits (a power of 2), so fSCLK = fMCLK * 'bits per frame' / 256.
+static void set_frame(uint8_t bytes)
+{
+	uint32_t bits;
+
+	bits = (uint32_t)bytes * 8 * I2S_SLOTS;
+#if I2S_SLOTS == 2
+	// FSOFF = 1: FS is asserted one bit before the first bit of the slot 0
+	// FSPOL = 0: FS is active low (falling edge)
+	// FSDEF = 1: FS signal is a start of frame signal + channel side identification
+	// FSALL[6:0]: the number of bits in the active level of the audio frame - 1 = 'bits per frame' / 2 - 1
+	// FRL[7:0]: the number of bits in the audio frame - 1
+	SAI2_Block_A->FRCR = SAI_xFRCR_FSOFF | SAI_xFRCR_FSDEF | ((bits / 2 - 1) << SAI_xFRCR_FSALL_Pos) | ((bits - 1) << SAI_xFRCR_FRL_Pos);
+#else
+	// FSOFF = 1: FS is asserted one bit before the first bit of the slot 0
+	// FSPOL = 1: FS is active high (rising edge)
+	// FSDEF = 0: FS signal is a start frame signal
+	// FSALL[6:0] = 0: FS is one bit wide
+	// FRL[7:0]: the number of bits in the audio frame - 1
+	SAI2_Block_A->FRCR = SAI_xFRCR_FSOFF | SAI_xFRCR_FSPOL | ((bits - 1) << SAI_xFRCR_FRL_Pos);
+#endif
+
+	//-----------------------------
+	// SLOTEN[15:0]: the slots of the frame are enabled
+	// NBSLOT[3:0]: Number of slots in an audio frame - 1
+	// FBOFF[4:0] = 0000: First bit offset
+	// SLOTSZ[1:0] = 01: 16-bit, 10: 32-bit
+	SAI2_Block_A->SLOTR = (((1U << I2S_SLOTS) - 1) << SAI_xSLOTR_SLOTEN_Pos) | ((I2S_SLOTS - 1) << SAI_xSLOTR_NBSLOT_Pos) |
+	                      ((bytes == 2) ? SAI_xSLOTR_SLOTSZ_0 : SAI_xSLOTR_SLOTSZ_1);
+}
 
 //--------------------------------------------
 void hal_sai_i2s_init(void)
@@ -239,34 +285,78 @@ void hal_sai_i2s_config(uint8_t master_transmit)
 	// FTH[2:0] = 000: FIFO threshold: FIFO empty
 	SAI2_Block_A->CR2 = 0; // reset value
 
-	//-----------------------------
-	// FSOFF = 1: FS is asserted one bit before the first bit of the slot 0
-	// FSPOL = 0: FS is active low (falling edge)
-	// FSDEF = 1: FS signal is a start of frame signal + channel side identification
-#if BYTES_PER_AUDIO_SAMPLE == 2
-	// FSALL[6:0] = 15: the number of bits in the active level of the audio frame - 1 = 16 - 1 = 15
-	// FRL[7:0] = 31: the number of bits in the audio frame - 1 = 32 - 1 = 31
-	SAI2_Block_A->FRCR = SAI_xFRCR_FSOFF | SAI_xFRCR_FSDEF | (15 << SAI_xFRCR_FSALL_Pos) | (31 << SAI_xFRCR_FRL_Pos);
-#else
-	// FSALL[6:0] = 31: the number of bits in the active level of the audio frame - 1 = 32 - 1 = 31
-	// FRL[7:0] = 63: the number of bits in the audio frame - 1 = 64 - 1 = 63
-	SAI2_Block_A->FRCR = SAI_xFRCR_FSOFF | SAI_xFRCR_FSDEF | (31 << SAI_xFRCR_FSALL_Pos) | (63 << SAI_xFRCR_FRL_Pos);
-#endif
+	set_frame(BYTES_PER_AUDIO_SAMPLE);
 
-	//-----------------------------
-	// SLOTEN[15:0] = 0xFFFF: All slots are enable
-	// NBSLOT[3:0] = 1: Number of slots in an audio frame - 1 = 2 - 1 = 1
-	// FBOFF[4:0] = 0000: First bit offset
-#if BYTES_PER_AUDIO_SAMPLE == 2
-	// SLOTSZ[1:0] = 01: 16-bit
-	SAI2_Block_A->SLOTR = (0xFFFFU << SAI_xSLOTR_SLOTEN_Pos) | SAI_xSLOTR_NBSLOT_0 | SAI_xSLOTR_SLOTSZ_0;
-#else
-	// SLOTSZ[1:0] = 10: 32-bit
-	SAI2_Block_A->SLOTR = (0xFFFFU << SAI_xSLOTR_SLOTEN_Pos) | SAI_xSLOTR_NBSLOT_0 | SAI_xSLOTR_SLOTSZ_1;
-#endif
+	// SAI enable
+	SAI2_Block_A->CR1 |= SAI_xCR1_SAIEN;
+}
+
+//--------------------------------------------
+// Changes the frame clock and the resolution set by I2S_FCLK and I2S_BITRES
+// (the DMA must be stopped):
+// fclk: 8000, 12000, 16000, 24000, 32000, 48000, 96000, 192000 Hz (fPLLSAIQ = 98333333.33 Hz) or
+//       11025, 22050, 44100, 88200, 176400 Hz (fPLLSAIQ = 90333333.33 Hz)
+// bitres: 16, 24, 32
+// fMCLK = fFCLK * 256 = fPLLSAIQ / (PLLSAIDIVQ*MCKDIV*2), MCKDIV is 4-bit wide,
+// so the lower rates are divided by PLLSAIDIVQ as well.
+// Returns 0 on success, 1 if the rate can't be generated.
+uint8_t hal_sai_i2s_set_format(uint32_t fclk, uint8_t bitres)
+{
+	double i2s_clk;
+	double real_fclk;
+	uint32_t pll_n;
+	uint32_t div;
+	uint32_t divq;
+	uint32_t reg;
+
+	pll_n = (fclk % 11025) ? 295 : 271;
+	i2s_clk = (double)HSE_VALUE / 6.0 * (double)pll_n / (double)PLL_SAI_Q;
+	div = (uint32_t)(i2s_clk / ((double)fclk * 2 * 256) + 0.5);
+	for (divq = 1; divq <= 32 && (div % divq || div / divq > 15); divq++);
+	if (!div || divq > 32)
+	{
+		return 1;
+	}
+	real_fclk = i2s_clk / ((double)div * 2 * 256);
+	if (real_fclk > fclk * 1.002 || real_fclk < fclk * 0.998)
+	{
+		return 1;
+	}
+
+	// SAI disable
+	SAI2_Block_A->CR1 &= ~SAI_xCR1_SAIEN;
+	while (SAI2_Block_A->CR1 & SAI_xCR1_SAIEN);
+
+	// PLLSAI reconfiguration
+	RCC->CR &= ~RCC_CR_PLLSAION;
+	while (RCC->CR & RCC_CR_PLLSAIRDY);
+	RCC->PLLSAICFGR = (RCC->PLLSAICFGR & ~RCC_PLLSAICFGR_PLLSAIN) | (pll_n << RCC_PLLSAICFGR_PLLSAIN_Pos);
+	// PLLSAIDIVQ[4:0] = divq - 1
+	RCC->DCKCFGR1 = (RCC->DCKCFGR1 & ~RCC_DCKCFGR1_PLLSAIDIVQ) | ((divq - 1) << RCC_DCKCFGR1_PLLSAIDIVQ_Pos);
+	RCC->CR |= RCC_CR_PLLSAION;
+	while (!(RCC->CR & RCC_CR_PLLSAIRDY));
+
+	bytes_per_sample = (bitres == 16) ? 2 : 4;
+	// MODE[1:0] is kept
+	reg = SAI2_Block_A->CR1 & SAI_xCR1_MODE;
+	reg |= (div / divq) << SAI_xCR1_MCKDIV_Pos;
+	if (bytes_per_sample == 2)
+	{
+		// DS[2:0] = 100: Data size - 16 bits
+		reg |= SAI_xCR1_DS_2;
+	}
+	else
+	{
+		// DS[2:0] = 111: Data size - 32 bits
+		reg |= SAI_xCR1_DS_2 | SAI_xCR1_DS_1 | SAI_xCR1_DS_0;
+	}
+	set_frame(bytes_per_sample);
+	SAI2_Block_A->CR1 = reg;
+	i2s_mclk = real_fclk * 256;
 
 	// SAI enable
 	SAI2_Block_A->CR1 |= SAI_xCR1_SAIEN;
+	return 0;
 }
 
 //--------------------------------------------
@@ -404,6 +494,49 @@ void hal_sai_i2s_init_dma_tx_buf_cycle(void)
 #endif
 }
 
+//--------------------------------------------
+void hal_sai_i2s_init_dma_rx_buf_cycle(void)
+{
+	// DMA2 clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+	// DMA stream disable
+	DMA2_Stream4->CR &= ~DMA_SxCR_EN;
+	while (DMA2_Stream4->CR & DMA_SxCR_EN);
+
+	DMA2_Stream4->CR =  DMA_SxCR_CHSEL_0 | DMA_SxCR_CHSEL_1 | // Channel selection: (011) channel 3
+	                                       // Memory burst transfer configuration: (00) single transfer
+	                                       // Peripheral burst transfer configuration: (00) single transfer
+	                                       // Current target: (0) ignored
+	                                       // Double buffer mode: (0) No buffer switching at the end of transfer
+	                    DMA_SxCR_PL_0 | DMA_SxCR_PL_1 | // Priority level: (11) Very high
+	                                       // Peripheral increment offset size: (0) ignored
+#if BYTES_PER_AUDIO_SAMPLE == 2
+	                    DMA_SxCR_MSIZE_0 | // Memory data size: (01) 16-bit
+	                    DMA_SxCR_PSIZE_0 | // Peripheral data size: (01) 16-bit
+#else
+						DMA_SxCR_MSIZE_1 | // Memory data size: (10) 32-bit
+						DMA_SxCR_PSIZE_1 | // Peripheral data size: (10) 32-bit
+#endif
+	                    DMA_SxCR_MINC |    // Memory increment mode: (1) incremented after each data transfer
+	                                       // Peripheral increment mode: (0) Peripheral address pointer is fixed
+	                    DMA_SxCR_CIRC      // Circular mode: (1) enabled
+	                                       // Data transfer direction: (00) Peripheral-to-memory
+	                                     ; // Peripheral flow controller: (0) DMA is the flow controller
+
+	DMA2_Stream4->FCR =                     // FIFO error interrupt: (0) disabled
+	                                        // FIFO status: These bits are read-only
+	                    DMA_SxFCR_DMDIS   | // Direct mode: (1) disable
+	                    DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1; // FIFO threshold selection: (11) full FIFO
+
+#if 1
+	// set sai2 dma global interrupt priority
+	NVIC_SetPriority(DMA2_Stream4_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), DMA_SAI2_IRQ_PREEMPT_PRIORITY, 0));
+	// enable sai2 dma global interrupt
+	NVIC_EnableIRQ(DMA2_Stream4_IRQn);
+#endif
+}
+
 //--------------------------------------------
 void hal_sai_i2s_write_dma_buf(void *txbuf, uint32_t length)
 {
@@ -421,13 +554,17 @@ void hal_sai_i2s_write_dma_buf(void *txbuf, uint32_t length)
 	DMA2_Stream4->PAR = (uint32_t)&(SAI2_Block_A->DR);
 	DMA2_Stream4->M0AR = (uint32_t)txbuf;
 
-#if BYTES_PER_AUDIO_SAMPLE == 2
-	// Set the number of 16-bit words to transfer
-	DMA2_Stream4->NDTR = length / sizeof(uint16_t);
-#else
-	// Set the number of 32-bit words to transfer
-	DMA2_Stream4->NDTR = length / sizeof(uint32_t);
-#endif
+	// Set the data size and the number of 16-bit (32-bit) words to transfer
+	DMA2_Stream4->CR &= ~(DMA_SxCR_MSIZE | DMA_SxCR_PSIZE);
+	if (bytes_per_sample == 2)
+	{
+		DMA2_Stream4->CR |= DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0;
+	}
+	else
+	{
+		DMA2_Stream4->CR |= DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1;
+	}
+	DMA2_Stream4->NDTR = length / bytes_per_sample;
 
 	// Enable interrupts
 	DMA2_Stream4->CR |= DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_HTIE;
@@ -457,13 +594,17 @@ void hal_sai_i2s_write_dma_buf_stop(void *txbuf, uint32_t length, uint32_t timeo
 	DMA2_Stream4->PAR = (uint32_t)&(SAI2_Block_A->DR);
 	DMA2_Stream4->M0AR = (uint32_t)txbuf;
 
-#if BYTES_PER_AUDIO_SAMPLE == 2
-	// Set the number of 16-bit words to transfer
-	DMA2_Stream4->NDTR = length / sizeof(uint16_t);
-#else
-	// Set the number of 32-bit words to transfer
-	DMA2_Stream4->NDTR = length / sizeof(uint32_t);
-#endif
+	// Set the data size and the number of 16-bit (32-bit) words to transfer
+	DMA2_Stream4->CR &= ~(DMA_SxCR_MSIZE | DMA_SxCR_PSIZE);
+	if (bytes_per_sample == 2)
+	{
+		DMA2_Stream4->CR |= DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0;
+	}
+	else
+	{
+		DMA2_Stream4->CR |= DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1;
+	}
+	DMA2_Stream4->NDTR = length / bytes_per_sample;
 
 	// Enable interrupts
 	DMA2_Stream4->CR |= DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_HTIE;
@@ -499,6 +640,12 @@ void hal_sai_i2s_stop_dma(void)
 	SAI2_Block_A->CR1 &= ~SAI_xCR1_DMAEN;
 }
 
+//--------------------------------------------
+// The number of bytes remaining to transfer till the end of the buffer
+uint32_t hal_sai_i2s_get_dma_remain(void)
+{
+	return DMA2_Stream4->NDTR * bytes_per_sample;
+}
 
 #if 1
 //--------------------------------------------
@@ -73,6 +73,9 @@
 // 16, 24, 32 are allowed
 #define I2S_BITRES     16
 #endif
+#if defined I2S_SLOTS && I2S_SLOTS != 2
+#error "SPI-I2S: only 2 slots (I2S) are supported, the TDM needs the SAI interface."
+#endif
 // Based on the specificity of the SPI-I2S interface, only 16-bit and 32-bit variants may be used:
 #if I2S_BITRES == 16
 #define BYTES_PER_AUDIO_SAMPLE    2
@@ -335,6 +338,80 @@ void hal_spi_i2s_config(uint8_t master_transmit)
 	SPI2->I2SCFGR = reg;
 }
 
+//--------------------------------------------
+// Changes the frame clock and the resolution set by I2S_FCLK and I2S_BITRES
+// (the DMA must be stopped):
+// fclk: 8000, 12000, 16000, 24000, 32000, 48000, 96000, 192000 Hz (fPLLI2SR = 98333333.33 Hz) or
+//       11025, 22050, 44100, 88200, 176400 Hz (fPLLI2SR = 90333333.33 Hz)
+// bitres: 16, 24, 32
+// Returns 0 on success, 1 if the rate can't be generated.
+uint8_t hal_spi_i2s_set_format(uint32_t fclk, uint8_t bitres)
+{
+	double i2s_clk;
+	double real_fclk;
+	uint32_t pll_n;
+	uint32_t div;
+	uint32_t reg;
+
+	pll_n = (fclk % 11025) ? 295 : 271;
+	i2s_clk = (double)HSE_VALUE / 6.0 * (double)pll_n / (double)PLL_I2S_R;
+#if I2S_MCLK == 1
+	// fFCLK = fPLLI2SR / (256*((2*I2SDIV) + ODD))
+	div = (uint32_t)(i2s_clk / ((double)fclk * 256) + 0.5);
+	real_fclk = i2s_clk / ((double)div * 256);
+#else
+	// fFCLK = fPLLI2SR / (32*(CHLEN+1)*((2*I2SDIV) + ODD))
+	div = (uint32_t)(i2s_clk / ((double)fclk * 32 * ((bitres == 16) ? 1 : 2)) + 0.5);
+	real_fclk = i2s_clk / ((double)div * 32 * ((bitres == 16) ? 1 : 2));
+#endif
+	if (div < 2 || div / 2 > 0xFF)
+	{
+		return 1;
+	}
+	if (real_fclk > fclk * 1.002 || real_fclk < fclk * 0.998)
+	{
+		return 1;
+	}
+
+	// I2S disable
+	SPI2->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+
+	// PLLI2S reconfiguration
+	RCC->CR &= ~RCC_CR_PLLI2SON;
+	while (RCC->CR & RCC_CR_PLLI2SRDY);
+	RCC->PLLI2SCFGR = (RCC->PLLI2SCFGR & ~RCC_PLLI2SCFGR_PLLI2SN) | (pll_n << RCC_PLLI2SCFGR_PLLI2SN_Pos);
+	RCC->CR |= RCC_CR_PLLI2SON;
+	while (!(RCC->CR & RCC_CR_PLLI2SRDY));
+
+	// I2SDIV[7:0] = div / 2, ODD = div % 2
+	reg = ((div / 2) << SPI_I2SPR_I2SDIV_Pos) | ((div & 1) ? SPI_I2SPR_ODD : 0);
+#if I2S_MCLK == 1
+	reg |= SPI_I2SPR_MCKOE;
+#endif
+	SPI2->I2SPR = reg;
+	i2s_mclk = real_fclk * 256;
+
+	// I2SCFG[9:8] is kept
+	reg = (SPI2->I2SCFGR & SPI_I2SCFGR_I2SCFG) | SPI_I2SCFGR_I2SMOD;
+	if (bitres == 24)
+	{
+		// DATLEN[2:1] = 01: 24-bit data length
+		// CHLEN = 1: 32 bits per audio channel
+		reg |= SPI_I2SCFGR_DATLEN_0 | SPI_I2SCFGR_CHLEN;
+	}
+	else if (bitres == 32)
+	{
+		// DATLEN[2:1] = 10: 32-bit data length
+		// CHLEN = 1: 32 bits per audio channel
+		reg |= SPI_I2SCFGR_DATLEN_1 | SPI_I2SCFGR_CHLEN;
+	}
+	SPI2->I2SCFGR = reg;
+
+	// I2S enable
+	SPI2->I2SCFGR |= SPI_I2SCFGR_I2SE;
+	return 0;
+}
+
 //--------------------------------------------
 // Full reset, see comment to hal_i2s_stop_dma_tx() function
 void hal_spi_i2s_reset(void)
@@ -626,6 +703,29 @@ void hal_spi_i2s_stop_dma_tx(void)
 	SPI2->CR2 &= ~SPI_CR2_TXDMAEN;
 }
 
+//--------------------------------------------
+void hal_spi_i2s_stop_dma_rx(void)
+{
+	// DMA stream disable
+	DMA1_Stream3->CR &= ~DMA_SxCR_EN;
+	while (DMA1_Stream3->CR & DMA_SxCR_EN);
+	// SPI2 DMA disable
+	SPI2->CR2 &= ~SPI_CR2_RXDMAEN;
+}
+
+//--------------------------------------------
+// The number of bytes remaining to transfer till the end of the buffer
+uint32_t hal_spi_i2s_get_dma_tx_remain(void)
+{
+	return DMA1_Stream4->NDTR * sizeof(uint16_t);
+}
+
+//--------------------------------------------
+uint32_t hal_spi_i2s_get_dma_rx_remain(void)
+{
+	return DMA1_Stream3->NDTR * sizeof(uint16_t);
+}
+
 #if 1
 //--------------------------------------------
 __WEAK void hal_spi_i2s_tx_irq_htif_callback(void)
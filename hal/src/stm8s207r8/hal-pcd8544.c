@@ -83,3 +83,12 @@ void hal_pcd8544_tx(uint8_t data)
 	SPI_DR = data;
 	while (!(SPI_SR & (1 << SPI_SR_TXE)));
 }
+
+//--------------------------------------------
+void hal_pcd8544_tx_block(const uint8_t *data, uint16_t length)
+{
+	for (; length; length--)
+	{
+		hal_pcd8544_tx(*data++);
+	}
+}
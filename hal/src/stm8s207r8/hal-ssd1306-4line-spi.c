@@ -106,8 +106,29 @@ void hal_ssd1306_data(uint8_t data)
 	spi_tx(data);
 }
 
+//--------------------------------------------
+void hal_ssd1306_data_block(const uint8_t *data, uint16_t length)
+{
+	for (; length; length--)
+	{
+		spi_tx(*data++);
+	}
+}
+
 //--------------------------------------------
 void hal_ssd1306_stopdata(void)
 {
 	spi_release();
 }
+
+//--------------------------------------------
+uint8_t hal_ssd1306_busy(void)
+{
+	return 0;
+}
+
+//--------------------------------------------
+uint8_t hal_ssd1306_error(void)
+{
+	return 0;
+}
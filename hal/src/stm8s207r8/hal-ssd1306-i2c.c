@@ -118,9 +118,30 @@ void hal_ssd1306_data(uint8_t data)
 	i2c_writebyte(data);
 }
 
+//--------------------------------------------
+void hal_ssd1306_data_block(const uint8_t *data, uint16_t length)
+{
+	for (; length; length--)
+	{
+		i2c_writebyte(*data++);
+	}
+}
+
 //--------------------------------------------
 void hal_ssd1306_stopdata(void)
 {
 	i2c_stop();
 	i2c_slow();
 }
+
+//--------------------------------------------
+uint8_t hal_ssd1306_busy(void)
+{
+	return 0;
+}
+
+//--------------------------------------------
+uint8_t hal_ssd1306_error(void)
+{
+	return 0;
+}
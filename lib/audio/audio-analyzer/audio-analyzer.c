@@ -0,0 +1,466 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-analyzer.h"
+#include <string.h>
+#include <math.h>
+
+//--------------------------------------------
+#define PI_F                      3.14159265f
+// The FFT passes: the radix-4 (radix-2) passes are done by the group size
+#define PASS_IDLE                 0
+#define PASS_GROUP                1
+#define PASS_REVERSE              2
+#define PASS_SPLIT                3
+
+//--------------------------------------------
+// Hann window * 2 / sum(window) / 2^31, size / 2 + 1 values (symmetric)
+static float *window;
+// W(k) = exp(-2 pi i k / size), k = 0 ... 3 / 4 size - 1 (re, im)
+static float *twiddle;
+// The frame collected by the interrupt (the windowed samples)
+static float *frame;
+// The size / 2 complex values
+static float *work;
+static float *power;
+static uint16_t fft_size;
+static uint32_t sample_rate;
+static uint8_t frame_channels;
+static uint8_t spectrum_channel;
+static volatile uint16_t frame_pos;
+static volatile uint8_t frame_full;
+static uint8_t pass;
+static uint16_t group;
+// The meters
+static uint32_t peak_acc[AUDIO_ANALYZER_CHANNELS];
+static uint64_t square_acc[AUDIO_ANALYZER_CHANNELS];
+static uint16_t meter_pos;
+static volatile uint32_t peak_last[AUDIO_ANALYZER_CHANNELS];
+// The mean square, 1.0 - the full scale
+static volatile float square_last[AUDIO_ANALYZER_CHANNELS];
+// The statistics
+static uint64_t put_cycles;
+static uint32_t put_frames;
+static uint64_t fft_cycles;
+static uint32_t fft_cycles_cur;
+static uint32_t spectra;
+static uint32_t skipped_samples;
+
+//--------------------------------------------
+static inline float get_window(uint16_t pos)
+{
+	return window[(pos <= fft_size / 2) ? pos : fft_size - pos];
+}
+
+//--------------------------------------------
+static int16_t level(float value)
+{
+	float db;
+
+	if (value <= 0)
+	{
+		return AUDIO_ANALYZER_LEVEL_MIN;
+	}
+	db = 100.0f * log10f(value);
+	return (db < AUDIO_ANALYZER_LEVEL_MIN) ? AUDIO_ANALYZER_LEVEL_MIN : (int16_t)db;
+}
+
+//--------------------------------------------
+// Two radix-2 DIF passes in one (radix-2^2): the groups of size = 4 q,
+// the butterfly of x(j), x(j + q), x(j + 2 q), x(j + 3 q) with W^j, W^2j, W^3j, W = W(size / group)
+static void radix4_pass(float *data, uint16_t points, uint16_t size)
+{
+	float *x0, *x1, *x2, *x3;
+	float t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i;
+	float ar, ai, br, bi;
+	const float *w;
+	uint16_t stride;
+	uint16_t q;
+	uint16_t start;
+	uint16_t j;
+
+	q = size / 4;
+	stride = fft_size / size;
+	for (start = 0; start < points; start += size)
+	{
+		x0 = data + start * 2;
+		x1 = x0 + q * 2;
+		x2 = x1 + q * 2;
+		x3 = x2 + q * 2;
+		for (j = 0; j < q; j++)
+		{
+			t0r = x0[0] + x2[0];
+			t0i = x0[1] + x2[1];
+			t1r = x0[0] - x2[0];
+			t1i = x0[1] - x2[1];
+			t2r = x1[0] + x3[0];
+			t2i = x1[1] + x3[1];
+			t3r = x1[0] - x3[0];
+			t3i = x1[1] - x3[1];
+			x0[0] = t0r + t2r;
+			x0[1] = t0i + t2i;
+			// (t0 - t2) W^2j
+			ar = t0r - t2r;
+			ai = t0i - t2i;
+			w = twiddle + 2 * 2 * j * stride;
+			x1[0] = ar * w[0] - ai * w[1];
+			x1[1] = ar * w[1] + ai * w[0];
+			// (t1 - i t3) W^j
+			ar = t1r + t3i;
+			ai = t1i - t3r;
+			w = twiddle + 2 * j * stride;
+			x2[0] = ar * w[0] - ai * w[1];
+			x2[1] = ar * w[1] + ai * w[0];
+			// (t1 + i t3) W^3j
+			br = t1r - t3i;
+			bi = t1i + t3r;
+			w = twiddle + 2 * 3 * j * stride;
+			x3[0] = br * w[0] - bi * w[1];
+			x3[1] = br * w[1] + bi * w[0];
+			x0 += 2;
+			x1 += 2;
+			x2 += 2;
+			x3 += 2;
+		}
+	}
+}
+
+//--------------------------------------------
+// The last radix-2 pass (the groups of 2, no twiddles)
+static void radix2_pass(float *data, uint16_t points)
+{
+	float tr, ti;
+	uint16_t cnt;
+
+	for (cnt = 0; cnt < points; cnt += 2, data += 4)
+	{
+		tr = data[0] - data[2];
+		ti = data[1] - data[3];
+		data[0] += data[2];
+		data[1] += data[3];
+		data[2] = tr;
+		data[3] = ti;
+	}
+}
+
+//--------------------------------------------
+static void bit_reverse(float *data, uint16_t points)
+{
+	float tr, ti;
+	uint16_t i, j, bit;
+
+	for (i = 1, j = 0; i < points; i++)
+	{
+		for (bit = points >> 1; j & bit; bit >>= 1)
+		{
+			j ^= bit;
+		}
+		j |= bit;
+		if (i < j)
+		{
+			tr = data[i * 2];
+			ti = data[i * 2 + 1];
+			data[i * 2] = data[j * 2];
+			data[i * 2 + 1] = data[j * 2 + 1];
+			data[j * 2] = tr;
+			data[j * 2 + 1] = ti;
+		}
+	}
+}
+
+//--------------------------------------------
+// The spectrum of the real frame from the spectrum Z of z(n) = x(2n) + i x(2n + 1), M = size / 2:
+// X(k) = (Z(k) + Z*(M - k)) / 2 - i W(k) (Z(k) - Z*(M - k)) / 2
+static void split(const float *data, float *out)
+{
+	const float *w;
+	float er, ei, odr, odi;
+	float xr, xi;
+	uint16_t points;
+	uint16_t k, m;
+
+	points = fft_size / 2;
+	out[0] = (data[0] + data[1]) * (data[0] + data[1]);
+	out[points] = (data[0] - data[1]) * (data[0] - data[1]);
+	for (k = 1; k < points; k++)
+	{
+		m = points - k;
+		er = (data[k * 2] + data[m * 2]) * 0.5f;
+		ei = (data[k * 2 + 1] - data[m * 2 + 1]) * 0.5f;
+		odr = (data[k * 2 + 1] + data[m * 2 + 1]) * 0.5f;
+		odi = (data[m * 2] - data[k * 2]) * 0.5f;
+		w = twiddle + 2 * k;
+		xr = er + odr * w[0] - odi * w[1];
+		xi = ei + odr * w[1] + odi * w[0];
+		out[k] = xr * xr + xi * xi;
+	}
+}
+
+//--------------------------------------------
+// Returns 1 when the spectrum is calculated
+static uint8_t fft_step(void)
+{
+	switch (pass)
+	{
+	case PASS_GROUP:
+		if (group >= 4)
+		{
+			radix4_pass(work, fft_size / 2, group);
+			group /= 4;
+		}
+		else
+		{
+			if (group == 2)
+			{
+				radix2_pass(work, fft_size / 2);
+			}
+			pass = PASS_REVERSE;
+		}
+		break;
+	case PASS_REVERSE:
+		bit_reverse(work, fft_size / 2);
+		pass = PASS_SPLIT;
+		break;
+	case PASS_SPLIT:
+		split(work, power);
+		pass = PASS_IDLE;
+		return 1;
+	}
+	return 0;
+}
+
+//--------------------------------------------
+void audio_analyzer_init(void *buf, uint16_t size, uint32_t rate, uint8_t channels)
+{
+	uint16_t cnt;
+
+	fft_size = size;
+	sample_rate = rate;
+	frame_channels = channels;
+	window = (float *)buf;
+	twiddle = window + size / 2 + 1;
+	frame = twiddle + size * 3 / 2;
+	work = frame + size;
+	power = work + size;
+	for (cnt = 0; cnt <= size / 2; cnt++)
+	{
+		// the sum of the Hann window is size / 2
+		window[cnt] = (0.5f - 0.5f * cosf(2 * PI_F * cnt / size)) * 4 / size / 2147483648.0f;
+	}
+	for (cnt = 0; cnt < size * 3 / 4; cnt++)
+	{
+		twiddle[cnt * 2] = cosf(2 * PI_F * cnt / size);
+		twiddle[cnt * 2 + 1] = -sinf(2 * PI_F * cnt / size);
+	}
+	memset(power, 0, (size / 2 + 1) * sizeof(float));
+	memset(peak_acc, 0, sizeof(peak_acc));
+	memset(square_acc, 0, sizeof(square_acc));
+	memset((void *)peak_last, 0, sizeof(peak_last));
+	memset((void *)square_last, 0, sizeof(square_last));
+	meter_pos = 0;
+	spectrum_channel = 0;
+	frame_pos = 0;
+	frame_full = 0;
+	pass = PASS_IDLE;
+	audio_analyzer_reset_stats();
+}
+
+//--------------------------------------------
+void audio_analyzer_set_channel(uint8_t channel)
+{
+	spectrum_channel = channel;
+}
+
+//--------------------------------------------
+void audio_analyzer_put(const uint32_t *samples, uint32_t frames)
+{
+	uint32_t start;
+	uint32_t sample;
+	int32_t value;
+	float mix;
+	uint16_t pos;
+	uint8_t ch;
+
+	start = DWT->CYCCNT;
+	put_frames += frames;
+	pos = frame_pos;
+	for (; frames; frames--)
+	{
+		for (ch = 0, mix = 0; ch < frame_channels; ch++)
+		{
+			value = (int32_t)samples[ch];
+			sample = (value < 0) ? 0 - (uint32_t)value : (uint32_t)value;
+			if (sample > peak_acc[ch])
+			{
+				peak_acc[ch] = sample;
+			}
+			value >>= 16;
+			square_acc[ch] += (uint32_t)(value * value);
+			mix += (float)(int32_t)samples[ch];
+		}
+		if (++meter_pos == fft_size)
+		{
+			for (ch = 0; ch < frame_channels; ch++)
+			{
+				peak_last[ch] = peak_acc[ch];
+				// (2^15)^2 - the full scale
+				square_last[ch] = (float)square_acc[ch] / ((float)fft_size * 1073741824.0f);
+				peak_acc[ch] = 0;
+				square_acc[ch] = 0;
+			}
+			meter_pos = 0;
+		}
+		if (frame_full)
+		{
+			skipped_samples++;
+		}
+		else
+		{
+			if (spectrum_channel == AUDIO_ANALYZER_MIX)
+			{
+				mix /= frame_channels;
+			}
+			else
+			{
+				mix = (float)(int32_t)samples[spectrum_channel];
+			}
+			frame[pos] = mix * get_window(pos);
+			if (++pos == fft_size)
+			{
+				pos = 0;
+				frame_full = 1;
+			}
+		}
+		samples += frame_channels;
+	}
+	frame_pos = pos;
+	put_cycles += DWT->CYCCNT - start;
+}
+
+//--------------------------------------------
+uint8_t audio_analyzer_process(void)
+{
+	uint32_t start;
+	uint8_t res;
+
+	start = DWT->CYCCNT;
+	if (pass == PASS_IDLE)
+	{
+		if (!frame_full)
+		{
+			return 0;
+		}
+		memcpy(work, frame, fft_size * sizeof(float));
+		frame_full = 0;
+		fft_cycles_cur = 0;
+		group = fft_size / 2;
+		pass = PASS_GROUP;
+		res = 0;
+	}
+	else
+	{
+		res = fft_step();
+	}
+	fft_cycles_cur += DWT->CYCCNT - start;
+	if (res)
+	{
+		fft_cycles += fft_cycles_cur;
+		spectra++;
+	}
+	return res;
+}
+
+//--------------------------------------------
+const float *audio_analyzer_transform(const int32_t *samples)
+{
+	uint16_t cnt;
+
+	for (cnt = 0; cnt < fft_size; cnt++)
+	{
+		work[cnt] = (float)samples[cnt] * get_window(cnt);
+	}
+	group = fft_size / 2;
+	pass = PASS_GROUP;
+	while (!fft_step());
+	return power;
+}
+
+//--------------------------------------------
+void audio_analyzer_get_levels(uint8_t channel, int16_t *peak, int16_t *rms)
+{
+	float value;
+
+	value = (float)peak_last[channel] / 2147483648.0f;
+	// 20 log10(peak / 2^31)
+	*peak = level(value * value);
+	*rms = level(square_last[channel]);
+}
+
+//--------------------------------------------
+const float *audio_analyzer_get_power(void)
+{
+	return power;
+}
+
+//--------------------------------------------
+int16_t audio_analyzer_get_band(uint32_t freq_lo, uint32_t freq_hi)
+{
+	float sum;
+	uint32_t bin;
+	uint32_t last;
+
+	// the nearest bins
+	bin = (freq_lo * fft_size + sample_rate / 2) / sample_rate;
+	last = (freq_hi * fft_size + sample_rate / 2) / sample_rate;
+	if (last > fft_size / 2)
+	{
+		last = fft_size / 2;
+	}
+	for (sum = 0; bin <= last; bin++)
+	{
+		sum += power[bin];
+	}
+	// the equivalent noise bandwidth of the Hann window is 1.5 bins
+	return level(sum / 1.5f);
+}
+
+//--------------------------------------------
+void audio_analyzer_get_stats(audio_analyzer_stats_t *stats)
+{
+	uint64_t cycles;
+	uint32_t frames;
+
+	stats->put_cycles = put_frames ? (uint32_t)(put_cycles * 100 / put_frames) : 0;
+	stats->fft_cycles = spectra ? (uint32_t)(fft_cycles / spectra) : 0;
+	stats->spectra = spectra;
+	stats->skipped = skipped_samples / fft_size;
+	// the cycles per second: every frame is metered, the spectra of the frames taken are calculated
+	frames = spectra + stats->skipped;
+	cycles = (uint64_t)stats->put_cycles * sample_rate / 100;
+	if (frames)
+	{
+		cycles += (uint64_t)stats->fft_cycles * sample_rate / fft_size * spectra / frames;
+	}
+	stats->load = (uint32_t)(cycles * 10000 / SystemCoreClock);
+}
+
+//--------------------------------------------
+void audio_analyzer_reset_stats(void)
+{
+	put_cycles = 0;
+	put_frames = 0;
+	fft_cycles = 0;
+	spectra = 0;
+	skipped_samples = 0;
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#ifndef AUDIO_ANALYZER_H_
+#define AUDIO_ANALYZER_H_
+
+//--------------------------------------------
+// Level meters and spectrum analyzer of the audio input:
+// audio_analyzer_put is called by the DMA interrupt for every received block
+// of the 32-bit (24-bit MSB aligned, CPU order) interleaved samples.
+// It updates the peak and RMS meters of every channel and collects the frame of
+// AUDIO_ANALYZER_SIZE samples (one channel or the mix), the Hann window is applied on the fly.
+// The frame is transformed by the main loop incrementally (one FFT pass per
+// audio_analyzer_process call), so the analysis never takes the interrupt time
+// and the main loop keeps its latency; the blocks received while the previous frame
+// is not taken by the main loop are metered, but not analyzed.
+// The N-point real FFT is the N/2-point complex FFT (radix-4 passes,
+// one radix-2 pass if log2(N/2) is odd, in place, float32 for the Cortex-M4F/M7 FPU)
+// followed by the real split. The power spectrum is normalized to the full scale
+// sine (0 dBFS at its bin).
+// The CPU cycles of the metering and of the FFT are counted by the DWT cycle counter.
+// The functions are not reentrant.
+// The host test (test/, make test) checks the spectrum against the double precision DFT.
+//
+// static uint32_t analyzer_buf[AUDIO_ANALYZER_BUF_SIZE(1024) / sizeof(uint32_t)];
+// audio_analyzer_init(analyzer_buf, 1024, 48000, 2);
+// rx_half_callback: audio_analyzer_put(half_buf, frames);
+// if (audio_analyzer_process())
+// {
+//     db = audio_analyzer_get_band(900, 1100);
+// }
+
+#ifndef AUDIO_ANALYZER_CHANNELS
+#define AUDIO_ANALYZER_CHANNELS        2
+#endif
+// The spectrum channel: the average of all the channels
+#define AUDIO_ANALYZER_MIX             0xFF
+
+// The levels are in 0.1 dBFS, the silence is AUDIO_ANALYZER_LEVEL_MIN
+#define AUDIO_ANALYZER_LEVEL_MIN       (-1200)
+
+#define AUDIO_ANALYZER_SIZE_MIN        64
+#define AUDIO_ANALYZER_SIZE_MAX        4096
+// The window (size / 2 + 1), the twiddles (3 / 4 size complex), the frame (size),
+// the FFT data (size / 2 complex) and the power spectrum (size / 2 + 1)
+#define AUDIO_ANALYZER_BUF_SIZE(size)  ((uint32_t)((size) * 9 / 2 + 2) * sizeof(float))
+
+typedef struct audio_analyzer_stats
+{
+	uint32_t put_cycles;      // the CPU cycles per frame of audio_analyzer_put * 100
+	uint32_t fft_cycles;      // the CPU cycles per spectrum
+	uint32_t spectra;         // the spectra calculated
+	uint32_t skipped;         // the frames not analyzed (the main loop is late)
+	uint32_t load;            // the CPU load of the metering and the analysis, 0.01 %
+} audio_analyzer_stats_t;
+
+// buf: AUDIO_ANALYZER_BUF_SIZE(size) bytes, 4 byte aligned
+// size: the FFT size, a power of 2 (AUDIO_ANALYZER_SIZE_MIN ... AUDIO_ANALYZER_SIZE_MAX)
+// channels: the interleaved channels of the samples (up to AUDIO_ANALYZER_CHANNELS)
+// The spectrum channel is 0
+void audio_analyzer_init(void *buf, uint16_t size, uint32_t rate, uint8_t channels);
+// channel: 0 ... channels - 1, AUDIO_ANALYZER_MIX
+void audio_analyzer_set_channel(uint8_t channel);
+// The interrupt context
+void audio_analyzer_put(const uint32_t *samples, uint32_t frames);
+// Call it from the main loop: at most one FFT pass per call,
+// returns 1 when the new spectrum is calculated
+uint8_t audio_analyzer_process(void);
+// The frame (size samples of one channel) is transformed at once,
+// the spectrum in progress is dropped, returns the power spectrum
+const float *audio_analyzer_transform(const int32_t *samples);
+// The peak and the RMS level of the last metered frame (size samples)
+void audio_analyzer_get_levels(uint8_t channel, int16_t *peak, int16_t *rms);
+// The power of the bins 0 ... size / 2 (the bin width is rate / size)
+const float *audio_analyzer_get_power(void);
+// The level of the band in 0.1 dBFS: the power of the bins of freq_lo ... freq_hi Hz
+// over the equivalent noise bandwidth of the window (the tone in the band is measured at its level)
+int16_t audio_analyzer_get_band(uint32_t freq_lo, uint32_t freq_hi);
+void audio_analyzer_get_stats(audio_analyzer_stats_t *stats);
+void audio_analyzer_reset_stats(void);
+
+#endif // AUDIO_ANALYZER_H_
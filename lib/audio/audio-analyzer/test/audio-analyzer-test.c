@@ -0,0 +1,205 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host test of the audio analyzer:
+// - the power spectrum of every FFT size against the double precision DFT
+//   of the same Hann windowed frame (two sines and noise),
+// - the peak and RMS meters, the band levels and the spectrum channel selection
+//   with the blocks of the stereo samples put incrementally.
+// Exit status 1 if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "platform.h"
+#include "audio-analyzer.h"
+
+//--------------------------------------------
+#define PI                  3.14159265358979323846
+#define FULL_SCALE          2147483648.0
+#define RATE                48000
+#define BLOCK_FRAMES        96
+// The maximum spectrum error relative to the spectrum peak
+#define SPECTRUM_ERROR_MAX  1e-5
+// The maximum level errors, 0.1 dB
+#define LEVEL_ERROR_MAX     1
+#define BAND_ERROR_MAX      5
+
+//--------------------------------------------
+DWT_Type dwt;
+uint32_t SystemCoreClock = 216000000;
+
+static uint32_t buf[AUDIO_ANALYZER_BUF_SIZE(AUDIO_ANALYZER_SIZE_MAX) / sizeof(uint32_t)];
+static int32_t frame[AUDIO_ANALYZER_SIZE_MAX];
+static double ref[AUDIO_ANALYZER_SIZE_MAX / 2 + 1];
+static uint32_t block[BLOCK_FRAMES * 2];
+static int failed;
+
+//--------------------------------------------
+static void check(int ok, const char *name)
+{
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+	if (!ok)
+	{
+		failed++;
+	}
+}
+
+//--------------------------------------------
+// The power spectrum normalized as by the analyzer:
+// the full scale sine has the power 1 at its bin
+static void dft(uint32_t size)
+{
+	uint32_t k, i;
+	double re, im, w;
+
+	for (k = 0; k <= size / 2; k++)
+	{
+		re = 0;
+		im = 0;
+		for (i = 0; i < size; i++)
+		{
+			w = (0.5 - 0.5 * cos(2 * PI * i / size)) * 4.0 / size / FULL_SCALE;
+			re += frame[i] * w * cos(2 * PI * k * i / size);
+			im -= frame[i] * w * sin(2 * PI * k * i / size);
+		}
+		ref[k] = re * re + im * im;
+	}
+}
+
+//--------------------------------------------
+static void test_spectrum(void)
+{
+	uint32_t size, i;
+	const float *power;
+	double error, peak;
+	char name[64];
+
+	for (size = AUDIO_ANALYZER_SIZE_MIN; size <= AUDIO_ANALYZER_SIZE_MAX; size *= 2)
+	{
+		audio_analyzer_init(buf, size, RATE, 2);
+		srand(size);
+		// -6 dBFS 1 kHz, -12 dBFS at the bin size / 8 and the noise of the 16 LSBs of 24 bits
+		for (i = 0; i < size; i++)
+		{
+			frame[i] = (int32_t)(0.5 * (FULL_SCALE - 1) * sin(2 * PI * 1000 * i / RATE) +
+				0.25 * (FULL_SCALE - 1) * cos(2 * PI * (size / 8) * i / size)) + (rand() % 65536 - 32768) * 256;
+		}
+		power = audio_analyzer_transform(frame);
+		dft(size);
+		error = 0;
+		peak = 0;
+		for (i = 0; i <= size / 2; i++)
+		{
+			error = fmax(error, fabs(power[i] - ref[i]));
+			peak = fmax(peak, ref[i]);
+		}
+		printf("N %4lu: max |P - Pref| %.3g, %.1f dB below the peak, bin N/8 %.5f (0.0625)\n",
+			(unsigned long)size, error, 10 * log10(error / peak), power[size / 8]);
+		snprintf(name, sizeof(name), "%lu-point spectrum matches the DFT", (unsigned long)size);
+		check(error / peak <= SPECTRUM_ERROR_MAX, name);
+	}
+}
+
+//--------------------------------------------
+// L: 0 dBFS 1 kHz, R: -20 dBFS 5 kHz
+static void put_blocks(uint32_t count)
+{
+	static uint32_t phase;
+	uint32_t cnt, i;
+
+	for (cnt = 0; cnt < count; cnt++)
+	{
+		for (i = 0; i < BLOCK_FRAMES; i++, phase++)
+		{
+			block[i * 2] = (uint32_t)(int32_t)((FULL_SCALE - 1) * sin(2 * PI * 1000 * phase / RATE));
+			block[i * 2 + 1] = (uint32_t)(int32_t)(0.1 * (FULL_SCALE - 1) * sin(2 * PI * 5000 * phase / RATE));
+		}
+		audio_analyzer_put(block, BLOCK_FRAMES);
+	}
+}
+
+//--------------------------------------------
+// Returns the number of the spectra calculated from 200 blocks,
+// the main loop takes a pass after every third block
+static uint32_t collect(uint8_t channel)
+{
+	uint32_t cnt;
+	uint32_t spectra = 0;
+
+	audio_analyzer_init(buf, 1024, RATE, 2);
+	audio_analyzer_set_channel(channel);
+	for (cnt = 0; cnt < 200; cnt++)
+	{
+		put_blocks(1);
+		if (!(cnt % 3))
+		{
+			spectra += audio_analyzer_process();
+		}
+	}
+	return spectra;
+}
+
+//--------------------------------------------
+static void check_bands(const char *name, int16_t level_1k, int16_t level_5k)
+{
+	int16_t band_1k = audio_analyzer_get_band(900, 1100);
+	int16_t band_5k = audio_analyzer_get_band(4900, 5100);
+	int16_t band_2k = audio_analyzer_get_band(2000, 3000);
+	char text[64];
+
+	printf("%s: 900-1100 Hz %d, 4900-5100 Hz %d, 2000-3000 Hz %d (0.1 dBFS)\n", name, band_1k, band_5k, band_2k);
+	snprintf(text, sizeof(text), "%s: the 1 kHz band", name);
+	check((level_1k == AUDIO_ANALYZER_LEVEL_MIN) ? band_1k < -600 : abs(band_1k - level_1k) <= BAND_ERROR_MAX, text);
+	snprintf(text, sizeof(text), "%s: the 5 kHz band", name);
+	check((level_5k == AUDIO_ANALYZER_LEVEL_MIN) ? band_5k < -600 : abs(band_5k - level_5k) <= BAND_ERROR_MAX, text);
+	snprintf(text, sizeof(text), "%s: no band between the sines", name);
+	check(band_2k < -600, text);
+}
+
+//--------------------------------------------
+static void test_meters(void)
+{
+	audio_analyzer_stats_t stats;
+	uint32_t spectra;
+	int16_t peak, rms;
+
+	spectra = collect(0);
+	check(spectra > 0, "the incremental transform completes");
+	audio_analyzer_get_levels(0, &peak, &rms);
+	printf("L: peak %d, rms %d (0.1 dBFS)\n", peak, rms);
+	check(abs(peak) <= LEVEL_ERROR_MAX && abs(rms + 30) <= LEVEL_ERROR_MAX, "0 dBFS sine: peak 0 dBFS, RMS -3 dBFS");
+	audio_analyzer_get_levels(1, &peak, &rms);
+	printf("R: peak %d, rms %d (0.1 dBFS)\n", peak, rms);
+	check(abs(peak + 200) <= LEVEL_ERROR_MAX && abs(rms + 230) <= LEVEL_ERROR_MAX, "-20 dBFS sine: peak -20 dBFS, RMS -23 dBFS");
+	check_bands("L", 0, AUDIO_ANALYZER_LEVEL_MIN);
+	audio_analyzer_get_stats(&stats);
+	printf("spectra %lu, skipped %lu\n", (unsigned long)stats.spectra, (unsigned long)stats.skipped);
+
+	collect(1);
+	check_bands("R", AUDIO_ANALYZER_LEVEL_MIN, -200);
+	// (0 dBFS + -20 dBFS) / 2
+	collect(AUDIO_ANALYZER_MIX);
+	check_bands("mix", -60, -260);
+}
+
+//--------------------------------------------
+int main(void)
+{
+	test_spectrum();
+	test_meters();
+	printf("%s: %d checks failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+// Host build of the library: the DWT cycle counter is a variable
+#include <stdint.h>
+
+typedef struct
+{
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern DWT_Type dwt;
+extern uint32_t SystemCoreClock;
+#define DWT (&dwt)
+
+#endif // PLATFORM_H_
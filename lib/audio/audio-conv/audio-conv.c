@@ -0,0 +1,427 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-conv.h"
+#include <string.h>
+
+//--------------------------------------------
+void audio_conv_32to16_ref(const uint32_t *src, int16_t *dst, uint32_t samples)
+{
+	for (; samples; samples--)
+	{
+		*dst++ = (int16_t)(*src++ >> 16);
+	}
+}
+
+//--------------------------------------------
+void audio_conv_mono_to_stereo16_ref(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+	src += frames;
+	dst += frames * 2;
+	for (; frames; frames--)
+	{
+		dst -= 2;
+		dst[0] = dst[1] = *--src;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_stereo_to_mono16_ref(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+	for (; frames; frames--)
+	{
+		*dst++ = *src;
+		src += 2;
+	}
+}
+
+//--------------------------------------------
+// gain < AUDIO_CONV_UNITY
+void audio_conv_volume16_ref(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain)
+{
+	for (; samples; samples--)
+	{
+		*dst++ = (int16_t)((*src++ * (int32_t)gain) >> 15);
+	}
+}
+
+#if defined __ARM_FEATURE_DSP
+//--------------------------------------------
+// PKHTB: the 16 MSBs of 2 samples per instruction
+void audio_conv_32to16_dsp(const uint32_t *src, int16_t *dst, uint32_t samples)
+{
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t cnt;
+
+	for (cnt = samples / 2; cnt; cnt--)
+	{
+		*d++ = __PKHTB(src[1], src[0], 16);
+		src += 2;
+	}
+	if (samples & 1)
+	{
+		audio_conv_32to16_ref(src, (int16_t *)d, 1);
+	}
+}
+
+//--------------------------------------------
+// PKHBT/PKHTB: the word of 2 mono samples gives 2 stereo frames
+void audio_conv_mono_to_stereo16_dsp(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+	const uint32_t *s;
+	uint32_t *d;
+	uint32_t sample;
+	uint32_t cnt;
+
+	if (frames & 1)
+	{
+		audio_conv_mono_to_stereo16_ref(src + frames - 1, dst + (frames - 1) * 2, 1);
+	}
+	s = (const uint32_t *)src + frames / 2;
+	d = (uint32_t *)dst + frames / 2 * 2;
+	for (cnt = frames / 2; cnt; cnt--)
+	{
+		sample = *--s;
+		d -= 2;
+		d[1] = __PKHTB(sample, sample, 16);
+		d[0] = __PKHBT(sample, sample, 16);
+	}
+}
+
+//--------------------------------------------
+// PKHBT: the left samples of 2 stereo frames per instruction
+void audio_conv_stereo_to_mono16_dsp(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t cnt;
+
+	for (cnt = frames / 2; cnt; cnt--)
+	{
+		*d++ = __PKHBT(s[0], s[1], 16);
+		s += 2;
+	}
+	if (frames & 1)
+	{
+		audio_conv_stereo_to_mono16_ref((const int16_t *)s, (int16_t *)d, 1);
+	}
+}
+
+//--------------------------------------------
+// SMUAD with the gain in one halfword multiplies one sample of the word,
+// PKHBT packs the products back
+void audio_conv_volume16_dsp(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t gain_hi = (uint32_t)gain << 16;
+	uint32_t sample;
+	uint32_t cnt;
+
+	for (cnt = samples / 2; cnt; cnt--)
+	{
+		sample = *s++;
+		*d++ = __PKHBT((uint32_t)((int32_t)__SMUAD(sample, gain) >> 15), (uint32_t)((int32_t)__SMUAD(sample, gain_hi) >> 15), 16);
+	}
+	if (samples & 1)
+	{
+		audio_conv_volume16_ref((const int16_t *)s, (int16_t *)d, 1, gain);
+	}
+}
+#endif
+
+//--------------------------------------------
+#if defined __ARM_FEATURE_DSP
+#define IS_ALIGNED(a, b)  (!(((uintptr_t)(a) | (uintptr_t)(b)) & 3))
+#endif
+
+//--------------------------------------------
+// ROR #16, 4 samples per iteration
+void audio_conv_swap16(const uint32_t *src, uint32_t *dst, uint32_t samples)
+{
+	uint32_t sample;
+	uint32_t cnt;
+
+	for (cnt = samples / 4; cnt; cnt--)
+	{
+		sample = src[0];
+		dst[0] = sample << 16 | sample >> 16;
+		sample = src[1];
+		dst[1] = sample << 16 | sample >> 16;
+		sample = src[2];
+		dst[2] = sample << 16 | sample >> 16;
+		sample = src[3];
+		dst[3] = sample << 16 | sample >> 16;
+		src += 4;
+		dst += 4;
+	}
+	for (cnt = samples % 4; cnt; cnt--)
+	{
+		sample = *src++;
+		*dst++ = sample << 16 | sample >> 16;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_32to16(const uint32_t *src, int16_t *dst, uint32_t samples)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		audio_conv_32to16_dsp(src, dst, samples);
+		return;
+	}
+#endif
+	audio_conv_32to16_ref(src, dst, samples);
+}
+
+//--------------------------------------------
+void audio_conv_16to32(const int16_t *src, uint32_t *dst, uint32_t samples)
+{
+	src += samples;
+	dst += samples;
+	for (; samples; samples--)
+	{
+		*--dst = (uint32_t)(uint16_t)*--src << 16;
+	}
+}
+
+//--------------------------------------------
+// 4 samples: 3 words (S0 S0 S0 S1 | S1 S1 S2 S2 | S2 S3 S3 S3)
+void audio_conv_32to24(const uint32_t *src, uint8_t *dst, uint32_t samples)
+{
+	uint32_t *d;
+	uint32_t sample;
+	uint32_t cnt;
+
+	if (!((uintptr_t)dst & 3))
+	{
+		d = (uint32_t *)dst;
+		for (cnt = samples / 4; cnt; cnt--)
+		{
+			d[0] = (src[0] >> 8) | ((src[1] >> 8) << 24);
+			d[1] = (src[1] >> 16) | ((src[2] >> 8) << 16);
+			d[2] = (src[2] >> 24) | (src[3] & 0xFFFFFF00);
+			src += 4;
+			d += 3;
+		}
+		dst = (uint8_t *)d;
+		samples %= 4;
+	}
+	for (; samples; samples--)
+	{
+		sample = *src++;
+		dst[0] = (uint8_t)(sample >> 8);
+		dst[1] = (uint8_t)(sample >> 16);
+		dst[2] = (uint8_t)(sample >> 24);
+		dst += 3;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_24to32(const uint8_t *src, uint32_t *dst, uint32_t samples)
+{
+	const uint32_t *s;
+	uint32_t w0, w1, w2;
+	uint32_t cnt;
+
+	// the samples are processed backwards, so the tail goes first
+	cnt = ((uintptr_t)src & 3) ? samples : samples % 4;
+	src += samples * 3;
+	dst += samples;
+	for (samples -= cnt; cnt; cnt--)
+	{
+		src -= 3;
+		*--dst = (src[0] << 8) | (src[1] << 16) | ((uint32_t)src[2] << 24);
+	}
+	s = (const uint32_t *)src;
+	for (cnt = samples / 4; cnt; cnt--)
+	{
+		s -= 3;
+		dst -= 4;
+		w0 = s[0];
+		w1 = s[1];
+		w2 = s[2];
+		dst[3] = w2 & 0xFFFFFF00;
+		dst[2] = ((w1 >> 8) & 0x00FFFF00) | (w2 << 24);
+		dst[1] = ((w0 >> 16) & 0x0000FF00) | (w1 << 16);
+		dst[0] = w0 << 8;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_mono_to_stereo16(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		audio_conv_mono_to_stereo16_dsp(src, dst, frames);
+		return;
+	}
+#endif
+	audio_conv_mono_to_stereo16_ref(src, dst, frames);
+}
+
+//--------------------------------------------
+void audio_conv_mono_to_stereo32(const uint32_t *src, uint32_t *dst, uint32_t frames)
+{
+	src += frames;
+	dst += frames * 2;
+	for (; frames; frames--)
+	{
+		dst -= 2;
+		dst[0] = dst[1] = *--src;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_stereo_to_mono16(const int16_t *src, int16_t *dst, uint32_t frames)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		audio_conv_stereo_to_mono16_dsp(src, dst, frames);
+		return;
+	}
+#endif
+	audio_conv_stereo_to_mono16_ref(src, dst, frames);
+}
+
+//--------------------------------------------
+void audio_conv_stereo_to_mono32(const uint32_t *src, uint32_t *dst, uint32_t frames)
+{
+	for (; frames; frames--)
+	{
+		*dst++ = *src;
+		src += 2;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_extract32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t src_channels, uint8_t dst_channels)
+{
+	uint8_t cnt;
+
+	for (; frames; frames--)
+	{
+		for (cnt = 0; cnt < dst_channels; cnt++)
+		{
+			*dst++ = src[cnt];
+		}
+		src += src_channels;
+	}
+}
+
+//--------------------------------------------
+void audio_conv_expand32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t src_channels, uint8_t dst_channels)
+{
+	uint8_t cnt;
+
+	src += frames * src_channels;
+	dst += frames * dst_channels;
+	for (; frames; frames--)
+	{
+		for (cnt = dst_channels; cnt > src_channels; cnt--)
+		{
+			*--dst = 0;
+		}
+		for (; cnt; cnt--)
+		{
+			*--dst = *--src;
+		}
+	}
+}
+
+//--------------------------------------------
+void audio_conv_deinterleave32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t channels)
+{
+	uint32_t *plane;
+	uint32_t cnt;
+	uint8_t ch;
+
+	for (ch = 0; ch < channels; ch++)
+	{
+		plane = dst + frames * ch;
+		for (cnt = 0; cnt < frames; cnt++)
+		{
+			plane[cnt] = src[cnt * channels + ch];
+		}
+	}
+}
+
+//--------------------------------------------
+void audio_conv_interleave32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t channels)
+{
+	const uint32_t *plane;
+	uint32_t cnt;
+	uint8_t ch;
+
+	for (ch = 0; ch < channels; ch++)
+	{
+		plane = src + frames * ch;
+		for (cnt = 0; cnt < frames; cnt++)
+		{
+			dst[cnt * channels + ch] = plane[cnt];
+		}
+	}
+}
+
+//--------------------------------------------
+void audio_conv_volume16(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain)
+{
+	if (gain >= AUDIO_CONV_UNITY)
+	{
+		if (src != dst)
+		{
+			memcpy(dst, src, samples * sizeof(int16_t));
+		}
+		return;
+	}
+	if (!gain)
+	{
+		memset(dst, 0, samples * sizeof(int16_t));
+		return;
+	}
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		audio_conv_volume16_dsp(src, dst, samples, gain);
+		return;
+	}
+#endif
+	audio_conv_volume16_ref(src, dst, samples, gain);
+}
+
+//--------------------------------------------
+// SMULL
+void audio_conv_volume32(const uint32_t *src, uint32_t *dst, uint32_t samples, uint16_t gain)
+{
+	if (gain >= AUDIO_CONV_UNITY)
+	{
+		if (src != dst)
+		{
+			memcpy(dst, src, samples * sizeof(uint32_t));
+		}
+		return;
+	}
+	if (!gain)
+	{
+		memset(dst, 0, samples * sizeof(uint32_t));
+		return;
+	}
+	for (; samples; samples--)
+	{
+		*dst++ = (uint32_t)(int32_t)(((int64_t)(int32_t)*src++ * gain) >> 15);
+	}
+}
@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#ifndef AUDIO_CONV_H_
+#define AUDIO_CONV_H_
+
+//--------------------------------------------
+// Sample format conversion kernels for the audio streams.
+// The 32-bit samples are MSB aligned (the 24-bit ones have the zero low byte)
+// in the CPU byte order, the 16-bit samples are signed, the stereo samples are interleaved L/R.
+// The 24-bit packed samples are 3 bytes, LSB first (USB, WAV).
+// The 16-bit kernels have the portable C reference implementation (_ref)
+// and the Cortex-M4/M7 DSP (SIMD) implementation processing 2 samples
+// per instruction, the results of both implementations are bit-exact.
+// The kernels without the suffix select the DSP implementation when __ARM_FEATURE_DSP
+// is defined and the buffers are 4 byte aligned, the reference one otherwise.
+// The 32-bit kernels have one implementation (no SIMD gain for the 32-bit lanes),
+// the 24-bit packed ones move 4 samples per 3 words when the buffers are 4 byte aligned.
+// The destination buffer may be the source buffer (in-place conversion) except the (de)interleaving,
+// the expanding kernels (16 -> 32, 24 -> 32, mono -> stereo, expand) process the samples backwards.
+//
+// // SPI-I2S DMA buffer (halfword swapped) -> 16-bit USB samples
+// audio_conv_swap16(i2s, tmp, samples);
+// audio_conv_32to16(tmp, usb, samples);
+
+// The Q15 gain of the volume kernels: AUDIO_CONV_UNITY - 0 dB (copy), 0 - mute
+#define AUDIO_CONV_UNITY    0x8000
+
+void audio_conv_32to16_ref(const uint32_t *src, int16_t *dst, uint32_t samples);
+void audio_conv_mono_to_stereo16_ref(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_stereo_to_mono16_ref(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_volume16_ref(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain);
+
+#if defined __ARM_FEATURE_DSP
+void audio_conv_32to16_dsp(const uint32_t *src, int16_t *dst, uint32_t samples);
+void audio_conv_mono_to_stereo16_dsp(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_stereo_to_mono16_dsp(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_volume16_dsp(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain);
+#endif
+
+// The halfwords of every word are swapped: the SPI-I2S DMA order <-> the CPU order
+void audio_conv_swap16(const uint32_t *src, uint32_t *dst, uint32_t samples);
+// The 16 MSBs of the 32-bit samples
+void audio_conv_32to16(const uint32_t *src, int16_t *dst, uint32_t samples);
+void audio_conv_16to32(const int16_t *src, uint32_t *dst, uint32_t samples);
+// The 24 MSBs of the 32-bit samples
+void audio_conv_32to24(const uint32_t *src, uint8_t *dst, uint32_t samples);
+void audio_conv_24to32(const uint8_t *src, uint32_t *dst, uint32_t samples);
+// The mono sample is copied to both channels
+void audio_conv_mono_to_stereo16(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_mono_to_stereo32(const uint32_t *src, uint32_t *dst, uint32_t frames);
+// The left channel is taken
+void audio_conv_stereo_to_mono16(const int16_t *src, int16_t *dst, uint32_t frames);
+void audio_conv_stereo_to_mono32(const uint32_t *src, uint32_t *dst, uint32_t frames);
+// The first dst_channels of the src_channels of every frame are taken
+// (the TDM frame -> the USB frame), dst_channels <= src_channels
+void audio_conv_extract32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t src_channels, uint8_t dst_channels);
+// The channels above src_channels are zeroed, dst_channels >= src_channels
+void audio_conv_expand32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t src_channels, uint8_t dst_channels);
+// The interleaved frames <-> the channel planes of 'frames' samples (dst may not be src)
+void audio_conv_deinterleave32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t channels);
+void audio_conv_interleave32(const uint32_t *src, uint32_t *dst, uint32_t frames, uint8_t channels);
+// gain: Q15, AUDIO_CONV_UNITY or more - the samples are copied
+void audio_conv_volume16(const int16_t *src, int16_t *dst, uint32_t samples, uint16_t gain);
+void audio_conv_volume32(const uint32_t *src, uint32_t *dst, uint32_t samples, uint16_t gain);
+
+#endif // AUDIO_CONV_H_
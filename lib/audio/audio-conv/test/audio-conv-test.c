@@ -0,0 +1,370 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host test of the sample format conversion kernels:
+// - every kernel against the hand-computed vectors: the odd numbers of samples
+//   (the tails of the unrolled and the SIMD loops), the full scale values,
+//   the 24-bit packed samples to the aligned and the unaligned buffers,
+//   the volume at unity, above unity, mute, -6 dB and the minimum gain,
+//   the in-place conversion (forwards and backwards),
+//   the TDM channels extracted, expanded, deinterleaved and interleaved,
+// - the DSP implementations (built with the C models of the instructions, see platform.h)
+//   are bit-exact with the reference ones, the dispatching kernels
+//   give the same results with the unaligned buffers.
+// Exit status 1 if any check fails.
+
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "audio-conv.h"
+
+//--------------------------------------------
+#define BUF_SAMPLES         64
+#define RANDOM_SAMPLES      (BUF_SAMPLES / 2 - 1)
+#define GUARD               0xA5
+
+//--------------------------------------------
+static uint32_t buf[BUF_SAMPLES];
+static uint32_t out[BUF_SAMPLES];
+static uint32_t ref[BUF_SAMPLES];
+static uint32_t rnd = 1;
+static int failed;
+
+//--------------------------------------------
+static void check(int ok, const char *name)
+{
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+	if (!ok)
+	{
+		failed++;
+	}
+}
+
+//--------------------------------------------
+static void fill_random(void *p, uint32_t size)
+{
+	uint8_t *b = (uint8_t *)p;
+
+	while (size--)
+	{
+		rnd = rnd * 1103515245 + 12345;
+		*b++ = (uint8_t)(rnd >> 16);
+	}
+}
+
+//--------------------------------------------
+// The bytes from size to the end of the buffer are intact
+static int guard_intact(const void *p, uint32_t size)
+{
+	const uint8_t *b = (const uint8_t *)p;
+
+	for (; size < sizeof(out); size++)
+	{
+		if (b[size] != GUARD)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//--------------------------------------------
+static void test_swap16(void)
+{
+	static const uint32_t src[] = { 0x12345678, 0x0000FFFF, 0x80000001, 0xFFFF0000, 0x00010002, 0xA5A5C3C3, 0x7FFF8000, 0xDEADBEEF, 0x00000001 };
+	static const uint32_t dst[] = { 0x56781234, 0xFFFF0000, 0x00018000, 0x0000FFFF, 0x00020001, 0xC3C3A5A5, 0x80007FFF, 0xBEEFDEAD, 0x00010000 };
+	uint32_t samples;
+	int ok;
+
+	for (ok = 1, samples = 0; samples <= 9; samples++)
+	{
+		memset(out, GUARD, sizeof(out));
+		audio_conv_swap16(src, out, samples);
+		ok &= !memcmp(out, dst, samples * sizeof(uint32_t)) && guard_intact(out, samples * sizeof(uint32_t));
+	}
+	check(ok, "swap16: 0 .. 9 samples");
+	memcpy(buf, src, sizeof(src));
+	audio_conv_swap16(buf, buf, 9);
+	check(!memcmp(buf, dst, sizeof(dst)), "swap16: in-place");
+}
+
+//--------------------------------------------
+static void test_32to16(void)
+{
+	static const uint32_t src32[] = { 0x12345678, 0x80000000, 0x7FFFFF00, 0xFFFF0000, 0x0000FFFF, 0xFFFFFFFF, 0x00010000 };
+	static const int16_t src16[] = { 0x1234, -32768, 32767, -1, 0, -1, 1 };
+	static const uint32_t dst32[] = { 0x12340000, 0x80000000, 0x7FFF0000, 0xFFFF0000, 0x00000000, 0xFFFF0000, 0x00010000 };
+	int16_t *o = (int16_t *)out;
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_32to16_ref(src32, o, 7);
+	check(!memcmp(o, src16, sizeof(src16)) && guard_intact(o, sizeof(src16)), "32to16_ref: 7 samples");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_32to16(src32, o, 7);
+	check(!memcmp(o, src16, sizeof(src16)) && guard_intact(o, sizeof(src16)), "32to16: 7 samples");
+	memcpy(buf, src32, sizeof(src32));
+	audio_conv_32to16(buf, (int16_t *)buf, 7);
+	check(!memcmp(buf, src16, sizeof(src16)), "32to16: in-place");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_16to32(src16, out, 7);
+	check(!memcmp(out, dst32, sizeof(dst32)) && guard_intact(out, sizeof(dst32)), "16to32: 7 samples");
+	memcpy(buf, src16, sizeof(src16));
+	audio_conv_16to32((int16_t *)buf, buf, 7);
+	check(!memcmp(buf, dst32, sizeof(dst32)), "16to32: in-place, backwards");
+}
+
+//--------------------------------------------
+static void test_32to24(void)
+{
+	static const uint32_t src32[] = { 0x11223300, 0x44556600, 0x77889900, 0xAABBCC00, 0xDDEEFF00, 0x80000000, 0x7FFFFF00 };
+	static const uint8_t src24[] =
+	{
+		0x33, 0x22, 0x11, 0x66, 0x55, 0x44, 0x99, 0x88, 0x77, 0xCC, 0xBB, 0xAA,
+		0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x80, 0xFF, 0xFF, 0x7F,
+	};
+	uint8_t *o = (uint8_t *)out;
+	uint8_t *b = (uint8_t *)buf;
+	uint32_t samples;
+	uint8_t offset;
+	int ok;
+
+	// 4 byte aligned and unaligned destination, the tails of the 4 sample groups
+	for (ok = 1, offset = 0; offset < 4; offset++)
+	{
+		for (samples = 0; samples <= 7; samples++)
+		{
+			memset(out, GUARD, sizeof(out));
+			audio_conv_32to24(src32, o + offset, samples);
+			ok &= !memcmp(o + offset, src24, samples * 3) && guard_intact(o, offset + samples * 3);
+		}
+	}
+	check(ok, "32to24: 0 .. 7 samples, dst offset 0 .. 3");
+
+	for (ok = 1, offset = 0; offset < 4; offset++)
+	{
+		for (samples = 0; samples <= 7; samples++)
+		{
+			memset(buf, 0, sizeof(buf));
+			memcpy(b + offset, src24, samples * 3);
+			memset(out, GUARD, sizeof(out));
+			audio_conv_24to32(b + offset, out, samples);
+			ok &= !memcmp(out, src32, samples * sizeof(uint32_t)) && guard_intact(out, samples * sizeof(uint32_t));
+		}
+	}
+	check(ok, "24to32: 0 .. 7 samples, src offset 0 .. 3");
+
+	memcpy(buf, src32, sizeof(src32));
+	audio_conv_32to24(buf, b, 7);
+	check(!memcmp(b, src24, sizeof(src24)), "32to24: in-place");
+	memcpy(buf, src24, sizeof(src24));
+	audio_conv_24to32(b, buf, 7);
+	check(!memcmp(buf, src32, sizeof(src32)), "24to32: in-place, backwards");
+}
+
+//--------------------------------------------
+static void test_mono_stereo(void)
+{
+	static const int16_t mono16[] = { 1, -2, 32767, -32768, 0x1234, 0, -1 };
+	static const int16_t stereo16[] = { 1, 1, -2, -2, 32767, 32767, -32768, -32768, 0x1234, 0x1234, 0, 0, -1, -1 };
+	static const int16_t left16[] = { 1, -2, 32767, -32768, 0x1234, 0, -1 };
+	static const int16_t lr16[] = { 1, 100, -2, 200, 32767, 300, -32768, 400, 0x1234, 500, 0, 600, -1, 700 };
+	static const uint32_t mono32[] = { 0x11111100, 0x80000000, 0x7FFFFF00 };
+	static const uint32_t stereo32[] = { 0x11111100, 0x11111100, 0x80000000, 0x80000000, 0x7FFFFF00, 0x7FFFFF00 };
+	static const uint32_t lr32[] = { 0x11111100, 1, 0x80000000, 2, 0x7FFFFF00, 3 };
+	int16_t *o = (int16_t *)out;
+	int16_t *b = (int16_t *)buf;
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_mono_to_stereo16_ref(mono16, o, 7);
+	check(!memcmp(o, stereo16, sizeof(stereo16)) && guard_intact(o, sizeof(stereo16)), "mono_to_stereo16_ref: 7 frames");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_mono_to_stereo16(mono16, o, 7);
+	check(!memcmp(o, stereo16, sizeof(stereo16)) && guard_intact(o, sizeof(stereo16)), "mono_to_stereo16: 7 frames");
+	memcpy(buf, mono16, sizeof(mono16));
+	audio_conv_mono_to_stereo16(b, b, 7);
+	check(!memcmp(b, stereo16, sizeof(stereo16)), "mono_to_stereo16: in-place, backwards");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_stereo_to_mono16_ref(lr16, o, 7);
+	check(!memcmp(o, left16, sizeof(left16)) && guard_intact(o, sizeof(left16)), "stereo_to_mono16_ref: 7 frames");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_stereo_to_mono16(lr16, o, 7);
+	check(!memcmp(o, left16, sizeof(left16)) && guard_intact(o, sizeof(left16)), "stereo_to_mono16: 7 frames");
+	memcpy(buf, lr16, sizeof(lr16));
+	audio_conv_stereo_to_mono16(b, b, 7);
+	check(!memcmp(b, left16, sizeof(left16)), "stereo_to_mono16: in-place");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_mono_to_stereo32(mono32, out, 3);
+	check(!memcmp(out, stereo32, sizeof(stereo32)) && guard_intact(out, sizeof(stereo32)), "mono_to_stereo32: 3 frames");
+	memcpy(buf, mono32, sizeof(mono32));
+	audio_conv_mono_to_stereo32(buf, buf, 3);
+	check(!memcmp(buf, stereo32, sizeof(stereo32)), "mono_to_stereo32: in-place, backwards");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_stereo_to_mono32(lr32, out, 3);
+	check(!memcmp(out, mono32, sizeof(mono32)) && guard_intact(out, sizeof(mono32)), "stereo_to_mono32: 3 frames");
+}
+
+//--------------------------------------------
+static void test_volume(void)
+{
+	static const int16_t src16[] = { 1000, -1001, 32767, -32768, 1, -1, 0 };
+	// Q15 products rounded down (arithmetic shift)
+	static const int16_t half16[] = { 500, -501, 16383, -16384, 0, -1, 0 };
+	static const int16_t min16[] = { 0, -1, 0, -1, 0, -1, 0 };
+	static const uint32_t src32[] = { 0x7FFFFF00, 0x80000000, 0x00000100, 0xFFFFFF00, 0x12345600 };
+	static const uint32_t half32[] = { 0x3FFFFF80, 0xC0000000, 0x00000080, 0xFFFFFF80, 0x091A2B00 };
+	static const uint16_t gains[] = { AUDIO_CONV_UNITY, 0xFFFF, 0, 0x4000, 1 };
+	static const int16_t zero16[7] = { 0 };
+	static const uint32_t zero32[5] = { 0 };
+	const int16_t *expected[] = { src16, src16, zero16, half16, min16 };
+	int16_t *o = (int16_t *)out;
+	int16_t *b = (int16_t *)buf;
+	uint8_t cnt;
+	int ok;
+
+	for (ok = 1, cnt = 0; cnt < sizeof(gains) / sizeof(gains[0]); cnt++)
+	{
+		memset(out, GUARD, sizeof(out));
+		audio_conv_volume16(src16, o, 7, gains[cnt]);
+		ok &= !memcmp(o, expected[cnt], sizeof(src16)) && guard_intact(o, sizeof(src16));
+		memcpy(buf, src16, sizeof(src16));
+		audio_conv_volume16(b, b, 7, gains[cnt]);
+		ok &= !memcmp(b, expected[cnt], sizeof(src16));
+	}
+	check(ok, "volume16: unity, above unity, mute, -6 dB, minimum, 7 samples, in-place");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_volume16_ref(src16, o, 7, 0x4000);
+	check(!memcmp(o, half16, sizeof(half16)) && guard_intact(o, sizeof(half16)), "volume16_ref: -6 dB");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_volume32(src32, out, 5, AUDIO_CONV_UNITY);
+	ok = !memcmp(out, src32, sizeof(src32)) && guard_intact(out, sizeof(src32));
+	audio_conv_volume32(src32, out, 5, 0);
+	ok &= !memcmp(out, zero32, sizeof(zero32)) && guard_intact(out, sizeof(zero32));
+	audio_conv_volume32(src32, out, 5, 0x4000);
+	ok &= !memcmp(out, half32, sizeof(half32)) && guard_intact(out, sizeof(half32));
+	memcpy(buf, src32, sizeof(src32));
+	audio_conv_volume32(buf, buf, 5, 0x4000);
+	ok &= !memcmp(buf, half32, sizeof(half32));
+	check(ok, "volume32: unity, mute, -6 dB, in-place");
+}
+
+//--------------------------------------------
+static void test_channels(void)
+{
+	// 3 TDM frames of 4 channels
+	static const uint32_t tdm[] = { 0x10, 0x11, 0x12, 0x13, 0x20, 0x21, 0x22, 0x23, 0x30, 0x31, 0x32, 0x33 };
+	static const uint32_t first2[] = { 0x10, 0x11, 0x20, 0x21, 0x30, 0x31 };
+	static const uint32_t first3[] = { 0x10, 0x11, 0x12, 0x20, 0x21, 0x22, 0x30, 0x31, 0x32 };
+	static const uint32_t expanded[] = { 0x10, 0x11, 0, 0, 0x20, 0x21, 0, 0, 0x30, 0x31, 0, 0 };
+	// 4 frames of 3 channels
+	static const uint32_t planes[] = { 0x10, 0x13, 0x22, 0x31, 0x11, 0x20, 0x23, 0x32, 0x12, 0x21, 0x30, 0x33 };
+	static const uint32_t first1[] = { 0x10, 0x20, 0x30 };
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_extract32(tdm, out, 3, 4, 2);
+	check(!memcmp(out, first2, sizeof(first2)) && guard_intact(out, sizeof(first2)), "extract32: 4 -> 2 channels");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_extract32(tdm, out, 3, 4, 1);
+	check(!memcmp(out, first1, sizeof(first1)) && guard_intact(out, sizeof(first1)), "extract32: 4 -> 1 channel");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_extract32(tdm, out, 3, 4, 4);
+	check(!memcmp(out, tdm, sizeof(tdm)) && guard_intact(out, sizeof(tdm)), "extract32: 4 -> 4 channels");
+	memcpy(buf, tdm, sizeof(tdm));
+	audio_conv_extract32(buf, buf, 3, 4, 3);
+	check(!memcmp(buf, first3, sizeof(first3)), "extract32: 4 -> 3 channels, in-place");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_expand32(first2, out, 3, 2, 4);
+	check(!memcmp(out, expanded, sizeof(expanded)) && guard_intact(out, sizeof(expanded)), "expand32: 2 -> 4 channels");
+	memcpy(buf, first2, sizeof(first2));
+	audio_conv_expand32(buf, buf, 3, 2, 4);
+	check(!memcmp(buf, expanded, sizeof(expanded)), "expand32: 2 -> 4 channels, in-place, backwards");
+	memcpy(buf, tdm, sizeof(tdm));
+	audio_conv_expand32(buf, buf, 3, 4, 4);
+	check(!memcmp(buf, tdm, sizeof(tdm)), "expand32: 4 -> 4 channels, in-place");
+
+	memset(out, GUARD, sizeof(out));
+	audio_conv_deinterleave32(tdm, out, 4, 3);
+	check(!memcmp(out, planes, sizeof(planes)) && guard_intact(out, sizeof(planes)), "deinterleave32: 4 frames, 3 channels");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_interleave32(planes, out, 4, 3);
+	check(!memcmp(out, tdm, sizeof(tdm)) && guard_intact(out, sizeof(tdm)), "interleave32: 4 frames, 3 channels");
+	memset(out, GUARD, sizeof(out));
+	audio_conv_deinterleave32(tdm, out, 12, 1);
+	check(!memcmp(out, tdm, sizeof(tdm)) && guard_intact(out, sizeof(tdm)), "deinterleave32: 1 channel");
+}
+
+//--------------------------------------------
+// The DSP kernels are bit-exact with the reference ones on the random samples,
+// the dispatching kernels fall back to the reference ones with the unaligned (halfword) buffers
+static void test_dsp(void)
+{
+	int16_t *b = (int16_t *)buf;
+	int16_t *o = (int16_t *)out;
+	int16_t *r = (int16_t *)ref;
+	uint32_t samples;
+	int dsp, unaligned;
+
+	fill_random(buf, sizeof(buf));
+	for (dsp = unaligned = 1, samples = RANDOM_SAMPLES - 1; samples <= RANDOM_SAMPLES; samples++)
+	{
+		audio_conv_32to16_ref(buf, r, samples);
+		audio_conv_32to16_dsp(buf, o, samples);
+		dsp &= !memcmp(o, r, samples * sizeof(int16_t));
+		audio_conv_32to16_ref(buf, r + 1, samples);
+		audio_conv_32to16(buf, o + 1, samples);
+		unaligned &= !memcmp(o + 1, r + 1, samples * sizeof(int16_t));
+
+		audio_conv_mono_to_stereo16_ref(b, r, samples);
+		audio_conv_mono_to_stereo16_dsp(b, o, samples);
+		dsp &= !memcmp(o, r, samples * 2 * sizeof(int16_t));
+		audio_conv_mono_to_stereo16_ref(b + 1, r + 1, samples);
+		audio_conv_mono_to_stereo16(b + 1, o + 1, samples);
+		unaligned &= !memcmp(o + 1, r + 1, samples * 2 * sizeof(int16_t));
+
+		audio_conv_stereo_to_mono16_ref(b, r, samples);
+		audio_conv_stereo_to_mono16_dsp(b, o, samples);
+		dsp &= !memcmp(o, r, samples * sizeof(int16_t));
+		audio_conv_stereo_to_mono16_ref(b + 1, r + 1, samples);
+		audio_conv_stereo_to_mono16(b + 1, o + 1, samples);
+		unaligned &= !memcmp(o + 1, r + 1, samples * sizeof(int16_t));
+
+		audio_conv_volume16_ref(b, r, samples * 2 + 1, 0x5A82);
+		audio_conv_volume16_dsp(b, o, samples * 2 + 1, 0x5A82);
+		dsp &= !memcmp(o, r, (samples * 2 + 1) * sizeof(int16_t));
+		audio_conv_volume16_ref(b + 1, r + 1, samples * 2, 0x5A82);
+		audio_conv_volume16(b + 1, o + 1, samples * 2, 0x5A82);
+		unaligned &= !memcmp(o + 1, r + 1, samples * 2 * sizeof(int16_t));
+	}
+	check(dsp, "dsp == ref: 32to16, mono_to_stereo16, stereo_to_mono16, volume16");
+	check(unaligned, "unaligned buffers: 32to16, mono_to_stereo16, stereo_to_mono16, volume16");
+}
+
+//--------------------------------------------
+int main(void)
+{
+	test_swap16();
+	test_32to16();
+	test_32to24();
+	test_mono_stereo();
+	test_volume();
+	test_channels();
+	test_dsp();
+	printf("%s: %d checks failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
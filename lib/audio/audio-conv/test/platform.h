@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+// Host build of the library
+#include <stdint.h>
+
+//--------------------------------------------
+// The DSP kernels are built on the host with the C models
+// of the Cortex-M4/M7 SIMD instructions they use
+#define __ARM_FEATURE_DSP 1
+
+//--------------------------------------------
+static inline uint32_t __SMUAD(uint32_t x, uint32_t y)
+{
+	return (uint32_t)((int32_t)(int16_t)x * (int16_t)y + (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16));
+}
+
+//--------------------------------------------
+static inline uint32_t __PKHBT(uint32_t x, uint32_t y, uint32_t shift)
+{
+	return (x & 0x0000FFFF) | ((y << shift) & 0xFFFF0000);
+}
+
+//--------------------------------------------
+static inline uint32_t __PKHTB(uint32_t x, uint32_t y, uint32_t shift)
+{
+	return (x & 0xFFFF0000) | ((uint32_t)((int32_t)y >> shift) & 0x0000FFFF);
+}
+
+#endif // PLATFORM_H_
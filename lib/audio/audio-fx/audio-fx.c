@@ -0,0 +1,477 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "audio-conv.h"
+#include "audio-fx.h"
+#include <string.h>
+#include <math.h>
+#if defined AUDIO_FX_CMSIS_DSP
+#include "arm_math.h"
+#endif
+
+//--------------------------------------------
+// Q2.30 gain
+#define GAIN_UNITY              (1L << 30)
+// The time constant of the gain smoother, ms
+#define GAIN_SMOOTH_MS          5
+// The cycle counters are halved every STATS_FRAMES frames (the moving average)
+#define STATS_FRAMES            (1UL << 16)
+// The 16-bit samples are processed by the blocks of CHUNK_FRAMES frames
+#define CHUNK_FRAMES            16
+#define PI                      3.14159265f
+
+//--------------------------------------------
+static inline int32_t saturate(int64_t value)
+{
+	if (value > INT32_MAX)
+	{
+		return INT32_MAX;
+	}
+	if (value < INT32_MIN)
+	{
+		return INT32_MIN;
+	}
+	return (int32_t)value;
+}
+
+//--------------------------------------------
+// The shift of the one pole smoother (y += (x - y) >> shift) of the time constant ms
+static uint8_t time_to_shift(uint32_t rate, uint32_t ms)
+{
+	uint32_t samples;
+	uint8_t shift;
+
+	samples = rate / 1000 * ms;
+	for (shift = 0; shift < 24 && (2UL << shift) <= samples; shift++);
+	return shift;
+}
+
+//--------------------------------------------
+static void gain_stage(audio_fx_t *fx, int32_t *samples, uint32_t frames)
+{
+	int32_t gain = fx->gain;
+	int32_t step;
+	uint32_t cnt;
+	uint8_t ch;
+
+	if (gain == fx->gain_target)
+	{
+		if (gain == GAIN_UNITY)
+		{
+			return;
+		}
+		if (!gain)
+		{
+			memset(samples, 0, frames * fx->channels * sizeof(int32_t));
+			return;
+		}
+		for (cnt = frames * fx->channels; cnt; cnt--, samples++)
+		{
+			*samples = saturate(((int64_t)*samples * gain) >> 30);
+		}
+		return;
+	}
+	// the gain is changed by the frame
+	for (; frames; frames--)
+	{
+		step = (fx->gain_target - gain) >> fx->gain_shift;
+		gain = step ? gain + step : fx->gain_target;
+		for (ch = 0; ch < fx->channels; ch++, samples++)
+		{
+			*samples = saturate(((int64_t)*samples * gain) >> 30);
+		}
+	}
+	fx->gain = gain;
+}
+
+#if defined AUDIO_FX_CMSIS_DSP
+//--------------------------------------------
+// The channel samples are gathered into the block, the cascade runs on the block.
+// The instance is filled directly, arm_biquad_cascade_df1_init_q31() clears the state.
+static void eq_stage(audio_fx_t *fx, int32_t *samples, uint32_t frames)
+{
+	arm_biquad_casd_df1_inst_q31 inst;
+	q31_t block[CHUNK_FRAMES];
+	int32_t *p;
+	uint32_t cnt, idx;
+	uint32_t pos;
+	uint8_t ch;
+
+	inst.numStages = fx->bands;
+	inst.pCoeffs = (q31_t *)fx->coef;
+	inst.postShift = 31 - AUDIO_FX_COEF_SHIFT;
+	for (ch = 0; ch < fx->channels; ch++)
+	{
+		inst.pState = fx->state[ch];
+		for (pos = 0; pos < frames; pos += cnt)
+		{
+			cnt = (frames - pos < CHUNK_FRAMES) ? frames - pos : CHUNK_FRAMES;
+			p = samples + pos * fx->channels + ch;
+			for (idx = 0; idx < cnt; idx++)
+			{
+				block[idx] = p[idx * fx->channels];
+			}
+			arm_biquad_cascade_df1_q31(&inst, block, block, cnt);
+			for (idx = 0; idx < cnt; idx++)
+			{
+				p[idx * fx->channels] = block[idx];
+			}
+		}
+	}
+}
+#else
+//--------------------------------------------
+// Band by band for every channel: the coefficients and the state are kept in the registers
+static void eq_stage(audio_fx_t *fx, int32_t *samples, uint32_t frames)
+{
+	const audio_fx_biquad_t *coef;
+	int32_t b0, b1, b2, a1, a2;
+	int32_t x0, x1, x2, y1, y2;
+	int32_t *state;
+	int32_t *p;
+	uint32_t cnt;
+	uint8_t band;
+	uint8_t ch;
+
+	for (ch = 0; ch < fx->channels; ch++)
+	{
+		state = fx->state[ch];
+		for (band = 0, coef = fx->coef; band < fx->bands; band++, coef++, state += 4)
+		{
+			b0 = coef->b0;
+			b1 = coef->b1;
+			b2 = coef->b2;
+			a1 = coef->a1;
+			a2 = coef->a2;
+			x1 = state[0];
+			x2 = state[1];
+			y1 = state[2];
+			y2 = state[3];
+			for (p = samples + ch, cnt = frames; cnt; cnt--, p += fx->channels)
+			{
+				x0 = *p;
+				*p = saturate(((int64_t)b0 * x0 + (int64_t)b1 * x1 + (int64_t)b2 * x2 +
+				               (int64_t)a1 * y1 + (int64_t)a2 * y2) >> AUDIO_FX_COEF_SHIFT);
+				x2 = x1;
+				x1 = x0;
+				y2 = y1;
+				y1 = *p;
+			}
+			state[0] = x1;
+			state[1] = x2;
+			state[2] = y1;
+			state[3] = y2;
+		}
+	}
+}
+#endif
+
+//--------------------------------------------
+// The frame peak charges the envelope at once, the envelope decays to the peak
+// with the release time constant, the frames above the threshold are scaled by threshold / envelope.
+// Both are normalized by their leading zeros before the division, so the quotient
+// has 15 significant bits at any threshold, it is shifted back to the Q30 gain
+// (threshold / envelope >= 2^-11: the shift is not negative)
+static void limiter_stage(audio_fx_t *fx, int32_t *samples, uint32_t frames)
+{
+	uint32_t envelope = fx->envelope;
+	uint32_t peak, value;
+	uint32_t threshold_norm;
+	int32_t gain;
+	uint8_t threshold_shift;
+	uint8_t shift;
+	uint8_t ch;
+
+	threshold_shift = (uint8_t)__CLZ(fx->threshold);
+	threshold_norm = fx->threshold << threshold_shift;
+
+	for (; frames; frames--, samples += fx->channels)
+	{
+		for (peak = 0, ch = 0; ch < fx->channels; ch++)
+		{
+			value = (samples[ch] < 0) ? 0U - (uint32_t)samples[ch] : (uint32_t)samples[ch];
+			if (value > peak)
+			{
+				peak = value;
+			}
+		}
+		if (peak >= envelope)
+		{
+			envelope = peak;
+		}
+		else
+		{
+			envelope -= (envelope - peak) >> fx->release_shift;
+		}
+		if (envelope > fx->threshold)
+		{
+			shift = (uint8_t)__CLZ(envelope);
+			// Q30: (threshold_norm / envelope_norm) * 2^15 * 2^(15 - threshold_shift + shift)
+			gain = (int32_t)(((threshold_norm >> 1) / ((envelope << shift) >> 16)) << (15 - threshold_shift + shift));
+			for (ch = 0; ch < fx->channels; ch++)
+			{
+				samples[ch] = (int32_t)(((int64_t)samples[ch] * gain) >> 30);
+			}
+		}
+	}
+	fx->envelope = envelope;
+}
+
+//--------------------------------------------
+static void update_gain(audio_fx_t *fx)
+{
+	fx->gain_target = fx->mute ? 0 : fx->volume;
+}
+
+//--------------------------------------------
+void audio_fx_init(audio_fx_t *fx, uint32_t rate, uint8_t channels)
+{
+	uint8_t band;
+
+	memset(fx, 0, sizeof(audio_fx_t));
+	fx->rate = rate;
+	fx->channels = (channels > AUDIO_FX_CHANNELS) ? AUDIO_FX_CHANNELS : channels;
+	for (band = 0; band < AUDIO_FX_BANDS; band++)
+	{
+		fx->coef[band].b0 = 1L << AUDIO_FX_COEF_SHIFT;
+	}
+	fx->volume = GAIN_UNITY;
+	fx->gain = GAIN_UNITY;
+	update_gain(fx);
+	fx->gain_shift = time_to_shift(rate, GAIN_SMOOTH_MS);
+}
+
+//--------------------------------------------
+void audio_fx_reset(audio_fx_t *fx)
+{
+	memset(fx->state, 0, sizeof(fx->state));
+	fx->envelope = 0;
+	fx->gain = fx->gain_target;
+}
+
+//--------------------------------------------
+void audio_fx_set_biquad(audio_fx_t *fx, uint8_t band, const audio_fx_biquad_t *coef)
+{
+	if (band >= AUDIO_FX_BANDS)
+	{
+		return;
+	}
+	fx->coef[band] = *coef;
+	if (band >= fx->bands)
+	{
+		fx->bands = band + 1;
+	}
+}
+
+//--------------------------------------------
+// Audio EQ Cookbook by Robert Bristow-Johnson
+uint8_t audio_fx_set_band(audio_fx_t *fx, uint8_t band, uint8_t type, float freq, float q, float gain_db)
+{
+	audio_fx_biquad_t coef;
+	float a, w0, cs, alpha, sa;
+	float b[3], an[3];
+	float *value;
+	int32_t *result;
+	uint8_t cnt;
+
+	if (band >= AUDIO_FX_BANDS || freq <= 0 || freq >= (float)fx->rate / 2 || q <= 0)
+	{
+		return 0;
+	}
+	a = powf(10, gain_db / 40);
+	w0 = 2 * PI * freq / (float)fx->rate;
+	cs = cosf(w0);
+	alpha = sinf(w0) / (2 * q);
+	sa = 2 * sqrtf(a) * alpha;
+	switch (type)
+	{
+	case AUDIO_FX_PEAK:
+		b[0] = 1 + alpha * a;
+		b[1] = -2 * cs;
+		b[2] = 1 - alpha * a;
+		an[0] = 1 + alpha / a;
+		an[1] = -2 * cs;
+		an[2] = 1 - alpha / a;
+		break;
+	case AUDIO_FX_LOW_SHELF:
+		b[0] = a * ((a + 1) - (a - 1) * cs + sa);
+		b[1] = 2 * a * ((a - 1) - (a + 1) * cs);
+		b[2] = a * ((a + 1) - (a - 1) * cs - sa);
+		an[0] = (a + 1) + (a - 1) * cs + sa;
+		an[1] = -2 * ((a - 1) + (a + 1) * cs);
+		an[2] = (a + 1) + (a - 1) * cs - sa;
+		break;
+	case AUDIO_FX_HIGH_SHELF:
+		b[0] = a * ((a + 1) + (a - 1) * cs + sa);
+		b[1] = -2 * a * ((a - 1) + (a + 1) * cs);
+		b[2] = a * ((a + 1) + (a - 1) * cs - sa);
+		an[0] = (a + 1) - (a - 1) * cs + sa;
+		an[1] = 2 * ((a - 1) - (a + 1) * cs);
+		an[2] = (a + 1) - (a - 1) * cs - sa;
+		break;
+	case AUDIO_FX_LOW_PASS:
+		b[0] = (1 - cs) / 2;
+		b[1] = 1 - cs;
+		b[2] = (1 - cs) / 2;
+		an[0] = 1 + alpha;
+		an[1] = -2 * cs;
+		an[2] = 1 - alpha;
+		break;
+	case AUDIO_FX_HIGH_PASS:
+		b[0] = (1 + cs) / 2;
+		b[1] = -(1 + cs);
+		b[2] = (1 + cs) / 2;
+		an[0] = 1 + alpha;
+		an[1] = -2 * cs;
+		an[2] = 1 - alpha;
+		break;
+	default:
+		return 0;
+	}
+
+	// b0, b1, b2, -a1, -a2 normalized by a0
+	b[0] /= an[0];
+	b[1] /= an[0];
+	b[2] /= an[0];
+	an[1] = -an[1] / an[0];
+	an[2] = -an[2] / an[0];
+	result = &coef.b0;
+	for (cnt = 0; cnt < 5; cnt++)
+	{
+		value = (cnt < 3) ? &b[cnt] : &an[cnt - 2];
+		if (fabsf(*value) >= 4)
+		{
+			return 0;
+		}
+		result[cnt] = (int32_t)lrintf(*value * (float)(1L << AUDIO_FX_COEF_SHIFT));
+	}
+	audio_fx_set_biquad(fx, band, &coef);
+	return 1;
+}
+
+//--------------------------------------------
+void audio_fx_set_bands(audio_fx_t *fx, uint8_t bands)
+{
+	fx->bands = (bands > AUDIO_FX_BANDS) ? AUDIO_FX_BANDS : bands;
+}
+
+//--------------------------------------------
+void audio_fx_set_volume(audio_fx_t *fx, int16_t volume)
+{
+	if (volume == AUDIO_FX_VOLUME_SILENCE)
+	{
+		fx->volume = 0;
+	}
+	else
+	{
+		if (volume > AUDIO_FX_VOLUME_MAX)
+		{
+			volume = AUDIO_FX_VOLUME_MAX;
+		}
+		fx->volume = (int32_t)lrintf(powf(10, (float)volume / (20 * 256)) * (float)GAIN_UNITY);
+	}
+	update_gain(fx);
+}
+
+//--------------------------------------------
+void audio_fx_set_mute(audio_fx_t *fx, uint8_t mute)
+{
+	fx->mute = mute;
+	update_gain(fx);
+}
+
+//--------------------------------------------
+void audio_fx_set_limiter(audio_fx_t *fx, int16_t threshold, uint16_t release)
+{
+	if (threshold >= 0)
+	{
+		fx->threshold = 0;
+		return;
+	}
+	// -60 dBFS at least (2^-10), the limiter gain is not less than 2^-11
+	if (threshold < -60 * 256)
+	{
+		threshold = -60 * 256;
+	}
+	fx->threshold = (uint32_t)lrintf(powf(10, (float)threshold / (20 * 256)) * 2147483648.0f);
+	fx->envelope = 0;
+	fx->release_shift = time_to_shift(fx->rate, release);
+}
+
+//--------------------------------------------
+void audio_fx_process(audio_fx_t *fx, int32_t *samples, uint32_t frames)
+{
+	uint32_t time, now;
+	uint8_t stage;
+
+	time = DWT->CYCCNT;
+	gain_stage(fx, samples, frames);
+	now = DWT->CYCCNT;
+	fx->cycles[AUDIO_FX_STAGE_GAIN] += now - time;
+	if (fx->bands)
+	{
+		time = now;
+		eq_stage(fx, samples, frames);
+		now = DWT->CYCCNT;
+		fx->cycles[AUDIO_FX_STAGE_EQ] += now - time;
+	}
+	if (fx->threshold)
+	{
+		time = now;
+		limiter_stage(fx, samples, frames);
+		fx->cycles[AUDIO_FX_STAGE_LIMITER] += DWT->CYCCNT - time;
+	}
+	fx->frames += frames;
+	if (fx->frames >= STATS_FRAMES)
+	{
+		fx->frames /= 2;
+		for (stage = 0; stage < AUDIO_FX_STAGES; stage++)
+		{
+			fx->cycles[stage] /= 2;
+		}
+	}
+}
+
+//--------------------------------------------
+void audio_fx_process16(audio_fx_t *fx, int16_t *samples, uint32_t frames)
+{
+	uint32_t block[CHUNK_FRAMES * AUDIO_FX_CHANNELS];
+	uint32_t cnt;
+
+	for (; frames; frames -= cnt)
+	{
+		cnt = (frames < CHUNK_FRAMES) ? frames : CHUNK_FRAMES;
+		audio_conv_16to32(samples, block, cnt * fx->channels);
+		audio_fx_process(fx, (int32_t *)block, cnt);
+		audio_conv_32to16(block, samples, cnt * fx->channels);
+		samples += cnt * fx->channels;
+	}
+}
+
+//--------------------------------------------
+uint32_t audio_fx_get_cycles(const audio_fx_t *fx, uint8_t stage)
+{
+	if (stage >= AUDIO_FX_STAGES || !fx->frames)
+	{
+		return 0;
+	}
+	return (uint32_t)((uint64_t)fx->cycles[stage] * 100 / fx->frames);
+}
+
+//--------------------------------------------
+void audio_fx_reset_cycles(audio_fx_t *fx)
+{
+	memset(fx->cycles, 0, sizeof(fx->cycles));
+	fx->frames = 0;
+}
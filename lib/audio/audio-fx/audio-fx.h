@@ -0,0 +1,127 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#ifndef AUDIO_FX_H_
+#define AUDIO_FX_H_
+
+//--------------------------------------------
+// Block based effects chain for the audio output: gain -> EQ -> limiter.
+// The samples are 32-bit (24-bit MSB aligned) in the CPU byte order, interleaved,
+// the 16-bit ones are processed through the 32-bit ones.
+// The gain follows its target (the volume and the mute) by the one pole smoother,
+// so the volume steps don't click.
+// The EQ is the cascade of up to AUDIO_FX_BANDS biquads (Direct Form I, Q3.29 coefficients,
+// 64-bit accumulator, SMLAL), the coefficients of every band are designed by the RBJ cookbook
+// formulas or set directly.
+// The limiter scales the frames down to the threshold by the peak envelope
+// (instant attack, exponential release) instead of the hard clipping.
+// The stages without an effect (unity gain, no bands, the limiter off) are skipped.
+// The CPU cycles of every stage are counted by the DWT cycle counter,
+// so the number of the bands fitting the frame budget can be measured.
+// AUDIO_FX_CMSIS_DSP: the EQ uses arm_biquad_cascade_df1_q31() of CMSIS-DSP
+// (arm_math.h and the CMSIS-DSP library must be provided).
+// The coefficients are changed by the main loop while the chain may run
+// in the interrupt context, so one block may be processed by the mixed coefficients.
+//
+// static audio_fx_t fx;
+// audio_fx_init(&fx, 48000, 2);
+// audio_fx_set_band(&fx, 0, AUDIO_FX_LOW_SHELF, 100, 0.707f, 6.0f);
+// audio_fx_set_limiter(&fx, -256, 50); // -1 dBFS, 50 ms
+// audio_fx_set_volume(&fx, -20 * 256); // -20 dB
+// audio_fx_process(&fx, samples, frames);
+
+#ifndef AUDIO_FX_BANDS
+#define AUDIO_FX_BANDS           8
+#endif
+#ifndef AUDIO_FX_CHANNELS
+#define AUDIO_FX_CHANNELS        2
+#endif
+
+// The biquad types
+#define AUDIO_FX_PEAK            0
+#define AUDIO_FX_LOW_SHELF       1
+#define AUDIO_FX_HIGH_SHELF      2
+#define AUDIO_FX_LOW_PASS        3
+#define AUDIO_FX_HIGH_PASS       4
+
+// The stages
+#define AUDIO_FX_STAGE_GAIN      0
+#define AUDIO_FX_STAGE_EQ        1
+#define AUDIO_FX_STAGE_LIMITER   2
+#define AUDIO_FX_STAGES          3
+
+// The volume and the thresholds are in 1/256 dB (as the UAC volume control),
+// the gain is limited by AUDIO_FX_VOLUME_MAX
+#define AUDIO_FX_VOLUME_MAX      (6 * 256)
+#define AUDIO_FX_VOLUME_SILENCE  ((int16_t)0x8000)
+
+// Q3.29: y = b0 x0 + b1 x1 + b2 x2 + a1 y1 + a2 y2 (a1, a2 are negated)
+#define AUDIO_FX_COEF_SHIFT      29
+
+typedef struct audio_fx_biquad
+{
+	int32_t b0;
+	int32_t b1;
+	int32_t b2;
+	int32_t a1;
+	int32_t a2;
+} audio_fx_biquad_t;
+
+typedef struct audio_fx
+{
+	audio_fx_biquad_t coef[AUDIO_FX_BANDS];
+	// x1, x2, y1, y2 of every band
+	int32_t state[AUDIO_FX_CHANNELS][AUDIO_FX_BANDS * 4];
+	uint32_t rate;
+	uint8_t channels;
+	uint8_t bands;
+	uint8_t mute;
+	// Q2.30
+	int32_t volume;
+	int32_t gain;
+	int32_t gain_target;
+	uint8_t gain_shift;
+	// The limiter threshold and the peak envelope, Q31 (0 - the limiter is off)
+	uint32_t threshold;
+	uint32_t envelope;
+	uint8_t release_shift;
+	// The CPU cycles of the stages and the frames processed
+	uint32_t cycles[AUDIO_FX_STAGES];
+	uint32_t frames;
+} audio_fx_t;
+
+// Unity gain, no bands, the limiter off
+// channels: up to AUDIO_FX_CHANNELS
+void audio_fx_init(audio_fx_t *fx, uint32_t rate, uint8_t channels);
+// Silent history of the EQ and the limiter
+void audio_fx_reset(audio_fx_t *fx);
+// The band (0 ... AUDIO_FX_BANDS - 1) is designed, the bands below are flat if they were not set
+// freq: Hz, q: the quality factor (0.707 - Butterworth), gain_db: the peak and the shelf gain
+// Returns 0 if the coefficients are out of the Q3.29 range (the band is not changed)
+uint8_t audio_fx_set_band(audio_fx_t *fx, uint8_t band, uint8_t type, float freq, float q, float gain_db);
+void audio_fx_set_biquad(audio_fx_t *fx, uint8_t band, const audio_fx_biquad_t *coef);
+// The number of the bands used (the bands above are bypassed)
+void audio_fx_set_bands(audio_fx_t *fx, uint8_t bands);
+// volume: 1/256 dB, AUDIO_FX_VOLUME_SILENCE - the silence
+void audio_fx_set_volume(audio_fx_t *fx, int16_t volume);
+void audio_fx_set_mute(audio_fx_t *fx, uint8_t mute);
+// threshold: 1/256 dBFS (0 - the limiter is off), release: ms
+void audio_fx_set_limiter(audio_fx_t *fx, int16_t threshold, uint16_t release);
+// samples: interleaved, in place
+void audio_fx_process(audio_fx_t *fx, int32_t *samples, uint32_t frames);
+void audio_fx_process16(audio_fx_t *fx, int16_t *samples, uint32_t frames);
+// The CPU cycles per frame of the stage * 100 (the average since the reset)
+uint32_t audio_fx_get_cycles(const audio_fx_t *fx, uint8_t stage);
+void audio_fx_reset_cycles(audio_fx_t *fx);
+
+#endif // AUDIO_FX_H_
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "audio-rate.h"
+#include <string.h>
+
+//--------------------------------------------
+void audio_rate_init(audio_rate_t *rate, uint32_t mclk_expected, uint32_t mclk_per_frame, uint32_t bytes_per_frame, uint32_t target)
+{
+	memset(rate, 0, sizeof(audio_rate_t));
+	rate->mclk_expected = mclk_expected;
+	rate->mclk_per_frame = mclk_per_frame;
+	rate->bytes_per_frame = bytes_per_frame;
+	rate->target = target;
+	rate->limit = (int32_t)(mclk_expected / (1000000 / AUDIO_RATE_LIMIT_PPM));
+	rate->stats.fill_min = UINT32_MAX;
+}
+
+//--------------------------------------------
+uint32_t audio_rate_update(audio_rate_t *rate, uint32_t mclk, uint32_t fill)
+{
+	audio_rate_stats_t *stats = &rate->stats;
+	int32_t deviation;
+	int32_t err;
+	int32_t correction;
+
+	// the first measurement is the average
+	if (!stats->updates++)
+	{
+		rate->average = mclk << 8;
+	}
+	rate->average += (int32_t)((mclk << 8) - rate->average) / (1 << AUDIO_RATE_AVG_SHIFT);
+	deviation = (int32_t)(mclk - ((rate->average + 128) >> 8));
+	if ((uint32_t)((deviation < 0) ? -deviation : deviation) > stats->jitter)
+	{
+		stats->jitter = (deviation < 0) ? -deviation : deviation;
+	}
+
+	// the fill error in the MCLK periods
+	err = ((int32_t)rate->target - (int32_t)fill) * (int32_t)rate->mclk_per_frame / (int32_t)rate->bytes_per_frame;
+	rate->sum += err;
+	// anti-windup
+	if (rate->sum > rate->limit * (1 << AUDIO_RATE_KI_SHIFT))
+	{
+		rate->sum = rate->limit * (1 << AUDIO_RATE_KI_SHIFT);
+	}
+	if (rate->sum < -rate->limit * (1 << AUDIO_RATE_KI_SHIFT))
+	{
+		rate->sum = -rate->limit * (1 << AUDIO_RATE_KI_SHIFT);
+	}
+	stats->integral = rate->sum / (1 << AUDIO_RATE_KI_SHIFT);
+
+	// the correction of the measured rate
+	correction = err / (1 << AUDIO_RATE_KP_SHIFT) + stats->integral;
+	if (correction > rate->limit || correction < -rate->limit)
+	{
+		correction = (correction > 0) ? rate->limit : -rate->limit;
+		stats->limited++;
+	}
+
+	stats->mclk = mclk;
+	stats->feedback = ((rate->average + 128) >> 8) + correction;
+	if (fill < stats->fill_min)
+	{
+		stats->fill_min = fill;
+	}
+	if (fill > stats->fill_max)
+	{
+		stats->fill_max = fill;
+	}
+	stats->fill_history[stats->history_pos] = fill;
+	stats->history_pos = (stats->history_pos + 1) % AUDIO_RATE_HISTORY;
+	return stats->feedback;
+}
+
+//--------------------------------------------
+void audio_rate_get_stats(audio_rate_t *rate, audio_rate_stats_t *stats)
+{
+	*stats = rate->stats;
+}
@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef AUDIO_RATE_H_
+#define AUDIO_RATE_H_
+
+//--------------------------------------------
+// Rate control of the asynchronous audio sink (the USB audio feedback):
+// the device measures its audio clock (the MCLK periods per the measurement interval)
+// and requests the source to send the measured rate corrected by the PI controller
+// of the ring fill, so the fill is kept at the target instead of drifting between the limits:
+// feedback = average(mclk) + err / 2^AUDIO_RATE_KP_SHIFT + sum(err) / 2^AUDIO_RATE_KI_SHIFT,
+// err = target - fill (in the MCLK periods, one audio frame is mclk_per_frame periods).
+// The measured count is averaged by the first order low-pass filter (1 / 2^AUDIO_RATE_AVG_SHIFT),
+// the integral term removes the steady state error (the feedback rounding of the host,
+// the fill offset after the start), both the integral term and the whole correction
+// of the measured rate are limited to AUDIO_RATE_LIMIT_PPM of the nominal one.
+// With the 32 ms measurement interval the fill settles in 4.5 s at most after the 150 frames offset
+// (the correction limit alone takes 3.1 s) and is kept within +-12 audio frames
+// (host simulation, test/ make test: 48 kHz, the 48 frames packet jitter, the device clock
+// drift up to 800 ppm, the host reacts in 1-3 intervals and its rate is off the feedback
+// by up to 200 ppm),
+// so the ring can be smaller than with the fixed step corrections.
+//
+// static audio_rate_t rate;
+// audio_rate_init(&rate, mclk_expected, 256, 8, AUDIO_RING_SIZE / 4 * 3);
+// static void mclk_callback(uint32_t mclk)
+// {
+//     feedback = audio_rate_update(&rate, mclk, audio_ring_get_fill(&ring));
+// }
+
+#define AUDIO_RATE_AVG_SHIFT    2
+#define AUDIO_RATE_KP_SHIFT     4
+#define AUDIO_RATE_KI_SHIFT     9
+#define AUDIO_RATE_LIMIT_PPM    1000
+// The number of the last fill values kept
+#define AUDIO_RATE_HISTORY      32
+
+// Telemetry since the start
+typedef struct audio_rate_stats
+{
+	uint32_t updates;
+	// The last measured MCLK count and the requested one
+	uint32_t mclk;
+	uint32_t feedback;
+	// The maximum deviation of the measured count from its average
+	uint32_t jitter;
+	// The integral term, MCLK periods
+	int32_t integral;
+	// The correction reached the limit
+	uint32_t limited;
+	// The fill, bytes
+	uint32_t fill_min;
+	uint32_t fill_max;
+	// The oldest value is at history_pos
+	uint32_t fill_history[AUDIO_RATE_HISTORY];
+	uint8_t history_pos;
+} audio_rate_stats_t;
+
+typedef struct audio_rate
+{
+	uint32_t mclk_expected;
+	uint32_t mclk_per_frame;
+	uint32_t bytes_per_frame;
+	uint32_t target;
+	int32_t limit;
+	// The average of the measured count, Q8
+	uint32_t average;
+	int32_t sum;
+	audio_rate_stats_t stats;
+} audio_rate_t;
+
+// mclk_expected: the nominal MCLK count per the measurement interval
+// mclk_per_frame: the MCLK periods per audio frame (256 for fMCLK = 256 * fFCLK)
+// bytes_per_frame: the ring bytes per audio frame (all the channel samples)
+// target: the ring fill to keep, bytes
+void audio_rate_init(audio_rate_t *rate, uint32_t mclk_expected, uint32_t mclk_per_frame, uint32_t bytes_per_frame, uint32_t target);
+// mclk: the MCLK count measured in the last interval, fill: the ring fill, bytes
+// (the target while the playback is not started, the controller is not changed then)
+// Returns the feedback, MCLK periods per the measurement interval
+uint32_t audio_rate_update(audio_rate_t *rate, uint32_t mclk, uint32_t fill);
+void audio_rate_get_stats(audio_rate_t *rate, audio_rate_stats_t *stats);
+
+#endif // AUDIO_RATE_H_
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host simulation of the UAC2 feedback loop with the audio-rate controller:
+// 48 kHz stereo 32-bit, the 768 frames ring kept at 3/4,
+// the feedback is requested every 32 ms (1536 frames, 256 MCLK periods per frame).
+// The host sends the requested rate after 1-3 intervals with a rate error
+// (the feedback rounding), the device clock drifts from the nominal one,
+// the fill is read with the jitter of one 1 ms packet (48 frames).
+// The fill is checked after the settling time: exit status 1 if any case fails.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "audio-rate.h"
+
+//--------------------------------------------
+#define FRAMES_PER_INTERVAL     1536
+#define MCLK_PER_FRAME          256
+#define BYTES_PER_FRAME         8
+#define RING_FRAMES             768
+#define PACKET_FRAMES           48
+#define INTERVALS               3000
+#define HOST_DELAY_MAX          3
+// 4.5 s in 32 ms intervals
+#define SETTLE_INTERVALS        141
+// The fill deviation, audio frames
+#define SETTLE_FRAMES           20
+#define KEEP_FRAMES             12
+
+//--------------------------------------------
+static uint32_t seed;
+
+//--------------------------------------------
+// Deterministic pseudo random numbers from -range to range
+static int32_t noise(int32_t range)
+{
+	seed = seed * 1103515245 + 12345;
+	return (int32_t)((seed >> 16) % (2 * range + 1)) - range;
+}
+
+//--------------------------------------------
+// Returns 0 if the fill settles in time and is kept within KEEP_FRAMES
+static int run(int32_t host_ppm, int32_t offset, uint8_t delay, int32_t drift_ppm)
+{
+	audio_rate_t rate;
+	uint32_t target = RING_FRAMES * BYTES_PER_FRAME / 4 * 3;
+	uint32_t requested[HOST_DELAY_MAX + 1];
+	double device = FRAMES_PER_INTERVAL * (1.0 + drift_ppm * 1e-6);
+	double fill = target + (double)offset * BYTES_PER_FRAME;
+	double deviation;
+	double min = 0;
+	double max = 0;
+	uint32_t settle = 0;
+	uint32_t cnt;
+	uint32_t feedback;
+	uint8_t i;
+
+	seed = 1;
+	audio_rate_init(&rate, FRAMES_PER_INTERVAL * MCLK_PER_FRAME, MCLK_PER_FRAME, BYTES_PER_FRAME, target);
+	for (i = 0; i <= delay; i++)
+	{
+		requested[i] = FRAMES_PER_INTERVAL * MCLK_PER_FRAME;
+	}
+	for (cnt = 0; cnt < INTERVALS; cnt++)
+	{
+		// the measured MCLK count with +-1 period of the SOF jitter
+		feedback = audio_rate_update(&rate, (uint32_t)(device * MCLK_PER_FRAME) + noise(1),
+			(uint32_t)(fill + noise(PACKET_FRAMES / 2) * BYTES_PER_FRAME));
+		for (i = 0; i < delay; i++)
+		{
+			requested[i] = requested[i + 1];
+		}
+		requested[delay] = feedback;
+		// the host sends the rate requested delay intervals ago, the device plays its rate
+		fill += (requested[0] * (1.0 + host_ppm * 1e-6) / MCLK_PER_FRAME - device) * BYTES_PER_FRAME;
+		deviation = (fill - target) / BYTES_PER_FRAME;
+		if (deviation > SETTLE_FRAMES || deviation < -SETTLE_FRAMES)
+		{
+			settle = cnt + 1;
+		}
+		if (cnt >= INTERVALS / 3)
+		{
+			min = (deviation < min) ? deviation : min;
+			max = (deviation > max) ? deviation : max;
+		}
+	}
+	printf("host %4ld ppm, offset %4ld, delay %u, drift %4ld ppm: fill %6.1f .. %5.1f frames, settled in %5.2f s, limited %lu\n",
+		(long)host_ppm, (long)offset, delay, (long)drift_ppm, min, max, settle * 0.032, (unsigned long)rate.stats.limited);
+	return (settle > SETTLE_INTERVALS || min < -KEEP_FRAMES || max > KEEP_FRAMES) ? 1 : 0;
+}
+
+//--------------------------------------------
+int main(void)
+{
+	static const int32_t host_ppm[] = { 0, 50, -200 };
+	static const int32_t offsets[] = { 0, -150, 150 };
+	static const int32_t drift_ppm[] = { 0, 100, -300, 800, -800 };
+	unsigned int h, o, d, delay;
+	int failed = 0;
+
+	for (h = 0; h < sizeof(host_ppm) / sizeof(host_ppm[0]); h++)
+	{
+		for (o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+		{
+			for (delay = 1; delay <= HOST_DELAY_MAX; delay++)
+			{
+				for (d = 0; d < sizeof(drift_ppm) / sizeof(drift_ppm[0]); d++)
+				{
+					failed += run(host_ppm[h], offsets[o], (uint8_t)delay, drift_ppm[d]);
+				}
+			}
+		}
+	}
+	printf("%s: %d cases failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
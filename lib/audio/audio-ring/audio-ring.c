@@ -0,0 +1,266 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "audio-ring.h"
+#include <string.h>
+
+//--------------------------------------------
+static uint32_t pos_add(audio_ring_t *ring, uint32_t pos, uint32_t length)
+{
+	pos += length;
+	return (pos >= ring->wrap) ? pos - ring->wrap : pos;
+}
+
+//--------------------------------------------
+// The distance from pos2 to pos1 (pos1 is not behind pos2)
+static uint32_t pos_sub(audio_ring_t *ring, uint32_t pos1, uint32_t pos2)
+{
+	return (pos1 >= pos2) ? pos1 - pos2 : pos1 + ring->wrap - pos2;
+}
+
+//--------------------------------------------
+// pos1 is behind pos2
+static uint8_t pos_before(audio_ring_t *ring, uint32_t pos1, uint32_t pos2)
+{
+	return pos1 != pos2 && pos_sub(ring, pos2, pos1) < ring->wrap / 2;
+}
+
+//--------------------------------------------
+// TX: the position the DMA reads from
+static uint32_t dma_pos(audio_ring_t *ring)
+{
+	uint32_t rd;
+	uint32_t offset;
+
+	// rd first: the DMA is less than the ring ahead of it even if the interrupt occurs in between
+	rd = ring->rd;
+	if (!ring->dma_remain)
+	{
+		return rd;
+	}
+	offset = (ring->size - ring->dma_remain()) % ring->size;
+	return pos_add(ring, rd, (offset + ring->size - rd % ring->size) % ring->size);
+}
+
+//--------------------------------------------
+// TX: the producer position (the underrun moves it forward)
+static uint32_t tx_wr(audio_ring_t *ring)
+{
+	uint32_t wr = ring->wr;
+	uint32_t xrun = ring->xrun;
+
+	return pos_before(ring, wr, xrun) ? xrun : wr;
+}
+
+//--------------------------------------------
+// RX: the consumer position (the overrun moves it forward)
+static uint32_t rx_rd(audio_ring_t *ring)
+{
+	uint32_t rd = ring->rd;
+	uint32_t xrun = ring->xrun;
+
+	return pos_before(ring, rd, xrun) ? xrun : rd;
+}
+
+//--------------------------------------------
+void audio_ring_init(audio_ring_t *ring, uint8_t dir, void *buf, uint32_t size, audio_ring_dma_remain_t dma_remain)
+{
+	ring->buf = (uint8_t *)buf;
+	ring->size = size;
+	ring->half = size / 2;
+	ring->wrap = 0x80000000 / size * size;
+	ring->dir = dir;
+	ring->dma_remain = dma_remain;
+	audio_ring_reset(ring);
+}
+
+//--------------------------------------------
+void audio_ring_reset(audio_ring_t *ring)
+{
+	memset(ring->buf, 0, ring->size);
+	ring->wr = 0;
+	ring->rd = 0;
+	ring->xrun = 0;
+	ring->periods = 0;
+	ring->underruns = 0;
+	ring->overruns = 0;
+}
+
+//--------------------------------------------
+void audio_ring_dma_callback(audio_ring_t *ring, uint8_t half)
+{
+	uint32_t pos;
+	uint32_t wr;
+	uint32_t end;
+
+	// the position of the half the DMA has started
+	pos = (ring->dir == AUDIO_RING_TX) ? ring->rd : ring->wr;
+	pos = pos_add(ring, pos, ring->half);
+	if (pos % ring->size != (half ? 0 : ring->half))
+	{
+		// the interrupt was missed
+		pos = pos_add(ring, pos, ring->half);
+		ring->overruns++;
+	}
+	ring->periods++;
+
+	if (ring->dir == AUDIO_RING_TX)
+	{
+		ring->rd = pos;
+		end = pos_add(ring, pos, ring->half);
+		wr = tx_wr(ring);
+		if (pos_before(ring, wr, end))
+		{
+			// the half is incomplete: the rest of it is silence
+			// and the producer continues from the next half
+			if (pos_before(ring, wr, pos))
+			{
+				wr = pos;
+			}
+			memset(ring->buf + wr % ring->size, 0, pos_sub(ring, end, wr));
+			ring->xrun = end;
+			ring->underruns++;
+		}
+	}
+	else
+	{
+		ring->wr = pos;
+		// the completed half before the one the DMA has started is readable only
+		pos = pos_add(ring, pos, ring->wrap - ring->half);
+		if (pos_before(ring, rx_rd(ring), pos))
+		{
+			ring->xrun = pos;
+			ring->overruns++;
+		}
+	}
+}
+
+//--------------------------------------------
+uint32_t audio_ring_get_fill(audio_ring_t *ring)
+{
+	uint32_t wr, rd;
+
+	if (ring->dir == AUDIO_RING_TX)
+	{
+		rd = dma_pos(ring);
+		wr = tx_wr(ring);
+	}
+	else
+	{
+		rd = rx_rd(ring);
+		wr = ring->wr;
+	}
+	return pos_before(ring, rd, wr) ? pos_sub(ring, wr, rd) : 0;
+}
+
+//--------------------------------------------
+uint32_t audio_ring_get_free(audio_ring_t *ring)
+{
+	uint32_t fill = audio_ring_get_fill(ring);
+
+	if (ring->dir == AUDIO_RING_TX)
+	{
+		return (fill < ring->size) ? ring->size - fill : 0;
+	}
+	return (fill < ring->half) ? ring->half - fill : 0;
+}
+
+//--------------------------------------------
+uint8_t *audio_ring_get_write_ptr(audio_ring_t *ring, uint32_t *length)
+{
+	uint32_t free;
+	uint32_t offset;
+
+	ring->wr = tx_wr(ring);
+	free = audio_ring_get_free(ring);
+	offset = ring->wr % ring->size;
+	*length = (free < ring->size - offset) ? free : ring->size - offset;
+	return ring->buf + offset;
+}
+
+//--------------------------------------------
+void audio_ring_commit_write(audio_ring_t *ring, uint32_t length)
+{
+	ring->wr = pos_add(ring, ring->wr, length);
+}
+
+//--------------------------------------------
+uint8_t *audio_ring_get_read_ptr(audio_ring_t *ring, uint32_t *length)
+{
+	uint32_t fill;
+	uint32_t offset;
+
+	ring->rd = rx_rd(ring);
+	fill = audio_ring_get_fill(ring);
+	offset = ring->rd % ring->size;
+	*length = (fill < ring->size - offset) ? fill : ring->size - offset;
+	return ring->buf + offset;
+}
+
+//--------------------------------------------
+void audio_ring_commit_read(audio_ring_t *ring, uint32_t length)
+{
+	ring->rd = pos_add(ring, ring->rd, length);
+}
+
+//--------------------------------------------
+uint32_t audio_ring_write(audio_ring_t *ring, const void *data, uint32_t length)
+{
+	const uint8_t *src = (const uint8_t *)data;
+	uint32_t done;
+	uint32_t size;
+	uint8_t *dst;
+
+	for (done = 0; done < length; done += size)
+	{
+		dst = audio_ring_get_write_ptr(ring, &size);
+		if (!size)
+		{
+			break;
+		}
+		if (size > length - done)
+		{
+			size = length - done;
+		}
+		memcpy(dst, src + done, size);
+		audio_ring_commit_write(ring, size);
+	}
+	return done;
+}
+
+//--------------------------------------------
+uint32_t audio_ring_read(audio_ring_t *ring, void *data, uint32_t length)
+{
+	uint8_t *dst = (uint8_t *)data;
+	uint32_t done;
+	uint32_t size;
+	uint8_t *src;
+
+	for (done = 0; done < length; done += size)
+	{
+		src = audio_ring_get_read_ptr(ring, &size);
+		if (!size)
+		{
+			break;
+		}
+		if (size > length - done)
+		{
+			size = length - done;
+		}
+		memcpy(dst + done, src, size);
+		audio_ring_commit_read(ring, size);
+	}
+	return done;
+}
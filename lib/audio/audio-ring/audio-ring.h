@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef AUDIO_RING_H_
+#define AUDIO_RING_H_
+
+//--------------------------------------------
+// Ring buffer audio streaming engine:
+// the DMA runs in the circular mode over the whole ring,
+// the half transfer (HT) and transfer complete (TC) interrupts
+// mark the end of the first and the second half of the ring.
+// The DMA is never re-armed while streaming, so there is no gap between the periods.
+// The positions are the byte counters since the start (they wrap around
+// the multiple of the ring size), the ring offset of the position is position % size.
+//
+// Playback (AUDIO_RING_TX): the application is the producer, the DMA is the consumer.
+// The data can be written up to the current DMA position (one ring ahead),
+// the half the DMA starts with must be written completely by the time of its HT/TC interrupt,
+// otherwise the rest of it is filled with silence (underrun).
+//
+// static uint32_t ring_buf[1024];
+// static audio_ring_t ring;
+// static void tx_cycle_callback(uint8_t half) { audio_ring_dma_callback(&ring, half); }
+// audio_out_drv.init_dma_txbuf_cycle(tx_cycle_callback);
+// audio_ring_init(&ring, AUDIO_RING_TX, ring_buf, sizeof(ring_buf), audio_out_drv.get_dma_txbuf_remain);
+// audio_ring_write(&ring, data, sizeof(ring_buf) * 3 / 4);
+// audio_out_drv.write_dma_txbuf(ring_buf, sizeof(ring_buf));
+// while (1)
+// {
+//     audio_ring_write(&ring, data, length);
+// }
+//
+// Capture (AUDIO_RING_RX): the DMA is the producer, the application is the consumer.
+// The half becomes readable at its HT/TC interrupt, the half is dropped
+// if it has not been read before the DMA starts to write it again (overrun).
+
+#define AUDIO_RING_TX    0
+#define AUDIO_RING_RX    1
+
+// Returns the number of bytes the DMA has to transfer till the end of the ring (NDTR)
+typedef uint32_t (*audio_ring_dma_remain_t)(void);
+
+typedef struct audio_ring
+{
+	uint8_t *buf;
+	uint32_t size;
+	uint8_t dir;
+	audio_ring_dma_remain_t dma_remain;
+	uint32_t half;
+	// The positions wrap around at the multiple of size
+	uint32_t wrap;
+	// The producer and the consumer positions
+	volatile uint32_t wr;
+	volatile uint32_t rd;
+	// The position the application skips to after the underrun (overrun),
+	// set by the interrupt, so wr (rd) is changed by the application only
+	volatile uint32_t xrun;
+	// Statistics since the start
+	volatile uint32_t periods;      // halves transferred by the DMA
+	volatile uint32_t underruns;    // TX: halves started incomplete
+	volatile uint32_t overruns;     // RX: halves overwritten before they were read, TX: missed interrupts
+} audio_ring_t;
+
+// buf: 4 byte aligned, size: even number of the audio frames (all the channel samples)
+// dma_remain: NULL if the DMA position is not available,
+// the TX data can be written up to the start of the current half then
+void audio_ring_init(audio_ring_t *ring, uint8_t dir, void *buf, uint32_t size, audio_ring_dma_remain_t dma_remain);
+// Silence, empty ring, before the DMA is started
+void audio_ring_reset(audio_ring_t *ring);
+// DMA interrupt context: half = 0 - HT (the first half is transferred), 1 - TC
+void audio_ring_dma_callback(audio_ring_t *ring, uint8_t half);
+// TX: the bytes written and not transferred yet, RX: the bytes captured and not read yet
+uint32_t audio_ring_get_fill(audio_ring_t *ring);
+// TX: the bytes can be written, RX: the bytes can be captured before the overrun
+uint32_t audio_ring_get_free(audio_ring_t *ring);
+// Return the number of bytes copied
+uint32_t audio_ring_write(audio_ring_t *ring, const void *data, uint32_t length);
+uint32_t audio_ring_read(audio_ring_t *ring, void *data, uint32_t length);
+// Zero copy access: the contiguous part of the ring to write to (read from) is returned,
+// its length is limited by the free (filled) bytes and the end of the ring.
+// The position is moved by audio_ring_commit_write (audio_ring_commit_read).
+uint8_t *audio_ring_get_write_ptr(audio_ring_t *ring, uint32_t *length);
+void audio_ring_commit_write(audio_ring_t *ring, uint32_t length);
+uint8_t *audio_ring_get_read_ptr(audio_ring_t *ring, uint32_t *length);
+void audio_ring_commit_read(audio_ring_t *ring, uint32_t length);
+
+#endif // AUDIO_RING_H_
@@ -0,0 +1,480 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "audio-ring.h"
+#include "audio-src.h"
+#include <string.h>
+
+//--------------------------------------------
+// The phase (6 bits) and the interpolation factor between the phases (Q10) of the output time
+#define PHASE_SHIFT             (24 - 6)
+#define MU_SHIFT                (PHASE_SHIFT - 10)
+#define MU_MASK                 0x3FF
+
+typedef void (*filter_t)(audio_src_t *src, uint32_t pos, int16_t *out);
+
+//--------------------------------------------
+// Kaiser windowed sinc (beta = 10, cutoff = 0.44 of the input rate),
+// the window is shifted to 0 at the ends, so the tap entering the filter
+// changes smoothly from the phase to the phase.
+// The phase p row: h(AUDIO_SRC_TAPS / 2 - tap + p / AUDIO_SRC_PHASES),
+// tap 0 is for the oldest sample, the sum of every row is 32768
+// (the sum of the absolute values is less than 2, so the 32-bit accumulator doesn't overflow),
+// the row AUDIO_SRC_PHASES is the row 0 delayed by one sample
+static const int16_t coefs[AUDIO_SRC_PHASES + 1][AUDIO_SRC_TAPS] =
+{
+	{ // 0
+		0, -1, 5, -16, 36, -61, 77, -56, -46, 277, -671, 1234, -1926, 2659, -3314, 3769,
+		28836, 3769, -3314, 2659, -1926, 1234, -671, 277, -46, -56, 77, -61, 36, -16, 5, -1,
+	},
+	{ // 1
+		0, -1, 5, -16, 35, -59, 72, -46, -61, 296, -690, 1243, -1907, 2584, -3130, 3301,
+		28829, 4245, -3495, 2729, -1942, 1223, -651, 256, -30, -66, 83, -63, 36, -16, 5, -1,
+	},
+	{ // 2
+		0, -1, 5, -16, 34, -56, 67, -36, -76, 315, -707, 1249, -1884, 2506, -2944, 2841,
+		28799, 4729, -3672, 2796, -1954, 1210, -629, 235, -15, -76, 88, -65, 37, -16, 5, -1,
+	},
+	{ // 3
+		0, -1, 5, -15, 33, -54, 61, -27, -91, 333, -723, 1252, -1859, 2424, -2756, 2391,
+		28754, 5221, -3845, 2858, -1962, 1194, -605, 214, 1, -86, 93, -67, 37, -16, 5, -1,
+	},
+	{ // 4
+		0, -1, 5, -15, 32, -51, 56, -17, -105, 349, -738, 1254, -1830, 2338, -2565, 1949,
+		28691, 5719, -4015, 2915, -1967, 1176, -580, 191, 18, -96, 98, -69, 38, -16, 5, -1,
+	},
+	{ // 5
+		0, -1, 5, -15, 31, -49, 51, -8, -119, 365, -750, 1252, -1798, 2250, -2373, 1518,
+		28610, 6224, -4180, 2968, -1968, 1155, -554, 168, 34, -106, 103, -71, 38, -16, 5, -1,
+	},
+	{ // 6
+		0, -1, 5, -15, 30, -46, 45, 2, -132, 381, -761, 1249, -1763, 2158, -2180, 1096,
+		28509, 6735, -4339, 3015, -1966, 1131, -526, 144, 51, -116, 108, -73, 39, -16, 5, -1,
+	},
+	{ // 7
+		0, -1, 5, -15, 29, -43, 40, 11, -145, 395, -771, 1243, -1725, 2063, -1986, 685,
+		28393, 7251, -4494, 3058, -1959, 1106, -497, 120, 68, -126, 112, -75, 39, -16, 4, -1,
+	},
+	{ // 8
+		0, -1, 5, -14, 28, -41, 34, 20, -157, 408, -779, 1235, -1684, 1966, -1792, 284,
+		28257, 7772, -4643, 3095, -1949, 1077, -466, 95, 85, -135, 117, -76, 39, -15, 4, -1,
+	},
+	{ // 9
+		0, -1, 5, -14, 27, -38, 29, 29, -169, 420, -785, 1224, -1641, 1867, -1598, -105,
+		28105, 8298, -4786, 3127, -1935, 1047, -435, 69, 102, -145, 121, -78, 39, -15, 4, 0,
+	},
+	{ // 10
+		0, -1, 5, -14, 26, -35, 24, 37, -181, 432, -790, 1212, -1595, 1765, -1404, -484,
+		27934, 8827, -4922, 3154, -1917, 1014, -402, 43, 119, -154, 126, -79, 39, -15, 4, 0,
+	},
+	{ // 11
+		0, -1, 5, -13, 25, -33, 18, 46, -192, 442, -793, 1197, -1547, 1661, -1211, -850,
+		27748, 9361, -5052, 3174, -1895, 978, -367, 17, 136, -164, 130, -80, 39, -15, 4, 0,
+	},
+	{ // 12
+		0, -1, 5, -13, 24, -30, 13, 54, -202, 451, -795, 1180, -1496, 1556, -1018, -1206,
+		27545, 9897, -5174, 3189, -1870, 940, -332, -10, 153, -173, 134, -81, 39, -14, 3, 0,
+	},
+	{ // 13
+		0, -1, 5, -13, 23, -27, 8, 62, -212, 460, -795, 1161, -1443, 1449, -827, -1549,
+		27323, 10435, -5289, 3199, -1840, 901, -296, -37, 170, -182, 137, -82, 39, -14, 3, 0,
+	},
+	{ // 14
+		0, -1, 5, -12, 22, -24, 3, 70, -221, 467, -794, 1140, -1388, 1341, -638, -1880,
+		27085, 10976, -5397, 3202, -1807, 858, -258, -64, 187, -190, 141, -83, 39, -14, 3, 0,
+	},
+	{ // 15
+		0, -1, 5, -12, 20, -22, -2, 77, -230, 474, -791, 1118, -1331, 1231, -450, -2199,
+		26833, 11518, -5496, 3199, -1769, 814, -220, -92, 204, -199, 144, -83, 38, -13, 3, 0,
+	},
+	{ // 16
+		0, -1, 4, -11, 19, -19, -7, 84, -238, 479, -787, 1093, -1273, 1121, -265, -2505,
+		26568, 12060, -5586, 3190, -1728, 767, -181, -120, 221, -207, 147, -84, 38, -13, 2, 0,
+	},
+	{ // 17
+		0, -1, 4, -11, 18, -16, -12, 91, -246, 483, -781, 1067, -1212, 1011, -82, -2798,
+		26280, 12603, -5668, 3175, -1683, 719, -140, -148, 237, -215, 150, -84, 37, -12, 2, 0,
+	},
+	{ // 18
+		0, -1, 4, -10, 17, -14, -17, 98, -253, 487, -774, 1039, -1150, 899, 98, -3079,
+		25980, 13146, -5740, 3153, -1634, 668, -99, -176, 254, -223, 152, -84, 37, -12, 2, 0,
+	},
+	{ // 19
+		0, -1, 4, -10, 15, -11, -21, 104, -259, 489, -765, 1009, -1087, 788, 275, -3347,
+		25665, 13688, -5803, 3125, -1581, 616, -58, -204, 270, -230, 154, -84, 36, -11, 2, 0,
+	},
+	{ // 20
+		0, -1, 4, -9, 14, -8, -26, 110, -265, 491, -755, 978, -1022, 677, 448, -3602,
+		25335, 14228, -5856, 3091, -1525, 562, -16, -232, 285, -237, 156, -84, 35, -10, 1, 1,
+	},
+	{ // 21
+		0, -1, 4, -9, 13, -6, -30, 116, -270, 491, -744, 945, -957, 565, 618, -3843,
+		24990, 14767, -5899, 3051, -1465, 506, 27, -260, 301, -244, 158, -83, 35, -10, 1, 1,
+	},
+	{ // 22
+		0, -1, 4, -9, 12, -3, -34, 122, -275, 491, -731, 911, -890, 455, 784, -4072,
+		24631, 15302, -5931, 3003, -1401, 448, 71, -288, 316, -250, 160, -83, 34, -9, 0, 1,
+	},
+	{ // 23
+		0, -1, 4, -8, 10, -1, -38, 127, -279, 490, -718, 876, -822, 344, 946, -4287,
+		24261, 15835, -5953, 2950, -1334, 389, 114, -315, 330, -256, 161, -82, 32, -8, 0, 1,
+	},
+	{ // 24
+		0, -1, 3, -8, 9, 2, -42, 131, -282, 487, -703, 839, -754, 235, 1103, -4489,
+		23881, 16364, -5964, 2890, -1264, 328, 158, -343, 345, -262, 162, -81, 31, -8, 0, 1,
+	},
+	{ // 25
+		0, -1, 3, -7, 8, 4, -46, 136, -285, 484, -687, 802, -685, 127, 1256, -4678,
+		23483, 16889, -5964, 2824, -1190, 266, 203, -370, 358, -267, 162, -80, 30, -7, -1, 1,
+	},
+	{ // 26
+		0, -1, 3, -7, 7, 6, -49, 140, -288, 480, -670, 763, -616, 19, 1404, -4853,
+		23074, 17409, -5952, 2751, -1113, 203, 247, -397, 372, -271, 163, -79, 29, -6, -1, 1,
+	},
+	{ // 27
+		0, -1, 3, -6, 6, 9, -53, 144, -289, 475, -652, 723, -546, -86, 1547, -5015,
+		22654, 17923, -5929, 2672, -1033, 138, 292, -423, 384, -276, 162, -77, 27, -5, -2, 2,
+	},
+	{ // 28
+		0, -1, 3, -6, 4, 11, -56, 147, -290, 470, -632, 682, -476, -191, 1685, -5165,
+		22224, 18432, -5894, 2586, -950, 73, 336, -449, 396, -279, 162, -76, 26, -4, -2, 2,
+	},
+	{ // 29
+		0, -1, 3, -5, 3, 13, -59, 150, -291, 463, -612, 641, -407, -293, 1818, -5301,
+		21782, 18934, -5847, 2494, -863, 6, 381, -474, 408, -283, 161, -74, 24, -3, -2, 2,
+	},
+	{ // 30
+		0, -1, 3, -5, 2, 15, -62, 153, -291, 456, -591, 599, -337, -394, 1945, -5424,
+		21329, 19429, -5787, 2397, -775, -61, 425, -499, 419, -285, 160, -72, 23, -2, -3, 2,
+	},
+	{ // 31
+		0, -1, 2, -4, 1, 17, -65, 155, -290, 448, -569, 556, -267, -493, 2067, -5534,
+		20866, 19917, -5715, 2293, -683, -129, 469, -523, 429, -287, 159, -70, 21, -1, -3, 2,
+	},
+	{ // 32
+		0, 0, 2, -4, 0, 19, -67, 157, -289, 439, -547, 513, -198, -589, 2183, -5631,
+		20396, 20396, -5631, 2183, -589, -198, 513, -547, 439, -289, 157, -67, 19, 0, -4, 2,
+	},
+	{ // 33
+		0, 0, 2, -3, -1, 21, -70, 159, -287, 429, -523, 469, -129, -683, 2293, -5715,
+		19917, 20865, -5534, 2067, -493, -267, 556, -569, 448, -290, 155, -65, 17, 1, -4, 2,
+	},
+	{ // 34
+		0, 0, 2, -3, -2, 23, -72, 160, -285, 419, -499, 425, -61, -775, 2397, -5787,
+		19429, 21328, -5424, 1945, -394, -337, 599, -591, 456, -291, 153, -62, 15, 2, -5, 3,
+	},
+	{ // 35
+		0, 0, 2, -2, -3, 24, -74, 161, -283, 408, -474, 381, 6, -863, 2494, -5847,
+		18934, 21781, -5301, 1818, -293, -407, 641, -612, 463, -291, 150, -59, 13, 3, -5, 3,
+	},
+	{ // 36
+		0, 0, 2, -2, -4, 26, -76, 162, -279, 396, -449, 336, 73, -950, 2586, -5894,
+		18432, 22223, -5165, 1685, -191, -476, 682, -632, 470, -290, 147, -56, 11, 4, -6, 3,
+	},
+	{ // 37
+		0, 0, 2, -2, -5, 27, -77, 162, -276, 384, -423, 292, 138, -1033, 2672, -5929,
+		17923, 22653, -5015, 1547, -86, -546, 723, -652, 475, -289, 144, -53, 9, 6, -6, 3,
+	},
+	{ // 38
+		0, 0, 1, -1, -6, 29, -79, 163, -271, 372, -397, 247, 203, -1113, 2751, -5952,
+		17409, 23073, -4853, 1404, 19, -616, 763, -670, 480, -288, 140, -49, 6, 7, -7, 3,
+	},
+	{ // 39
+		0, 0, 1, -1, -7, 30, -80, 162, -267, 358, -370, 203, 266, -1190, 2824, -5964,
+		16889, 23482, -4678, 1256, 127, -685, 802, -687, 484, -285, 136, -46, 4, 8, -7, 3,
+	},
+	{ // 40
+		0, 0, 1, 0, -8, 31, -81, 162, -262, 345, -343, 158, 328, -1264, 2890, -5964,
+		16364, 23880, -4489, 1103, 235, -754, 839, -703, 487, -282, 131, -42, 2, 9, -8, 3,
+	},
+	{ // 41
+		0, 0, 1, 0, -8, 32, -82, 161, -256, 330, -315, 114, 389, -1334, 2950, -5953,
+		15835, 24260, -4287, 946, 344, -822, 876, -718, 490, -279, 127, -38, -1, 10, -8, 4,
+	},
+	{ // 42
+		0, 0, 1, 0, -9, 34, -83, 160, -250, 316, -288, 71, 448, -1401, 3003, -5931,
+		15302, 24630, -4072, 784, 455, -890, 911, -731, 491, -275, 122, -34, -3, 12, -9, 4,
+	},
+	{ // 43
+		0, 0, 1, 1, -10, 35, -83, 158, -244, 301, -260, 27, 506, -1465, 3050, -5899,
+		14766, 24991, -3843, 618, 565, -957, 945, -744, 491, -270, 116, -30, -6, 13, -9, 4,
+	},
+	{ // 44
+		0, 0, 1, 1, -10, 35, -84, 156, -237, 285, -232, -16, 562, -1525, 3091, -5856,
+		14228, 25333, -3601, 448, 677, -1022, 978, -755, 491, -265, 110, -26, -8, 14, -9, 4,
+	},
+	{ // 45
+		0, 0, 0, 2, -11, 36, -84, 154, -230, 270, -204, -58, 616, -1581, 3125, -5803,
+		13687, 25665, -3347, 275, 788, -1087, 1009, -765, 489, -259, 104, -21, -11, 15, -10, 4,
+	},
+	{ // 46
+		0, 0, 0, 2, -12, 37, -84, 152, -223, 254, -176, -99, 668, -1634, 3153, -5740,
+		13146, 25979, -3079, 98, 899, -1150, 1039, -774, 487, -253, 98, -17, -14, 17, -10, 4,
+	},
+	{ // 47
+		0, 0, 0, 2, -12, 37, -84, 150, -215, 237, -148, -140, 719, -1683, 3175, -5667,
+		12603, 26278, -2798, -82, 1011, -1212, 1067, -781, 483, -246, 91, -12, -16, 18, -11, 4,
+	},
+	{ // 48
+		0, 0, 0, 2, -13, 38, -84, 147, -207, 221, -120, -181, 767, -1728, 3190, -5586,
+		12060, 26566, -2505, -265, 1121, -1273, 1093, -786, 479, -238, 84, -7, -19, 19, -11, 4,
+	},
+	{ // 49
+		0, 0, 0, 3, -13, 38, -83, 144, -199, 204, -92, -220, 814, -1769, 3199, -5495,
+		11517, 26832, -2199, -450, 1231, -1331, 1118, -791, 474, -230, 77, -2, -22, 20, -12, 5,
+	},
+	{ // 50
+		0, 0, 0, 3, -14, 39, -83, 141, -190, 187, -64, -258, 858, -1806, 3202, -5396,
+		10976, 27082, -1880, -638, 1341, -1388, 1140, -794, 467, -221, 70, 3, -24, 22, -12, 5,
+	},
+	{ // 51
+		0, 0, 0, 3, -14, 39, -82, 137, -182, 170, -37, -296, 900, -1840, 3199, -5289,
+		10435, 27323, -1549, -827, 1449, -1443, 1161, -795, 460, -212, 62, 8, -27, 23, -13, 5,
+	},
+	{ // 52
+		0, 0, 0, 3, -14, 39, -81, 134, -173, 153, -10, -332, 940, -1870, 3189, -5174,
+		9896, 27545, -1206, -1018, 1556, -1496, 1180, -795, 451, -202, 54, 13, -30, 24, -13, 5,
+	},
+	{ // 53
+		0, 0, 0, 4, -15, 39, -80, 130, -164, 136, 17, -367, 978, -1895, 3174, -5052,
+		9360, 27748, -850, -1211, 1661, -1547, 1197, -793, 442, -192, 46, 18, -33, 25, -13, 5,
+	},
+	{ // 54
+		0, 0, 0, 4, -15, 39, -79, 126, -154, 119, 43, -402, 1014, -1917, 3154, -4922,
+		8827, 27933, -484, -1404, 1765, -1595, 1212, -790, 432, -181, 37, 24, -35, 26, -14, 5,
+	},
+	{ // 55
+		0, 0, 0, 4, -15, 39, -78, 121, -145, 102, 69, -435, 1047, -1935, 3127, -4786,
+		8297, 28105, -105, -1598, 1867, -1641, 1224, -785, 420, -169, 29, 29, -38, 27, -14, 5,
+	},
+	{ // 56
+		0, 0, -1, 4, -15, 39, -76, 117, -135, 85, 95, -466, 1077, -1949, 3095, -4643,
+		7772, 28256, 284, -1792, 1966, -1684, 1235, -779, 408, -157, 20, 34, -41, 28, -14, 5,
+	},
+	{ // 57
+		0, 0, -1, 4, -16, 39, -75, 112, -126, 68, 120, -497, 1106, -1959, 3058, -4494,
+		7251, 28392, 685, -1986, 2063, -1725, 1243, -771, 395, -145, 11, 40, -43, 29, -15, 5,
+	},
+	{ // 58
+		0, 0, -1, 5, -16, 39, -73, 108, -116, 51, 144, -526, 1131, -1966, 3015, -4339,
+		6734, 28509, 1096, -2180, 2158, -1763, 1249, -761, 381, -132, 2, 45, -46, 30, -15, 5,
+	},
+	{ // 59
+		0, 0, -1, 5, -16, 38, -71, 103, -106, 34, 168, -554, 1155, -1968, 2967, -4179,
+		6224, 28610, 1518, -2373, 2249, -1798, 1252, -750, 365, -119, -8, 51, -49, 31, -15, 5,
+	},
+	{ // 60
+		0, 0, -1, 5, -16, 38, -69, 98, -96, 18, 191, -580, 1176, -1967, 2915, -4015,
+		5719, 28690, 1949, -2565, 2338, -1830, 1254, -738, 349, -105, -17, 56, -51, 32, -15, 5,
+	},
+	{ // 61
+		0, 0, -1, 5, -16, 37, -67, 93, -86, 1, 214, -605, 1194, -1962, 2858, -3845,
+		5221, 28753, 2391, -2756, 2424, -1859, 1252, -723, 333, -91, -27, 61, -54, 33, -15, 5,
+	},
+	{ // 62
+		0, 0, -1, 5, -16, 37, -65, 88, -76, -15, 235, -629, 1210, -1954, 2796, -3672,
+		4729, 28798, 2841, -2944, 2506, -1884, 1249, -707, 315, -76, -36, 67, -56, 34, -16, 5,
+	},
+	{ // 63
+		0, 0, -1, 5, -16, 36, -63, 83, -66, -30, 256, -651, 1223, -1941, 2729, -3495,
+		4245, 28827, 3301, -3130, 2584, -1907, 1243, -690, 296, -61, -46, 72, -59, 35, -16, 5,
+	},
+	{ // 64
+		0, 0, -1, 5, -16, 36, -61, 77, -56, -46, 277, -671, 1234, -1926, 2659, -3314,
+		3769, 28835, 3769, -3314, 2659, -1926, 1234, -671, 277, -46, -56, 77, -61, 36, -16, 5,
+	},
+};
+
+//--------------------------------------------
+static void push(audio_src_t *src, const int16_t *in)
+{
+	src->left[src->oldest] = src->left[src->oldest + AUDIO_SRC_TAPS] = in[0];
+	src->right[src->oldest] = src->right[src->oldest + AUDIO_SRC_TAPS] = in[1];
+	src->oldest = (src->oldest + 1) % AUDIO_SRC_TAPS;
+}
+
+//--------------------------------------------
+// y0, y1: Q30 results of the neighbouring phases,
+// 3 extra bits are kept till the end of the interpolation
+static int32_t interpolate(int32_t y0, int32_t y1, uint32_t pos)
+{
+	y0 >>= 12;
+	y1 >>= 12;
+	return (y0 + (((y1 - y0) * (int32_t)((pos >> MU_SHIFT) & MU_MASK)) >> 10) + (1 << 2)) >> 3;
+}
+
+//--------------------------------------------
+static int32_t dot_ref(const int16_t *x, const int16_t *c)
+{
+	int32_t acc;
+	uint8_t cnt;
+
+	for (acc = 0, cnt = 0; cnt < AUDIO_SRC_TAPS; cnt++)
+	{
+		acc += x[cnt] * c[cnt];
+	}
+	return acc;
+}
+
+//--------------------------------------------
+static int16_t saturate_ref(int32_t y)
+{
+	return (y > INT16_MAX) ? INT16_MAX : (y < INT16_MIN) ? INT16_MIN : (int16_t)y;
+}
+
+//--------------------------------------------
+static void filter_ref(audio_src_t *src, uint32_t pos, int16_t *out)
+{
+	const int16_t *c0 = coefs[pos >> PHASE_SHIFT];
+	const int16_t *c1 = c0 + AUDIO_SRC_TAPS;
+
+	out[0] = saturate_ref(interpolate(dot_ref(&src->left[src->oldest], c0), dot_ref(&src->left[src->oldest], c1), pos));
+	out[1] = saturate_ref(interpolate(dot_ref(&src->right[src->oldest], c0), dot_ref(&src->right[src->oldest], c1), pos));
+}
+
+#if defined __ARM_FEATURE_DSP
+//--------------------------------------------
+// SMLAD: 2 taps per instruction, the history window may start at the odd sample
+static int32_t dot_dsp(const int16_t *x, const int16_t *c)
+{
+	int32_t acc;
+	uint8_t cnt;
+
+	for (acc = 0, cnt = AUDIO_SRC_TAPS / 8; cnt; cnt--)
+	{
+		acc = __SMLAD(__UNALIGNED_UINT32_READ(x), __UNALIGNED_UINT32_READ(c), acc);
+		acc = __SMLAD(__UNALIGNED_UINT32_READ(x + 2), __UNALIGNED_UINT32_READ(c + 2), acc);
+		acc = __SMLAD(__UNALIGNED_UINT32_READ(x + 4), __UNALIGNED_UINT32_READ(c + 4), acc);
+		acc = __SMLAD(__UNALIGNED_UINT32_READ(x + 6), __UNALIGNED_UINT32_READ(c + 6), acc);
+		x += 8;
+		c += 8;
+	}
+	return acc;
+}
+
+//--------------------------------------------
+static void filter_dsp(audio_src_t *src, uint32_t pos, int16_t *out)
+{
+	const int16_t *c0 = coefs[pos >> PHASE_SHIFT];
+	const int16_t *c1 = c0 + AUDIO_SRC_TAPS;
+
+	out[0] = (int16_t)__SSAT(interpolate(dot_dsp(&src->left[src->oldest], c0), dot_dsp(&src->left[src->oldest], c1), pos), 16);
+	out[1] = (int16_t)__SSAT(interpolate(dot_dsp(&src->right[src->oldest], c0), dot_dsp(&src->right[src->oldest], c1), pos), 16);
+}
+#endif
+
+//--------------------------------------------
+static uint32_t process(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames, filter_t filter)
+{
+	uint32_t used;
+	uint32_t cnt;
+
+	for (used = 0, cnt = 0; cnt < out_frames; cnt++)
+	{
+		// the input samples before the output time
+		for (; src->pos >= AUDIO_SRC_ONE; src->pos -= AUDIO_SRC_ONE)
+		{
+			if (used == *in_frames)
+			{
+				*in_frames = used;
+				return cnt;
+			}
+			push(src, in);
+			in += 2;
+			used++;
+		}
+		filter(src, src->pos, out);
+		out += 2;
+		src->pos += src->step;
+	}
+	*in_frames = used;
+	return cnt;
+}
+
+//--------------------------------------------
+void audio_src_init(audio_src_t *src, uint32_t rate_in, uint32_t rate_out)
+{
+	src->step_nominal = (uint32_t)(((uint64_t)rate_in << 24) / rate_out);
+	src->step = src->step_nominal;
+	audio_src_reset(src);
+}
+
+//--------------------------------------------
+void audio_src_reset(audio_src_t *src)
+{
+	memset(src->left, 0, sizeof(src->left));
+	memset(src->right, 0, sizeof(src->right));
+	src->oldest = 0;
+	src->pos = 0;
+}
+
+//--------------------------------------------
+void audio_src_trim(audio_src_t *src, int32_t ppm)
+{
+	src->step = (uint32_t)((int64_t)src->step_nominal * 1000000 / (1000000 + ppm));
+}
+
+//--------------------------------------------
+uint32_t audio_src_process_ref(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames)
+{
+	return process(src, in, in_frames, out, out_frames, filter_ref);
+}
+
+#if defined __ARM_FEATURE_DSP
+//--------------------------------------------
+uint32_t audio_src_process_dsp(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames)
+{
+	return process(src, in, in_frames, out, out_frames, filter_dsp);
+}
+#endif
+
+//--------------------------------------------
+uint32_t audio_src_process(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames)
+{
+#if defined __ARM_FEATURE_DSP
+	return audio_src_process_dsp(src, in, in_frames, out, out_frames);
+#else
+	return audio_src_process_ref(src, in, in_frames, out, out_frames);
+#endif
+}
+
+//--------------------------------------------
+uint32_t audio_src_write_ring(audio_src_t *src, audio_ring_t *ring, const int16_t *in, uint32_t in_frames)
+{
+	uint32_t used;
+	uint32_t total;
+	uint32_t length;
+	uint32_t frames;
+	int16_t *dst;
+
+	// the contiguous parts till the end of the ring and from its start
+	for (total = 0; total < in_frames;)
+	{
+		dst = (int16_t *)audio_ring_get_write_ptr(ring, &length);
+		if (length < 4)
+		{
+			break;
+		}
+		used = in_frames - total;
+		frames = audio_src_process(src, in + total * 2, &used, dst, length / 4);
+		audio_ring_commit_write(ring, frames * 4);
+		total += used;
+		if (frames < length / 4)
+		{
+			break;
+		}
+	}
+	return total;
+}
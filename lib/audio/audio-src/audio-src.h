@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef AUDIO_SRC_H_
+#define AUDIO_SRC_H_
+
+//--------------------------------------------
+// Asynchronous sample rate converter for the 16-bit stereo streams
+// the output clock can't be synchronized with (a file, a network stream, the audio input):
+// the output sample is calculated by the polyphase FIR filter
+// (AUDIO_SRC_TAPS taps, AUDIO_SRC_PHASES phases of the Kaiser windowed sinc, Q15)
+// at the two neighbouring phases and the results are linearly interpolated
+// (the first order Farrow structure), so any ratio is available
+// and it can be trimmed on the fly to follow the clock drift.
+// The cutoff frequency is 0.44 of the input rate, the converter is intended
+// for the ratios close to 1 (44100 <-> 48000 Hz, the clock drift).
+// THD+N of the -1 dBFS sine (44100 -> 48000) is about -86 dB at 1 kHz, -84 dB at 10 kHz
+// and -75 dB at 20 kHz (test/audio-src-test.c), the delay is AUDIO_SRC_TAPS / 2 input samples.
+// The dot products use the Cortex-M4/M7 DSP (SIMD) instructions
+// when __ARM_FEATURE_DSP is defined, the results are the same as of the C code.
+//
+// static audio_src_t src;
+// audio_src_init(&src, 44100, 48000);
+// while (frames)
+// {
+//     used = audio_src_write_ring(&src, &ring, data, frames);
+//     data += used * 2;
+//     frames -= used;
+//     audio_src_trim(&src, ppm); // from the ring fill, for example
+// }
+
+#define AUDIO_SRC_TAPS          32
+#define AUDIO_SRC_PHASES        64
+// Q8.24 ratio
+#define AUDIO_SRC_ONE           (1UL << 24)
+
+typedef struct audio_src
+{
+	// The input history (doubled, so the taps are contiguous)
+	int16_t left[AUDIO_SRC_TAPS * 2];
+	int16_t right[AUDIO_SRC_TAPS * 2];
+	// The oldest input sample
+	uint32_t oldest;
+	// The output time after the newest input sample, Q8.24
+	uint32_t pos;
+	// The input samples per the output sample, Q8.24
+	uint32_t step;
+	uint32_t step_nominal;
+} audio_src_t;
+
+// rate_in / rate_out < 256
+void audio_src_init(audio_src_t *src, uint32_t rate_in, uint32_t rate_out);
+// Silent history
+void audio_src_reset(audio_src_t *src);
+// ppm > 0: the output rate is higher than the nominal one (the more output samples per input sample)
+void audio_src_trim(audio_src_t *src, int32_t ppm);
+// in, out: interleaved L/R samples
+// in_frames: the input frames available, the frames used are returned in it
+// Returns the number of the output frames
+uint32_t audio_src_process_ref(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames);
+#if defined __ARM_FEATURE_DSP
+uint32_t audio_src_process_dsp(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames);
+#endif
+uint32_t audio_src_process(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames);
+// The output frames are written to the ring directly (audio-ring.h must be included before),
+// returns the number of the input frames used
+uint32_t audio_src_write_ring(audio_src_t *src, audio_ring_t *ring, const int16_t *in, uint32_t in_frames);
+
+#endif // AUDIO_SRC_H_
@@ -0,0 +1,242 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host test of the asynchronous sample rate converter:
+// - THD+N of the -1 dBFS sines converted 44100 -> 48000 and 48000 -> 44100
+//   (the left channel is fitted by the sine of the tone frequency, least squares),
+//   the right channel is the inverted left one,
+// - the output frames per the input frames at the nominal ratio,
+// - the ppm trim step in the middle of the stream: the output rate follows the trim,
+//   the sine continues without a glitch (THD+N over the window around the step),
+// - the stream processed in the small blocks is the same as processed at once,
+// - the DSP implementation (built with the C models of the instructions, see platform.h)
+//   is bit-exact with the reference one.
+// Exit status 1 if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "platform.h"
+#include "audio-ring.h"
+#include "audio-src.h"
+
+//--------------------------------------------
+#define PI                  3.14159265358979323846
+#define AMPLITUDE           (32767.0 * 0.891250938) // -1 dBFS
+#define IN_FRAMES           44100
+#define OUT_FRAMES          (IN_FRAMES * 2)
+// The filter settling, output frames
+#define SKIP                1000
+#define BLOCK_FRAMES        441
+#define TRIM_PPM            500
+
+//--------------------------------------------
+typedef uint32_t (*process_t)(audio_src_t *src, const int16_t *in, uint32_t *in_frames, int16_t *out, uint32_t out_frames);
+
+static int16_t in_buf[IN_FRAMES * 2];
+static int16_t out_buf[OUT_FRAMES * 2];
+static int16_t ref_buf[OUT_FRAMES * 2];
+static audio_src_t src;
+static int failed;
+
+//--------------------------------------------
+static void check(int ok, const char *name)
+{
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+	if (!ok)
+	{
+		failed++;
+	}
+}
+
+//--------------------------------------------
+static void generate(double tone, uint32_t rate)
+{
+	uint32_t cnt;
+
+	for (cnt = 0; cnt < IN_FRAMES; cnt++)
+	{
+		in_buf[cnt * 2] = (int16_t)lrint(AMPLITUDE * sin(2 * PI * tone * cnt / rate));
+		in_buf[cnt * 2 + 1] = (int16_t)-in_buf[cnt * 2];
+	}
+}
+
+//--------------------------------------------
+// The left channel from the frame first is fitted by the sine,
+// the tone phase increments per output frame are inc0 till the frame trim and inc1 after it.
+// returns: THD+N in dB
+static double thdn(const int16_t *out, uint32_t first, uint32_t frames, uint32_t trim, double inc0, double inc1)
+{
+	double sum_ss, sum_cc, sum_sc, sum_ys, sum_yc;
+	double a, b, d, s, c, e;
+	double signal, noise;
+	double phase;
+	uint32_t cnt;
+
+	sum_ss = sum_cc = sum_sc = sum_ys = sum_yc = 0;
+	for (cnt = first, phase = 0; cnt < frames; cnt++, phase += (cnt <= trim) ? inc0 : inc1)
+	{
+		s = sin(phase);
+		c = cos(phase);
+		sum_ss += s * s;
+		sum_cc += c * c;
+		sum_sc += s * c;
+		sum_ys += out[cnt * 2] * s;
+		sum_yc += out[cnt * 2] * c;
+	}
+	d = sum_ss * sum_cc - sum_sc * sum_sc;
+	a = (sum_ys * sum_cc - sum_yc * sum_sc) / d;
+	b = (sum_yc * sum_ss - sum_ys * sum_sc) / d;
+
+	signal = noise = 0;
+	for (cnt = first, phase = 0; cnt < frames; cnt++, phase += (cnt <= trim) ? inc0 : inc1)
+	{
+		s = a * sin(phase) + b * cos(phase);
+		e = out[cnt * 2] - s;
+		signal += s * s;
+		noise += e * e;
+	}
+	return 10 * log10(noise / signal);
+}
+
+//--------------------------------------------
+// The tone phase increment per output frame at the current converter step
+static double phase_inc(double tone, uint32_t rate_in)
+{
+	return 2 * PI * tone / rate_in * src.step / AUDIO_SRC_ONE;
+}
+
+//--------------------------------------------
+// The output frames from the start for the input frames at the current converter step:
+// the output frame k is calculated after floor(k * step) input frames
+static uint32_t output_frames(uint32_t in_frames)
+{
+	return (uint32_t)((((uint64_t)in_frames + 1) * AUDIO_SRC_ONE - 1) / src.step + 1);
+}
+
+//--------------------------------------------
+static int right_inverted(const int16_t *out, uint32_t frames)
+{
+	uint32_t cnt;
+
+	for (cnt = 0; cnt < frames; cnt++)
+	{
+		// the rounding of the filter output may differ by 1
+		if (abs(out[cnt * 2] + out[cnt * 2 + 1]) > 1)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//--------------------------------------------
+static void test_thdn(uint32_t rate_in, uint32_t rate_out, double tone, double limit)
+{
+	uint32_t used;
+	uint32_t frames;
+	double db;
+	char name[64];
+
+	generate(tone, rate_in);
+	audio_src_init(&src, rate_in, rate_out);
+	used = IN_FRAMES;
+	frames = audio_src_process_ref(&src, in_buf, &used, out_buf, OUT_FRAMES);
+	db = thdn(out_buf, SKIP, frames, frames, phase_inc(tone, rate_in), 0);
+	printf("%lu -> %lu, %.0f Hz: THD+N %.1f dB\n", (unsigned long)rate_in, (unsigned long)rate_out, tone, db);
+	snprintf(name, sizeof(name), "%lu -> %lu, %.0f Hz: THD+N < %.0f dB", (unsigned long)rate_in, (unsigned long)rate_out, tone, limit);
+	check(db < limit && right_inverted(out_buf, frames), name);
+	snprintf(name, sizeof(name), "%lu -> %lu: output frames", (unsigned long)rate_in, (unsigned long)rate_out);
+	check(used == IN_FRAMES && frames == output_frames(IN_FRAMES), name);
+}
+
+//--------------------------------------------
+// The blocks of BLOCK_FRAMES input frames, the trim is set after the half of the input
+static void test_trim(void)
+{
+	uint32_t used;
+	uint32_t frames;
+	uint32_t expected;
+	uint32_t before, after;
+	uint32_t block;
+	double inc0, inc1;
+	double db;
+
+	generate(1000, 44100);
+	audio_src_init(&src, 44100, 48000);
+	inc0 = inc1 = phase_inc(1000, 44100);
+	expected = output_frames(IN_FRAMES / 2);
+	before = 0;
+	for (frames = 0, block = 0; block < IN_FRAMES / BLOCK_FRAMES; block++)
+	{
+		if (block == IN_FRAMES / BLOCK_FRAMES / 2)
+		{
+			audio_src_trim(&src, TRIM_PPM);
+			inc1 = phase_inc(1000, 44100);
+			before = frames;
+		}
+		used = BLOCK_FRAMES;
+		frames += audio_src_process_ref(&src, &in_buf[block * BLOCK_FRAMES * 2], &used, &out_buf[frames * 2], OUT_FRAMES - frames);
+	}
+	after = frames - before;
+	printf("trim %+d ppm: %lu -> %lu output frames per %d input frames\n", TRIM_PPM,
+		(unsigned long)before, (unsigned long)after, IN_FRAMES / 2);
+	check(before == expected, "trim: nominal rate before the step");
+	check(labs((long)after - lrint(IN_FRAMES / 2 * 48000.0 / 44100 * (1 + TRIM_PPM * 1e-6))) <= 1, "trim: trimmed rate after the step");
+	db = thdn(out_buf, before - 4800, before + 4800, before, inc0, inc1);
+	printf("trim %+d ppm: THD+N around the step %.1f dB\n", TRIM_PPM, db);
+	check(db < -85, "trim: no glitch at the step, THD+N < -85 dB");
+}
+
+//--------------------------------------------
+// The stream processed in the blocks of the different sizes
+// with the output limited is the same as the stream processed at once
+static void test_blocks(process_t process, const char *name)
+{
+	uint32_t in_pos, out_pos;
+	uint32_t used;
+	uint32_t frames;
+	uint32_t size;
+
+	generate(7000, 44100);
+	audio_src_init(&src, 44100, 48000);
+	used = IN_FRAMES;
+	frames = audio_src_process_ref(&src, in_buf, &used, ref_buf, OUT_FRAMES);
+
+	audio_src_init(&src, 44100, 48000);
+	memset(out_buf, 0, sizeof(out_buf));
+	for (in_pos = out_pos = 0, size = 1; in_pos < IN_FRAMES; size = size % 97 + 13)
+	{
+		used = (IN_FRAMES - in_pos < size) ? IN_FRAMES - in_pos : size;
+		out_pos += process(&src, &in_buf[in_pos * 2], &used, &out_buf[out_pos * 2], size / 2 + 1);
+		in_pos += used;
+	}
+	check(out_pos == frames && !memcmp(out_buf, ref_buf, frames * 2 * sizeof(int16_t)), name);
+}
+
+//--------------------------------------------
+int main(void)
+{
+	test_thdn(44100, 48000, 1000, -85);
+	test_thdn(44100, 48000, 10000, -83);
+	test_thdn(44100, 48000, 20000, -74);
+	test_thdn(48000, 44100, 1000, -85);
+	test_trim();
+	test_blocks(audio_src_process_ref, "blocks: ref == at once");
+	test_blocks(audio_src_process_dsp, "blocks: dsp == ref");
+	printf("%s: %d checks failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
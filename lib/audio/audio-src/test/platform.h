@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+// Host build of the library
+#include <stdint.h>
+#include <string.h>
+
+//--------------------------------------------
+// The DSP dot products are built on the host with the C models
+// of the Cortex-M4/M7 instructions they use
+#define __ARM_FEATURE_DSP 1
+
+//--------------------------------------------
+static inline uint32_t __UNALIGNED_UINT32_READ(const void *addr)
+{
+	uint32_t word;
+	memcpy(&word, addr, sizeof(word));
+	return word;
+}
+
+//--------------------------------------------
+static inline uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t acc)
+{
+	return (uint32_t)((int32_t)(int16_t)x * (int16_t)y + (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16) + (int32_t)acc);
+}
+
+//--------------------------------------------
+static inline int32_t __SSAT(int32_t x, uint32_t bits)
+{
+	int32_t max = (1 << (bits - 1)) - 1;
+	return (x > max) ? max : (x < -max - 1) ? -max - 1 : x;
+}
+
+#endif // PLATFORM_H_
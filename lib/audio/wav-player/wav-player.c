@@ -0,0 +1,493 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "ff.h"
+#include "audio-out-drv.h"
+#include "audio-ring.h"
+#include "audio-conv.h"
+#include "wav-player.h"
+#include <string.h>
+
+//--------------------------------------------
+#define WAVE_FORMAT_PCM           0x0001
+#define WAVE_FORMAT_EXTENSIBLE    0xFFFE
+// The partial frame left in the staging area is moved before its read area,
+// the read area is shifted by the file position % 4 (the sector boundaries are word aligned)
+#define STAGE_HEAD                8
+#define STAGE_SIZE(unit)          (STAGE_HEAD + 4 + (unit))
+
+//--------------------------------------------
+extern const audio_out_drv_t audio_out_drv;
+
+//--------------------------------------------
+static uint8_t *player_buf;
+static uint32_t player_size;
+static audio_ring_t ring;
+static FIL wav_file;
+static wav_format_t wav_format;
+static uint8_t player_state;
+// The current output format
+static uint32_t out_rate;
+static uint8_t out_bits;
+static uint8_t in_frame;
+static uint8_t out_frame;
+// The file is read into the ring directly
+static uint8_t direct;
+static uint32_t data_remain;
+static uint32_t read_unit;
+// The staging area: STAGE_SIZE(read_unit) bytes
+static uint8_t *stage;
+static uint32_t stage_pos;
+static uint32_t stage_end;
+// The ring position of the data end (the last half is completed with silence)
+static uint32_t end_pos;
+static uint8_t draining;
+static wav_player_stats_t player_stats;
+
+//--------------------------------------------
+static void tx_half_callback(uint8_t half)
+{
+	audio_ring_dma_callback(&ring, half);
+}
+
+//--------------------------------------------
+// NDTR keeps the count of the stopped transfer, so the DMA position
+// is the start of the ring till the playback is started
+static uint32_t tx_remain(void)
+{
+	return (player_state == WAV_PLAYER_PLAYING) ? audio_out_drv.get_dma_txbuf_remain() : ring.size;
+}
+
+//--------------------------------------------
+static uint16_t get_le16(const uint8_t *buf)
+{
+	return buf[0] | (buf[1] << 8);
+}
+
+//--------------------------------------------
+static uint32_t get_le32(const uint8_t *buf)
+{
+	return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+//--------------------------------------------
+// Converts the file frames to the ring frames (src may be equal to dst)
+static void convert(uint8_t *dst, const uint8_t *src, uint32_t frames)
+{
+	uint32_t *dst32 = (uint32_t *)dst;
+
+	if (wav_format.bits == 16)
+	{
+		if (wav_format.channels == 2)
+		{
+			if (dst != src)
+			{
+				memcpy(dst, src, frames * 4);
+			}
+			return;
+		}
+		audio_conv_mono_to_stereo16((const int16_t *)src, (int16_t *)dst, frames);
+		return;
+	}
+	if (wav_format.bits == 24)
+	{
+		// MSB aligned
+		audio_conv_24to32(src, dst32, frames * wav_format.channels);
+	}
+	else if (dst != src)
+	{
+		memcpy(dst, src, frames * wav_format.channels * 4);
+	}
+	if (wav_format.channels == 1)
+	{
+		audio_conv_mono_to_stereo32(dst32, dst32, frames);
+	}
+	audio_out_drv.convert(dst32, dst32, frames * 2);
+}
+
+//--------------------------------------------
+static uint8_t data_pending(void)
+{
+	return data_remain || (!direct && stage_end - stage_pos >= in_frame);
+}
+
+//--------------------------------------------
+// The bytes from the file position to the end of its read unit
+static uint32_t unit_remain(void)
+{
+	uint32_t length;
+
+	length = read_unit - (uint32_t)(f_tell(&wav_file) % read_unit);
+	return (length < data_remain) ? length : data_remain;
+}
+
+//--------------------------------------------
+static uint8_t file_read(void *buf, uint32_t length, uint32_t *read)
+{
+	uint32_t start;
+	UINT br;
+	FRESULT res;
+
+	start = get_platform_counter();
+	res = f_read(&wav_file, buf, length, &br);
+	start = get_platform_counter() - start;
+	player_stats.reads++;
+	if (start > player_stats.read_max_time)
+	{
+		player_stats.read_max_time = start;
+	}
+	if (res != FR_OK)
+	{
+		return WAV_PLAYER_ERR_READ;
+	}
+	// the truncated file
+	data_remain = (br < length) ? 0 : data_remain - br;
+	*read = br;
+	return WAV_PLAYER_SUCCESS;
+}
+
+//--------------------------------------------
+// The cluster aligned unit is read into the ring when there is a room for it,
+// a shorter part is read only at the end of the ring
+static uint8_t read_direct(void)
+{
+	uint8_t *dst;
+	uint32_t avail;
+	uint32_t length;
+	uint32_t end;
+	uint32_t read;
+
+	dst = audio_ring_get_write_ptr(&ring, &avail);
+	length = unit_remain();
+	if (length > avail)
+	{
+		if (avail == audio_ring_get_free(&ring))
+		{
+			return WAV_PLAYER_SUCCESS;
+		}
+		length = avail;
+		// up to the sector boundary if possible
+		end = (f_tell(&wav_file) + length) & ~(FF_MAX_SS - 1);
+		if (end > f_tell(&wav_file))
+		{
+			length = end - (uint32_t)f_tell(&wav_file);
+		}
+	}
+	length -= length % in_frame;
+	if (!length)
+	{
+		return WAV_PLAYER_SUCCESS;
+	}
+	if (file_read(dst, length, &read) != WAV_PLAYER_SUCCESS)
+	{
+		return WAV_PLAYER_ERR_READ;
+	}
+	read -= read % in_frame;
+	convert(dst, dst, read / in_frame);
+	audio_ring_commit_write(&ring, read);
+	return WAV_PLAYER_SUCCESS;
+}
+
+//--------------------------------------------
+// The unit is read into the staging area when it is empty,
+// the frames are converted into the ring as the room permits
+static uint8_t read_staged(void)
+{
+	uint8_t *dst;
+	uint32_t avail;
+	uint32_t frames;
+	uint32_t rest;
+	uint32_t offset;
+	uint32_t read;
+
+	rest = stage_end - stage_pos;
+	if (rest < in_frame && data_remain)
+	{
+		// the partial frame is kept before the read area
+		offset = STAGE_HEAD + (uint32_t)f_tell(&wav_file) % 4;
+		memmove(stage + offset - rest, stage + stage_pos, rest);
+		stage_pos = offset - rest;
+		stage_end = offset;
+		if (file_read(stage + offset, unit_remain(), &read) != WAV_PLAYER_SUCCESS)
+		{
+			return WAV_PLAYER_ERR_READ;
+		}
+		stage_end += read;
+	}
+	dst = audio_ring_get_write_ptr(&ring, &avail);
+	frames = avail / out_frame;
+	if (frames > (stage_end - stage_pos) / in_frame)
+	{
+		frames = (stage_end - stage_pos) / in_frame;
+	}
+	convert(dst, stage + stage_pos, frames);
+	audio_ring_commit_write(&ring, frames * out_frame);
+	stage_pos += frames * in_frame;
+	return WAV_PLAYER_SUCCESS;
+}
+
+//--------------------------------------------
+// The last half and one more half are completed with silence,
+// so the DMA starts the silent half without the underrun at the end of the data
+static void pad_silence(void)
+{
+	uint8_t *dst;
+	uint32_t avail;
+	uint32_t length;
+
+	if (!draining)
+	{
+		end_pos = (ring.wr + (ring.half - ring.wr % ring.half) % ring.half) % ring.wrap;
+		draining = 1;
+	}
+	dst = audio_ring_get_write_ptr(&ring, &avail);
+	// up to the end of the silent half (the underrun may have moved the producer past it)
+	length = (end_pos + ring.half + ring.wrap - ring.wr) % ring.wrap;
+	if (length > ring.size)
+	{
+		return;
+	}
+	if (length > avail)
+	{
+		length = avail;
+	}
+	memset(dst, 0, length);
+	audio_ring_commit_write(&ring, length);
+}
+
+//--------------------------------------------
+void wav_player_init(void *buf, uint32_t size)
+{
+	player_buf = (uint8_t *)buf;
+	player_size = size;
+	player_state = WAV_PLAYER_STOPPED;
+	out_rate = 0;
+	out_bits = 0;
+	audio_out_drv.init_dma_txbuf_cycle(tx_half_callback);
+}
+
+//--------------------------------------------
+uint8_t wav_player_parse(FIL *file, wav_format_t *format)
+{
+	uint8_t buf[40];
+	uint32_t size;
+	uint32_t chunk;
+	uint16_t tag;
+	uint8_t found;
+	UINT br;
+
+	memset(format, 0, sizeof(wav_format_t));
+	if (f_lseek(file, 0) != FR_OK || f_read(file, buf, 12, &br) != FR_OK || br != 12)
+	{
+		return WAV_PLAYER_ERR_FILE;
+	}
+	if (memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4))
+	{
+		return WAV_PLAYER_ERR_FORMAT;
+	}
+	// bit 0: fmt, bit 1: data
+	for (found = 0; found != 0x03;)
+	{
+		if (f_read(file, buf, 8, &br) != FR_OK || br != 8)
+		{
+			return WAV_PLAYER_ERR_FORMAT;
+		}
+		size = get_le32(buf + 4);
+		chunk = (uint32_t)f_tell(file);
+		if (!memcmp(buf, "fmt ", 4))
+		{
+			if (size < 16 || f_read(file, buf, (size < sizeof(buf)) ? size : sizeof(buf), &br) != FR_OK || br < 16)
+			{
+				return WAV_PLAYER_ERR_FORMAT;
+			}
+			tag = get_le16(buf);
+			// the subformat GUID starts with the format tag
+			if (tag == WAVE_FORMAT_EXTENSIBLE && br == sizeof(buf))
+			{
+				tag = get_le16(buf + 24);
+			}
+			if (tag != WAVE_FORMAT_PCM)
+			{
+				return WAV_PLAYER_ERR_FORMAT;
+			}
+			format->channels = get_le16(buf + 2);
+			format->rate = get_le32(buf + 4);
+			format->block_align = get_le16(buf + 12);
+			format->bits = get_le16(buf + 14);
+			found |= 0x01;
+		}
+		else if (!memcmp(buf, "data", 4))
+		{
+			format->data_offset = chunk;
+			// the streamed file can have no actual size
+			if (size > f_size(file) - chunk)
+			{
+				size = (uint32_t)f_size(file) - chunk;
+			}
+			format->data_size = size;
+			found |= 0x02;
+		}
+		// LIST, fact, etc. are skipped, the chunks are word aligned
+		if (f_lseek(file, chunk + size + (size & 1)) != FR_OK)
+		{
+			return WAV_PLAYER_ERR_FORMAT;
+		}
+	}
+	if ((format->channels != 1 && format->channels != 2) ||
+		(format->bits != 16 && format->bits != 24 && format->bits != 32) ||
+		format->block_align != format->channels * format->bits / 8 ||
+		format->rate < 8000 || format->rate > 192000)
+	{
+		return WAV_PLAYER_ERR_FORMAT;
+	}
+	return WAV_PLAYER_SUCCESS;
+}
+
+//--------------------------------------------
+uint8_t wav_player_start(const char *path)
+{
+	uint32_t size;
+	uint8_t res;
+
+	wav_player_stop();
+	memset(&player_stats, 0, sizeof(wav_player_stats_t));
+	if (f_open(&wav_file, path, FA_READ) != FR_OK)
+	{
+		return player_stats.error = WAV_PLAYER_ERR_FILE;
+	}
+	if ((res = wav_player_parse(&wav_file, &wav_format)) != WAV_PLAYER_SUCCESS)
+	{
+		f_close(&wav_file);
+		return player_stats.error = res;
+	}
+	if (wav_format.rate != out_rate || wav_format.bits != out_bits)
+	{
+		if (audio_out_drv.set_format(wav_format.rate, (uint8_t)wav_format.bits))
+		{
+			f_close(&wav_file);
+			out_rate = 0;
+			return player_stats.error = WAV_PLAYER_ERR_RATE;
+		}
+		out_rate = wav_format.rate;
+		out_bits = (uint8_t)wav_format.bits;
+	}
+
+	in_frame = (uint8_t)wav_format.block_align;
+	out_frame = (wav_format.bits == 16) ? 4 : 8;
+	// the cluster or its part, but a quarter of the buffer at most
+	for (read_unit = (uint32_t)wav_file.obj.fs->csize * FF_MAX_SS; read_unit > FF_MAX_SS && read_unit > player_size / 4; read_unit /= 2);
+	player_stats.read_unit = read_unit;
+	// the sector boundaries of the data are the frame and the word boundaries
+	direct = in_frame == out_frame && !(wav_format.data_offset % in_frame);
+	size = player_size;
+	if (!direct)
+	{
+		size -= STAGE_SIZE(read_unit);
+		stage = player_buf + size;
+		stage_pos = stage_end = STAGE_HEAD;
+	}
+	// two halves of the whole ring frames
+	size &= ~(uint32_t)(out_frame * 2 - 1);
+	audio_ring_init(&ring, AUDIO_RING_TX, player_buf, size, tx_remain);
+
+	data_remain = wav_format.data_size - wav_format.data_size % in_frame;
+	if (f_lseek(&wav_file, wav_format.data_offset) != FR_OK)
+	{
+		f_close(&wav_file);
+		return player_stats.error = WAV_PLAYER_ERR_FILE;
+	}
+	player_stats.fill_min = size;
+	draining = 0;
+	player_state = WAV_PLAYER_PREFILL;
+	return WAV_PLAYER_SUCCESS;
+}
+
+//--------------------------------------------
+uint8_t wav_player_process(void)
+{
+	uint32_t fill;
+	uint8_t res;
+
+	if (player_state == WAV_PLAYER_STOPPED)
+	{
+		return player_state;
+	}
+
+	if (data_pending())
+	{
+		res = direct ? read_direct() : read_staged();
+		if (res != WAV_PLAYER_SUCCESS)
+		{
+			player_stats.error = res;
+			wav_player_stop();
+			return player_state;
+		}
+	}
+	else
+	{
+		pad_silence();
+	}
+
+	if (player_state == WAV_PLAYER_PREFILL)
+	{
+		// the ring is full: there is no room for the next unit
+		if (audio_ring_get_free(&ring) < read_unit || !data_pending())
+		{
+			player_state = WAV_PLAYER_PLAYING;
+			audio_out_drv.write_dma_txbuf(ring.buf, ring.size);
+		}
+		return player_state;
+	}
+
+	player_stats.underruns = ring.underruns;
+	if (!draining)
+	{
+		fill = audio_ring_get_fill(&ring);
+		if (fill < player_stats.fill_min)
+		{
+			player_stats.fill_min = fill;
+		}
+	}
+	else if ((ring.rd + ring.wrap - end_pos) % ring.wrap < ring.wrap / 2)
+	{
+		// the DMA has started the silent half
+		wav_player_stop();
+	}
+	return player_state;
+}
+
+//--------------------------------------------
+void wav_player_stop(void)
+{
+	if (player_state == WAV_PLAYER_STOPPED)
+	{
+		return;
+	}
+	audio_out_drv.stop_dma_txbuf();
+	f_close(&wav_file);
+	player_state = WAV_PLAYER_STOPPED;
+}
+
+//--------------------------------------------
+const wav_format_t *wav_player_get_format(void)
+{
+	return &wav_format;
+}
+
+//--------------------------------------------
+void wav_player_get_stats(wav_player_stats_t *stats)
+{
+	*stats = player_stats;
+}
@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef WAV_PLAYER_H_
+#define WAV_PLAYER_H_
+
+//--------------------------------------------
+// Non-blocking WAV (PCM) file player on FatFs:
+// the RIFF chunks are parsed in any order (fmt, LIST, data, ...),
+// the file is read by the cluster aligned units (at most a quarter of the buffer)
+// into the audio ring the DMA plays from, so the SD card latency spikes
+// up to the ring length are not audible.
+// 16, 24, 32-bit, mono and stereo files at 8000..192000 Hz are played,
+// the sampling rate and the resolution of the audio output are changed
+// for every file (audio_out_drv.set_format).
+// 16-bit samples are played in 16-bit containers, 24 and 32-bit samples
+// in 32-bit containers (24-bit MSB aligned), mono samples are sent to both channels.
+// 16 and 32-bit stereo data are read into the ring directly, the other formats
+// are converted from the staging area at the end of the buffer.
+// ff.h and audio-ring.h must be included before this header.
+// The functions are not reentrant.
+//
+// static uint32_t player_buf[4096];
+// audio_out_drv.init();
+// wav_player_init(player_buf, sizeof(player_buf));
+// wav_player_start("music.wav");
+// while (wav_player_process() != WAV_PLAYER_STOPPED)
+// {
+//     ...
+// }
+
+#define WAV_PLAYER_SUCCESS        0
+#define WAV_PLAYER_ERR_FILE       1
+#define WAV_PLAYER_ERR_FORMAT     2
+#define WAV_PLAYER_ERR_RATE       3
+#define WAV_PLAYER_ERR_READ       4
+
+#define WAV_PLAYER_STOPPED        0
+#define WAV_PLAYER_PREFILL        1
+#define WAV_PLAYER_PLAYING        2
+
+typedef struct wav_format
+{
+	uint16_t channels;
+	uint16_t bits;
+	uint32_t rate;
+	uint16_t block_align;
+	// The data chunk
+	uint32_t data_offset;
+	uint32_t data_size;
+} wav_format_t;
+
+typedef struct wav_player_stats
+{
+	uint32_t underruns;       // the ring halves played incomplete
+	uint32_t reads;           // f_read calls
+	uint32_t read_max_time;   // the longest f_read call, ms
+	uint32_t fill_min;        // the minimal ring fill while playing, bytes
+	uint32_t read_unit;       // bytes
+	uint8_t error;            // the last error
+} wav_player_stats_t;
+
+// buf: 4 byte aligned, size: a multiple of 1024 bytes (4096 bytes at least)
+// the audio output DMA is set to the circular mode
+void wav_player_init(void *buf, uint32_t size);
+// Parses the RIFF chunks, file: opened, returns WAV_PLAYER_SUCCESS for the supported PCM file
+uint8_t wav_player_parse(FIL *file, wav_format_t *format);
+// Opens and parses the file, sets the audio output format, the playback is started
+// by wav_player_process when the ring is full
+uint8_t wav_player_start(const char *path);
+// Call it from the main loop: at most one read per call,
+// returns the state (WAV_PLAYER_STOPPED at the end of the file or on the read error)
+uint8_t wav_player_process(void);
+void wav_player_stop(void);
+const wav_format_t *wav_player_get_format(void);
+void wav_player_get_stats(wav_player_stats_t *stats);
+
+#endif // WAV_PLAYER_H_
@@ -0,0 +1,317 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#include "platform.h"
+#include "ff.h"
+#include "audio-in-drv.h"
+#include "audio-conv.h"
+#include "wav-recorder.h"
+#include <string.h>
+
+//--------------------------------------------
+#define WAVE_FORMAT_PCM           0x0001
+// The RIFF header, the fmt chunk, the JUNK chunk header and the data chunk header
+#define JUNK_SIZE                 (WAV_RECORDER_HEADER_SIZE - 12 - 24 - 8 - 8)
+// FAT: the file size is 32-bit
+#define DATA_SIZE_MAX             (0xFFFFFFFF - WAV_RECORDER_HEADER_SIZE)
+
+//--------------------------------------------
+extern const audio_in_drv_t audio_in_drv;
+
+//--------------------------------------------
+static uint8_t *rx_buf;
+static uint32_t rx_size;
+static uint8_t *ring_buf;
+static uint32_t buf_size;
+// The whole write units of the buffer
+static uint32_t ring_size;
+static FIL wav_file;
+// Read by the DMA interrupt, changed by the main loop
+static volatile uint8_t recorder_state;
+static uint32_t rec_rate;
+static uint8_t rec_channels;
+static uint8_t rec_bits;
+static uint8_t block_align;
+static uint32_t write_unit;
+// The file positions: the DMA interrupt writes the ring up to wr,
+// the main loop writes the file up to rd, the ring offset is position % ring_size
+static volatile uint32_t wr;
+static volatile uint32_t rd;
+// The position of the pre-allocated file end
+static uint32_t limit;
+static wav_recorder_stats_t recorder_stats;
+
+//--------------------------------------------
+static void put_le16(uint8_t *buf, uint16_t value)
+{
+	buf[0] = (uint8_t)value;
+	buf[1] = (uint8_t)(value >> 8);
+}
+
+//--------------------------------------------
+static void put_le32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = (uint8_t)value;
+	buf[1] = (uint8_t)(value >> 8);
+	buf[2] = (uint8_t)(value >> 16);
+	buf[3] = (uint8_t)(value >> 24);
+}
+
+//--------------------------------------------
+// data_size: the data chunk size
+static void make_header(uint8_t *buf, uint32_t data_size)
+{
+	memset(buf, 0, WAV_RECORDER_HEADER_SIZE);
+	memcpy(buf, "RIFF", 4);
+	put_le32(buf + 4, WAV_RECORDER_HEADER_SIZE - 8 + data_size);
+	memcpy(buf + 8, "WAVE", 4);
+	memcpy(buf + 12, "fmt ", 4);
+	put_le32(buf + 16, 16);
+	put_le16(buf + 20, WAVE_FORMAT_PCM);
+	put_le16(buf + 22, rec_channels);
+	put_le32(buf + 24, rec_rate);
+	put_le32(buf + 28, rec_rate * block_align);
+	put_le16(buf + 32, block_align);
+	put_le16(buf + 34, rec_bits);
+	// the padding to the sector, the players skip the unknown chunks
+	memcpy(buf + 36, "JUNK", 4);
+	put_le32(buf + 40, JUNK_SIZE);
+	memcpy(buf + WAV_RECORDER_HEADER_SIZE - 8, "data", 4);
+	put_le32(buf + WAV_RECORDER_HEADER_SIZE - 4, data_size);
+}
+
+//--------------------------------------------
+// DMA interrupt context: the half is converted in place and is put into the ring
+static void rx_half_callback(uint8_t half)
+{
+	uint8_t *src;
+	uint32_t frames;
+	uint32_t length;
+	uint32_t offset;
+	uint32_t part;
+
+	if (recorder_state != WAV_RECORDER_RECORDING || wr >= limit)
+	{
+		return;
+	}
+	src = rx_buf + half * (rx_size / 2);
+	if (rec_bits == 16)
+	{
+		frames = rx_size / 2 / (sizeof(int16_t) * 2);
+		if (rec_channels == 1)
+		{
+			audio_conv_stereo_to_mono16((const int16_t *)src, (int16_t *)src, frames);
+		}
+	}
+	else
+	{
+		frames = rx_size / 2 / (sizeof(uint32_t) * 2);
+		audio_in_drv.convert((const uint32_t *)src, (uint32_t *)src, frames * 2);
+		if (rec_channels == 1)
+		{
+			audio_conv_stereo_to_mono32((const uint32_t *)src, (uint32_t *)src, frames);
+		}
+		if (rec_bits == 24)
+		{
+			audio_conv_32to24((const uint32_t *)src, src, frames * rec_channels);
+		}
+	}
+	length = frames * block_align;
+	if (length > limit - wr)
+	{
+		length = limit - wr;
+	}
+	if (length > ring_size - (wr - rd))
+	{
+		// the half is dropped, the file keeps the whole frames
+		recorder_stats.overruns++;
+		return;
+	}
+	offset = wr % ring_size;
+	part = (length < ring_size - offset) ? length : ring_size - offset;
+	memcpy(ring_buf + offset, src, part);
+	memcpy(ring_buf, src + part, length - part);
+	wr += length;
+	if (wr - rd > recorder_stats.fill_max)
+	{
+		recorder_stats.fill_max = wr - rd;
+	}
+}
+
+//--------------------------------------------
+// The ring part from rd is written to the file
+static uint8_t file_write(uint32_t length)
+{
+	uint32_t start;
+	UINT bw;
+	FRESULT res;
+
+	start = get_platform_counter();
+	res = f_write(&wav_file, ring_buf + rd % ring_size, length, &bw);
+	start = get_platform_counter() - start;
+	recorder_stats.writes++;
+	if (start > recorder_stats.write_max_time)
+	{
+		recorder_stats.write_max_time = start;
+	}
+	if (res != FR_OK || bw != length)
+	{
+		return WAV_RECORDER_ERR_WRITE;
+	}
+	rd += length;
+	return WAV_RECORDER_SUCCESS;
+}
+
+//--------------------------------------------
+// The rest of the ring is written, the file is truncated to the recorded data,
+// the header is patched (the samples written before the write error are kept)
+static void finish(void)
+{
+	uint32_t length;
+	UINT bw;
+
+	audio_in_drv.stop_dma_rxbuf();
+	recorder_state = WAV_RECORDER_STOPPED;
+	while (recorder_stats.error == WAV_RECORDER_SUCCESS && wr != rd)
+	{
+		length = ring_size - rd % ring_size;
+		if (length > wr - rd)
+		{
+			length = wr - rd;
+		}
+		recorder_stats.error = file_write(length);
+	}
+	// the partial frame of the failed write is not a part of the data
+	if (rd < WAV_RECORDER_HEADER_SIZE)
+	{
+		rd = WAV_RECORDER_HEADER_SIZE;
+	}
+	rd -= (rd - WAV_RECORDER_HEADER_SIZE) % block_align;
+	recorder_stats.data_size = rd - WAV_RECORDER_HEADER_SIZE;
+	// the ring is free now
+	make_header(ring_buf, recorder_stats.data_size);
+	if (f_lseek(&wav_file, rd) != FR_OK || f_truncate(&wav_file) != FR_OK || f_lseek(&wav_file, 0) != FR_OK ||
+		f_write(&wav_file, ring_buf, WAV_RECORDER_HEADER_SIZE, &bw) != FR_OK || bw != WAV_RECORDER_HEADER_SIZE)
+	{
+		recorder_stats.error = WAV_RECORDER_ERR_WRITE;
+	}
+	if (f_close(&wav_file) != FR_OK)
+	{
+		recorder_stats.error = WAV_RECORDER_ERR_WRITE;
+	}
+}
+
+//--------------------------------------------
+void wav_recorder_init(void *dma_buf, uint32_t dma_size, void *buf, uint32_t size)
+{
+	rx_buf = (uint8_t *)dma_buf;
+	rx_size = dma_size;
+	ring_buf = (uint8_t *)buf;
+	buf_size = size;
+	recorder_state = WAV_RECORDER_STOPPED;
+	audio_in_drv.init_dma_rxbuf_cycle(rx_half_callback);
+}
+
+//--------------------------------------------
+uint8_t wav_recorder_start(const char *path, uint32_t rate, uint8_t channels, uint8_t bits, uint32_t seconds)
+{
+	uint64_t data_size;
+	FRESULT res;
+
+	wav_recorder_stop();
+	memset(&recorder_stats, 0, sizeof(wav_recorder_stats_t));
+	if ((channels != 1 && channels != 2) || (bits != 16 && bits != 24 && bits != 32) || !rate || !seconds)
+	{
+		return recorder_stats.error = WAV_RECORDER_ERR_FORMAT;
+	}
+	rec_rate = rate;
+	rec_channels = channels;
+	rec_bits = bits;
+	block_align = channels * bits / 8;
+
+	data_size = (uint64_t)seconds * rate * block_align;
+	if (data_size > DATA_SIZE_MAX)
+	{
+		data_size = DATA_SIZE_MAX - DATA_SIZE_MAX % block_align;
+	}
+	limit = WAV_RECORDER_HEADER_SIZE + (uint32_t)data_size;
+
+	if (f_open(&wav_file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+	{
+		return recorder_stats.error = WAV_RECORDER_ERR_FILE;
+	}
+	// the contiguous clusters
+	if ((res = f_expand(&wav_file, limit, 1)) != FR_OK)
+	{
+		f_close(&wav_file);
+		f_unlink(path);
+		return recorder_stats.error = (res == FR_DENIED) ? WAV_RECORDER_ERR_EXPAND : WAV_RECORDER_ERR_FILE;
+	}
+	// the cluster or its part, but a quarter of the ring at most
+	for (write_unit = (uint32_t)wav_file.obj.fs->csize * FF_MAX_SS; write_unit > FF_MAX_SS && write_unit > buf_size / 4; write_unit /= 2);
+	// the ring offset is the file offset
+	ring_size = buf_size - buf_size % write_unit;
+	recorder_stats.ring_size = ring_size;
+	recorder_stats.write_unit = write_unit;
+
+	// the header is written with the first unit, its sizes are patched by wav_recorder_stop
+	make_header(ring_buf, 0);
+	rd = 0;
+	wr = WAV_RECORDER_HEADER_SIZE;
+	recorder_stats.fill_max = wr;
+	recorder_state = WAV_RECORDER_RECORDING;
+	audio_in_drv.read_dma_rxbuf(rx_buf, rx_size);
+	return WAV_RECORDER_SUCCESS;
+}
+
+//--------------------------------------------
+uint8_t wav_recorder_process(void)
+{
+	if (recorder_state == WAV_RECORDER_STOPPED)
+	{
+		return recorder_state;
+	}
+	if (wr - rd >= write_unit)
+	{
+		if ((recorder_stats.error = file_write(write_unit)) != WAV_RECORDER_SUCCESS)
+		{
+			finish();
+		}
+	}
+	else if (wr >= limit)
+	{
+		// the duration is recorded
+		finish();
+	}
+	return recorder_state;
+}
+
+//--------------------------------------------
+uint8_t wav_recorder_stop(void)
+{
+	if (recorder_state != WAV_RECORDER_STOPPED)
+	{
+		finish();
+	}
+	return recorder_stats.error;
+}
+
+//--------------------------------------------
+void wav_recorder_get_stats(wav_recorder_stats_t *stats)
+{
+	*stats = recorder_stats;
+	if (recorder_state != WAV_RECORDER_STOPPED)
+	{
+		stats->data_size = wr - WAV_RECORDER_HEADER_SIZE;
+	}
+}
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+#ifndef WAV_RECORDER_H_
+#define WAV_RECORDER_H_
+
+//--------------------------------------------
+// Non-blocking WAV (PCM) file recorder on FatFs:
+// the audio input DMA runs in the circular mode over the small DMA buffer,
+// every received half is converted to the file format in the DMA interrupt
+// and is put into the large ring, the main loop writes the ring to the file
+// by the cluster aligned units (at most a quarter of the ring),
+// so the SD card latency spikes up to the ring length don't drop the samples.
+// The file is pre-allocated as one contiguous area (f_expand, FF_USE_EXPAND = 1)
+// for the maximal duration, so the writes don't search the free clusters;
+// the file is truncated and the WAV header is patched when the recording is stopped.
+// The header is padded to the sector (JUNK chunk), so the data and the writes
+// are sector aligned. The ring offset is the file offset, so the writes are never split.
+// 16-bit samples are recorded from 16-bit containers, 24 and 32-bit samples
+// from 32-bit containers (24-bit MSB aligned), mono files get the left channel.
+// ff.h must be included before this header.
+// The functions are not reentrant.
+//
+// static uint32_t dma_buf[96000 * 2 / 1000 * 2];   // 2 x 1 ms of 96 kHz stereo 32-bit
+// static uint32_t ring_buf[64 * 1024];             // 341 ms of 96 kHz stereo 24-bit
+// audio_in_drv.init();
+// wav_recorder_init(dma_buf, sizeof(dma_buf), ring_buf, sizeof(ring_buf));
+// wav_recorder_start("rec.wav", 96000, 2, 24, 600);
+// while (wav_recorder_process() != WAV_RECORDER_STOPPED)
+// {
+//     ...
+// }
+// wav_recorder_stop();
+
+#define WAV_RECORDER_SUCCESS        0
+#define WAV_RECORDER_ERR_FILE       1
+#define WAV_RECORDER_ERR_FORMAT     2
+#define WAV_RECORDER_ERR_EXPAND     3
+#define WAV_RECORDER_ERR_WRITE      4
+
+#define WAV_RECORDER_STOPPED        0
+#define WAV_RECORDER_RECORDING      1
+
+// The WAV header is padded to the sector
+#define WAV_RECORDER_HEADER_SIZE    512
+
+typedef struct wav_recorder_stats
+{
+	uint32_t overruns;        // the DMA halves dropped (the ring is full)
+	uint32_t writes;          // f_write calls
+	uint32_t write_max_time;  // the longest f_write call, ms
+	uint32_t fill_max;        // the ring high-water mark, bytes
+	uint32_t ring_size;       // bytes
+	uint32_t write_unit;      // bytes
+	uint32_t data_size;       // the samples recorded, bytes
+	uint8_t error;            // the last error
+} wav_recorder_stats_t;
+
+// dma_buf: 4 byte aligned, dma_size: a multiple of 16 bytes (two halves of the stereo frames)
+// buf: 4 byte aligned, size: a multiple of 1024 bytes (4096 bytes at least)
+// the audio input DMA is set to the circular mode
+void wav_recorder_init(void *dma_buf, uint32_t dma_size, void *buf, uint32_t size);
+// Creates the file pre-allocated for the duration (seconds) and starts the audio input DMA,
+// rate, bits: the audio input format (I2S_FCLK, I2S_BITRES), bits: 16, 24, 32, channels: 1, 2
+uint8_t wav_recorder_start(const char *path, uint32_t rate, uint8_t channels, uint8_t bits, uint32_t seconds);
+// Call it from the main loop: at most one write per call,
+// returns the state (WAV_RECORDER_STOPPED when the duration is recorded or on the write error)
+uint8_t wav_recorder_process(void);
+// Stops the audio input DMA, writes the rest of the ring, patches the header and closes the file,
+// returns the error of the recording
+uint8_t wav_recorder_stop(void);
+void wav_recorder_get_stats(wav_recorder_stats_t *stats);
+
+#endif // WAV_RECORDER_H_
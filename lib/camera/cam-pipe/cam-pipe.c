@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "scr.h"
+#include "color-scr-drv.h"
+#include "imgsensor-drv.h"
+#include "cam-pipe.h"
+
+//--------------------------------------------
+extern const color_scr_drv_t scr_drv;
+extern const imgsensor_drv_t cam_drv;
+
+//--------------------------------------------
+static uint8_t *pipe_buf;
+static uint16_t pipe_width;
+static uint16_t pipe_height;
+static uint8_t pipe_lines;
+static cam_pipe_convert_t pipe_convert;
+static uint16_t scr_x;
+static uint16_t scr_y;
+
+// Captured lines: the line with the sequence number n
+// is described by the element n % pipe_lines
+static uint8_t *volatile line_addr[CAM_PIPE_LINES_MAX];
+static volatile uint16_t line_row[CAM_PIPE_LINES_MAX];
+static volatile uint32_t captured_lines;
+static volatile uint16_t capture_row;
+static volatile uint32_t captured_frames;
+
+// Sent lines
+static uint32_t sent_lines;
+static uint16_t next_scr_row;
+
+// Statistics
+static uint32_t stat_lines;
+static uint32_t stat_dropped_lines;
+static uint32_t fps_frames;
+static uint32_t fps_time;
+
+//--------------------------------------------
+// DMA interrupt context
+static void line_complete(uint8_t *line)
+{
+	uint8_t idx;
+
+	if (capture_row < pipe_height)
+	{
+		idx = captured_lines % pipe_lines;
+		line_addr[idx] = line;
+		line_row[idx] = capture_row;
+		captured_lines++;
+	}
+	capture_row++;
+}
+
+//--------------------------------------------
+// DCMI interrupt context
+static void frame_complete(void)
+{
+	if (capture_row)
+	{
+		captured_frames++;
+	}
+	capture_row = 0;
+}
+
+//--------------------------------------------
+// buf: CAM_PIPE_BUF_SIZE(width, lines) bytes aligned to 4,
+// lines: 2 ... CAM_PIPE_LINES_MAX line buffers
+void cam_pipe_init(uint8_t *buf, uint16_t width, uint16_t height, uint8_t lines)
+{
+	pipe_buf = buf;
+	pipe_width = width;
+	pipe_height = height;
+	pipe_lines = (lines > CAM_PIPE_LINES_MAX) ? CAM_PIPE_LINES_MAX : lines;
+
+	scr_drv.init_dma();
+	cam_drv.init_dma_lines(line_complete, frame_complete);
+}
+
+//--------------------------------------------
+// convert: called for every line before it is sent to the screen, NULL - no conversion
+void cam_pipe_set_convert(cam_pipe_convert_t convert)
+{
+	pipe_convert = convert;
+}
+
+//--------------------------------------------
+// x, y: the image position on the screen
+void cam_pipe_start(uint16_t x, uint16_t y)
+{
+	scr_x = x;
+	scr_y = y;
+	captured_lines = 0;
+	capture_row = 0;
+	captured_frames = 0;
+	sent_lines = 0;
+	next_scr_row = pipe_height;
+	stat_lines = 0;
+	stat_dropped_lines = 0;
+	fps_frames = 0;
+	fps_time = get_platform_counter();
+
+	cam_drv.start_dma_lines(pipe_buf, (uint32_t)pipe_width * 2, pipe_lines);
+}
+
+//--------------------------------------------
+void cam_pipe_stop(void)
+{
+	cam_drv.stop_dma();
+	scr_drv.stop_memory_write();
+}
+
+//--------------------------------------------
+// Sends all the captured lines to the screen,
+// must be called from the main loop as often as possible
+void cam_pipe_process(void)
+{
+	uint32_t captured;
+	uint8_t idx;
+	uint16_t row;
+
+	for (captured = captured_lines; sent_lines != captured; captured = captured_lines)
+	{
+		// The line with the sequence number n is overwritten
+		// when DMA starts to capture the line n + pipe_lines
+		if (captured - sent_lines >= pipe_lines)
+		{
+			stat_dropped_lines += captured - sent_lines - (pipe_lines - 1);
+			sent_lines = captured - (pipe_lines - 1);
+		}
+
+		idx = sent_lines % pipe_lines;
+		row = line_row[idx];
+		if (row != next_scr_row)
+		{
+			scr_drv.set_bound_rect(scr_x, scr_y + row, scr_x + pipe_width - 1, scr_y + pipe_height - 1);
+			scr_drv.start_memory_write();
+		}
+		if (pipe_convert)
+		{
+			pipe_convert(line_addr[idx], pipe_width);
+		}
+		scr_drv.write_dma(line_addr[idx], (uint32_t)pipe_width * 2);
+		next_scr_row = row + 1;
+		sent_lines++;
+		stat_lines++;
+	}
+}
+
+//--------------------------------------------
+void cam_pipe_get_stat(cam_pipe_stat_t *stat)
+{
+	uint32_t frames;
+	uint32_t time;
+
+	frames = captured_frames;
+	time = get_platform_counter();
+
+	stat->frames = frames;
+	stat->lines = stat_lines;
+	stat->dropped_lines = stat_dropped_lines;
+	stat->fps_x10 = (time != fps_time) ? (frames - fps_frames) * 10000 / (time - fps_time) : 0;
+
+	fps_frames = frames;
+	fps_time = time;
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef CAM_PIPE_H_
+#define CAM_PIPE_H_
+
+//--------------------------------------------
+// Camera to screen pipeline:
+// the camera lines are captured by DMA to the ring of line buffers
+// and sent to the screen by DMA from the main loop,
+// so the capture of the next lines overlaps with the screen write of the previous one.
+// The line is dropped when it is overwritten before it was sent
+// (the screen is slower than the camera), the screen window
+// is moved to the next sent line in this case.
+//
+// static uint32_t lines[CAM_PIPE_BUF_SIZE(320, 4) / sizeof(uint32_t)];
+// cam_drv.init(1);
+// cam_pipe_init((uint8_t *)lines, 320, 240, 4);
+// cam_pipe_start(0, 0);
+// while (1)
+// {
+//     cam_pipe_process();
+// }
+//
+// The lines can be converted in place before they are sent to the screen
+// (see lib/image/img-conv), e.g. the YUV422 sensor output:
+// static void line_convert(uint8_t *line, uint16_t width)
+// {
+//     img_yuv422_to_rgb565(line, (uint16_t *)line, width);
+// }
+// cam_pipe_set_convert(line_convert);
+
+#define CAM_PIPE_LINES_MAX            8
+#define CAM_PIPE_BUF_SIZE(width, lines) ((uint32_t)(width) * 2 * (lines))
+
+typedef struct cam_pipe_stat
+{
+	uint32_t frames;          // frames captured
+	uint32_t lines;           // lines sent to the screen
+	uint32_t dropped_lines;   // lines overwritten before they were sent
+	uint32_t fps_x10;         // frames per second * 10 since the previous call
+} cam_pipe_stat_t;
+
+typedef void (*cam_pipe_convert_t)(uint8_t *line, uint16_t width);
+
+void cam_pipe_init(uint8_t *buf, uint16_t width, uint16_t height, uint8_t lines);
+void cam_pipe_set_convert(cam_pipe_convert_t convert);
+void cam_pipe_start(uint16_t x, uint16_t y);
+void cam_pipe_stop(void);
+void cam_pipe_process(void);
+void cam_pipe_get_stat(cam_pipe_stat_t *stat);
+
+#endif // CAM_PIPE_H_
@@ -0,0 +1,161 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "cfont.h"
+
+//--------------------------------------------
+void cfont_read_memory(const cfont_t *font, uint32_t offset, uint8_t *buf, uint16_t length)
+{
+	FLASH_MEMORY_DECLARE(uint8_t, *src) = font->data + offset;
+
+	while (length--)
+	{
+		*buf++ = FLASH_MEMORY_READ_BYTE(src++);
+	}
+}
+
+//--------------------------------------------
+uint8_t cfont_get_info(const cfont_t *font, cfont_info_t *info)
+{
+	uint8_t hdr[CFONT_HEADER_SIZE];
+
+	font->read(font, 0, hdr, CFONT_HEADER_SIZE);
+	if (hdr[0] != 'C' || hdr[1] != 'F' || hdr[2] != CFONT_VERSION)
+	{
+		return CFONT_FAIL;
+	}
+	info->bpp = 1 << (hdr[3] & CFONT_FLAG_BPP_MASK);
+	info->rle = (hdr[3] & CFONT_FLAG_RLE) ? 1 : 0;
+	info->first = hdr[4];
+	info->last = hdr[5];
+	info->height = hdr[6];
+	info->ascent = hdr[7];
+	return CFONT_SUCCESS;
+}
+
+//--------------------------------------------
+uint8_t cfont_get_glyph(const cfont_t *font, const cfont_info_t *info, uint8_t ch, cfont_glyph_t *glyph)
+{
+	uint8_t entry[CFONT_GLYPH_SIZE];
+
+	if ((ch < info->first) || (ch > info->last))
+	{
+		return CFONT_FAIL;
+	}
+	font->read(font, CFONT_HEADER_SIZE + (uint32_t)(ch - info->first) * CFONT_GLYPH_SIZE, entry, CFONT_GLYPH_SIZE);
+	glyph->offset = (uint32_t)entry[0] | ((uint32_t)entry[1] << 8) | ((uint32_t)entry[2] << 16);
+	glyph->width = entry[3];
+	glyph->height = entry[4];
+	glyph->xofs = (int8_t)entry[5];
+	glyph->yofs = (int8_t)entry[6];
+	glyph->advance = entry[7];
+	return CFONT_SUCCESS;
+}
+
+//--------------------------------------------
+// The font is read in small blocks to reduce
+// the number of transactions with a serial flash
+static uint8_t decode_byte(cfont_decoder_t *dec)
+{
+	if (dec->buf_pos == dec->buf_len)
+	{
+		dec->font->read(dec->font, dec->offset, dec->buf, CFONT_BUF_SIZE);
+		dec->offset += CFONT_BUF_SIZE;
+		dec->buf_pos = 0;
+		dec->buf_len = CFONT_BUF_SIZE;
+	}
+	return dec->buf[dec->buf_pos++];
+}
+
+//--------------------------------------------
+static uint8_t decode_bits(cfont_decoder_t *dec)
+{
+	uint8_t value;
+
+	if (!dec->bits_left)
+	{
+		dec->bits = decode_byte(dec);
+		dec->bits_left = 8;
+	}
+	value = dec->bits >> (8 - dec->bpp);
+	dec->bits <<= dec->bpp;
+	dec->bits_left -= dec->bpp;
+	return value;
+}
+
+//--------------------------------------------
+void cfont_decode_init(cfont_decoder_t *dec, const cfont_t *font, const cfont_info_t *info, const cfont_glyph_t *glyph)
+{
+	dec->font = font;
+	dec->offset = glyph->offset;
+	dec->buf_pos = 0;
+	dec->buf_len = 0;
+	dec->bpp = info->bpp;
+	dec->rle = info->rle;
+	dec->bits = 0;
+	dec->bits_left = 0;
+	dec->run = 0;
+	dec->run_type = CFONT_RLE_LITERAL;
+}
+
+//--------------------------------------------
+// Returns the alpha value of the next pixel (0 - transparent, 255 - opaque)
+uint8_t cfont_decode_alpha(cfont_decoder_t *dec)
+{
+	uint8_t token;
+	uint8_t max = (1 << dec->bpp) - 1;
+
+	if (!dec->rle)
+	{
+		return decode_bits(dec) * (255 / max);
+	}
+
+	if (!dec->run)
+	{
+		token = decode_byte(dec);
+		if (token & CFONT_RLE_OPAQUE)
+		{
+			dec->run_type = token & CFONT_RLE_CLEAR;
+			dec->run = (token & 0x3F) + 1;
+		}
+		else
+		{
+			// literal pixels always start on a byte boundary
+			dec->run_type = CFONT_RLE_LITERAL;
+			dec->run = (token & 0x7F) + 1;
+			dec->bits_left = 0;
+		}
+	}
+	dec->run--;
+
+	switch (dec->run_type)
+	{
+	case CFONT_RLE_CLEAR:
+		return 0;
+	case CFONT_RLE_OPAQUE:
+		return 255;
+	default:
+		return decode_bits(dec) * (255 / max);
+	}
+}
+
+//--------------------------------------------
+void cfont_decode_skip(cfont_decoder_t *dec, uint16_t count)
+{
+	while (count--)
+	{
+		cfont_decode_alpha(dec);
+	}
+}
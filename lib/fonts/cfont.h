@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef CFONT_H_
+#define CFONT_H_
+
+//------------------------------------------------------
+// Compressed font format (use lib/fonts/fontconv to create it).
+// All multi-byte fields are little endian.
+//
+// Header (8 bytes):
+//  0: 'C', 'F'   - signature
+//  2: version    - CFONT_VERSION
+//  3: flags      - bits[1:0]: bits per pixel (0 - 1bpp, 1 - 2bpp, 2 - 4bpp)
+//                  bit[7]:    glyph bitmaps are RLE compressed
+//  4: first      - the first char (inclusive)
+//  5: last       - the last char (inclusive)
+//  6: height     - line height in pixels
+//  7: ascent     - baseline position from the top of the line
+//
+// Glyph table (last - first + 1 entries, 8 bytes each):
+//  0: offset     - 24-bit glyph bitmap offset from the beginning of the font
+//  3: width      - glyph bitmap width in pixels (0 for blank glyphs)
+//  4: height     - glyph bitmap height in pixels
+//  5: xofs       - signed bitmap offset from the pen position
+//  6: yofs       - signed bitmap offset from the top of the line
+//  7: advance    - pen advance in pixels
+//
+// Glyph bitmap: width * height alpha values in raster order, MSB first.
+// The uncompressed bitmap is a packed bit stream.
+// The RLE compressed bitmap is a sequence of tokens:
+//  11nnnnnn          - nnnnnn + 1 transparent pixels
+//  10nnnnnn          - nnnnnn + 1 opaque pixels
+//  0nnnnnnn data...  - nnnnnnn + 1 pixels packed in the following bytes
+//
+// The font is padded with CFONT_BUF_SIZE zero bytes,
+// so the decoder can always read it in CFONT_BUF_SIZE blocks.
+//------------------------------------------------------
+
+#define CFONT_SUCCESS         0
+#define CFONT_FAIL            1
+
+#define CFONT_VERSION         1
+#define CFONT_HEADER_SIZE     8
+#define CFONT_GLYPH_SIZE      8
+#define CFONT_FLAG_BPP_MASK   0x03
+#define CFONT_FLAG_RLE        0x80
+
+#define CFONT_RLE_LITERAL     0x00
+#define CFONT_RLE_OPAQUE      0x80
+#define CFONT_RLE_CLEAR       0xC0
+
+#define CFONT_BUF_SIZE        16
+
+//------------------------------------------------------
+// The font can be placed in the internal flash, in the memory-mapped
+// external flash or in the serial flash that is read through a driver:
+//
+// static void w25q_font_read(const cfont_t *font, uint32_t offset, uint8_t *buf, uint16_t length)
+// {
+//     flash_drv.read(buf, font->addr + offset, length);
+// }
+// const cfont_t font_w25q = { w25q_font_read, 0, 0x00100000 };
+// const cfont_t font_int = CFONT_MEMORY(font_array);
+typedef struct cfont cfont_t;
+typedef void (*cfont_read_t)(const cfont_t *font, uint32_t offset, uint8_t *buf, uint16_t length);
+
+struct cfont
+{
+	cfont_read_t read;
+	FLASH_MEMORY_DECLARE(uint8_t, *data);
+	uint32_t addr;
+};
+
+#define CFONT_MEMORY(array) { cfont_read_memory, (array), 0 }
+
+typedef struct cfont_info
+{
+	uint8_t bpp;
+	uint8_t rle;
+	uint8_t first;
+	uint8_t last;
+	uint8_t height;
+	uint8_t ascent;
+} cfont_info_t;
+
+typedef struct cfont_glyph
+{
+	uint32_t offset;
+	uint8_t width;
+	uint8_t height;
+	int8_t xofs;
+	int8_t yofs;
+	uint8_t advance;
+} cfont_glyph_t;
+
+typedef struct cfont_decoder
+{
+	const cfont_t *font;
+	uint32_t offset;
+	uint8_t buf[CFONT_BUF_SIZE];
+	uint8_t buf_pos;
+	uint8_t buf_len;
+	uint8_t bpp;
+	uint8_t rle;
+	uint8_t bits;
+	uint8_t bits_left;
+	uint8_t run;
+	uint8_t run_type;
+} cfont_decoder_t;
+
+void cfont_read_memory(const cfont_t *font, uint32_t offset, uint8_t *buf, uint16_t length);
+uint8_t cfont_get_info(const cfont_t *font, cfont_info_t *info);
+uint8_t cfont_get_glyph(const cfont_t *font, const cfont_info_t *info, uint8_t ch, cfont_glyph_t *glyph);
+void cfont_decode_init(cfont_decoder_t *dec, const cfont_t *font, const cfont_info_t *info, const cfont_glyph_t *glyph);
+uint8_t cfont_decode_alpha(cfont_decoder_t *dec);
+void cfont_decode_skip(cfont_decoder_t *dec, uint16_t count);
+
+#endif // CFONT_H_
@@ -0,0 +1,496 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//------------------------------------------------------
+// Host utility: BDF font => compressed font (see lib/fonts/cfont.h)
+//
+// Usage: fontconv [options] font.bdf
+//   -n name    array name in the generated C file (default: font)
+//   -f first   the first char (default: 32)
+//   -l last    the last char (default: 126)
+//   -b bpp     bits per pixel: 1, 2 or 4 (default: 1)
+//   -s scale   downscale factor for antialiasing (default: 1)
+//              a BDF font rendered with the 'scale' times bigger size
+//              gives 'bpp' bit alpha values
+//   -r         RLE compression
+//   -o file    output file, *.c - C array, otherwise binary image
+//              for programming into the serial flash (default: stdout C array)
+//
+// Example (16px antialiased font from a 64px BDF font):
+//   fontconv -n dejavu_16 -b 4 -s 4 -r -o dejavu-16.c dejavu-64.bdf
+//------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FLASH_MEMORY_DECLARE(type, name) type const name
+#include "../cfont.h"
+
+//--------------------------------------------
+#define MAX_CHARS           256
+#define MAX_BITMAP          (512 * 512)
+#define MAX_FONT_SIZE       (16 * 1024 * 1024)
+
+typedef struct bdf_char
+{
+	int defined;
+	int dwidth;
+	int bbw;
+	int bbh;
+	int bbx;
+	int bby;
+	uint8_t *bitmap;       // bbw * bbh, one byte per pixel
+} bdf_char_t;
+
+typedef struct out_glyph
+{
+	int width;
+	int height;
+	int xofs;
+	int yofs;
+	int advance;
+	uint8_t *alpha;        // width * height, values 0..(1 << bpp) - 1
+} out_glyph_t;
+
+static bdf_char_t chars[MAX_CHARS];
+static int font_ascent;
+static int font_descent;
+
+static uint8_t font[MAX_FONT_SIZE];
+static uint32_t font_size;
+
+//--------------------------------------------
+static void fail(const char *msg)
+{
+	fprintf(stderr, "fontconv: %s\n", msg);
+	exit(1);
+}
+
+//--------------------------------------------
+static int hexval(int ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'A' && ch <= 'F')
+		return ch - 'A' + 10;
+	if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	return 0;
+}
+
+//--------------------------------------------
+static void read_bdf(const char *filename)
+{
+	FILE *fp;
+	char line[1024];
+	int encoding = -1;
+	int dwidth = 0;
+	int bbw = 0, bbh = 0, bbx = 0, bby = 0;
+	int row;
+	int col;
+	int fbbh = 0, fbby = 0;
+	bdf_char_t *bc;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+	{
+		fail("can't open the BDF file");
+	}
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (!strncmp(line, "FONTBOUNDINGBOX ", 16))
+		{
+			sscanf(line + 16, "%*d %d %*d %d", &fbbh, &fbby);
+		}
+		else if (!strncmp(line, "FONT_ASCENT ", 12))
+		{
+			font_ascent = atoi(line + 12);
+		}
+		else if (!strncmp(line, "FONT_DESCENT ", 13))
+		{
+			font_descent = atoi(line + 13);
+		}
+		else if (!strncmp(line, "STARTCHAR", 9))
+		{
+			encoding = -1;
+			dwidth = 0;
+			bbw = bbh = bbx = bby = 0;
+		}
+		else if (!strncmp(line, "ENCODING ", 9))
+		{
+			encoding = atoi(line + 9);
+		}
+		else if (!strncmp(line, "DWIDTH ", 7))
+		{
+			dwidth = atoi(line + 7);
+		}
+		else if (!strncmp(line, "BBX ", 4))
+		{
+			sscanf(line + 4, "%d %d %d %d", &bbw, &bbh, &bbx, &bby);
+		}
+		else if (!strncmp(line, "BITMAP", 6))
+		{
+			if (encoding < 0 || encoding >= MAX_CHARS)
+			{
+				continue;
+			}
+			if (bbw * bbh > MAX_BITMAP)
+			{
+				fail("the glyph is too big");
+			}
+			bc = &chars[encoding];
+			bc->defined = 1;
+			bc->dwidth = dwidth;
+			bc->bbw = bbw;
+			bc->bbh = bbh;
+			bc->bbx = bbx;
+			bc->bby = bby;
+			bc->bitmap = calloc(bbw * bbh + 1, 1);
+			for (row = 0; row < bbh && fgets(line, sizeof(line), fp); row++)
+			{
+				for (col = 0; col < bbw; col++)
+				{
+					int nibble = hexval(line[col / 4]);
+					bc->bitmap[row * bbw + col] = (nibble >> (3 - (col % 4))) & 1;
+				}
+			}
+		}
+	}
+	fclose(fp);
+
+	if (!font_ascent && !font_descent)
+	{
+		font_ascent = fbbh + fbby;
+		font_descent = -fbby;
+	}
+}
+
+//--------------------------------------------
+static int floor_div(int a, int b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+//--------------------------------------------
+// Every (scale x scale) block of the source glyph gives one output pixel,
+// its alpha value is the ink coverage of the block
+static void make_glyph(const bdf_char_t *bc, int scale, int bpp, int ascent, out_glyph_t *og)
+{
+	int max = (1 << bpp) - 1;
+	int x0, x1, y0, y1;
+	int w, h;
+	int row, col;
+	int *cover;
+	int minx, maxx, miny, maxy;
+
+	memset(og, 0, sizeof(*og));
+	og->advance = (bc->dwidth + scale / 2) / scale;
+	if (!bc->bbw || !bc->bbh)
+	{
+		return;
+	}
+
+	// output grid in the baseline coordinates (y axis is up)
+	x0 = floor_div(bc->bbx, scale);
+	x1 = floor_div(bc->bbx + bc->bbw - 1, scale);
+	y0 = floor_div(bc->bby, scale);
+	y1 = floor_div(bc->bby + bc->bbh - 1, scale);
+	w = x1 - x0 + 1;
+	h = y1 - y0 + 1;
+	cover = calloc(w * h, sizeof(int));
+
+	for (row = 0; row < bc->bbh; row++)
+	{
+		for (col = 0; col < bc->bbw; col++)
+		{
+			int px = bc->bbx + col;
+			int py = bc->bby + bc->bbh - 1 - row;
+			int ox = floor_div(px, scale) - x0;
+			int oy = y1 - floor_div(py, scale);
+			cover[oy * w + ox] += bc->bitmap[row * bc->bbw + col];
+		}
+	}
+
+	// trim the empty border
+	minx = w; maxx = -1; miny = h; maxy = -1;
+	for (row = 0; row < h; row++)
+	{
+		for (col = 0; col < w; col++)
+		{
+			int a = (cover[row * w + col] * max * 2 + scale * scale) / (scale * scale * 2);
+			cover[row * w + col] = a;
+			if (a)
+			{
+				if (col < minx) minx = col;
+				if (col > maxx) maxx = col;
+				if (row < miny) miny = row;
+				if (row > maxy) maxy = row;
+			}
+		}
+	}
+	if (maxx < 0)
+	{
+		free(cover);
+		return;
+	}
+
+	og->width = maxx - minx + 1;
+	og->height = maxy - miny + 1;
+	og->xofs = x0 + minx;
+	og->yofs = ascent - 1 - (y1 - miny);
+	og->alpha = malloc(og->width * og->height);
+	for (row = 0; row < og->height; row++)
+	{
+		for (col = 0; col < og->width; col++)
+		{
+			og->alpha[row * og->width + col] = cover[(row + miny) * w + col + minx];
+		}
+	}
+	free(cover);
+}
+
+//--------------------------------------------
+static void put_byte(uint8_t byte)
+{
+	if (font_size >= MAX_FONT_SIZE)
+	{
+		fail("the font is too big");
+	}
+	font[font_size++] = byte;
+}
+
+//--------------------------------------------
+static void put_bits(const uint8_t *alpha, int count, int bpp)
+{
+	int cnt;
+	int bits = 0;
+	uint8_t byte = 0;
+
+	for (cnt = 0; cnt < count; cnt++)
+	{
+		byte = (byte << bpp) | alpha[cnt];
+		bits += bpp;
+		if (bits == 8)
+		{
+			put_byte(byte);
+			byte = 0;
+			bits = 0;
+		}
+	}
+	if (bits)
+	{
+		put_byte(byte << (8 - bits));
+	}
+}
+
+//--------------------------------------------
+static int run_length(const uint8_t *alpha, int count, int limit)
+{
+	int cnt;
+
+	for (cnt = 1; cnt < count && cnt < limit && alpha[cnt] == alpha[0]; cnt++);
+	return cnt;
+}
+
+//--------------------------------------------
+// A run token is one byte, so it is used only when the run
+// is longer than the same pixels packed in a literal token
+static void put_rle(const uint8_t *alpha, int count, int bpp)
+{
+	int max = (1 << bpp) - 1;
+	int min_run = 8 / bpp + 1;
+	int pos = 0;
+	int run;
+	int lit;
+
+	while (pos < count)
+	{
+		if (alpha[pos] == 0 || alpha[pos] == max)
+		{
+			run = run_length(&alpha[pos], count - pos, 64);
+			if (run >= min_run || run == count - pos)
+			{
+				put_byte((alpha[pos] ? CFONT_RLE_OPAQUE : CFONT_RLE_CLEAR) | (run - 1));
+				pos += run;
+				continue;
+			}
+		}
+		// collect literal pixels up to the next long run
+		for (lit = 1; pos + lit < count && lit < 128; lit++)
+		{
+			const uint8_t *p = &alpha[pos + lit];
+			if ((*p == 0 || *p == max) && run_length(p, count - pos - lit, 64) >= min_run)
+			{
+				break;
+			}
+		}
+		put_byte(CFONT_RLE_LITERAL | (lit - 1));
+		put_bits(&alpha[pos], lit, bpp);
+		pos += lit;
+	}
+}
+
+//--------------------------------------------
+static void write_c(FILE *fp, const char *name)
+{
+	uint32_t cnt;
+
+	fprintf(fp, "#include \"platform.h\"\n\n");
+	fprintf(fp, "FLASH_MEMORY_DECLARE(uint8_t, %s[]) =\n{", name);
+	for (cnt = 0; cnt < font_size; cnt++)
+	{
+		fprintf(fp, "%s0x%02X,", (cnt % 16) ? "" : "\n\t", font[cnt]);
+	}
+	fprintf(fp, "\n};\n");
+}
+
+//--------------------------------------------
+int main(int argc, char *argv[])
+{
+	const char *name = "font";
+	const char *outname = NULL;
+	int first = 32;
+	int last = 126;
+	int bpp = 1;
+	int scale = 1;
+	int rle = 0;
+	int opt;
+	int ch;
+	int height;
+	int ascent;
+	uint32_t raw_size = 0;
+	uint32_t glyph_pos;
+	out_glyph_t og;
+	FILE *fp;
+
+	while ((opt = getopt(argc, argv, "n:f:l:b:s:ro:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': name = optarg; break;
+		case 'f': first = atoi(optarg); break;
+		case 'l': last = atoi(optarg); break;
+		case 'b': bpp = atoi(optarg); break;
+		case 's': scale = atoi(optarg); break;
+		case 'r': rle = 1; break;
+		case 'o': outname = optarg; break;
+		default:
+			fail("usage: fontconv [-n name] [-f first] [-l last] [-b bpp] [-s scale] [-r] [-o file] font.bdf");
+		}
+	}
+	if (optind >= argc)
+	{
+		fail("no BDF file");
+	}
+	if (bpp != 1 && bpp != 2 && bpp != 4)
+	{
+		fail("bpp must be 1, 2 or 4");
+	}
+	if (scale < 1 || first < 0 || last >= MAX_CHARS || first > last)
+	{
+		fail("invalid options");
+	}
+
+	read_bdf(argv[optind]);
+	ascent = (font_ascent + scale - 1) / scale;
+	height = (font_ascent + font_descent + scale - 1) / scale;
+	if (height > 255)
+	{
+		fail("the font is too big");
+	}
+
+	// header
+	put_byte('C');
+	put_byte('F');
+	put_byte(CFONT_VERSION);
+	put_byte((bpp == 1 ? 0 : bpp == 2 ? 1 : 2) | (rle ? CFONT_FLAG_RLE : 0));
+	put_byte(first);
+	put_byte(last);
+	put_byte(height);
+	put_byte(ascent);
+
+	// glyph table is filled in later
+	glyph_pos = font_size;
+	font_size += (last - first + 1) * CFONT_GLYPH_SIZE;
+
+	for (ch = first; ch <= last; ch++)
+	{
+		uint8_t *entry = &font[glyph_pos + (ch - first) * CFONT_GLYPH_SIZE];
+
+		if (chars[ch].defined)
+		{
+			make_glyph(&chars[ch], scale, bpp, ascent, &og);
+		}
+		else
+		{
+			memset(&og, 0, sizeof(og));
+		}
+		if (og.width > 255 || og.height > 255 || og.xofs < -128 || og.xofs > 127 ||
+		    og.yofs < -128 || og.yofs > 127 || og.advance > 255)
+		{
+			fail("the glyph metrics are out of range");
+		}
+		entry[0] = font_size & 0xFF;
+		entry[1] = (font_size >> 8) & 0xFF;
+		entry[2] = (font_size >> 16) & 0xFF;
+		entry[3] = og.width;
+		entry[4] = og.height;
+		entry[5] = (uint8_t)og.xofs;
+		entry[6] = (uint8_t)og.yofs;
+		entry[7] = og.advance;
+
+		raw_size += (og.width * og.height * bpp + 7) / 8;
+		if (rle)
+		{
+			put_rle(og.alpha, og.width * og.height, bpp);
+		}
+		else
+		{
+			put_bits(og.alpha, og.width * og.height, bpp);
+		}
+		free(og.alpha);
+	}
+
+	for (ch = 0; ch < CFONT_BUF_SIZE; ch++)
+	{
+		put_byte(0);
+	}
+
+	fprintf(stderr, "%s: %d chars, %d bpp, height %d, bitmaps %u bytes (uncompressed %u), total %u bytes\n",
+		name, last - first + 1, bpp, height,
+		font_size - glyph_pos - (last - first + 1) * CFONT_GLYPH_SIZE - CFONT_BUF_SIZE,
+		raw_size, font_size);
+
+	if (!outname)
+	{
+		write_c(stdout, name);
+		return 0;
+	}
+	if ((fp = fopen(outname, "wb")) == NULL)
+	{
+		fail("can't create the output file");
+	}
+	if (strlen(outname) > 2 && !strcmp(outname + strlen(outname) - 2, ".c"))
+	{
+		write_c(fp, name);
+	}
+	else
+	{
+		fwrite(font, 1, font_size, fp);
+	}
+	fclose(fp);
+	return 0;
+}
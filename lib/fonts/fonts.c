@@ -1110,3 +1110,7 @@ FLASH_MEMORY_DECLARE(uint8_t, monotypeSorts_26ptBitmaps[]) =
 //------------------------------------------------------
 // Also it's possible to use font bitmap arrays from uGUI library
 // adding 4 bytes before (see above).
+//------------------------------------------------------
+// Big and antialiased fonts can be converted from BDF files
+// to the compressed format (lib/fonts/cfont.h) with lib/fonts/fontconv
+// and printed with the color_scr_printstring_cfont/mono_scr_printstring_cfont.
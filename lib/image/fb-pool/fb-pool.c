@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "fb-pool.h"
+#include <stddef.h>
+
+//--------------------------------------------
+// The state of every block:
+// 0 - free, FB_POOL_TAIL - not the first block of the acquired blocks,
+// otherwise the number of the blocks acquired together
+#define FB_POOL_TAIL    0xFF
+
+static uint8_t *pool_mem;
+static uint32_t pool_block_size;
+static uint8_t pool_blocks;
+static uint8_t pool_state[FB_POOL_BLOCKS_MAX];
+
+//--------------------------------------------
+void fb_pool_init(uint8_t *mem, uint32_t size, uint32_t block_size)
+{
+	uint8_t cnt;
+
+	pool_mem = mem;
+	pool_block_size = block_size;
+	pool_blocks = (size / block_size > FB_POOL_BLOCKS_MAX) ? FB_POOL_BLOCKS_MAX : (uint8_t)(size / block_size);
+	for (cnt = 0; cnt < FB_POOL_BLOCKS_MAX; cnt++)
+	{
+		pool_state[cnt] = 0;
+	}
+}
+
+//--------------------------------------------
+uint8_t *fb_pool_acquire(uint8_t blocks)
+{
+	uint8_t first;
+	uint8_t cnt;
+
+	if (!blocks || blocks == FB_POOL_TAIL)
+	{
+		return NULL;
+	}
+	// the first fit
+	for (first = 0, cnt = 0; first + blocks <= pool_blocks; )
+	{
+		if (pool_state[first + cnt])
+		{
+			first += cnt + 1;
+			cnt = 0;
+			continue;
+		}
+		if (++cnt == blocks)
+		{
+			pool_state[first] = blocks;
+			for (cnt = 1; cnt < blocks; cnt++)
+			{
+				pool_state[first + cnt] = FB_POOL_TAIL;
+			}
+			return &pool_mem[first * pool_block_size];
+		}
+	}
+	return NULL;
+}
+
+//--------------------------------------------
+void fb_pool_release(uint8_t *buf)
+{
+	uint32_t first;
+	uint8_t cnt;
+
+	if (buf < pool_mem || ((uint32_t)(buf - pool_mem) % pool_block_size))
+	{
+		return;
+	}
+	first = (uint32_t)(buf - pool_mem) / pool_block_size;
+	if (first >= pool_blocks || !pool_state[first] || pool_state[first] == FB_POOL_TAIL)
+	{
+		return;
+	}
+	for (cnt = pool_state[first]; cnt; cnt--)
+	{
+		pool_state[first + cnt - 1] = 0;
+	}
+}
+
+//--------------------------------------------
+uint8_t fb_pool_get_free(void)
+{
+	uint8_t free_blocks;
+	uint8_t cnt;
+
+	for (free_blocks = 0, cnt = 0; cnt < pool_blocks; cnt++)
+	{
+		if (!pool_state[cnt])
+		{
+			free_blocks++;
+		}
+	}
+	return free_blocks;
+}
+
+//--------------------------------------------
+uint32_t fb_pool_get_block_size(void)
+{
+	return pool_block_size;
+}
+
+#if defined __DCACHE_PRESENT && __DCACHE_PRESENT
+//--------------------------------------------
+// The cache maintenance operations are applied to the whole cache lines:
+// the start address is aligned down, the length is extended to the end of the last line
+#define CACHE_LINE_ADDR(buf)           ((uint32_t)(buf) & ~(uint32_t)(FB_POOL_ALIGN - 1))
+#define CACHE_LINES_SIZE(buf, length)  ((int32_t)((uint32_t)(buf) + (length) - CACHE_LINE_ADDR(buf)))
+#define DCACHE_ENABLED()               (SCB->CCR & SCB_CCR_DC_Msk)
+#endif
+
+//--------------------------------------------
+void fb_pool_clean(const void *buf, uint32_t length)
+{
+#if defined __DCACHE_PRESENT && __DCACHE_PRESENT
+	if (DCACHE_ENABLED())
+	{
+		SCB_CleanDCache_by_Addr((uint32_t *)CACHE_LINE_ADDR(buf), CACHE_LINES_SIZE(buf, length));
+	}
+#endif
+}
+
+//--------------------------------------------
+void fb_pool_invalidate(void *buf, uint32_t length)
+{
+#if defined __DCACHE_PRESENT && __DCACHE_PRESENT
+	if (DCACHE_ENABLED())
+	{
+		SCB_InvalidateDCache_by_Addr((uint32_t *)CACHE_LINE_ADDR(buf), CACHE_LINES_SIZE(buf, length));
+	}
+#endif
+}
+
+//--------------------------------------------
+void fb_pool_flush(void *buf, uint32_t length)
+{
+#if defined __DCACHE_PRESENT && __DCACHE_PRESENT
+	if (DCACHE_ENABLED())
+	{
+		SCB_CleanInvalidateDCache_by_Addr((uint32_t *)CACHE_LINE_ADDR(buf), CACHE_LINES_SIZE(buf, length));
+	}
+#endif
+}
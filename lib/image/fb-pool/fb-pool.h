@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef FB_POOL_H_
+#define FB_POOL_H_
+
+//--------------------------------------------
+// Frame buffer pool:
+// the memory (e.g. the external SDRAM) is divided into the blocks of the same size,
+// the frame ring of the camera DMA is acquired as several consecutive blocks.
+// The functions are not reentrant, they are called from the main loop.
+//
+// fb_pool_init((uint8_t *)EXT_SDRAM_ADDR, EXT_SDRAM_SIZE, FB_POOL_BLOCK_SIZE(640 * 480 * 2));
+// frames = fb_pool_acquire(3);
+// cam_drv.start_dma_frames(frames, 640 * 480 * 2, 3);
+//
+// The Cortex-M7 D-cache is not coherent with DMA (the pool memory is cacheable),
+// so if the D-cache is enabled:
+// - the buffer written by the CPU is cleaned before DMA reads it (fb_pool_clean),
+// - the buffer is invalidated after DMA has written it, before the CPU reads it (fb_pool_invalidate),
+// - the buffer the CPU has written to is cleaned and invalidated
+//   before it is given back to DMA for writing (fb_pool_flush),
+//   so no dirty cache line is evicted over the new DMA data.
+// The functions do nothing if there is no D-cache or it is disabled.
+
+#define FB_POOL_BLOCKS_MAX         32
+// The cache line size
+#define FB_POOL_ALIGN              32
+#define FB_POOL_BLOCK_SIZE(size)   (((uint32_t)(size) + FB_POOL_ALIGN - 1) & ~(uint32_t)(FB_POOL_ALIGN - 1))
+
+// mem: FB_POOL_ALIGN aligned, block_size: a multiple of FB_POOL_ALIGN
+void fb_pool_init(uint8_t *mem, uint32_t size, uint32_t block_size);
+// Returns the consecutive blocks or NULL if there are no such free blocks
+uint8_t *fb_pool_acquire(uint8_t blocks);
+// buf: the pointer returned by fb_pool_acquire, all its blocks are released
+void fb_pool_release(uint8_t *buf);
+uint8_t fb_pool_get_free(void);
+uint32_t fb_pool_get_block_size(void);
+void fb_pool_clean(const void *buf, uint32_t length);
+void fb_pool_invalidate(void *buf, uint32_t length);
+void fb_pool_flush(void *buf, uint32_t length);
+
+#endif // FB_POOL_H_
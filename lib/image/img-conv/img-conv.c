@@ -0,0 +1,266 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "img-conv.h"
+
+//--------------------------------------------
+// Per channel average of two RGB565 pixels (or two pairs of pixels packed in the word):
+// (a + b) / 2 = (a & b) + (a ^ b) / 2, the LSBs of the channels are masked before the shift
+// so they do not get into the next channel
+static inline uint32_t rgb565_avg(uint32_t a, uint32_t b)
+{
+	return (((a ^ b) & 0xF7DEF7DE) >> 1) + (a & b);
+}
+
+//--------------------------------------------
+static inline uint32_t rgb565_pack(int32_t r, int32_t g, int32_t b)
+{
+	return ((uint32_t)(r & 0xF8) << 8) | ((uint32_t)(g & 0xFC) << 3) | ((uint32_t)b >> 3);
+}
+
+//--------------------------------------------
+static inline int32_t clip_u8(int32_t x)
+{
+	return (x < 0) ? 0 : (x > 255) ? 255 : x;
+}
+
+//--------------------------------------------
+// ITU-R BT.601, limited range, 8-bit fixed point:
+// R = 1.164 (Y - 16) + 1.596 (V - 128)
+// G = 1.164 (Y - 16) - 0.391 (U - 128) - 0.813 (V - 128)
+// B = 1.164 (Y - 16) + 2.018 (U - 128)
+#define YUV_KY      298
+#define YUV_KRV     409
+#define YUV_KGU     (-100)
+#define YUV_KGV     (-208)
+#define YUV_KBU     516
+
+//--------------------------------------------
+void img_yuv422_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t pixels)
+{
+	int32_t y0, y1, u, v;
+	int32_t rv, guv, bu;
+
+	for (pixels /= 2; pixels; pixels--)
+	{
+		y0 = (src[0] - 16) * YUV_KY + 128;
+		u = src[1] - 128;
+		y1 = (src[2] - 16) * YUV_KY + 128;
+		v = src[3] - 128;
+		src += 4;
+		rv = YUV_KRV * v;
+		guv = YUV_KGU * u + YUV_KGV * v;
+		bu = YUV_KBU * u;
+		*dst++ = (uint16_t)rgb565_pack(clip_u8((y0 + rv) >> 8), clip_u8((y0 + guv) >> 8), clip_u8((y0 + bu) >> 8));
+		*dst++ = (uint16_t)rgb565_pack(clip_u8((y1 + rv) >> 8), clip_u8((y1 + guv) >> 8), clip_u8((y1 + bu) >> 8));
+	}
+}
+
+//--------------------------------------------
+void img_rgb565_swap_ref(const uint16_t *src, uint16_t *dst, uint32_t pixels)
+{
+	uint16_t pixel;
+
+	for (; pixels; pixels--)
+	{
+		pixel = *src++;
+		*dst++ = (uint16_t)((pixel >> 8) | (pixel << 8));
+	}
+}
+
+//--------------------------------------------
+void img_yuv422_to_gray_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+	for (; pixels; pixels--)
+	{
+		*dst++ = *src;
+		src += 2;
+	}
+}
+
+//--------------------------------------------
+// Every 2 x 2 block of the source image is replaced by its average:
+// the vertical pairs are averaged first, then the results are averaged horizontally
+void img_downscale2x_rgb565_ref(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height)
+{
+	const uint16_t *top;
+	const uint16_t *bottom;
+	uint32_t left, right;
+	uint16_t x, y;
+
+	for (y = 0; y < height / 2; y++)
+	{
+		top = src + (uint32_t)y * 2 * width;
+		bottom = top + width;
+		for (x = 0; x < width / 2; x++)
+		{
+			left = rgb565_avg(*top++, *bottom++);
+			right = rgb565_avg(*top++, *bottom++);
+			*dst++ = (uint16_t)rgb565_avg(left, right);
+		}
+	}
+}
+
+#if defined __ARM_FEATURE_DSP
+//--------------------------------------------
+// 2 pixels per iteration:
+// UXTB16 splits the YUYV word into the Y and UV halfword pairs,
+// SSUB16 removes the offsets, SMUAD/SMLAD multiply both halfwords and accumulate
+void img_yuv422_to_rgb565_dsp(const uint8_t *src, uint16_t *dst, uint32_t pixels)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t word, y, uv;
+	int32_t y0, y1;
+	int32_t rv, guv, bu;
+	uint32_t cnt;
+
+	for (cnt = pixels / 2; cnt; cnt--)
+	{
+		word = *s++;
+		y = __SSUB16(__UXTB16(word), 0x00100010);        // Y1 - 16 : Y0 - 16
+		uv = __SSUB16(__UXTB16(word >> 8), 0x00800080);  // V - 128 : U - 128
+		rv = (int32_t)__SMUAD(uv, (uint32_t)YUV_KRV << 16);
+		guv = (int32_t)__SMUAD(uv, ((uint32_t)(YUV_KGV & 0xFFFF) << 16) | (YUV_KGU & 0xFFFF));
+		bu = (int32_t)__SMUAD(uv, YUV_KBU);
+		y0 = (int32_t)__SMLAD(y, YUV_KY, 128);
+		y1 = (int32_t)__SMLAD(y, (uint32_t)YUV_KY << 16, 128);
+		*d++ = rgb565_pack(__USAT((y0 + rv) >> 8, 8), __USAT((y0 + guv) >> 8, 8), __USAT((y0 + bu) >> 8, 8)) |
+			(rgb565_pack(__USAT((y1 + rv) >> 8, 8), __USAT((y1 + guv) >> 8, 8), __USAT((y1 + bu) >> 8, 8)) << 16);
+	}
+}
+
+//--------------------------------------------
+// 2 pixels per iteration
+void img_rgb565_swap_dsp(const uint16_t *src, uint16_t *dst, uint32_t pixels)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t cnt;
+
+	for (cnt = pixels / 2; cnt; cnt--)
+	{
+		*d++ = __REV16(*s++);
+	}
+	if (pixels & 1)
+	{
+		img_rgb565_swap_ref((const uint16_t *)s, (uint16_t *)d, 1);
+	}
+}
+
+//--------------------------------------------
+// 4 pixels per iteration:
+// UXTB16 extracts Y1:Y0 and Y3:Y2, PKHBT/PKHTB regroup them into Y2:Y0 and Y3:Y1
+void img_yuv422_to_gray_dsp(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t y10, y32;
+	uint32_t cnt;
+
+	for (cnt = pixels / 4; cnt; cnt--)
+	{
+		y10 = __UXTB16(*s++);
+		y32 = __UXTB16(*s++);
+		*d++ = __PKHBT(y10, y32, 16) | (__PKHTB(y32, y10, 16) << 8);
+	}
+	if (pixels & 3)
+	{
+		img_yuv422_to_gray_ref((const uint8_t *)s, (uint8_t *)d, pixels & 3);
+	}
+}
+
+//--------------------------------------------
+// 2 output pixels per iteration: 2 vertical pairs are averaged in one word,
+// PKHBT/PKHTB regroup the results into the left and right pixels of both blocks
+// width: multiple of 4
+void img_downscale2x_rgb565_dsp(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height)
+{
+	const uint32_t *top;
+	const uint32_t *bottom;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t v10, v32;
+	uint16_t x, y;
+
+	for (y = 0; y < height / 2; y++)
+	{
+		top = (const uint32_t *)(src + (uint32_t)y * 2 * width);
+		bottom = top + width / 2;
+		for (x = width / 4; x; x--)
+		{
+			v10 = rgb565_avg(*top++, *bottom++);
+			v32 = rgb565_avg(*top++, *bottom++);
+			*d++ = rgb565_avg(__PKHBT(v10, v32, 16), __PKHTB(v32, v10, 16));
+		}
+	}
+}
+#endif
+
+//--------------------------------------------
+#if defined __ARM_FEATURE_DSP
+#define IS_ALIGNED(a, b)  (!(((uintptr_t)(a) | (uintptr_t)(b)) & 3))
+#endif
+
+//--------------------------------------------
+void img_yuv422_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t pixels)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		img_yuv422_to_rgb565_dsp(src, dst, pixels);
+		return;
+	}
+#endif
+	img_yuv422_to_rgb565_ref(src, dst, pixels);
+}
+
+//--------------------------------------------
+void img_rgb565_swap(const uint16_t *src, uint16_t *dst, uint32_t pixels)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		img_rgb565_swap_dsp(src, dst, pixels);
+		return;
+	}
+#endif
+	img_rgb565_swap_ref(src, dst, pixels);
+}
+
+//--------------------------------------------
+void img_yuv422_to_gray(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst))
+	{
+		img_yuv422_to_gray_dsp(src, dst, pixels);
+		return;
+	}
+#endif
+	img_yuv422_to_gray_ref(src, dst, pixels);
+}
+
+//--------------------------------------------
+void img_downscale2x_rgb565(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height)
+{
+#if defined __ARM_FEATURE_DSP
+	if (IS_ALIGNED(src, dst) && !(width & 3))
+	{
+		img_downscale2x_rgb565_dsp(src, dst, width, height);
+		return;
+	}
+#endif
+	img_downscale2x_rgb565_ref(src, dst, width, height);
+}
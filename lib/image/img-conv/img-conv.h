@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef IMG_CONV_H_
+#define IMG_CONV_H_
+
+//--------------------------------------------
+// Pixel format conversion kernels.
+// YUV422 is the YUYV byte order (Y0 U0 Y1 V0 ...), RGB565 is the CPU byte order.
+// Every kernel has the portable C reference implementation (_ref)
+// and the Cortex-M4/M7 DSP (SIMD) implementation processing 2 or 4 pixels
+// per iteration, the results of both implementations are bit-exact.
+// The kernels without the suffix select the DSP implementation when __ARM_FEATURE_DSP
+// is defined and the buffers are 4 byte aligned, the reference one otherwise.
+// The destination buffer may be the source buffer (in-place conversion).
+
+void img_yuv422_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t pixels);
+void img_rgb565_swap_ref(const uint16_t *src, uint16_t *dst, uint32_t pixels);
+void img_yuv422_to_gray_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+void img_downscale2x_rgb565_ref(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height);
+
+#if defined __ARM_FEATURE_DSP
+void img_yuv422_to_rgb565_dsp(const uint8_t *src, uint16_t *dst, uint32_t pixels);
+void img_rgb565_swap_dsp(const uint16_t *src, uint16_t *dst, uint32_t pixels);
+void img_yuv422_to_gray_dsp(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+void img_downscale2x_rgb565_dsp(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height);
+#endif
+
+// pixels: even
+void img_yuv422_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t pixels);
+void img_rgb565_swap(const uint16_t *src, uint16_t *dst, uint32_t pixels);
+// pixels: even
+void img_yuv422_to_gray(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+// width, height: the source image size, even
+void img_downscale2x_rgb565(const uint16_t *src, uint16_t *dst, uint16_t width, uint16_t height);
+
+#endif // IMG_CONV_H_
@@ -0,0 +1,331 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host test of the pixel format conversion kernels:
+// - every reference kernel is checked against the expected pixels computed
+//   independently: the named BT.601 colors and the floating point conversion
+//   of a YUV sweep (1 LSB of the RGB565 channel at most), the byte swap,
+//   the luma extraction and the per channel 2 x 2 average,
+//   with the odd pixel counts, the odd image width and in-place conversion,
+// - every DSP kernel (built with the C models of the SIMD instructions, see platform.h)
+//   is bit-exact with the reference one on the pseudo-random images,
+// - the dispatching kernels give the same results with the unaligned buffers
+//   and the tails that are not a multiple of the DSP step, and write nothing past the end.
+// Exit status 1 if any check fails.
+
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "img-conv.h"
+
+//--------------------------------------------
+#define WIDTH           64
+#define HEIGHT          16
+#define PIXELS          (WIDTH * HEIGHT)
+#define GUARD           0xA5
+
+//--------------------------------------------
+static uint32_t src_buf[PIXELS + 4];
+static uint32_t dst_buf[PIXELS + 4];
+static uint32_t ref_buf[PIXELS + 4];
+static uint32_t rnd = 1;
+static int failed;
+
+//--------------------------------------------
+static void check(int ok, const char *name)
+{
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+	if (!ok)
+	{
+		failed++;
+	}
+}
+
+//--------------------------------------------
+static uint8_t random_byte(void)
+{
+	rnd = rnd * 1103515245 + 12345;
+	return (uint8_t)(rnd >> 16);
+}
+
+//--------------------------------------------
+static void fill_random(void *buf, uint32_t size)
+{
+	uint8_t *p = (uint8_t *)buf;
+
+	while (size--)
+	{
+		*p++ = random_byte();
+	}
+}
+
+//--------------------------------------------
+static int guard_intact(const void *buf, uint32_t size)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+
+	while (size--)
+	{
+		if (*p++ != GUARD)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//--------------------------------------------
+static double clip(double x)
+{
+	return (x < 0) ? 0 : (x > 255) ? 255 : x;
+}
+
+//--------------------------------------------
+static int channel_close(int actual, double expected, int bits)
+{
+	int diff = actual - (int)(expected / (1 << (8 - bits)));
+	return diff >= -1 && diff <= 1;
+}
+
+//--------------------------------------------
+static void test_yuv422_to_rgb565(void)
+{
+	// Y U Y V: black, white, red, green, blue (BT.601, limited range)
+	static const uint8_t yuv[] = { 16, 128, 235, 128, 81, 90, 81, 240, 145, 54, 145, 34, 41, 240, 41, 110 };
+	static const uint16_t rgb[] = { 0x0000, 0xFFFF, 0xF800, 0xF800, 0x07E0, 0x07E0, 0x001F, 0x001F };
+	uint8_t *s = (uint8_t *)src_buf;
+	uint16_t *d = (uint16_t *)dst_buf;
+	uint32_t cnt;
+	double y, u, v;
+	int ok;
+
+	img_yuv422_to_rgb565_ref(yuv, d, 2);
+	check(d[0] == rgb[0] && d[1] == rgb[1], "yuv422_to_rgb565_ref: black, white");
+	img_yuv422_to_rgb565_ref(&yuv[4], d, 6);
+	check(!memcmp(d, &rgb[2], 6 * sizeof(uint16_t)), "yuv422_to_rgb565_ref: red, green, blue");
+
+	// The sweep over all Y and U, V values
+	for (cnt = 0; cnt < PIXELS / 2; cnt++)
+	{
+		s[cnt * 4] = (uint8_t)(cnt * 4);
+		s[cnt * 4 + 1] = (uint8_t)(cnt * 3);
+		s[cnt * 4 + 2] = (uint8_t)(cnt * 4 + 2);
+		s[cnt * 4 + 3] = (uint8_t)(cnt * 5);
+	}
+	img_yuv422_to_rgb565_ref(s, d, PIXELS);
+	for (ok = 1, cnt = 0; cnt < PIXELS; cnt++)
+	{
+		y = 1.164 * (s[cnt * 2] - 16);
+		u = s[(cnt & ~1u) * 2 + 1] - 128;
+		v = s[(cnt & ~1u) * 2 + 3] - 128;
+		ok &= channel_close(d[cnt] >> 11, clip(y + 1.596 * v), 5);
+		ok &= channel_close((d[cnt] >> 5) & 0x3F, clip(y - 0.391 * u - 0.813 * v), 6);
+		ok &= channel_close(d[cnt] & 0x1F, clip(y + 2.018 * u), 5);
+	}
+	check(ok, "yuv422_to_rgb565_ref: floating point sweep");
+
+	// In-place conversion
+	memcpy(ref_buf, d, PIXELS * sizeof(uint16_t));
+	img_yuv422_to_rgb565_ref(s, (uint16_t *)s, PIXELS);
+	check(!memcmp(s, ref_buf, PIXELS * sizeof(uint16_t)), "yuv422_to_rgb565_ref: in-place");
+}
+
+//--------------------------------------------
+static void test_rgb565_swap(void)
+{
+	uint16_t *s = (uint16_t *)src_buf;
+	uint16_t *d = (uint16_t *)dst_buf;
+	uint32_t cnt;
+	int ok;
+
+	fill_random(s, PIXELS * sizeof(uint16_t));
+	memset(d, GUARD, sizeof(dst_buf));
+	img_rgb565_swap_ref(s, d, 7);
+	for (ok = 1, cnt = 0; cnt < 7; cnt++)
+	{
+		ok &= ((uint8_t *)d)[cnt * 2] == ((uint8_t *)s)[cnt * 2 + 1] && ((uint8_t *)d)[cnt * 2 + 1] == ((uint8_t *)s)[cnt * 2];
+	}
+	check(ok && guard_intact(&d[7], 16), "rgb565_swap_ref: odd pixels");
+
+	memcpy(ref_buf, s, PIXELS * sizeof(uint16_t));
+	img_rgb565_swap_ref(s, s, PIXELS);
+	img_rgb565_swap_ref(s, s, PIXELS);
+	check(!memcmp(s, ref_buf, PIXELS * sizeof(uint16_t)), "rgb565_swap_ref: in-place, twice");
+}
+
+//--------------------------------------------
+static void test_yuv422_to_gray(void)
+{
+	uint8_t *s = (uint8_t *)src_buf;
+	uint8_t *d = (uint8_t *)dst_buf;
+	uint32_t cnt;
+	int ok;
+
+	fill_random(s, PIXELS * 2);
+	memset(d, GUARD, sizeof(dst_buf));
+	img_yuv422_to_gray_ref(s, d, 7);
+	for (ok = 1, cnt = 0; cnt < 7; cnt++)
+	{
+		ok &= d[cnt] == s[cnt * 2];
+	}
+	check(ok && guard_intact(&d[7], 16), "yuv422_to_gray_ref: odd pixels");
+
+	memcpy(ref_buf, s, PIXELS * 2);
+	img_yuv422_to_gray_ref(s, s, PIXELS);
+	for (ok = 1, cnt = 0; cnt < PIXELS; cnt++)
+	{
+		ok &= s[cnt] == ((uint8_t *)ref_buf)[cnt * 2];
+	}
+	check(ok, "yuv422_to_gray_ref: in-place");
+}
+
+//--------------------------------------------
+// The expected 2 x 2 average: the vertical pairs are averaged first,
+// then the results are averaged horizontally, every step rounds down
+static uint16_t average4(uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+{
+	static const uint16_t shift[] = { 11, 5, 0 };
+	static const uint16_t mask[] = { 0x1F, 0x3F, 0x1F };
+	uint16_t result = 0;
+	uint16_t left, right;
+	uint8_t ch;
+
+	for (ch = 0; ch < 3; ch++)
+	{
+		left = (uint16_t)((((a >> shift[ch]) & mask[ch]) + ((c >> shift[ch]) & mask[ch])) / 2);
+		right = (uint16_t)((((b >> shift[ch]) & mask[ch]) + ((d >> shift[ch]) & mask[ch])) / 2);
+		result |= (uint16_t)(((left + right) / 2) << shift[ch]);
+	}
+	return result;
+}
+
+//--------------------------------------------
+static void test_downscale2x_rgb565(void)
+{
+	static const uint16_t block[] = { 0xFFFF, 0x0000, 0x0000, 0xFFFF };
+	uint16_t *s = (uint16_t *)src_buf;
+	uint16_t *d = (uint16_t *)dst_buf;
+	uint16_t x, y;
+	uint16_t width;
+	int ok;
+
+	img_downscale2x_rgb565_ref(block, d, 2, 2);
+	// R 31 / 2 = 15, G 63 / 2 = 31, B 31 / 2 = 15
+	check(d[0] == 0x7BEF, "downscale2x_rgb565_ref: white, black");
+	// The odd width: the last column is skipped
+	for (width = 5; width <= 6; width++)
+	{
+		fill_random(s, width * 4 * sizeof(uint16_t));
+		memset(d, GUARD, sizeof(dst_buf));
+		img_downscale2x_rgb565_ref(s, d, width, 4);
+		for (ok = 1, y = 0; y < 2; y++)
+		{
+			for (x = 0; x < width / 2; x++)
+			{
+				ok &= d[y * (width / 2) + x] == average4(s[y * 2 * width + x * 2], s[y * 2 * width + x * 2 + 1],
+					s[(y * 2 + 1) * width + x * 2], s[(y * 2 + 1) * width + x * 2 + 1]);
+			}
+		}
+		ok &= guard_intact(&d[2 * (width / 2)], 16);
+		check(ok, width & 1 ? "downscale2x_rgb565_ref: odd width" : "downscale2x_rgb565_ref: even width");
+	}
+}
+
+//--------------------------------------------
+// The DSP kernels are bit-exact with the reference ones on the aligned buffers
+static void test_dsp(void)
+{
+	fill_random(src_buf, sizeof(src_buf));
+	img_yuv422_to_rgb565_ref((uint8_t *)src_buf, (uint16_t *)ref_buf, PIXELS);
+	img_yuv422_to_rgb565_dsp((uint8_t *)src_buf, (uint16_t *)dst_buf, PIXELS);
+	check(!memcmp(dst_buf, ref_buf, PIXELS * sizeof(uint16_t)), "yuv422_to_rgb565_dsp == ref");
+
+	img_rgb565_swap_ref((uint16_t *)src_buf, (uint16_t *)ref_buf, PIXELS - 1);
+	img_rgb565_swap_dsp((uint16_t *)src_buf, (uint16_t *)dst_buf, PIXELS - 1);
+	check(!memcmp(dst_buf, ref_buf, (PIXELS - 1) * sizeof(uint16_t)), "rgb565_swap_dsp == ref, odd pixels");
+
+	img_yuv422_to_gray_ref((uint8_t *)src_buf, (uint8_t *)ref_buf, PIXELS - 2);
+	img_yuv422_to_gray_dsp((uint8_t *)src_buf, (uint8_t *)dst_buf, PIXELS - 2);
+	check(!memcmp(dst_buf, ref_buf, PIXELS - 2), "yuv422_to_gray_dsp == ref, tail of 2 pixels");
+
+	img_downscale2x_rgb565_ref((uint16_t *)src_buf, (uint16_t *)ref_buf, WIDTH, HEIGHT);
+	img_downscale2x_rgb565_dsp((uint16_t *)src_buf, (uint16_t *)dst_buf, WIDTH, HEIGHT);
+	check(!memcmp(dst_buf, ref_buf, PIXELS / 4 * sizeof(uint16_t)), "downscale2x_rgb565_dsp == ref");
+}
+
+//--------------------------------------------
+// The dispatching kernels with the unaligned buffers and the tails
+// fall back to or complete with the reference implementation
+static void test_dispatch(void)
+{
+	uint8_t *s = (uint8_t *)src_buf + 2;
+	uint8_t *d = (uint8_t *)dst_buf + 2;
+	uint32_t pixels;
+
+	fill_random(src_buf, sizeof(src_buf));
+	for (pixels = PIXELS - 6; pixels <= PIXELS - 4; pixels += 2)
+	{
+		img_yuv422_to_rgb565_ref((uint8_t *)src_buf, (uint16_t *)ref_buf, pixels);
+		img_yuv422_to_rgb565((uint8_t *)src_buf, (uint16_t *)dst_buf, pixels);
+		check(!memcmp(dst_buf, ref_buf, pixels * sizeof(uint16_t)), "yuv422_to_rgb565: aligned");
+		img_yuv422_to_rgb565_ref(s, (uint16_t *)ref_buf, pixels);
+		memset(dst_buf, GUARD, sizeof(dst_buf));
+		img_yuv422_to_rgb565(s, (uint16_t *)d, pixels);
+		check(!memcmp(d, ref_buf, pixels * sizeof(uint16_t)) && guard_intact(d + pixels * sizeof(uint16_t), 8), "yuv422_to_rgb565: unaligned");
+	}
+	for (pixels = PIXELS - 3; pixels <= PIXELS; pixels++)
+	{
+		img_rgb565_swap_ref((uint16_t *)src_buf, (uint16_t *)ref_buf, pixels);
+		memset(dst_buf, GUARD, sizeof(dst_buf));
+		img_rgb565_swap((uint16_t *)src_buf, (uint16_t *)dst_buf, pixels);
+		check(!memcmp(dst_buf, ref_buf, pixels * sizeof(uint16_t)) && guard_intact((uint16_t *)dst_buf + pixels, 8), "rgb565_swap: aligned, tail");
+		img_rgb565_swap_ref((uint16_t *)s, (uint16_t *)ref_buf, pixels);
+		img_rgb565_swap((uint16_t *)s, (uint16_t *)d, pixels);
+		check(!memcmp(d, ref_buf, pixels * sizeof(uint16_t)), "rgb565_swap: unaligned");
+
+		img_yuv422_to_gray_ref((uint8_t *)src_buf, (uint8_t *)ref_buf, pixels & ~1u);
+		memset(dst_buf, GUARD, sizeof(dst_buf));
+		img_yuv422_to_gray((uint8_t *)src_buf, (uint8_t *)dst_buf, pixels & ~1u);
+		check(!memcmp(dst_buf, ref_buf, pixels & ~1u) && guard_intact((uint8_t *)dst_buf + (pixels & ~1u), 8), "yuv422_to_gray: aligned, tail");
+		img_yuv422_to_gray_ref(s, (uint8_t *)ref_buf, pixels & ~1u);
+		img_yuv422_to_gray(s, d, pixels & ~1u);
+		check(!memcmp(d, ref_buf, pixels & ~1u), "yuv422_to_gray: unaligned");
+	}
+	// Width multiple of 4 (DSP) and not (reference)
+	for (pixels = WIDTH - 2; pixels <= WIDTH; pixels += 2)
+	{
+		img_downscale2x_rgb565_ref((uint16_t *)src_buf, (uint16_t *)ref_buf, (uint16_t)pixels, HEIGHT);
+		memset(dst_buf, GUARD, sizeof(dst_buf));
+		img_downscale2x_rgb565((uint16_t *)src_buf, (uint16_t *)dst_buf, (uint16_t)pixels, HEIGHT);
+		check(!memcmp(dst_buf, ref_buf, pixels / 2 * HEIGHT / 2 * sizeof(uint16_t)) &&
+			guard_intact((uint16_t *)dst_buf + pixels / 2 * HEIGHT / 2, 8), "downscale2x_rgb565: width");
+		img_downscale2x_rgb565_ref((uint16_t *)s, (uint16_t *)ref_buf, (uint16_t)pixels, HEIGHT);
+		img_downscale2x_rgb565((uint16_t *)s, (uint16_t *)d, (uint16_t)pixels, HEIGHT);
+		check(!memcmp(d, ref_buf, pixels / 2 * HEIGHT / 2 * sizeof(uint16_t)), "downscale2x_rgb565: unaligned");
+	}
+}
+
+//--------------------------------------------
+int main(void)
+{
+	test_yuv422_to_rgb565();
+	test_rgb565_swap();
+	test_yuv422_to_gray();
+	test_downscale2x_rgb565();
+	test_dsp();
+	test_dispatch();
+	printf("%s: %d checks failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
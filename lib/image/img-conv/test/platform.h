@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+// Host build of the library
+#include <stdint.h>
+
+//--------------------------------------------
+// The DSP kernels are built on the host with the C models
+// of the Cortex-M4/M7 SIMD instructions they use
+#define __ARM_FEATURE_DSP 1
+
+//--------------------------------------------
+static inline uint32_t __UXTB16(uint32_t x)
+{
+	return x & 0x00FF00FF;
+}
+
+//--------------------------------------------
+static inline uint32_t __SSUB16(uint32_t x, uint32_t y)
+{
+	uint16_t lo = (uint16_t)((int16_t)x - (int16_t)y);
+	uint16_t hi = (uint16_t)((int16_t)(x >> 16) - (int16_t)(y >> 16));
+	return ((uint32_t)hi << 16) | lo;
+}
+
+//--------------------------------------------
+static inline uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t acc)
+{
+	return (uint32_t)((int32_t)(int16_t)x * (int16_t)y + (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16) + (int32_t)acc);
+}
+
+//--------------------------------------------
+static inline uint32_t __SMUAD(uint32_t x, uint32_t y)
+{
+	return __SMLAD(x, y, 0);
+}
+
+//--------------------------------------------
+static inline uint32_t __USAT(int32_t x, uint32_t bits)
+{
+	int32_t max = (1 << bits) - 1;
+	return (uint32_t)((x < 0) ? 0 : (x > max) ? max : x);
+}
+
+//--------------------------------------------
+static inline uint32_t __REV16(uint32_t x)
+{
+	return ((x & 0x00FF00FF) << 8) | ((x >> 8) & 0x00FF00FF);
+}
+
+//--------------------------------------------
+static inline uint32_t __PKHBT(uint32_t x, uint32_t y, uint32_t shift)
+{
+	return (x & 0x0000FFFF) | ((y << shift) & 0xFFFF0000);
+}
+
+//--------------------------------------------
+static inline uint32_t __PKHTB(uint32_t x, uint32_t y, uint32_t shift)
+{
+	return (x & 0xFFFF0000) | ((uint32_t)((int32_t)y >> shift) & 0x0000FFFF);
+}
+
+#endif // PLATFORM_H_
@@ -0,0 +1,268 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#include "platform.h"
+#include "img-motion.h"
+#include <string.h>
+
+//--------------------------------------------
+static uint8_t *luma_cur;
+static uint8_t *luma_prev;
+static uint32_t *motion_map;
+static uint16_t frame_width;
+static uint16_t frame_height;
+static uint16_t luma_width;
+static uint16_t luma_height;
+static uint16_t blocks_x;
+static uint16_t blocks_y;
+static uint8_t motion_format;
+static uint8_t motion_threshold;
+// The previous luma image is valid
+static uint8_t motion_valid;
+static uint16_t changed_blocks;
+// The bounding rectangle of the changed blocks
+static uint16_t roi_x1, roi_y1, roi_x2, roi_y2;
+
+//--------------------------------------------
+// 4 pixels: (Y0 + Y1 + Y2 + Y3) / 4
+static void luma_yuv422_ref(const uint8_t *src, uint8_t *dst, uint16_t width)
+{
+	for (width /= IMG_MOTION_SCALE; width; width--)
+	{
+		*dst++ = (uint8_t)((src[0] + src[2] + src[4] + src[6]) >> 2);
+		src += IMG_MOTION_SCALE * 2;
+	}
+}
+
+//--------------------------------------------
+// 4 pixels: the average of Y = (77 R + 150 G + 29 B) / 256
+static void luma_rgb565_ref(const uint16_t *src, uint8_t *dst, uint16_t width)
+{
+	uint32_t sum;
+	uint16_t pixel;
+	uint8_t cnt;
+
+	for (width /= IMG_MOTION_SCALE; width; width--)
+	{
+		for (sum = 0, cnt = 0; cnt < IMG_MOTION_SCALE; cnt++)
+		{
+			pixel = *src++;
+			sum += (77 * ((pixel >> 8) & 0xF8) + 150 * ((pixel >> 3) & 0xFC) + 29 * ((pixel << 3) & 0xF8)) >> 8;
+		}
+		*dst++ = (uint8_t)(sum >> 2);
+	}
+}
+
+//--------------------------------------------
+// The block of IMG_MOTION_BLOCK samples width
+static uint32_t block_sad_ref(const uint8_t *cur, const uint8_t *prev, uint16_t stride, uint8_t rows)
+{
+	uint32_t sad;
+	uint8_t cnt;
+
+	for (sad = 0; rows; rows--)
+	{
+		for (cnt = 0; cnt < IMG_MOTION_BLOCK; cnt++)
+		{
+			sad += (cur[cnt] > prev[cnt]) ? cur[cnt] - prev[cnt] : prev[cnt] - cur[cnt];
+		}
+		cur += stride;
+		prev += stride;
+	}
+	return sad;
+}
+
+#if defined __ARM_FEATURE_DSP
+//--------------------------------------------
+// 4 samples (16 pixels) per iteration, width: a multiple of IMG_MOTION_TILE:
+// UXTB16 extracts the Y pairs of the words, UADD16 adds them,
+// PKHBT/PKHTB regroup the pair sums of the neighbouring words,
+// so the next UADD16 gives the sums of 4 pixels of 2 samples
+static void luma_yuv422_dsp(const uint8_t *src, uint8_t *dst, uint16_t width)
+{
+	const uint32_t *s = (const uint32_t *)src;
+	uint32_t *d = (uint32_t *)dst;
+	uint32_t s0, s1, l10, l32;
+	uint16_t cnt;
+
+	for (cnt = width / (IMG_MOTION_SCALE * 4); cnt; cnt--)
+	{
+		s0 = __UADD16(__UXTB16(s[0]), __UXTB16(s[1]));
+		s1 = __UADD16(__UXTB16(s[2]), __UXTB16(s[3]));
+		l10 = (__UADD16(__PKHBT(s0, s1, 16), __PKHTB(s1, s0, 16)) >> 2) & 0x00FF00FF;
+		s0 = __UADD16(__UXTB16(s[4]), __UXTB16(s[5]));
+		s1 = __UADD16(__UXTB16(s[6]), __UXTB16(s[7]));
+		l32 = (__UADD16(__PKHBT(s0, s1, 16), __PKHTB(s1, s0, 16)) >> 2) & 0x00FF00FF;
+		s += 8;
+		*d++ = __PKHBT(l10, l32, 16) | (__PKHTB(l32, l10, 16) << 8);
+	}
+}
+
+//--------------------------------------------
+// USADA8: 4 samples (one block row) per instruction
+static uint32_t block_sad_dsp(const uint8_t *cur, const uint8_t *prev, uint16_t stride, uint8_t rows)
+{
+	uint32_t sad;
+
+	for (sad = 0; rows; rows--)
+	{
+		sad = __USADA8(*(const uint32_t *)cur, *(const uint32_t *)prev, sad);
+		cur += stride;
+		prev += stride;
+	}
+	return sad;
+}
+
+#define luma_yuv422    luma_yuv422_dsp
+#define block_sad      block_sad_dsp
+#else
+#define luma_yuv422    luma_yuv422_ref
+#define block_sad      block_sad_ref
+#endif
+
+//--------------------------------------------
+static void set_changed(uint16_t bx, uint16_t by)
+{
+	uint32_t block = (uint32_t)by * blocks_x + bx;
+
+	motion_map[block / 32] |= 1UL << (block % 32);
+	if (!changed_blocks++)
+	{
+		roi_x1 = roi_x2 = bx;
+		roi_y1 = roi_y2 = by;
+		return;
+	}
+	if (bx < roi_x1)
+	{
+		roi_x1 = bx;
+	}
+	if (bx > roi_x2)
+	{
+		roi_x2 = bx;
+	}
+	// the blocks are processed row by row
+	roi_y2 = by;
+}
+
+//--------------------------------------------
+void img_motion_init(uint8_t *buf, uint16_t width, uint16_t height, uint8_t format, uint8_t threshold)
+{
+	luma_width = width / IMG_MOTION_SCALE;
+	luma_height = (height + IMG_MOTION_SCALE - 1) / IMG_MOTION_SCALE;
+	luma_cur = buf;
+	luma_prev = buf + IMG_MOTION_LUMA_SIZE(width, height);
+	motion_map = (uint32_t *)(buf + IMG_MOTION_LUMA_SIZE(width, height) * 2);
+	frame_width = width;
+	frame_height = height;
+	blocks_x = width / IMG_MOTION_TILE;
+	blocks_y = (height + IMG_MOTION_TILE - 1) / IMG_MOTION_TILE;
+	motion_format = format;
+	motion_threshold = threshold;
+	img_motion_reset();
+}
+
+//--------------------------------------------
+void img_motion_reset(void)
+{
+	motion_valid = 0;
+}
+
+//--------------------------------------------
+uint16_t img_motion_process(const uint8_t *frame)
+{
+	uint8_t *luma;
+	uint32_t threshold;
+	uint16_t bx, by;
+	uint16_t row;
+	uint8_t rows;
+
+	// the luma image of the previous frame becomes the reference one
+	luma = luma_prev;
+	luma_prev = luma_cur;
+	luma_cur = luma;
+	for (row = 0; row < luma_height; row++)
+	{
+		if (motion_format == IMG_MOTION_FORMAT_YUV422)
+		{
+			luma_yuv422(frame, luma, frame_width);
+		}
+		else
+		{
+			luma_rgb565_ref((const uint16_t *)frame, luma, frame_width);
+		}
+		frame += (uint32_t)frame_width * 2 * IMG_MOTION_SCALE;
+		luma += luma_width;
+	}
+
+	memset(motion_map, 0, (IMG_MOTION_BLOCKS(frame_width, frame_height) + 31) / 32 * 4);
+	changed_blocks = 0;
+	for (by = 0; by < blocks_y; by++)
+	{
+		// the bottom blocks may have less rows
+		rows = (luma_height - by * IMG_MOTION_BLOCK < IMG_MOTION_BLOCK) ? luma_height - by * IMG_MOTION_BLOCK : IMG_MOTION_BLOCK;
+		threshold = (uint32_t)motion_threshold * rows * IMG_MOTION_BLOCK;
+		for (bx = 0; bx < blocks_x; bx++)
+		{
+			row = by * IMG_MOTION_BLOCK;
+			if (!motion_valid ||
+				block_sad(luma_cur + (uint32_t)row * luma_width + bx * IMG_MOTION_BLOCK,
+				          luma_prev + (uint32_t)row * luma_width + bx * IMG_MOTION_BLOCK, luma_width, rows) > threshold)
+			{
+				set_changed(bx, by);
+			}
+		}
+	}
+	motion_valid = 1;
+	return changed_blocks;
+}
+
+//--------------------------------------------
+uint8_t img_motion_get_score(void)
+{
+	return (uint8_t)((uint32_t)changed_blocks * 100 / ((uint32_t)blocks_x * blocks_y));
+}
+
+//--------------------------------------------
+const uint32_t *img_motion_get_map(uint16_t *bx, uint16_t *by)
+{
+	*bx = blocks_x;
+	*by = blocks_y;
+	return motion_map;
+}
+
+//--------------------------------------------
+uint8_t img_motion_is_changed(uint16_t x, uint16_t y)
+{
+	uint32_t block = (uint32_t)(y / IMG_MOTION_TILE) * blocks_x + x / IMG_MOTION_TILE;
+
+	return (motion_map[block / 32] >> (block % 32)) & 1;
+}
+
+//--------------------------------------------
+uint8_t img_motion_get_roi(uint16_t *x, uint16_t *y, uint16_t *width, uint16_t *height)
+{
+	uint16_t y2;
+
+	if (!changed_blocks)
+	{
+		return 0;
+	}
+	*x = roi_x1 * IMG_MOTION_TILE;
+	*y = roi_y1 * IMG_MOTION_TILE;
+	*width = (roi_x2 + 1) * IMG_MOTION_TILE - *x;
+	// the bottom tiles may have less rows
+	y2 = (roi_y2 + 1) * IMG_MOTION_TILE;
+	*height = ((y2 > frame_height) ? frame_height : y2) - *y;
+	return 1;
+}
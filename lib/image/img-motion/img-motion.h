@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef IMG_MOTION_H_
+#define IMG_MOTION_H_
+
+//--------------------------------------------
+// Motion (change) detection on the uncompressed frames:
+// the frame is downscaled to the luma image (every sample is the average luma
+// of IMG_MOTION_SCALE pixels of every IMG_MOTION_SCALE-th row),
+// the luma image is divided into the blocks of IMG_MOTION_BLOCK x IMG_MOTION_BLOCK samples
+// (the tiles of IMG_MOTION_TILE x IMG_MOTION_TILE pixels of the frame)
+// and the sum of absolute differences (SAD) between every block and the same block
+// of the previous frame is calculated. The block is changed if its mean
+// absolute difference exceeds the threshold.
+// The result is the bitmap of the changed blocks, the motion score and
+// the bounding rectangle of the changed tiles, so the consumer can skip
+// the unchanged frames or update the changed region only.
+// The SAD and the YUV422 downscaling use the Cortex-M4/M7 DSP (SIMD) instructions
+// when __ARM_FEATURE_DSP is defined, the results are the same as of the C code.
+// The functions are not reentrant.
+// The host test (test/, make test) checks the threshold logic with the synthetic frames.
+//
+// static uint32_t motion_buf[IMG_MOTION_BUF_SIZE(320, 240) / sizeof(uint32_t)];
+// img_motion_init((uint8_t *)motion_buf, 320, 240, IMG_MOTION_FORMAT_YUV422, 8);
+// if (img_motion_process(frame) && img_motion_get_roi(&x, &y, &width, &height))
+// {
+//     ...
+// }
+
+// The same values as IMGSENSOR_FORMAT_RGB565 and IMGSENSOR_FORMAT_YUV422,
+// RGB565 is the CPU byte order, YUV422 is the YUYV byte order
+#define IMG_MOTION_FORMAT_RGB565     0
+#define IMG_MOTION_FORMAT_YUV422     1
+
+#define IMG_MOTION_SCALE             4
+#define IMG_MOTION_BLOCK             4
+#define IMG_MOTION_TILE              (IMG_MOTION_SCALE * IMG_MOTION_BLOCK)
+
+#define IMG_MOTION_LUMA_SIZE(width, height) \
+	((uint32_t)(width) / IMG_MOTION_SCALE * (((uint32_t)(height) + IMG_MOTION_SCALE - 1) / IMG_MOTION_SCALE))
+#define IMG_MOTION_BLOCKS(width, height) \
+	((uint32_t)(width) / IMG_MOTION_TILE * (((uint32_t)(height) + IMG_MOTION_TILE - 1) / IMG_MOTION_TILE))
+// Two luma images and the bitmap of the changed blocks
+#define IMG_MOTION_BUF_SIZE(width, height) \
+	(IMG_MOTION_LUMA_SIZE(width, height) * 2 + (IMG_MOTION_BLOCKS(width, height) + 31) / 32 * 4)
+
+// buf: IMG_MOTION_BUF_SIZE(width, height) bytes, 4 byte aligned
+// width: a multiple of IMG_MOTION_TILE
+// threshold: the mean absolute luma difference of the changed block
+void img_motion_init(uint8_t *buf, uint16_t width, uint16_t height, uint8_t format, uint8_t threshold);
+// All the blocks of the next frame are changed
+void img_motion_reset(void);
+// frame: 4 byte aligned
+// Returns the number of the changed blocks
+uint16_t img_motion_process(const uint8_t *frame);
+// Returns the changed blocks in percent of all the blocks
+uint8_t img_motion_get_score(void);
+// Returns the bitmap of the changed blocks (row by row, bit 0 of the first word is the top left block)
+const uint32_t *img_motion_get_map(uint16_t *blocks_x, uint16_t *blocks_y);
+// x, y: the frame pixel
+uint8_t img_motion_is_changed(uint16_t x, uint16_t y);
+// The bounding rectangle of the changed tiles in the frame pixels,
+// returns 0 if there is no changed tile
+uint8_t img_motion_get_roi(uint16_t *x, uint16_t *y, uint16_t *width, uint16_t *height);
+
+#endif // IMG_MOTION_H_
@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host test of the motion detection threshold logic with the synthetic frames
+// (a textured gray background) in both formats:
+// - the first frame after init is changed entirely, a static frame is not changed,
+// - a global brightness change below the threshold is not a change,
+//   above the threshold every block is changed,
+// - a moving bright square changes exactly the tiles it has left and entered.
+// Exit status 1 if any check fails.
+
+#include <stdio.h>
+#include "platform.h"
+#include "img-motion.h"
+
+//--------------------------------------------
+#define WIDTH           320
+#define HEIGHT          240
+#define THRESHOLD       8
+#define BLOCKS_X        (WIDTH / IMG_MOTION_TILE)
+#define BLOCKS_Y        (HEIGHT / IMG_MOTION_TILE)
+// The square of 3 x 3 tiles, moved by 2 tiles to the right
+#define SQUARE_SIZE     (3 * IMG_MOTION_TILE)
+#define SQUARE_X        (3 * IMG_MOTION_TILE)
+#define SQUARE_Y        (4 * IMG_MOTION_TILE)
+#define SQUARE_MOVE     (2 * IMG_MOTION_TILE)
+#define SQUARE_LUMA     100
+
+//--------------------------------------------
+static uint32_t motion_buf[IMG_MOTION_BUF_SIZE(WIDTH, HEIGHT) / sizeof(uint32_t)];
+static uint32_t frame[WIDTH * HEIGHT * 2 / sizeof(uint32_t)];
+static int failed;
+
+//--------------------------------------------
+static void check(int ok, const char *format_name, const char *name)
+{
+	printf("%s: %s: %s\n", ok ? "ok  " : "FAIL", format_name, name);
+	if (!ok)
+	{
+		failed++;
+	}
+}
+
+//--------------------------------------------
+// brightness: added to the background luma,
+// square_x: the left edge of the bright square, -1 - no square
+static void make_frame(uint8_t format, int16_t brightness, int16_t square_x)
+{
+	uint8_t *yuv = (uint8_t *)frame;
+	uint16_t *rgb = (uint16_t *)frame;
+	uint16_t x, y;
+	uint8_t luma;
+
+	for (y = 0; y < HEIGHT; y++)
+	{
+		for (x = 0; x < WIDTH; x++)
+		{
+			luma = (uint8_t)(64 + (x * 7 + y * 13) % 64 + brightness);
+			if (square_x >= 0 && x >= square_x && x < square_x + SQUARE_SIZE && y >= SQUARE_Y && y < SQUARE_Y + SQUARE_SIZE)
+			{
+				luma += SQUARE_LUMA;
+			}
+			if (format == IMG_MOTION_FORMAT_YUV422)
+			{
+				// Y0 U Y1 V
+				yuv[((uint32_t)y * WIDTH + x) * 2] = luma;
+				yuv[((uint32_t)y * WIDTH + x) * 2 + 1] = 128;
+			}
+			else
+			{
+				rgb[(uint32_t)y * WIDTH + x] = (uint16_t)(((luma >> 3) << 11) | ((luma >> 2) << 5) | (luma >> 3));
+			}
+		}
+	}
+}
+
+//--------------------------------------------
+// Returns 1 if the tile is left or entered by the square
+static uint8_t square_tile(uint16_t bx, uint16_t by)
+{
+	uint16_t x = bx * IMG_MOTION_TILE;
+	uint16_t y = by * IMG_MOTION_TILE;
+	uint8_t before, after;
+
+	if (y < SQUARE_Y || y >= SQUARE_Y + SQUARE_SIZE)
+	{
+		return 0;
+	}
+	before = (x >= SQUARE_X && x < SQUARE_X + SQUARE_SIZE);
+	after = (x >= SQUARE_X + SQUARE_MOVE && x < SQUARE_X + SQUARE_MOVE + SQUARE_SIZE);
+	return before != after;
+}
+
+//--------------------------------------------
+static void test_format(uint8_t format, const char *format_name)
+{
+	uint16_t changed, expected;
+	uint16_t bx, by;
+	uint16_t x, y, width, height;
+	uint8_t match;
+
+	img_motion_init((uint8_t *)motion_buf, WIDTH, HEIGHT, format, THRESHOLD);
+
+	make_frame(format, 0, -1);
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == BLOCKS_X * BLOCKS_Y && img_motion_get_score() == 100, format_name, "the first frame is changed entirely");
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == 0 && !img_motion_get_roi(&x, &y, &width, &height), format_name, "a static frame is not changed");
+
+	make_frame(format, THRESHOLD / 2, -1);
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == 0, format_name, "the brightness change below the threshold is not a change");
+	make_frame(format, THRESHOLD * 3, -1);
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == BLOCKS_X * BLOCKS_Y && img_motion_get_roi(&x, &y, &width, &height) &&
+		x == 0 && y == 0 && width == WIDTH && height == HEIGHT, format_name, "the brightness change above the threshold changes every block");
+
+	make_frame(format, 0, SQUARE_X);
+	img_motion_process((const uint8_t *)frame);
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == 0, format_name, "a static square is not changed");
+	make_frame(format, 0, SQUARE_X + SQUARE_MOVE);
+	changed = img_motion_process((const uint8_t *)frame);
+	for (match = 1, expected = 0, by = 0; by < BLOCKS_Y; by++)
+	{
+		for (bx = 0; bx < BLOCKS_X; bx++)
+		{
+			expected += square_tile(bx, by);
+			if (img_motion_is_changed(bx * IMG_MOTION_TILE, by * IMG_MOTION_TILE) != square_tile(bx, by))
+			{
+				match = 0;
+			}
+		}
+	}
+	printf("      %s: moving square: %u blocks changed, score %u%%\n", format_name, changed, img_motion_get_score());
+	check(match && changed == expected, format_name, "the moving square changes the tiles it has left and entered");
+	check(img_motion_get_roi(&x, &y, &width, &height) &&
+		x == SQUARE_X && y == SQUARE_Y && width == SQUARE_SIZE + SQUARE_MOVE && height == SQUARE_SIZE,
+		format_name, "the ROI is the bounding rectangle of both squares");
+
+	img_motion_reset();
+	changed = img_motion_process((const uint8_t *)frame);
+	check(changed == BLOCKS_X * BLOCKS_Y, format_name, "the frame after reset is changed entirely");
+}
+
+//--------------------------------------------
+int main(void)
+{
+	test_format(IMG_MOTION_FORMAT_YUV422, "YUV422");
+	test_format(IMG_MOTION_FORMAT_RGB565, "RGB565");
+	printf("%s: %d checks failed\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
@@ -15,14 +15,17 @@
 #include "platform.h"
 #include "scr.h"
 #include "color-scr-drv.h"
+#include "cfont.h"
 #include <string.h>
 
 extern const color_scr_drv_t scr_drv;
 static scr_orient_t scr_orient = SCR_ORIENT_0;
+static color_scr_mode_t scr_mode = RGB565;
 
 //--------------------------------------------
 void color_scr_init(color_scr_mode_t mode)
 {
+	scr_mode = mode;
 	scr_drv.init(mode);
 }
 
@@ -184,3 +187,132 @@ void color_scr_printstring(const char *st, uint16_t x, uint16_t y, uint32_t char
 		color_scr_printchar(*st++, x + cnt * x_size, y, char_color, back_color, font);
 	}
 }
+
+//--------------------------------------------
+static uint32_t blend_channel(uint32_t fg, uint32_t bg, uint32_t mask, uint8_t alpha)
+{
+	return (((fg & mask) * alpha + (bg & mask) * (255 - alpha)) / 255) & mask;
+}
+
+//--------------------------------------------
+static uint32_t blend_color(uint32_t fg, uint32_t bg, uint8_t alpha)
+{
+	if (alpha == 255)
+	{
+		return fg;
+	}
+	if (alpha == 0)
+	{
+		return bg;
+	}
+	switch (scr_mode)
+	{
+	case RGB444:
+		return blend_channel(fg, bg, 0xF00, alpha) | blend_channel(fg, bg, 0x0F0, alpha) | blend_channel(fg, bg, 0x00F, alpha);
+	case RGB666:
+		return blend_channel(fg, bg, 0x3F000, alpha) | blend_channel(fg, bg, 0x00FC0, alpha) | blend_channel(fg, bg, 0x0003F, alpha);
+	default:
+		return blend_channel(fg, bg, 0xF800, alpha) | blend_channel(fg, bg, 0x07E0, alpha) | blend_channel(fg, bg, 0x001F, alpha);
+	}
+}
+
+//--------------------------------------------
+// The whole character cell (advance x line height) is written in one pass,
+// antialiased pixels are blended with the background color
+static uint16_t printglyph_cfont(uint8_t ch, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, const cfont_t *font, const cfont_info_t *info)
+{
+	cfont_glyph_t glyph;
+	cfont_decoder_t dec;
+	uint16_t cell_width;
+	uint16_t col;
+	uint8_t row;
+	int16_t gx;
+	int16_t gy;
+	uint32_t color;
+
+	if (cfont_get_glyph(font, info, ch, &glyph) != CFONT_SUCCESS)
+	{
+		return 0;
+	}
+
+	cell_width = glyph.advance;
+	if (glyph.xofs + glyph.width > cell_width)
+	{
+		cell_width = glyph.xofs + glyph.width;
+	}
+	if (!cell_width || !info->height)
+	{
+		return glyph.advance;
+	}
+
+	scr_drv.set_bound_rect(x, y, x + cell_width - 1, y + info->height - 1);
+	scr_drv.start_memory_write();
+
+	cfont_decode_init(&dec, font, info, &glyph);
+	// the glyph rows above the line are not drawn
+	if (glyph.yofs < 0)
+	{
+		cfont_decode_skip(&dec, (uint16_t)(-glyph.yofs) * glyph.width);
+	}
+
+	for (row = 0; row < info->height; row++)
+	{
+		gy = row - glyph.yofs;
+		if ((gy < 0) || (gy >= glyph.height))
+		{
+			for (col = 0; col < cell_width; col++)
+			{
+				scr_drv.memory_write(back_color);
+			}
+			continue;
+		}
+		// the glyph columns to the left of the pen position are not drawn
+		if (glyph.xofs < 0)
+		{
+			cfont_decode_skip(&dec, -glyph.xofs);
+		}
+		for (col = 0; col < cell_width; col++)
+		{
+			gx = col - glyph.xofs;
+			if ((gx < 0) || (gx >= glyph.width))
+			{
+				color = back_color;
+			}
+			else
+			{
+				color = blend_color(char_color, back_color, cfont_decode_alpha(&dec));
+			}
+			scr_drv.memory_write(color);
+		}
+	}
+
+	scr_drv.stop_memory_write();
+	return glyph.advance;
+}
+
+//--------------------------------------------
+void color_scr_printchar_cfont(uint8_t ch, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, const cfont_t *font)
+{
+	cfont_info_t info;
+
+	if (cfont_get_info(font, &info) != CFONT_SUCCESS)
+	{
+		return;
+	}
+	printglyph_cfont(ch, x, y, char_color, back_color, font, &info);
+}
+
+//--------------------------------------------
+void color_scr_printstring_cfont(const char *st, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, const cfont_t *font)
+{
+	cfont_info_t info;
+
+	if (cfont_get_info(font, &info) != CFONT_SUCCESS)
+	{
+		return;
+	}
+	while (*st)
+	{
+		x += printglyph_cfont(*st++, x, y, char_color, back_color, font, &info);
+	}
+}
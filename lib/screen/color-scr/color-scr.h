@@ -15,6 +15,8 @@
 #ifndef COLOR_SCR_H_
 #define COLOR_SCR_H_
 
+#include "cfont.h"
+
 void color_scr_init(color_scr_mode_t mode);
 void color_scr_setorientation(scr_orient_t orientation);
 scr_orient_t color_scr_getorientation(void);
@@ -28,5 +30,7 @@ void color_scr_fillrect(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint
 void color_scr_fillscreen(uint32_t color);
 void color_scr_printchar(uint8_t ch, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, FLASH_MEMORY_DECLARE(uint8_t, *font));
 void color_scr_printstring(const char *st, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, FLASH_MEMORY_DECLARE(uint8_t, *font));
+void color_scr_printchar_cfont(uint8_t ch, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, const cfont_t *font);
+void color_scr_printstring_cfont(const char *st, uint16_t x, uint16_t y, uint32_t char_color, uint32_t back_color, const cfont_t *font);
 
 #endif // COLOR_SCR_H_
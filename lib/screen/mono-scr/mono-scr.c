@@ -15,23 +15,89 @@
 #include "platform.h"
 #include "scr.h"
 #include "mono-scr-drv.h"
+#include "cfont.h"
 #include <string.h>
 
+#define MONO_SCR_PAGES_MAX    8
+
 extern const mono_scr_drv_t scr_drv;
 static scr_orient_t scr_orientation = SCR_ORIENT_0;
 static uint8_t *scr_buf;
 
+// Changed columns of every page since the last flush,
+// the page is clean when the first column is greater than the last one
+static uint8_t dirty_first[MONO_SCR_PAGES_MAX];
+static uint8_t dirty_last[MONO_SCR_PAGES_MAX];
+
+//--------------------------------------------
+static void mark_dirty(uint8_t page, uint8_t col_first, uint8_t col_last)
+{
+	if (col_first < dirty_first[page])
+	{
+		dirty_first[page] = col_first;
+	}
+	if (col_last > dirty_last[page])
+	{
+		dirty_last[page] = col_last;
+	}
+}
+
+//--------------------------------------------
+void mono_scr_invalidate(void)
+{
+	uint8_t page;
+
+	for (page = 0; page < scr_drv.height / 8; page++)
+	{
+		dirty_first[page] = 0;
+		dirty_last[page] = scr_drv.width - 1;
+	}
+}
+
 //--------------------------------------------
 void mono_scr_init(void)
 {
 	scr_drv.init();
 	scr_buf = scr_drv.buf();
+	mono_scr_invalidate();
 }
 
 //--------------------------------------------
+// Only the changed columns are sent to the display.
+// Adjacent dirty pages are sent as one window covering
+// the union of their column ranges.
 void mono_scr_flush(void)
 {
-	scr_drv.flush();
+	uint8_t page;
+	uint8_t page_first;
+	uint8_t col_first;
+	uint8_t col_last;
+
+	for (page = 0; page < scr_drv.height / 8;)
+	{
+		if (dirty_first[page] > dirty_last[page])
+		{
+			page++;
+			continue;
+		}
+		page_first = page;
+		col_first = dirty_first[page];
+		col_last = dirty_last[page];
+		for (; (page < scr_drv.height / 8) && (dirty_first[page] <= dirty_last[page]); page++)
+		{
+			if (dirty_first[page] < col_first)
+			{
+				col_first = dirty_first[page];
+			}
+			if (dirty_last[page] > col_last)
+			{
+				col_last = dirty_last[page];
+			}
+			dirty_first[page] = 0xFF;
+			dirty_last[page] = 0;
+		}
+		scr_drv.flush_area(col_first, col_last, page_first, page - 1);
+	}
 }
 
 //--------------------------------------------
@@ -64,13 +130,15 @@ void mono_scr_drawpixel(uint8_t x, uint8_t y, mono_scr_color_t color)
 		break;
 	}
 
-	offset = x + (y / 8) * scr_drv.width;
-
-	if (offset >= scr_drv.height * scr_drv.width / 8)
+	if ((x >= scr_drv.width) || (y >= scr_drv.height))
 	{
 		return;
 	}
 
+	offset = x + (y / 8) * scr_drv.width;
+
+	mark_dirty(y / 8, x, x);
+
 	switch (color)
 	{
 	case MONO_SCR_PSET:
@@ -95,6 +163,273 @@ void mono_scr_fillscreen(mono_scr_color_t color)
 		pattern = 0xFF;
 	}
 	memset(scr_buf, pattern, (scr_drv.height * scr_drv.width) / 8);
+	mono_scr_invalidate();
+}
+
+//--------------------------------------------
+// Fill the rectangle in the screen buffer coordinates:
+// every buffer byte covers 8 rows of a column (a page),
+// so the rectangle is filled by a byte mask per column of each page
+static void fill_buf_rect(int16_t bx, int16_t by, int16_t bw, int16_t bh, mono_scr_color_t color)
+{
+	uint8_t *ptr;
+	uint8_t page;
+	uint8_t last_page;
+	uint8_t mask;
+	int16_t cnt;
+
+	if (bx < 0)
+	{
+		bw += bx;
+		bx = 0;
+	}
+	if (by < 0)
+	{
+		bh += by;
+		by = 0;
+	}
+	if (bx + bw > scr_drv.width)
+	{
+		bw = scr_drv.width - bx;
+	}
+	if (by + bh > scr_drv.height)
+	{
+		bh = scr_drv.height - by;
+	}
+	if ((bw <= 0) || (bh <= 0))
+	{
+		return;
+	}
+
+	last_page = (uint8_t)((by + bh - 1) / 8);
+	for (page = (uint8_t)(by / 8); page <= last_page; page++)
+	{
+		mask = 0xFF;
+		if (page == by / 8)
+		{
+			mask &= 0xFF << (by & 0x07);
+		}
+		if (page == last_page)
+		{
+			mask &= 0xFF >> (7 - ((by + bh - 1) & 0x07));
+		}
+		mark_dirty(page, (uint8_t)bx, (uint8_t)(bx + bw - 1));
+		ptr = &scr_buf[page * scr_drv.width + bx];
+		if (mask == 0xFF)
+		{
+			memset(ptr, color == MONO_SCR_PSET ? 0xFF : 0x00, bw);
+		}
+		else if (color == MONO_SCR_PSET)
+		{
+			for (cnt = bw; cnt; cnt--)
+			{
+				*ptr++ |= mask;
+			}
+		}
+		else
+		{
+			for (cnt = bw; cnt; cnt--)
+			{
+				*ptr++ &= ~mask;
+			}
+		}
+	}
+}
+
+//--------------------------------------------
+// The orientation transformation is done once for the whole rectangle
+static void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, mono_scr_color_t color)
+{
+	switch (scr_orientation)
+	{
+	case SCR_ORIENT_90:
+		fill_buf_rect(scr_drv.width - y - h, x, h, w, color);
+		break;
+	case SCR_ORIENT_180:
+		fill_buf_rect(scr_drv.width - x - w, scr_drv.height - y - h, w, h, color);
+		break;
+	case SCR_ORIENT_270:
+		fill_buf_rect(y, scr_drv.height - x - w, h, w, color);
+		break;
+	default:
+		fill_buf_rect(x, y, w, h, color);
+		break;
+	}
+}
+
+//--------------------------------------------
+void mono_scr_drawhline(uint8_t x, uint8_t y, uint8_t len, mono_scr_color_t color)
+{
+	fill_rect(x, y, len, 1, color);
+}
+
+//--------------------------------------------
+void mono_scr_drawvline(uint8_t x, uint8_t y, uint8_t len, mono_scr_color_t color)
+{
+	fill_rect(x, y, 1, len, color);
+}
+
+//--------------------------------------------
+void mono_scr_fillrect(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, mono_scr_color_t color)
+{
+	fill_rect(x1, y1, (int16_t)x2 - x1, (int16_t)y2 - y1, color);
+}
+
+//--------------------------------------------
+// Write up to 8 vertical pixels to the buffer column bx starting from the row by,
+// bit 0 of the value is the top pixel.
+// A page aligned write of 8 pixels is a single byte write.
+static void put_buf_vbits(int16_t bx, int16_t by, uint8_t bits, uint8_t count, mono_scr_color_t color)
+{
+	uint16_t mask;
+	uint16_t value;
+	uint16_t offset;
+
+	if ((bx < 0) || (bx >= scr_drv.width))
+	{
+		return;
+	}
+	mask = (1 << count) - 1;
+	value = (color == MONO_SCR_PSET) ? bits : (uint8_t)~bits;
+	if (by < 0)
+	{
+		if (by <= -count)
+		{
+			return;
+		}
+		mask >>= -by;
+		value >>= -by;
+		by = 0;
+	}
+	if (by + count > scr_drv.height)
+	{
+		if (by >= scr_drv.height)
+		{
+			return;
+		}
+		mask &= (1 << (scr_drv.height - by)) - 1;
+	}
+	value &= mask;
+
+	mask <<= by & 0x07;
+	value <<= by & 0x07;
+	offset = bx + (by / 8) * scr_drv.width;
+	scr_buf[offset] = (scr_buf[offset] & ~(uint8_t)mask) | (uint8_t)value;
+	mark_dirty(by / 8, (uint8_t)bx, (uint8_t)bx);
+	if (mask >> 8)
+	{
+		mark_dirty(by / 8 + 1, (uint8_t)bx, (uint8_t)bx);
+		offset += scr_drv.width;
+		scr_buf[offset] = (scr_buf[offset] & ~(uint8_t)(mask >> 8)) | (uint8_t)(value >> 8);
+	}
+}
+
+//--------------------------------------------
+// Write up to 8 horizontal pixels to the buffer row by starting from the column bx,
+// bit 0 of the value is the leftmost pixel (dir = 1) or the rightmost pixel (dir = -1)
+static void put_buf_hbits(int16_t bx, int16_t by, int8_t dir, uint8_t bits, uint8_t count, mono_scr_color_t color)
+{
+	uint8_t *ptr;
+	uint8_t mask;
+	int16_t col_first;
+	int16_t col_last;
+
+	if ((by < 0) || (by >= scr_drv.height))
+	{
+		return;
+	}
+	col_first = (dir > 0) ? bx : bx - count + 1;
+	col_last = col_first + count - 1;
+	if (col_first < 0)
+	{
+		col_first = 0;
+	}
+	if (col_last >= scr_drv.width)
+	{
+		col_last = scr_drv.width - 1;
+	}
+	if (col_first > col_last)
+	{
+		return;
+	}
+	mark_dirty(by / 8, (uint8_t)col_first, (uint8_t)col_last);
+	if (color != MONO_SCR_PSET)
+	{
+		bits = ~bits;
+	}
+	mask = 1 << (by & 0x07);
+	ptr = &scr_buf[(by / 8) * scr_drv.width];
+	for (; count; count--, bits >>= 1, bx += dir)
+	{
+		if ((bx < 0) || (bx >= scr_drv.width))
+		{
+			continue;
+		}
+		if (bits & 0x01)
+		{
+			ptr[bx] |= mask;
+		}
+		else
+		{
+			ptr[bx] &= ~mask;
+		}
+	}
+}
+
+//--------------------------------------------
+static uint8_t reverse_bits(uint8_t bits)
+{
+	bits = (bits & 0xF0) >> 4 | (bits & 0x0F) << 4;
+	bits = (bits & 0xCC) >> 2 | (bits & 0x33) << 2;
+	bits = (bits & 0xAA) >> 1 | (bits & 0x55) << 1;
+	return bits;
+}
+
+//--------------------------------------------
+// Opaque 1bpp bitmap: row-major, LSB first (fonts.c format)
+// The rows of the bitmap are vertical in the screen buffer
+// for 90 and 270 orientations, so 8 pixels are written at once
+void mono_scr_drawbitmap(uint8_t x, uint8_t y, uint8_t width, uint8_t height, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *bitmap))
+{
+	uint8_t byte_width;
+	uint8_t row;
+	uint8_t col_byte;
+	uint8_t count;
+	uint8_t bits;
+	int16_t lx;
+	int16_t ly;
+
+	byte_width = (width % 8) ? (width / 8) + 1 : (width / 8);
+
+	for (row = 0; row < height; row++)
+	{
+		ly = y + row;
+		for (col_byte = 0; col_byte < byte_width; col_byte++)
+		{
+			bits = FLASH_MEMORY_READ_BYTE(bitmap++);
+			lx = x + col_byte * 8;
+			count = width - col_byte * 8;
+			if (count > 8)
+			{
+				count = 8;
+			}
+			switch (scr_orientation)
+			{
+			case SCR_ORIENT_90:
+				put_buf_vbits(scr_drv.width - ly - 1, lx, bits, count, color);
+				break;
+			case SCR_ORIENT_180:
+				put_buf_hbits(scr_drv.width - lx - 1, scr_drv.height - ly - 1, -1, bits, count, color);
+				break;
+			case SCR_ORIENT_270:
+				put_buf_vbits(ly, scr_drv.height - lx - count, reverse_bits(bits) >> (8 - count), count, color);
+				break;
+			default:
+				put_buf_hbits(lx, ly, 1, bits, count, color);
+				break;
+			}
+		}
+	}
 }
 
 //--------------------------------------------
@@ -105,12 +440,7 @@ void mono_scr_printchar(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color
 	uint8_t ch_pix_height;
 	uint8_t ch_from;
 	uint8_t ch_to;
-	uint8_t ch_col_byte_cnt;
-	uint8_t ch_col_bit_cnt;
-	uint8_t ch_row_cnt;
 	uint16_t ch_offset;
-	uint8_t ch_byte;
-	uint8_t x_beg;
 
 	ch_pix_width = FLASH_MEMORY_READ_BYTE(font++);
 	ch_pix_height = FLASH_MEMORY_READ_BYTE(font++);
@@ -125,28 +455,7 @@ void mono_scr_printchar(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color
 	ch_byte_width = (ch_pix_width % 8) ? (ch_pix_width / 8) + 1 : (ch_pix_width / 8);
 	ch_offset = (ch_byte_width * ch_pix_height) * (ch - ch_from);
 
-	font += ch_offset;
-
-	for (ch_row_cnt = 0; ch_row_cnt < ch_pix_height; ch_row_cnt++, y++)
-	{
-		for (ch_col_byte_cnt = 0, x_beg = x; ch_col_byte_cnt < ch_byte_width; ch_col_byte_cnt++, font++)
-		{
-			ch_byte = FLASH_MEMORY_READ_BYTE(font);
-			for (ch_col_bit_cnt = 0;
-				(ch_col_bit_cnt < 8) && (ch_col_bit_cnt < (ch_pix_width - ch_col_byte_cnt * 8));
-				ch_col_bit_cnt++, x_beg++, ch_byte >>= 1)
-			{
-				if (ch_byte & 0x01)
-				{
-					mono_scr_drawpixel(x_beg, y, color);
-				}
-				else
-				{
-					mono_scr_drawpixel(x_beg, y, color == MONO_SCR_PSET ? MONO_SCR_PRES : MONO_SCR_PSET);
-				}
-			}
-		}
-	}
+	mono_scr_drawbitmap(x, y, ch_pix_width, ch_pix_height, color, font + ch_offset);
 }
 
 //--------------------------------------------
@@ -164,3 +473,85 @@ void mono_scr_printstring(const char *st, uint8_t x, uint8_t y, mono_scr_color_t
 		mono_scr_printchar(*st++, x + cnt * x_size, y, color, font);
 	}
 }
+
+//--------------------------------------------
+// Antialiased pixels are drawn if their alpha value is at least 50%
+static uint8_t printglyph_cfont(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color, const cfont_t *font, const cfont_info_t *info)
+{
+	cfont_glyph_t glyph;
+	cfont_decoder_t dec;
+	mono_scr_color_t back_color;
+	uint16_t cell_width;
+	uint16_t col;
+	uint8_t row;
+	int16_t gx;
+	int16_t gy;
+	uint8_t alpha;
+
+	if (cfont_get_glyph(font, info, ch, &glyph) != CFONT_SUCCESS)
+	{
+		return 0;
+	}
+
+	back_color = (color == MONO_SCR_PSET) ? MONO_SCR_PRES : MONO_SCR_PSET;
+	cell_width = glyph.advance;
+	if (glyph.xofs + glyph.width > cell_width)
+	{
+		cell_width = glyph.xofs + glyph.width;
+	}
+
+	cfont_decode_init(&dec, font, info, &glyph);
+	// the glyph rows above the line are not drawn
+	if (glyph.yofs < 0)
+	{
+		cfont_decode_skip(&dec, (uint16_t)(-glyph.yofs) * glyph.width);
+	}
+
+	for (row = 0; row < info->height; row++)
+	{
+		gy = row - glyph.yofs;
+		if ((gy >= 0) && (gy < glyph.height) && (glyph.xofs < 0))
+		{
+			// the glyph columns to the left of the pen position are not drawn
+			cfont_decode_skip(&dec, -glyph.xofs);
+		}
+		for (col = 0; col < cell_width; col++)
+		{
+			gx = col - glyph.xofs;
+			alpha = 0;
+			if ((gy >= 0) && (gy < glyph.height) && (gx >= 0) && (gx < glyph.width))
+			{
+				alpha = cfont_decode_alpha(&dec);
+			}
+			mono_scr_drawpixel(x + col, y + row, (alpha & 0x80) ? color : back_color);
+		}
+	}
+	return glyph.advance;
+}
+
+//--------------------------------------------
+void mono_scr_printchar_cfont(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color, const cfont_t *font)
+{
+	cfont_info_t info;
+
+	if (cfont_get_info(font, &info) != CFONT_SUCCESS)
+	{
+		return;
+	}
+	printglyph_cfont(ch, x, y, color, font, &info);
+}
+
+//--------------------------------------------
+void mono_scr_printstring_cfont(const char *st, uint8_t x, uint8_t y, mono_scr_color_t color, const cfont_t *font)
+{
+	cfont_info_t info;
+
+	if (cfont_get_info(font, &info) != CFONT_SUCCESS)
+	{
+		return;
+	}
+	while (*st)
+	{
+		x += printglyph_cfont(*st++, x, y, color, font, &info);
+	}
+}
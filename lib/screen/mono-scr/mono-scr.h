@@ -14,12 +14,21 @@
 #ifndef MONO_SCR_H_
 #define MONO_SCR_H_
 
+#include "cfont.h"
+
 void mono_scr_init(void);
 void mono_scr_flush(void);
+void mono_scr_invalidate(void);
 void mono_scr_setorientation(scr_orient_t orientation);
 void mono_scr_drawpixel(uint8_t x, uint8_t y, mono_scr_color_t color);
+void mono_scr_drawhline(uint8_t x, uint8_t y, uint8_t len, mono_scr_color_t color);
+void mono_scr_drawvline(uint8_t x, uint8_t y, uint8_t len, mono_scr_color_t color);
+void mono_scr_fillrect(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, mono_scr_color_t color);
 void mono_scr_fillscreen(mono_scr_color_t color);
+void mono_scr_drawbitmap(uint8_t x, uint8_t y, uint8_t width, uint8_t height, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *bitmap));
 void mono_scr_printchar(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *font));
 void mono_scr_printstring(const char *st, uint8_t x, uint8_t y, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *font));
+void mono_scr_printchar_cfont(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color, const cfont_t *font);
+void mono_scr_printstring_cfont(const char *st, uint8_t x, uint8_t y, mono_scr_color_t color, const cfont_t *font);
 
 #endif // MONO_SCR_H_
@@ -0,0 +1,284 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+//--------------------------------------------
+// Host check and benchmark of the mono-scr drawing primitives:
+// every primitive is drawn to the 128 x 64 buffer in all the orientations
+// and compared with the same drawing made pixel by pixel (mono_scr_drawpixel,
+// as the code before the primitives did), then both are timed.
+// Exit status 1 if any drawing differs.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "platform.h"
+#include "scr.h"
+#include "mono-scr-drv.h"
+#include "mono-scr.h"
+#include "fonts.h"
+
+//--------------------------------------------
+#define SCR_WIDTH       128
+#define SCR_HEIGHT      64
+// The time of every measurement, ns
+#define BENCH_TIME      200000000
+
+//--------------------------------------------
+static uint8_t buf[SCR_WIDTH * SCR_HEIGHT / 8];
+static uint8_t ref_buf[SCR_WIDTH * SCR_HEIGHT / 8];
+
+//--------------------------------------------
+static uint8_t *host_buf(void)
+{
+	return buf;
+}
+
+//--------------------------------------------
+static void host_init(void)
+{
+}
+
+//--------------------------------------------
+static void host_flush(void)
+{
+}
+
+//--------------------------------------------
+static void host_flush_area(uint8_t col_first, uint8_t col_last, uint8_t page_first, uint8_t page_last)
+{
+}
+
+//--------------------------------------------
+const mono_scr_drv_t scr_drv =
+{
+	SCR_WIDTH,
+	SCR_HEIGHT,
+	host_buf,
+	host_init,
+	host_flush,
+	host_flush_area,
+};
+
+//--------------------------------------------
+typedef struct op
+{
+	const char *name;
+	void (*draw)(uint8_t width, uint8_t height);
+	void (*draw_ref)(uint8_t width, uint8_t height);
+} op_t;
+
+//--------------------------------------------
+// The pixel by pixel references
+static void ref_fillrect(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, mono_scr_color_t color)
+{
+	uint8_t x, y;
+
+	for (y = y1; y < y2; y++)
+	{
+		for (x = x1; x < x2; x++)
+		{
+			mono_scr_drawpixel(x, y, color);
+		}
+	}
+}
+
+//--------------------------------------------
+static void ref_printchar(uint8_t ch, uint8_t x, uint8_t y, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *font))
+{
+	uint8_t ch_byte_width;
+	uint8_t ch_pix_width;
+	uint8_t ch_pix_height;
+	uint8_t ch_from;
+	uint8_t ch_to;
+	uint8_t ch_col_byte_cnt;
+	uint8_t ch_col_bit_cnt;
+	uint8_t ch_row_cnt;
+	uint8_t ch_byte;
+	uint8_t x_beg;
+
+	ch_pix_width = FLASH_MEMORY_READ_BYTE(font++);
+	ch_pix_height = FLASH_MEMORY_READ_BYTE(font++);
+	ch_from = FLASH_MEMORY_READ_BYTE(font++);
+	ch_to = FLASH_MEMORY_READ_BYTE(font++);
+	if ((ch < ch_from) || (ch > ch_to))
+	{
+		return;
+	}
+	ch_byte_width = (ch_pix_width % 8) ? (ch_pix_width / 8) + 1 : (ch_pix_width / 8);
+	font += (ch_byte_width * ch_pix_height) * (ch - ch_from);
+	for (ch_row_cnt = 0; ch_row_cnt < ch_pix_height; ch_row_cnt++, y++)
+	{
+		for (ch_col_byte_cnt = 0, x_beg = x; ch_col_byte_cnt < ch_byte_width; ch_col_byte_cnt++, font++)
+		{
+			ch_byte = FLASH_MEMORY_READ_BYTE(font);
+			for (ch_col_bit_cnt = 0;
+				(ch_col_bit_cnt < 8) && (ch_col_bit_cnt < (ch_pix_width - ch_col_byte_cnt * 8));
+				ch_col_bit_cnt++, x_beg++, ch_byte >>= 1)
+			{
+				mono_scr_drawpixel(x_beg, y, (ch_byte & 0x01) ? color : (color == MONO_SCR_PSET ? MONO_SCR_PRES : MONO_SCR_PSET));
+			}
+		}
+	}
+}
+
+//--------------------------------------------
+static void ref_printstring(const char *st, uint8_t x, uint8_t y, mono_scr_color_t color, FLASH_MEMORY_DECLARE(uint8_t, *font))
+{
+	uint8_t x_size = FLASH_MEMORY_READ_BYTE(font);
+
+	for (; *st; st++, x += x_size)
+	{
+		ref_printchar(*st, x, y, color, font);
+	}
+}
+
+//--------------------------------------------
+static void fill_screen(uint8_t width, uint8_t height)
+{
+	mono_scr_fillrect(0, 0, width, height, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void fill_screen_ref(uint8_t width, uint8_t height)
+{
+	ref_fillrect(0, 0, width, height, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void fill_rect(uint8_t width, uint8_t height)
+{
+	mono_scr_fillrect(5, 3, width - 9, height - 5, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void fill_rect_ref(uint8_t width, uint8_t height)
+{
+	ref_fillrect(5, 3, width - 9, height - 5, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void lines(uint8_t width, uint8_t height)
+{
+	mono_scr_drawhline(1, 9, width - 2, MONO_SCR_PSET);
+	mono_scr_drawvline(7, 1, height - 2, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void lines_ref(uint8_t width, uint8_t height)
+{
+	ref_fillrect(1, 9, width - 1, 10, MONO_SCR_PSET);
+	ref_fillrect(7, 1, 8, height - 1, MONO_SCR_PSET);
+}
+
+//--------------------------------------------
+static void text_8x8(uint8_t width, uint8_t height)
+{
+	mono_scr_printstring("Hello, 8x8!", 0, 3, MONO_SCR_PSET, font_8x8);
+}
+
+//--------------------------------------------
+static void text_8x8_ref(uint8_t width, uint8_t height)
+{
+	ref_printstring("Hello, 8x8!", 0, 3, MONO_SCR_PSET, font_8x8);
+}
+
+//--------------------------------------------
+static void text_16x26(uint8_t width, uint8_t height)
+{
+	mono_scr_printstring("12:34", 2, 21, MONO_SCR_PSET, font_16x26);
+}
+
+//--------------------------------------------
+static void text_16x26_ref(uint8_t width, uint8_t height)
+{
+	ref_printstring("12:34", 2, 21, MONO_SCR_PSET, font_16x26);
+}
+
+//--------------------------------------------
+static const op_t ops[] =
+{
+	{ "fillrect screen", fill_screen, fill_screen_ref },
+	{ "fillrect unaligned", fill_rect, fill_rect_ref },
+	{ "hline + vline", lines, lines_ref },
+	{ "printstring 8x8", text_8x8, text_8x8_ref },
+	{ "printstring 16x26", text_16x26, text_16x26_ref },
+};
+
+//--------------------------------------------
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//--------------------------------------------
+// Returns the time of one call in ns
+static double bench(void (*draw)(uint8_t width, uint8_t height), uint8_t width, uint8_t height)
+{
+	double start;
+	double elapsed;
+	uint32_t calls = 0;
+
+	start = now_ns();
+	do
+	{
+		draw(width, height);
+		calls++;
+		elapsed = now_ns() - start;
+	} while (elapsed < BENCH_TIME);
+	return elapsed / calls;
+}
+
+//--------------------------------------------
+int main(void)
+{
+	uint8_t orient;
+	uint8_t width;
+	uint8_t height;
+	unsigned int cnt;
+	double time_ref;
+	double time_new;
+	int failed = 0;
+
+	mono_scr_init();
+	printf("%-20s %6s %12s %12s %8s\n", "", "orient", "pixels, ns", "mono-scr, ns", "speedup");
+	for (cnt = 0; cnt < sizeof(ops) / sizeof(ops[0]); cnt++)
+	{
+		for (orient = SCR_ORIENT_0; orient <= SCR_ORIENT_270; orient++)
+		{
+			mono_scr_setorientation((scr_orient_t)orient);
+			width = (orient & 1) ? SCR_HEIGHT : SCR_WIDTH;
+			height = (orient & 1) ? SCR_WIDTH : SCR_HEIGHT;
+
+			memset(buf, 0x5A, sizeof(buf));
+			ops[cnt].draw_ref(width, height);
+			memcpy(ref_buf, buf, sizeof(buf));
+			memset(buf, 0x5A, sizeof(buf));
+			ops[cnt].draw(width, height);
+			if (memcmp(buf, ref_buf, sizeof(buf)))
+			{
+				printf("%-20s %6u: FAIL, the drawing differs\n", ops[cnt].name, orient * 90);
+				failed++;
+				continue;
+			}
+			time_ref = bench(ops[cnt].draw_ref, width, height);
+			time_new = bench(ops[cnt].draw, width, height);
+			printf("%-20s %6u %12.0f %12.0f %7.1fx\n", ops[cnt].name, orient * 90, time_ref, time_new, time_ref / time_new);
+		}
+	}
+	printf("%s: %d drawings differ\n", failed ? "FAIL" : "PASS", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+/*
+* Copyright (c) 2021 Vladimir Alemasov
+* All rights reserved
+*
+* This program and the accompanying materials are distributed under 
+* the terms of GNU General Public License version 2 
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+// Host build of the library: the fonts are in RAM
+#include <stdint.h>
+
+#define FLASH_MEMORY_DECLARE(type, name) type const name
+#define FLASH_MEMORY_READ_BYTE(byte) *(byte)
+
+#endif // PLATFORM_H_
@@ -115,7 +115,13 @@
 
 // Audio Class-Specific Request Codes (ADC-1 Table A-9)
 #define USB_UAC_SET_CUR                                0x01
+#define USB_UAC_SET_MIN                                0x02
+#define USB_UAC_SET_MAX                                0x03
+#define USB_UAC_SET_RES                                0x04
 #define USB_UAC_GET_CUR                                0x81
+#define USB_UAC_GET_MIN                                0x82
+#define USB_UAC_GET_MAX                                0x83
+#define USB_UAC_GET_RES                                0x84
 
 #pragma pack(push, 1)
 
@@ -248,6 +254,12 @@ struct usb_uac_form2_mute_control_parameter_sz3_block
 	uint8_t bMute[3];
 };
 
+// First Form of the Volume Control Parameter Block (ADC-1 Table 5-19)
+struct usb_uac_form1_volume_control_parameter_block
+{
+	uint16_t wVolume;
+};
+
 #pragma pack(pop)
 
 #endif /* USB_UAC_H_ */
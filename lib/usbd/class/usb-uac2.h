@@ -252,6 +252,26 @@ struct usb_uac2_feature_unit_sz3x32_desc
 	uint32_t bmaControls[3];
 	uint8_t iFeature;
 };
+struct usb_uac2_feature_unit_sz5x32_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bUnitID;
+	uint8_t bSourceID;
+	uint32_t bmaControls[5];
+	uint8_t iFeature;
+};
+struct usb_uac2_feature_unit_sz9x32_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bUnitID;
+	uint8_t bSourceID;
+	uint32_t bmaControls[9];
+	uint8_t iFeature;
+};
 
 // Output Terminal Descriptor (ADC-2 Table 4-10)
 struct usb_uac2_output_terminal_desc
@@ -323,6 +343,21 @@ struct usb_uac2_layout_1_CUR_parameter_block
 	uint8_t bCUR;
 };
 
+// 2-byte Control CUR Parameter Block (ADC-2 Table 5-4)
+struct usb_uac2_layout_2_CUR_parameter_block
+{
+	uint16_t wCUR;
+};
+
+// 2-byte Control RANGE Parameter Block (ADC-2 Table 5-5)
+struct usb_uac2_layout_2_RANGE_parameter_sz3x16_block
+{
+	uint16_t wNumSubRanges;
+	uint16_t wMIN;
+	uint16_t wMAX;
+	uint16_t wRES;
+};
+
 // 4-byte Control CUR Parameter Block (ADC-2 Table 5-6)
 struct usb_uac2_layout_3_CUR_parameter_block
 {
@@ -229,6 +229,22 @@ struct usb_uvc_vs_input_header_sz1_desc
 	uint8_t bControlSize;
 	uint8_t bmaControls[1];
 };
+struct usb_uvc_vs_input_header_sz1_fmt2_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bNumFormats;
+	uint16_t wTotalLength;
+	uint8_t bEndpointAddress;
+	uint8_t bmInfo;
+	uint8_t bTerminalLink;
+	uint8_t bStillCaptureMethod;
+	uint8_t bTriggerSupport;
+	uint8_t bTriggerUsage;
+	uint8_t bControlSize;
+	uint8_t bmaControls[2];
+};
 
 // Uncompressed Video Format Descriptor (UP-1 Table 3-1)
 struct usb_uvc_vs_format_uncompressed_desc
@@ -266,6 +282,74 @@ struct usb_uvc_vs_frame_uncompressed_cont_desc
 	uint32_t dwMaxFrameInterval;
 	uint32_t dwFrameIntervalStep;
 };
+struct usb_uvc_vs_frame_uncompressed_disc3_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bFrameIndex;
+	uint8_t bmCapabilities;
+	uint16_t wWidth;
+	uint16_t wHeight;
+	uint32_t dwMinBitRate;
+	uint32_t dwMaxBitRate;
+	uint32_t dwMaxVideoFrameBufferSize;
+	uint32_t dwDefaultFrameInterval;
+	uint8_t bFrameIntervalType;
+	uint32_t dwFrameInterval[3];
+};
+
+// Motion-JPEG Video Format Descriptor (MJPEG-1 Table 3-1)
+struct usb_uvc_vs_format_mjpeg_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bFormatIndex;
+	uint8_t bNumFrameDescriptors;
+	uint8_t bmFlags;
+	uint8_t bDefaultFrameIndex;
+	uint8_t bAspectRatioX;
+	uint8_t bAspectRatioY;
+	uint8_t bmInterlaceFlags;
+	uint8_t bCopyProtect;
+};
+
+// Motion-JPEG Video Frame Descriptors (MJPEG-1 Table 3-2, 3-3)
+struct usb_uvc_vs_frame_mjpeg_cont_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bFrameIndex;
+	uint8_t bmCapabilities;
+	uint16_t wWidth;
+	uint16_t wHeight;
+	uint32_t dwMinBitRate;
+	uint32_t dwMaxBitRate;
+	uint32_t dwMaxVideoFrameBufferSize;
+	uint32_t dwDefaultFrameInterval;
+	uint8_t bFrameIntervalType;
+	uint32_t dwMinFrameInterval;
+	uint32_t dwMaxFrameInterval;
+	uint32_t dwFrameIntervalStep;
+};
+struct usb_uvc_vs_frame_mjpeg_disc3_desc
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bDescriptorSubType;
+	uint8_t bFrameIndex;
+	uint8_t bmCapabilities;
+	uint16_t wWidth;
+	uint16_t wHeight;
+	uint32_t dwMinBitRate;
+	uint32_t dwMaxBitRate;
+	uint32_t dwMaxVideoFrameBufferSize;
+	uint32_t dwDefaultFrameInterval;
+	uint8_t bFrameIntervalType;
+	uint32_t dwFrameInterval[3];
+};
 
 // Color Matching Descriptor (VDC-1 Table 3-18)
 struct usb_uvc_vs_color_matching_desc
@@ -25,6 +25,7 @@
 #include "hal-usbd-init.h"
 #include "usb-uac.h"
 #include "uac-adc-drv.h"
+#include "audio-conv.h"
 
 #ifndef USBD_FULL_SPEED
 #error "UAC 1.0 does not support high speed."
@@ -56,6 +57,14 @@ extern const struct usbd_driver usbd_otghs;
 #define BYTES_PER_AUDIO_SAMPLE          4
 #endif
 #define AUDIO_CHANNELS                  I2S_CHANNELS
+#ifdef I2S_SLOTS
+#define AUDIO_SLOTS                     I2S_SLOTS
+#else
+#define AUDIO_SLOTS                     2
+#endif
+#if AUDIO_CHANNELS != 1 && AUDIO_CHANNELS != 2
+#error "I2S_CHANNELS: 1 or 2 are allowed (UAC 1.0 FS), 4 or 8 channels need UAC 2.0 (HS)."
+#endif
 #define USB_FRAMES_PER_AUDIO_FRAME      1 // bInterval = 1 ms
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000) * USB_FRAMES_PER_AUDIO_FRAME
 #define BYTES_PER_AUDIO_FRAME           (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE)
@@ -331,14 +340,9 @@ static feedback_state_t feedback;
 // Due to use with USB FIFO and/or DMA, the data buffers below must be 32-bit aligned:
 #define USB_CTRL_BUFF_SZ 128
 static uint32_t ubuf[(USB_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
-// I2S controller captures 32-bit samples only
-#define I2S_TO_USB_BUF_LENGTH_RATIO (sizeof(uint32_t) / BYTES_PER_AUDIO_SAMPLE)
-#if AUDIO_CHANNELS == 1
-// I2S controller can't capture one channel only, so the double buffer is needed
-static uint32_t buff_i2s[(MAX_BYTES_PER_AUDIO_FRAME * I2S_TO_USB_BUF_LENGTH_RATIO * 2 + 3) / sizeof(uint32_t)];
-#else
+// I2S controller captures 32-bit samples of all the slots only (it can't capture one channel only)
+#define I2S_TO_USB_BUF_LENGTH_RATIO (sizeof(uint32_t) / BYTES_PER_AUDIO_SAMPLE * AUDIO_SLOTS / AUDIO_CHANNELS)
 static uint32_t buff_i2s[(MAX_BYTES_PER_AUDIO_FRAME * I2S_TO_USB_BUF_LENGTH_RATIO + 3) / sizeof(uint32_t)];
-#endif
 static uint32_t buff_usb[AUDIO_FRAMES_IN_BUFFER][(UAC_DATA_SZ + 3) / sizeof(uint32_t)];
 static uint16_t buff_usb_size[AUDIO_FRAMES_IN_BUFFER];
 // UAC_CTRL_BUFF_SZ must not be less than the UAC control parameter block of the maximum length
@@ -476,11 +480,7 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 					audio.record = true;
 					usbd_ep_write(dev, UAC_TXD_EP, (void *)0, 0);
 					buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
-#if AUDIO_CHANNELS == 1
-					audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO * 2);
-#else
 					audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO);
-#endif
 				}
 			}
 			if (iface_num == 1 && altset_num == 0)
@@ -533,6 +533,42 @@ static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 	}
 }
 
+//--------------------------------------------
+// The I2S samples (all the slots, the DMA order) are converted to the USB samples
+// (the first AUDIO_CHANNELS slots) block by block.
+// The DMA is filling the I2S buffer already, so it is not converted in place.
+#define CONVERT_CHUNK  32
+static void convert_i2s_to_usb(const uint32_t *i2s, uint32_t *usb, uint32_t samples)
+{
+#if BYTES_PER_AUDIO_SAMPLE == 4
+#if AUDIO_CHANNELS < AUDIO_SLOTS
+	audio_conv_extract32(i2s, usb, samples / AUDIO_CHANNELS, AUDIO_SLOTS, AUDIO_CHANNELS);
+	audio_in_drv.convert(usb, usb, samples);
+#else
+	audio_in_drv.convert(i2s, usb, samples);
+#endif
+#else
+	uint32_t buf[CONVERT_CHUNK];
+	int16_t *usb16 = (int16_t *)usb;
+	uint32_t cnt;
+
+	for (; samples; samples -= cnt)
+	{
+		cnt = (samples < CONVERT_CHUNK) ? samples : CONVERT_CHUNK;
+#if AUDIO_CHANNELS < AUDIO_SLOTS
+		audio_conv_extract32(i2s, buf, cnt / AUDIO_CHANNELS, AUDIO_SLOTS, AUDIO_CHANNELS);
+		audio_in_drv.convert(buf, buf, cnt);
+		i2s += cnt / AUDIO_CHANNELS * AUDIO_SLOTS;
+#else
+		audio_in_drv.convert(i2s, buf, cnt);
+		i2s += cnt;
+#endif
+		audio_conv_32to16(buf, usb16, cnt);
+		usb16 += cnt;
+	}
+#endif
+}
+
 //--------------------------------------------
 static void i2s_rx_complete_callback(void)
 {
@@ -583,36 +619,11 @@ static void i2s_rx_complete_callback(void)
 			buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
 		}
 
-#if AUDIO_CHANNELS == 1
-		audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO * 2);
-#else
 		audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO);
-#endif
 
 		if (convert)
 		{
-			//-----------
-			// This conversion only works with
-			// BITS_PER_AUDIO_SAMPLE == 16
-			// BYTES_PER_AUDIO_SAMPLE == 2
-			// I2S_BITRES == 16
-			// I2S_TO_USB_BUF_LENGTH_RATIO == 2
-			// It is needed to create another one if macros are different
-			//-----------
-			uint32_t cnt_usb = 0;
-			uint32_t cnt_i2s = 0;
-			uint32_t *buf32_i2s;
-			uint16_t *buf16_usb = (uint16_t *)buf32_usb;
-			buf32_i2s = &buff_i2s[0];
-			for (cnt_usb = 0, cnt_i2s = 0; cnt_usb < len / sizeof(uint16_t); cnt_usb += 1)
-			{
-				audio_in_drv.convert(&buf32_i2s[cnt_i2s], &buf16_usb[cnt_usb]);
-#if AUDIO_CHANNELS == 1
-				cnt_i2s += 2;
-#else
-				cnt_i2s += 1;
-#endif
-			}
+			convert_i2s_to_usb(&buff_i2s[0], buf32_usb, len / BYTES_PER_AUDIO_SAMPLE);
 		}
 	}
 }
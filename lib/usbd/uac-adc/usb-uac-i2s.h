@@ -17,6 +17,14 @@
 
 void usb_uac_i2s_init(void);
 void usb_uac_i2s_loop(void);
+// UAC2 only:
+// The buffer depth profile, it is applied at the next stream start
+#define USB_UAC_PROFILE_DEFAULT        0
+#define USB_UAC_PROFILE_LOW_LATENCY    1
+void usb_uac_i2s_set_profile(uint8_t profile);
+// The latency (from the capture of the first sample of the packet to its transmission), us:
+// the last, the minimum and the maximum values since the stream start (0 if not measured yet)
+void usb_uac_i2s_get_latency(uint32_t *last, uint32_t *min, uint32_t *max);
 
 #endif // USB_UAC_I2S_H_
 
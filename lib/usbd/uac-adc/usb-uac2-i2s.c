@@ -23,8 +23,10 @@
 #include "usbd_core.h"
 #include "usb_std.h"
 #include "hal-usbd-init.h"
+#include "usb-uac-i2s.h"
 #include "usb-uac2.h"
 #include "uac2-adc-drv.h"
+#include "audio-conv.h"
 
 //--------------------------------------------
 extern const audio_in_drv_t audio_in_drv;
@@ -52,23 +54,70 @@ extern const struct usbd_driver usbd_otghs;
 #define BYTES_PER_AUDIO_SAMPLE          4
 #endif
 #define AUDIO_CHANNELS                  I2S_CHANNELS
+#ifdef I2S_SLOTS
+#define AUDIO_SLOTS                     I2S_SLOTS
+#else
+#define AUDIO_SLOTS                     2
+#endif
+#if AUDIO_CHANNELS != 1 && AUDIO_CHANNELS != 2 && AUDIO_CHANNELS != 4 && AUDIO_CHANNELS != 8
+#error "I2S_CHANNELS: 1, 2, 4 or 8 are allowed."
+#endif
+#if AUDIO_CHANNELS > AUDIO_SLOTS
+#error "I2S_CHANNELS: the number of the I2S (TDM) slots I2S_SLOTS is exceeded."
+#endif
 #ifdef USBD_FULL_SPEED
 #define USB_FRAMES_PER_AUDIO_FRAME      1 // bInterval = 1 ms
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000) * USB_FRAMES_PER_AUDIO_FRAME
 #else
+#ifdef UAC_USB_FRAMES_PER_AUDIO_FRAME
+#define USB_FRAMES_PER_AUDIO_FRAME      UAC_USB_FRAMES_PER_AUDIO_FRAME // 1: 125 us packets for the low latency
+#else
 #define USB_FRAMES_PER_AUDIO_FRAME      2 // 2^bInterval-1 = 2^1 = 2 microframes = 0.25 ms (supported values: 1 or 2)
+#endif
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000 / 8) * USB_FRAMES_PER_AUDIO_FRAME
 #endif
 #define BYTES_PER_AUDIO_FRAME           (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE)
 #define MAX_BYTES_PER_AUDIO_FRAME       (BYTES_PER_AUDIO_FRAME + BYTES_PER_AUDIO_SAMPLE * AUDIO_CHANNELS * USB_FRAMES_PER_AUDIO_FRAME)
 #define MIN_BYTES_PER_AUDIO_FRAME       (BYTES_PER_AUDIO_FRAME - BYTES_PER_AUDIO_SAMPLE * AUDIO_CHANNELS * USB_FRAMES_PER_AUDIO_FRAME)
 #define MAX_SAMPLES_PER_AUDIO_FRAME     (MAX_BYTES_PER_AUDIO_FRAME / BYTES_PER_AUDIO_SAMPLE)
+// The number of the audio frames between the capture and the transmission is kept
+// from 1/8 to 7/8 of the buffer depth of the default and the low latency profiles
+#ifdef UAC_FRAMES_IN_BUFFER
+#define AUDIO_FRAMES_IN_BUFFER          UAC_FRAMES_IN_BUFFER
+#else
 #define AUDIO_FRAMES_IN_BUFFER          16
+#endif
+#ifdef UAC_LOW_LATENCY_FRAMES
+#define AUDIO_FRAMES_LOW_LATENCY        UAC_LOW_LATENCY_FRAMES
+#else
+#define AUDIO_FRAMES_LOW_LATENCY        8
+#endif
+#if AUDIO_FRAMES_LOW_LATENCY > AUDIO_FRAMES_IN_BUFFER || AUDIO_FRAMES_LOW_LATENCY < 2 || (AUDIO_FRAMES_LOW_LATENCY & 1)
+#error "UAC_LOW_LATENCY_FRAMES: an even number from 2 to UAC_FRAMES_IN_BUFFER is allowed."
+#endif
 
 //--------------------------------------------
 #define UAC_EP0_SIZE                64
 #define UAC_TXD_EP                  0x82
 #define UAC_DATA_SZ                 MAX_BYTES_PER_AUDIO_FRAME
+// The high-bandwidth isochronous endpoint (USB-2 5.6.4): up to 3 transactions
+// of up to 1024 bytes per microframe, bits 12:11 of wMaxPacketSize are the additional transactions
+#define UAC_EP_MULT                 ((UAC_DATA_SZ + 1023) / 1024)
+#define UAC_EP_SIZE                 (((UAC_DATA_SZ + UAC_EP_MULT - 1) / UAC_EP_MULT) | ((UAC_EP_MULT - 1) << 11))
+#ifdef USBD_FULL_SPEED
+#if UAC_DATA_SZ > 1023
+#error "UAC_DATA_SZ: FS isochronous packet is limited by 1023 bytes, reduce I2S_CHANNELS, UAC_BITRES or I2S_FCLK."
+#endif
+#elif UAC_DATA_SZ > 2880
+// 3 x 960 bytes: the TX FIFO of the 4 KB OTG HS FIFO with the RX FIFO (see uvc-camera.c)
+#error "UAC_DATA_SZ: the high-bandwidth packet does not fit into the TX FIFO, reduce I2S_CHANNELS, UAC_BITRES or I2S_FCLK."
+#endif
+#if UAC_EP_MULT > 1
+// The high-bandwidth packet does not fit into the TX FIFO twice
+#define UAC_EP_TYPE                 USB_EPTYPE_ISOCHRONOUS
+#else
+#define UAC_EP_TYPE                 (USB_EPTYPE_ISOCHRONOUS | USB_EPTYPE_DBLBUF)
+#endif
 
 // Interfaces
 #define UAC_CONTROL_INTERFACE       0
@@ -80,6 +129,21 @@ extern const struct usbd_driver usbd_otghs;
 #define UAC_FEATURE_UNIT_ID         3
 #define UAC_OUTPUT_UNIT_ID          4
 
+// The audio channel cluster (ADC-2 4.1): the channels of the TDM ADCs have no predefined spatial positions
+#if AUDIO_CHANNELS == 1
+#define UAC_CHANNEL_CONFIG          0x00000004 // FC
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz2x32_desc
+#elif AUDIO_CHANNELS == 2
+#define UAC_CHANNEL_CONFIG          0x00000003 // FL, FR
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz3x32_desc
+#elif AUDIO_CHANNELS == 4
+#define UAC_CHANNEL_CONFIG          0x00000000
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz5x32_desc
+#else
+#define UAC_CHANNEL_CONFIG          0x00000000
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz9x32_desc
+#endif
+
 //--------------------------------------------
 #pragma pack(push, 1)
 typedef struct uac_config
@@ -90,11 +154,7 @@ typedef struct uac_config
 	struct usb_uac2_ac_header_desc                      ac_hdr;
 	struct usb_uac2_clock_source_desc                   ac_clk;
 	struct usb_uac2_input_terminal_desc                 ac_itd;
-#if AUDIO_CHANNELS == 1
-	struct usb_uac2_feature_unit_sz2x32_desc            ac_fu;
-#else
-	struct usb_uac2_feature_unit_sz3x32_desc            ac_fu;
-#endif
+	struct uac_feature_unit_desc                        ac_fu;
 	struct usb_uac2_output_terminal_desc                ac_otd;
 	struct usb_interface_descriptor                     as_0;
 	struct usb_interface_descriptor                     as_1;
@@ -171,11 +231,7 @@ static const uac_config_t config_desc =
 		.wTotalLength              = CPU_TO_LE16(sizeof(struct usb_uac2_ac_header_desc) +
 	                                             sizeof(struct usb_uac2_clock_source_desc) +
 	                                             sizeof(struct usb_uac2_input_terminal_desc) +
-#if AUDIO_CHANNELS == 1
-	                                             sizeof(struct usb_uac2_feature_unit_sz2x32_desc) +
-#else
-	                                             sizeof(struct usb_uac2_feature_unit_sz3x32_desc) +
-#endif
+	                                             sizeof(struct uac_feature_unit_desc) +
 	                                             sizeof(struct usb_uac2_output_terminal_desc)),
 		.bmControls                = 0x00,
 	},
@@ -200,30 +256,32 @@ static const uac_config_t config_desc =
 		.bAssocTerminal            = 0,
 		.bCSourceID                = UAC_CLOCK_SOURCE_ID,
 		.bNrChannels               = AUDIO_CHANNELS,
-#if AUDIO_CHANNELS == 1
-		.bmChannelConfig           = CPU_TO_LE32(0x00000004), // FC
-#else
-		.bmChannelConfig           = CPU_TO_LE32(0x00000003), // FL, FR
-#endif
+		.bmChannelConfig           = CPU_TO_LE32(UAC_CHANNEL_CONFIG),
 		.iChannelNames             = 0,
 		.bmControls                = CPU_TO_LE16(0x0000),
 		.iTerminal                 = 0,
 	},
 	.ac_fu =
 	{
-#if AUDIO_CHANNELS == 1
-		.bLength                   = sizeof(struct usb_uac2_feature_unit_sz2x32_desc),
-#else
-		.bLength                   = sizeof(struct usb_uac2_feature_unit_sz3x32_desc),
-#endif
+		.bLength                   = sizeof(struct uac_feature_unit_desc),
 		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
 		.bDescriptorSubType        = USB_DTYPE_UAC2_AC_FEATURE_UNIT,
 		.bUnitID                   = UAC_FEATURE_UNIT_ID,
 		.bSourceID                 = UAC_INPUT_UNIT_ID,
 		.bmaControls[0]            = CPU_TO_LE32(0x0000), // Master controls
 		.bmaControls[1]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 0 controls: Mute read-only
-#if AUDIO_CHANNELS == 2
+#if AUDIO_CHANNELS >= 2
 		.bmaControls[2]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 1 controls: Mute read-only
+#endif
+#if AUDIO_CHANNELS >= 4
+		.bmaControls[3]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 2 controls: Mute read-only
+		.bmaControls[4]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 3 controls: Mute read-only
+#endif
+#if AUDIO_CHANNELS == 8
+		.bmaControls[5]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 4 controls: Mute read-only
+		.bmaControls[6]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 5 controls: Mute read-only
+		.bmaControls[7]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 6 controls: Mute read-only
+		.bmaControls[8]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 7 controls: Mute read-only
 #endif
 		.iFeature                  = 0,
 	},
@@ -274,11 +332,7 @@ static const uac_config_t config_desc =
 		.bFormatType               = USB_UAC2_DATA_FORMAT_TYPE_I,
 		.bmFormats                 = CPU_TO_LE32(USB_UAC2_DATA_FT_I_PCM),
 		.bNrChannels               = AUDIO_CHANNELS,
-#if AUDIO_CHANNELS == 1
-		.bmChannelConfig           = CPU_TO_LE32(0x00000004), // FC
-#else
-		.bmChannelConfig           = CPU_TO_LE32(0x00000003), // FL, FR
-#endif
+		.bmChannelConfig           = CPU_TO_LE32(UAC_CHANNEL_CONFIG),
 		.iChannelNames             = 0,
 	},
 	.as_format_type1 =
@@ -296,7 +350,7 @@ static const uac_config_t config_desc =
 		.bDescriptorType           = USB_DTYPE_ENDPOINT,
 		.bEndpointAddress          = UAC_TXD_EP,
 		.bmAttributes              = USB_EPTYPE_ISOCHRONOUS | USB_EPATTR_ASYNC,
-		.wMaxPacketSize            = CPU_TO_LE16(UAC_DATA_SZ),
+		.wMaxPacketSize            = CPU_TO_LE16(UAC_EP_SIZE),
 		.bInterval                 = USB_FRAMES_PER_AUDIO_FRAME,
 	},
 	.eptx_data_cs =
@@ -327,12 +381,27 @@ typedef struct audio_state
 {
 	uint8_t mute[AUDIO_CHANNELS + 1];
 	bool record;
+	// The buffer depth of the profile
+	uint8_t frames;
 	uint8_t cnt_i2s;
 	uint8_t cnt_usb;
 	uint32_t total_cnt_i2s;
 	uint32_t total_cnt_usb;
 } audio_state_t;
 
+// The latency measurement (DWT cycle counter): the capture completion time and the number
+// (total_cnt_i2s) of every frame, the frame written to the endpoint is transmitted by the next usbd_evt_eptx
+typedef struct latency_state
+{
+	uint32_t capture_time[AUDIO_FRAMES_IN_BUFFER];
+	uint32_t capture_cnt[AUDIO_FRAMES_IN_BUFFER];
+	bool sent_valid;
+	uint8_t sent;
+	uint32_t last_us;
+	uint32_t min_us;
+	uint32_t max_us;
+} latency_state_t;
+
 typedef struct feedback_state
 {
 	uint32_t flagO;
@@ -348,17 +417,14 @@ static uint8_t iface_num;
 static uint8_t altset_num;
 static audio_state_t audio;
 static feedback_state_t feedback;
+static latency_state_t latency;
+static uint8_t profile_frames = AUDIO_FRAMES_IN_BUFFER;
 // Due to use with USB FIFO and/or DMA, the data buffers below must be 32-bit aligned:
 #define USB_CTRL_BUFF_SZ 128
 static uint32_t ubuf[(USB_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
-// I2S controller captures 32-bit samples only
-#define I2S_TO_USB_BUF_LENGTH_RATIO (sizeof(uint32_t) / BYTES_PER_AUDIO_SAMPLE)
-#if AUDIO_CHANNELS == 1
-// I2S controller can't capture one channel only, so the double buffer is needed
-static uint32_t buff_i2s[(MAX_BYTES_PER_AUDIO_FRAME * I2S_TO_USB_BUF_LENGTH_RATIO * 2 + 3) / sizeof(uint32_t)];
-#else
+// I2S controller captures 32-bit samples of all the slots only (it can't capture one channel only)
+#define I2S_TO_USB_BUF_LENGTH_RATIO (sizeof(uint32_t) / BYTES_PER_AUDIO_SAMPLE * AUDIO_SLOTS / AUDIO_CHANNELS)
 static uint32_t buff_i2s[(MAX_BYTES_PER_AUDIO_FRAME * I2S_TO_USB_BUF_LENGTH_RATIO + 3) / sizeof(uint32_t)];
-#endif
 static uint32_t buff_usb[AUDIO_FRAMES_IN_BUFFER][(UAC_DATA_SZ + 3) / sizeof(uint32_t)];
 static uint16_t buff_usb_size[AUDIO_FRAMES_IN_BUFFER];
 // UAC_CTRL_BUFF_SZ must not be less than the UAC2 control parameter block of the maximum length
@@ -366,6 +432,39 @@ static uint16_t buff_usb_size[AUDIO_FRAMES_IN_BUFFER];
 static uint32_t buff_uac_ctrl[(UAC_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
 
 
+//--------------------------------------------
+static void reset_latency(void)
+{
+	latency.sent_valid = false;
+	latency.last_us = 0;
+	latency.min_us = UINT32_MAX;
+	latency.max_us = 0;
+}
+
+//--------------------------------------------
+// USB interrupt context: the frame written before is transmitted at the moment time,
+// its first sample was captured the frame duration before the capture completion
+static void measure_latency(uint32_t time)
+{
+	uint32_t latency_us;
+
+	if (!latency.sent_valid)
+	{
+		return;
+	}
+	latency_us = (time - latency.capture_time[latency.sent]) / (SystemCoreClock / 1000000) +
+		(uint32_t)((uint64_t)buff_usb_size[latency.sent] * 1000000 / (AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE));
+	latency.last_us = latency_us;
+	if (latency_us < latency.min_us)
+	{
+		latency.min_us = latency_us;
+	}
+	if (latency_us > latency.max_us)
+	{
+		latency.max_us = latency_us;
+	}
+}
+
 //--------------------------------------------
 static usbd_respond uac_getdesc(usbd_ctlreq *req, void **address, uint16_t *length)
 {
@@ -544,19 +643,17 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 			{
 				if (!audio.record)
 				{
+					audio.frames = profile_frames;
 					audio.cnt_i2s = 0;
 					audio.cnt_usb = 0;
 					audio.total_cnt_i2s = 0;
 					audio.total_cnt_usb = 0;
+					reset_latency();
 					audio_in_drv.config();
 					audio.record = true;
 					usbd_ep_write(dev, UAC_TXD_EP, (void *)0, 0);
 					buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
-#if AUDIO_CHANNELS == 1
-					audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO * 2);
-#else
 					audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO);
-#endif
 				}
 			}
 			if (iface_num == 1 && altset_num == 0)
@@ -598,10 +695,15 @@ static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 	switch (event)
 	{
 	case usbd_evt_eptx:
+		measure_latency(DWT->CYCCNT);
 		usbd_ep_write(dev, UAC_TXD_EP, &buff_usb[audio.cnt_usb][0], buff_usb_size[audio.cnt_usb]);
+		// the frame has been captured (not a repeated or a skipped one)
+		latency.sent_valid = audio.record && audio.total_cnt_i2s > audio.total_cnt_usb &&
+			latency.capture_cnt[audio.cnt_usb] == audio.total_cnt_usb;
+		latency.sent = audio.cnt_usb;
 		++audio.total_cnt_usb;
 		++audio.cnt_usb;
-		if (audio.cnt_usb == AUDIO_FRAMES_IN_BUFFER)
+		if (audio.cnt_usb == audio.frames)
 		{
 			audio.cnt_usb = 0;
 		}
@@ -611,6 +713,43 @@ static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 	}
 }
 
+//--------------------------------------------
+// The I2S samples (all the slots, the DMA order) are converted to the USB samples
+// (the first AUDIO_CHANNELS slots) block by block.
+// The DMA is filling the I2S buffer already, so it is not converted in place.
+// CONVERT_CHUNK is a multiple of AUDIO_CHANNELS.
+#define CONVERT_CHUNK  32
+static void convert_i2s_to_usb(const uint32_t *i2s, uint32_t *usb, uint32_t samples)
+{
+#if BYTES_PER_AUDIO_SAMPLE == 4
+#if AUDIO_CHANNELS < AUDIO_SLOTS
+	audio_conv_extract32(i2s, usb, samples / AUDIO_CHANNELS, AUDIO_SLOTS, AUDIO_CHANNELS);
+	audio_in_drv.convert(usb, usb, samples);
+#else
+	audio_in_drv.convert(i2s, usb, samples);
+#endif
+#else
+	uint32_t buf[CONVERT_CHUNK];
+	int16_t *usb16 = (int16_t *)usb;
+	uint32_t cnt;
+
+	for (; samples; samples -= cnt)
+	{
+		cnt = (samples < CONVERT_CHUNK) ? samples : CONVERT_CHUNK;
+#if AUDIO_CHANNELS < AUDIO_SLOTS
+		audio_conv_extract32(i2s, buf, cnt / AUDIO_CHANNELS, AUDIO_SLOTS, AUDIO_CHANNELS);
+		audio_in_drv.convert(buf, buf, cnt);
+		i2s += cnt / AUDIO_CHANNELS * AUDIO_SLOTS;
+#else
+		audio_in_drv.convert(i2s, buf, cnt);
+		i2s += cnt;
+#endif
+		audio_conv_32to16(buf, usb16, cnt);
+		usb16 += cnt;
+	}
+#endif
+}
+
 //--------------------------------------------
 static void i2s_rx_complete_callback(void)
 {
@@ -626,21 +765,23 @@ static void i2s_rx_complete_callback(void)
 		if (audio.total_cnt_i2s >= audio.total_cnt_usb)
 		{
 			++feedback.flagU;
-			if (audio.total_cnt_i2s - audio.total_cnt_usb < AUDIO_FRAMES_IN_BUFFER)
+			if (audio.total_cnt_i2s - audio.total_cnt_usb < audio.frames)
 			{
+				latency.capture_time[audio.cnt_i2s] = DWT->CYCCNT;
+				latency.capture_cnt[audio.cnt_i2s] = audio.total_cnt_i2s;
 				++audio.total_cnt_i2s;
 				++audio.cnt_i2s;
-				buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
-				if (audio.cnt_i2s == AUDIO_FRAMES_IN_BUFFER)
+				if (audio.cnt_i2s == audio.frames)
 				{
 					audio.cnt_i2s = 0;
 				}
-				if (audio.total_cnt_i2s - audio.total_cnt_usb >= AUDIO_FRAMES_IN_BUFFER - AUDIO_FRAMES_IN_BUFFER / 8)
+				buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
+				if (audio.total_cnt_i2s - audio.total_cnt_usb >= audio.frames - audio.frames / 8)
 				{
 					buff_usb_size[audio.cnt_i2s] = MAX_BYTES_PER_AUDIO_FRAME;
 					++feedback.flagU1;
 				}
-				if (audio.total_cnt_i2s - audio.total_cnt_usb <= AUDIO_FRAMES_IN_BUFFER / 8)
+				if (audio.total_cnt_i2s - audio.total_cnt_usb <= audio.frames / 8)
 				{
 					buff_usb_size[audio.cnt_i2s] = MIN_BYTES_PER_AUDIO_FRAME;
 					++feedback.flagU2;
@@ -657,39 +798,15 @@ static void i2s_rx_complete_callback(void)
 		{
 			++feedback.flagO;
 			audio.total_cnt_i2s = audio.total_cnt_usb + 2;
-			audio.cnt_i2s = audio.total_cnt_i2s % AUDIO_FRAMES_IN_BUFFER;
+			audio.cnt_i2s = audio.total_cnt_i2s % audio.frames;
 			buff_usb_size[audio.cnt_i2s] = BYTES_PER_AUDIO_FRAME;
 		}
 
-#if AUDIO_CHANNELS == 1
-		audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO * 2);
-#else
 		audio_in_drv.read_dma_rxbuf(&buff_i2s[0], buff_usb_size[audio.cnt_i2s] * I2S_TO_USB_BUF_LENGTH_RATIO);
-#endif
 
 		if (convert)
 		{
-			//-----------
-			// This conversion only works with
-			// BITS_PER_AUDIO_SAMPLE == 24(32)
-			// BYTES_PER_AUDIO_SAMPLE == 4
-			// I2S_BITRES == 24(32)
-			// I2S_TO_USB_BUF_LENGTH_RATIO == 1
-			// It is needed to create another one if macros are different
-			//-----------
-			uint32_t cnt_usb = 0;
-			uint32_t cnt_i2s = 0;
-			uint32_t *buf32_i2s;
-			buf32_i2s = &buff_i2s[0];
-			for (cnt_usb = 0, cnt_i2s = 0; cnt_usb < len / sizeof(uint32_t); cnt_usb += 1)
-			{
-				audio_in_drv.convert(&buf32_i2s[cnt_i2s], &buf32_usb[cnt_usb]);
-#if AUDIO_CHANNELS == 1
-				cnt_i2s += 2;
-#else
-				cnt_i2s += 1;
-#endif
-			}
+			convert_i2s_to_usb(&buff_i2s[0], buf32_usb, len / BYTES_PER_AUDIO_SAMPLE);
 		}
 	}
 }
@@ -706,7 +823,7 @@ static usbd_respond uac_setconf(usbd_device *dev, uint8_t cfg)
 		return usbd_ack;
 	case 1:
         // configuring device
-		usbd_ep_config(dev, UAC_TXD_EP, USB_EPTYPE_ISOCHRONOUS | USB_EPTYPE_DBLBUF, UAC_DATA_SZ);
+		usbd_ep_config(dev, UAC_TXD_EP, UAC_EP_TYPE, UAC_EP_SIZE);
 		usbd_reg_endpoint(dev, UAC_TXD_EP, uac_callback);
 		return usbd_ack;
 	default:
@@ -727,6 +844,20 @@ void usb_uac_i2s_init(void)
 	usbd_reg_descr(&udev, uac_getdesc);
 }
 
+//--------------------------------------------
+void usb_uac_i2s_set_profile(uint8_t profile)
+{
+	profile_frames = (profile == USB_UAC_PROFILE_LOW_LATENCY) ? AUDIO_FRAMES_LOW_LATENCY : AUDIO_FRAMES_IN_BUFFER;
+}
+
+//--------------------------------------------
+void usb_uac_i2s_get_latency(uint32_t *last, uint32_t *min, uint32_t *max)
+{
+	*last = latency.last_us;
+	*min = (latency.min_us == UINT32_MAX) ? 0 : latency.min_us;
+	*max = latency.max_us;
+}
+
 //--------------------------------------------
 void usb_uac_i2s_loop(void)
 {
@@ -25,6 +25,8 @@
 #include "hal-usbd-init.h"
 #include "usb-uac.h"
 #include "uac-dac-drv.h"
+#include "audio-fx.h"
+#include "usb-uac-i2s.h"
 
 #ifndef USBD_FULL_SPEED
 #error "UAC 1.0 does not support high speed."
@@ -55,6 +57,12 @@ extern const struct usbd_driver usbd_otghs;
 #define BYTES_PER_AUDIO_SAMPLE          4
 #endif
 #define AUDIO_CHANNELS                  I2S_CHANNELS
+#if AUDIO_CHANNELS != 1 && AUDIO_CHANNELS != 2
+#error "I2S_CHANNELS: 1 or 2 are allowed (UAC 1.0 FS), 4 or 8 channels need UAC 2.0 (HS)."
+#endif
+#if defined I2S_SLOTS && I2S_SLOTS != 2
+#error "I2S_SLOTS: the TDM playback needs UAC 2.0 (HS)."
+#endif
 #define USB_FRAMES_PER_AUDIO_FRAME      1 // bInterval = 1 ms
 #define USB_FRAMES_PER_FEEDBACK_FRAME   1 // bInterval = 1 ms
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000) * USB_FRAMES_PER_AUDIO_FRAME
@@ -83,6 +91,11 @@ extern const struct usbd_driver usbd_otghs;
 #define UAC_FEATURE_UNIT_ID         2
 #define UAC_OUTPUT_UNIT_ID          3
 
+// The master volume (ADC-1 5.2.2.4.3.2), 1/256 dB
+#define UAC_VOLUME_MIN              (-60 * 256)
+#define UAC_VOLUME_MAX              0
+#define UAC_VOLUME_RES              128
+
 //--------------------------------------------
 #pragma pack(push, 1)
 typedef struct uac_config
@@ -210,7 +223,7 @@ static const uac_config_t config_desc =
 		.bUnitID                   = UAC_FEATURE_UNIT_ID,
 		.bSourceID                 = UAC_INPUT_UNIT_ID,
 		.bControlSize              = 2,
-		.bmaControls[0]            = CPU_TO_LE16(0x0000), // Master controls
+		.bmaControls[0]            = CPU_TO_LE16(USB_UAC_FU_BMAC_MUTE_CONTROL | USB_UAC_FU_BMAC_VOLUME_CONTROL), // Master controls: Mute, Volume
 		.bmaControls[1]            = CPU_TO_LE16(USB_UAC_FU_BMAC_MUTE_CONTROL), // Channel 0 controls: Mute
 #if AUDIO_CHANNELS == 2
 		.bmaControls[2]            = CPU_TO_LE16(USB_UAC_FU_BMAC_MUTE_CONTROL), // Channel 1 controls: Mute
@@ -323,6 +336,7 @@ static const struct usb_string_descriptor *const dtable[] =
 typedef struct audio_state
 {
 	uint8_t mute[AUDIO_CHANNELS + 1];
+	int16_t volume;
 	bool playback;
 	bool feedback;
 	bool start_usb;
@@ -354,6 +368,8 @@ static uint8_t iface_num;
 static uint8_t altset_num;
 static audio_state_t audio;
 static feedback_state_t feedback;
+// The master mute and volume, the EQ and the limiter set by the application
+static audio_fx_t fx;
 // Due to use with USB FIFO and/or DMA, the data buffers below must be 32-bit aligned:
 #define USB_CTRL_BUFF_SZ 128
 static uint32_t ubuf[(USB_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
@@ -563,8 +579,53 @@ static usbd_respond uac_feature_control(usbd_device *dev, usbd_ctlreq *req)
 				{
 					audio.mute[cn] = req->data[0];
 				}
+				audio_fx_set_mute(&fx, audio.mute[0]);
+				return usbd_ack;
+			}
+		}
+		break;
+	case USB_UAC_FU_VOLUME_CONTROL:
+		{
+			// Volume Control (ADC-1 5.2.2.4.3.2)
+			// The master channel only, 1/256 dB
+			struct usb_uac_form1_volume_control_parameter_block *block = (struct usb_uac_form1_volume_control_parameter_block *)&buff_uac_ctrl[0];
+			if (cn)
+			{
+				break;
+			}
+			switch (req->bRequest)
+			{
+			case USB_UAC_GET_CUR:
+				block->wVolume = CPU_TO_LE16((uint16_t)audio.volume);
+				break;
+			case USB_UAC_GET_MIN:
+				block->wVolume = CPU_TO_LE16((uint16_t)UAC_VOLUME_MIN);
+				break;
+			case USB_UAC_GET_MAX:
+				block->wVolume = CPU_TO_LE16(UAC_VOLUME_MAX);
+				break;
+			case USB_UAC_GET_RES:
+				block->wVolume = CPU_TO_LE16(UAC_VOLUME_RES);
+				break;
+			case USB_UAC_SET_CUR:
+				audio.volume = (int16_t)(req->data[0] | (req->data[1] << 8));
+				if (audio.volume < UAC_VOLUME_MIN)
+				{
+					audio.volume = UAC_VOLUME_MIN;
+				}
+				if (audio.volume > UAC_VOLUME_MAX)
+				{
+					audio.volume = UAC_VOLUME_MAX;
+				}
+				audio_fx_set_volume(&fx, audio.volume);
 				return usbd_ack;
+			default:
+				return usbd_fail;
 			}
+			length = sizeof(struct usb_uac_form1_volume_control_parameter_block);
+			dev->status.data_ptr = &buff_uac_ctrl[0];
+			dev->status.data_count = length < req->wLength ? length : req->wLength;
+			return usbd_ack;
 		}
 	}
 	return usbd_fail;
@@ -598,6 +659,7 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 					audio.total_cnt_usb = 0;
 					audio.start_i2s = true;
 					audio.start_usb = true;
+					audio_fx_reset(&fx);
 					start_mclk_count();
 					usbd_ep_write(dev, UAC_TXD_EP, (void *)0, 0);
 				}
@@ -634,6 +696,19 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 	return usbd_fail;
 }
 
+//--------------------------------------------
+// The USB samples are processed by the effects chain (the master mute and volume, the EQ, the limiter)
+// and prepared for the I2S DMA transfer in place
+static void convert_usb_to_i2s(uint32_t *usb, uint32_t length)
+{
+#if BYTES_PER_AUDIO_SAMPLE == 4
+	audio_fx_process(&fx, (int32_t *)usb, length / (sizeof(uint32_t) * AUDIO_CHANNELS));
+	audio_out_drv.convert(usb, usb, length / sizeof(uint32_t));
+#else
+	audio_fx_process16(&fx, (int16_t *)usb, length / (sizeof(int16_t) * AUDIO_CHANNELS));
+#endif
+}
+
 //--------------------------------------------
 static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 {
@@ -653,17 +728,7 @@ static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 		audio.start_usb = false;
 		buff_usb_size[audio.cnt_usb] = usbd_ep_read(dev, UAC_RXD_EP, &buff_usb[audio.cnt_usb][0], UAC_DATA_SZ);
 
-#if BYTES_PER_AUDIO_SAMPLE == 4
-		// The I2S interface converts the 16-bit LSB data received in SPIx_DR to
-		// the serial transmission of 16 bits with the MSB (most significant bit) first.
-		// But, since all 32 bits are received in LSB, it is necessary to swap 16-bit words.
-		uint32_t *buf32;
-		buf32 = (uint32_t *)&buff_usb[audio.cnt_usb][0];
-		for (uint32_t cnt = 0; cnt < buff_usb_size[audio.cnt_usb] / sizeof(uint32_t); cnt++)
-		{
-			audio_out_drv.convert(&buf32[cnt], &buf32[cnt]);
-		}
-#endif
+		convert_usb_to_i2s(&buff_usb[audio.cnt_usb][0], buff_usb_size[audio.cnt_usb]);
 
 		if (audio.start_i2s && audio.cnt_usb >= AUDIO_FRAMES_IN_BUFFER / 2)
 		{
@@ -738,6 +803,7 @@ void usb_uac_i2s_init(void)
 {
 	audio_out_drv.init();
 	audio_out_drv.init_dma_txbuf(i2s_tx_complete_callback);
+	audio_fx_init(&fx, AUDIO_SAMPLE_RATE, AUDIO_CHANNELS);
 
 	usbd_hw_init(&udev);
 	usbd_init(&udev, &usbd_hw, UAC_EP0_SIZE, ubuf, sizeof(ubuf));
@@ -746,6 +812,12 @@ void usb_uac_i2s_init(void)
 	usbd_reg_descr(&udev, uac_getdesc);
 }
 
+//--------------------------------------------
+audio_fx_t *usb_uac_i2s_get_fx(void)
+{
+	return &fx;
+}
+
 //--------------------------------------------
 void usb_uac_i2s_loop(void)
 {
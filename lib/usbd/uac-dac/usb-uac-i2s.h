@@ -15,8 +15,20 @@
 #ifndef USB_UAC_I2S_H_
 #define USB_UAC_I2S_H_
 
+// audio-fx.h must be included before this header
 void usb_uac_i2s_init(void);
 void usb_uac_i2s_loop(void);
+// The effects chain of the playback: the master mute and volume are set by the host,
+// the EQ bands and the limiter may be set by the application
+audio_fx_t *usb_uac_i2s_get_fx(void);
+// UAC2 only:
+// The buffer depth profile, it is applied at the next stream start
+#define USB_UAC_PROFILE_DEFAULT        0
+#define USB_UAC_PROFILE_LOW_LATENCY    1
+void usb_uac_i2s_set_profile(uint8_t profile);
+// The latency (from the packet reception to the output of its first sample), us:
+// the last, the minimum and the maximum values since the stream start (0 if not measured yet)
+void usb_uac_i2s_get_latency(uint32_t *last, uint32_t *min, uint32_t *max);
 
 #endif // USB_UAC_I2S_H_
 
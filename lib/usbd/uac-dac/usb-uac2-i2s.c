@@ -23,8 +23,12 @@
 #include "usbd_core.h"
 #include "usb_std.h"
 #include "hal-usbd-init.h"
+#include "audio-fx.h"
+#include "usb-uac-i2s.h"
 #include "usb-uac2.h"
 #include "uac-dac-drv.h"
+#include "audio-ring.h"
+#include "audio-rate.h"
 
 //--------------------------------------------
 extern const audio_out_drv_t audio_out_drv;
@@ -51,19 +55,52 @@ extern const struct usbd_driver usbd_otghs;
 #define BYTES_PER_AUDIO_SAMPLE          4
 #endif
 #define AUDIO_CHANNELS                  I2S_CHANNELS
+#if AUDIO_CHANNELS != 1 && AUDIO_CHANNELS != 2 && AUDIO_CHANNELS != 4 && AUDIO_CHANNELS != 8
+#error "I2S_CHANNELS: 1, 2, 4 or 8 are allowed."
+#endif
+#if defined I2S_SLOTS && I2S_SLOTS != 2 && I2S_SLOTS != AUDIO_CHANNELS
+// The ring of the USB samples is played by the DMA directly
+#error "I2S_CHANNELS: the TDM playback needs the samples of all the I2S_SLOTS slots."
+#endif
+#if AUDIO_CHANNELS > 2 && !(defined I2S_SLOTS && I2S_SLOTS == AUDIO_CHANNELS)
+#error "I2S_SLOTS: the TDM playback of I2S_CHANNELS channels needs I2S_SLOTS = I2S_CHANNELS."
+#endif
 #ifdef USBD_FULL_SPEED
 #define USB_FRAMES_PER_AUDIO_FRAME      1 // bInterval = 1 ms
 #define USB_FRAMES_PER_FEEDBACK_FRAME   1 // bInterval = 1 ms
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000) * USB_FRAMES_PER_AUDIO_FRAME
 #else
+#ifdef UAC_USB_FRAMES_PER_AUDIO_FRAME
+#define USB_FRAMES_PER_AUDIO_FRAME      UAC_USB_FRAMES_PER_AUDIO_FRAME // 1: 125 us packets for the low latency
+#else
 #define USB_FRAMES_PER_AUDIO_FRAME      2 // 2^bInterval-1 = 2^1 = 2 microframes = 0.25 ms (supported values: 1 or 2)
+#endif
 #define USB_FRAMES_PER_FEEDBACK_FRAME   4 // 2^bInterval-1 = 2^3 = 8 microframes = 1 ms (supported values: 1, 2, 3 or 4)
 #define SAMPLES_PER_AUDIO_FRAME         (AUDIO_SAMPLE_RATE / 1000 / 8) * USB_FRAMES_PER_AUDIO_FRAME
 #endif
 #define BYTES_PER_AUDIO_FRAME           (SAMPLES_PER_AUDIO_FRAME * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE)
 #define MAX_BYTES_PER_AUDIO_FRAME       (BYTES_PER_AUDIO_FRAME + BYTES_PER_AUDIO_SAMPLE * AUDIO_CHANNELS * USB_FRAMES_PER_AUDIO_FRAME)
 #define MAX_SAMPLES_PER_AUDIO_FRAME     (MAX_BYTES_PER_AUDIO_FRAME / BYTES_PER_AUDIO_SAMPLE)
+// The ring depth (the latency) of the default and the low latency profiles (an even number),
+// the feedback controller keeps the fill at AUDIO_RING_START
+#ifdef UAC_FRAMES_IN_BUFFER
+#define AUDIO_FRAMES_IN_BUFFER          UAC_FRAMES_IN_BUFFER
+#else
 #define AUDIO_FRAMES_IN_BUFFER          16
+#endif
+#ifdef UAC_LOW_LATENCY_FRAMES
+#define AUDIO_FRAMES_LOW_LATENCY        UAC_LOW_LATENCY_FRAMES
+#else
+#define AUDIO_FRAMES_LOW_LATENCY        8
+#endif
+#if AUDIO_FRAMES_LOW_LATENCY > AUDIO_FRAMES_IN_BUFFER || AUDIO_FRAMES_LOW_LATENCY < 2 || (AUDIO_FRAMES_LOW_LATENCY & 1)
+#error "UAC_LOW_LATENCY_FRAMES: an even number from 2 to UAC_FRAMES_IN_BUFFER is allowed."
+#endif
+// The circular DMA buffer: the DMA plays one half while the other half is filled,
+// the playback starts and is kept at 3/4 of the buffer filled,
+// the ring size is selected by the profile at the stream start
+#define AUDIO_RING_SIZE                 (BYTES_PER_AUDIO_FRAME * AUDIO_FRAMES_IN_BUFFER)
+#define AUDIO_RING_START                (ring.size / 4 * 3)
 #ifdef USBD_FULL_SPEED
 // fMCLK measurement interval in ms as power of 2
 #define AUDIO_FMCLK_MEASUREINT_MS_POWER_OF_TWO         5  // 2^5 = 32 ms
@@ -82,6 +119,16 @@ extern const struct usbd_driver usbd_otghs;
 #define UAC_TXD_EP                  0x82
 #define UAC_DATA_SZ                 MAX_BYTES_PER_AUDIO_FRAME
 #define UAC_FEEDBACK_SZ             4
+// The OTG RX FIFO holds one packet of up to 1024 bytes (MAX_RX_PACKET of the driver),
+// so the high-bandwidth OUT endpoint (the transactions of one microframe back-to-back) is not used:
+// 8 channels of the 32-bit samples at 192 kHz need UAC_USB_FRAMES_PER_AUDIO_FRAME 1
+#ifdef USBD_FULL_SPEED
+#if UAC_DATA_SZ > 1023
+#error "UAC_DATA_SZ: FS isochronous packet is limited by 1023 bytes, reduce I2S_CHANNELS, UAC_BITRES or I2S_FCLK."
+#endif
+#elif UAC_DATA_SZ > 1024
+#error "UAC_DATA_SZ: HS isochronous packet of one transaction is limited by 1024 bytes, use UAC_USB_FRAMES_PER_AUDIO_FRAME 1."
+#endif
 
 // Interfaces
 #define UAC_CONTROL_INTERFACE       0
@@ -93,6 +140,29 @@ extern const struct usbd_driver usbd_otghs;
 #define UAC_FEATURE_UNIT_ID         3
 #define UAC_OUTPUT_UNIT_ID          4
 
+// The master volume (ADC-2 5.2.5.7.2), 1/256 dB
+#define UAC_VOLUME_MIN              (-60 * 256)
+#define UAC_VOLUME_MAX              0
+#define UAC_VOLUME_RES              128
+#if AUDIO_CHANNELS > AUDIO_FX_CHANNELS
+#error "AUDIO_FX_CHANNELS: the effects chain channels must not be less than I2S_CHANNELS."
+#endif
+
+// The audio channel cluster (ADC-2 4.1), the TDM slots are the channels in the order of the bit positions
+#if AUDIO_CHANNELS == 1
+#define UAC_CHANNEL_CONFIG          0x00000004 // FC
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz2x32_desc
+#elif AUDIO_CHANNELS == 2
+#define UAC_CHANNEL_CONFIG          0x00000003 // FL, FR
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz3x32_desc
+#elif AUDIO_CHANNELS == 4
+#define UAC_CHANNEL_CONFIG          0x00000033 // FL, FR, BL, BR
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz5x32_desc
+#else
+#define UAC_CHANNEL_CONFIG          0x0000063F // FL, FR, FC, LFE, BL, BR, SL, SR (7.1)
+#define uac_feature_unit_desc       usb_uac2_feature_unit_sz9x32_desc
+#endif
+
 //--------------------------------------------
 #pragma pack(push, 1)
 typedef struct uac_config
@@ -103,11 +173,7 @@ typedef struct uac_config
 	struct usb_uac2_ac_header_desc                      ac_hdr;
 	struct usb_uac2_clock_source_desc                   ac_clk;
 	struct usb_uac2_input_terminal_desc                 ac_itd;
-#if AUDIO_CHANNELS == 1
-	struct usb_uac2_feature_unit_sz2x32_desc            ac_fu;
-#else
-	struct usb_uac2_feature_unit_sz3x32_desc            ac_fu;
-#endif
+	struct uac_feature_unit_desc                        ac_fu;
 	struct usb_uac2_output_terminal_desc                ac_otd;
 	struct usb_interface_descriptor                     as_0;
 	struct usb_interface_descriptor                     as_1;
@@ -185,11 +251,7 @@ static const uac_config_t config_desc =
 		.wTotalLength              = CPU_TO_LE16(sizeof(struct usb_uac2_ac_header_desc) +
 	                                             sizeof(struct usb_uac2_clock_source_desc) +
 	                                             sizeof(struct usb_uac2_input_terminal_desc) +
-#if AUDIO_CHANNELS == 1
-	                                             sizeof(struct usb_uac2_feature_unit_sz2x32_desc) +
-#else
-	                                             sizeof(struct usb_uac2_feature_unit_sz3x32_desc) +
-#endif
+	                                             sizeof(struct uac_feature_unit_desc) +
 	                                             sizeof(struct usb_uac2_output_terminal_desc)),
 		.bmControls                = 0x00,
 	},
@@ -214,30 +276,32 @@ static const uac_config_t config_desc =
 		.bAssocTerminal            = 0,
 		.bCSourceID                = UAC_CLOCK_SOURCE_ID,
 		.bNrChannels               = AUDIO_CHANNELS,
-#if AUDIO_CHANNELS == 1
-		.bmChannelConfig           = CPU_TO_LE32(0x00000004), // FC
-#else
-		.bmChannelConfig           = CPU_TO_LE32(0x00000003), // FL, FR
-#endif
+		.bmChannelConfig           = CPU_TO_LE32(UAC_CHANNEL_CONFIG),
 		.iChannelNames             = 0,
 		.bmControls                = CPU_TO_LE16(0x0000),
 		.iTerminal                 = 0,
 	},
 	.ac_fu =
 	{
-#if AUDIO_CHANNELS == 1
-		.bLength                   = sizeof(struct usb_uac2_feature_unit_sz2x32_desc),
-#else
-		.bLength                   = sizeof(struct usb_uac2_feature_unit_sz3x32_desc),
-#endif
+		.bLength                   = sizeof(struct uac_feature_unit_desc),
 		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
 		.bDescriptorSubType        = USB_DTYPE_UAC2_AC_FEATURE_UNIT,
 		.bUnitID                   = UAC_FEATURE_UNIT_ID,
 		.bSourceID                 = UAC_INPUT_UNIT_ID,
-		.bmaControls[0]            = CPU_TO_LE32(0x0000), // Master controls
+		.bmaControls[0]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_HP | USB_UAC2_FU_BMAC_VOLUME_CONTROL_HP), // Master controls: Mute, Volume
 		.bmaControls[1]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 0 controls: Mute read-only
-#if AUDIO_CHANNELS == 2
+#if AUDIO_CHANNELS >= 2
 		.bmaControls[2]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 1 controls: Mute read-only
+#endif
+#if AUDIO_CHANNELS >= 4
+		.bmaControls[3]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 2 controls: Mute read-only
+		.bmaControls[4]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 3 controls: Mute read-only
+#endif
+#if AUDIO_CHANNELS == 8
+		.bmaControls[5]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 4 controls: Mute read-only
+		.bmaControls[6]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 5 controls: Mute read-only
+		.bmaControls[7]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 6 controls: Mute read-only
+		.bmaControls[8]            = CPU_TO_LE32(USB_UAC2_FU_BMAC_MUTE_CONTROL_RO), // Channel 7 controls: Mute read-only
 #endif
 		.iFeature                  = 0,
 	},
@@ -288,11 +352,7 @@ static const uac_config_t config_desc =
 		.bFormatType               = USB_UAC2_DATA_FORMAT_TYPE_I,
 		.bmFormats                 = CPU_TO_LE32(USB_UAC2_DATA_FT_I_PCM),
 		.bNrChannels               = AUDIO_CHANNELS,
-#if AUDIO_CHANNELS == 1
-		.bmChannelConfig           = CPU_TO_LE32(0x00000004), // FC
-#else
-		.bmChannelConfig           = CPU_TO_LE32(0x00000003), // FL, FR
-#endif
+		.bmChannelConfig           = CPU_TO_LE32(UAC_CHANNEL_CONFIG),
 		.iChannelNames             = 0,
 	},
 	.as_format_type1 =
@@ -349,42 +409,52 @@ static const struct usb_string_descriptor *const dtable[] =
 typedef struct audio_state
 {
 	uint8_t mute[AUDIO_CHANNELS + 1];
+	int16_t volume;
 	bool playback;
 	bool feedback;
-	bool start_usb;
 	bool start_i2s;
-	uint8_t cnt_i2s;
-	uint8_t cnt_usb;
-	uint32_t total_cnt_i2s;
-	uint32_t total_cnt_usb;
 } audio_state_t;
 
+// The telemetry: rate.stats (the feedback, the fill history, the MCLK jitter),
+// ring.underruns, ring.overruns and dropped (the bytes received with the ring full)
 typedef struct feedback_state
 {
-	uint32_t mclk_count_measured;
 	uint32_t mclk_count_expected;
-	uint32_t mclk_count_correction;
 	uint8_t feedback_data[UAC_FEEDBACK_SZ];
-	uint32_t flagO;
-	uint32_t flagE;
-	uint32_t flagU;
-	uint32_t flagU1;
-	uint32_t flagU2;
-	uint32_t flagU3;
-	uint32_t flagU4;
+	audio_rate_t rate;
+	uint32_t dropped;
 } feedback_state_t;
 
+// The latency measurement (DWT cycle counter): the reception time and the ring position
+// of the last packet are written by the USB interrupt (seq is odd while they are changed),
+// the output time of the position is known at the DMA HT/TC interrupt
+typedef struct latency_state
+{
+	volatile uint32_t seq;
+	volatile uint32_t rx_time;
+	volatile uint32_t rx_pos;
+	volatile bool rx_valid;
+	uint32_t last_us;
+	uint32_t min_us;
+	uint32_t max_us;
+} latency_state_t;
+
 //--------------------------------------------
 static usbd_device udev;
 static uint8_t iface_num;
 static uint8_t altset_num;
 static audio_state_t audio;
 static feedback_state_t feedback;
+static latency_state_t latency;
+static uint8_t profile_frames = AUDIO_FRAMES_IN_BUFFER;
 // Due to use with USB FIFO and/or DMA, the data buffers below must be 32-bit aligned:
 #define USB_CTRL_BUFF_SZ 128
 static uint32_t ubuf[(USB_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
-static uint32_t buff_usb[AUDIO_FRAMES_IN_BUFFER][(UAC_DATA_SZ + 3) / sizeof(uint32_t)];
-static uint16_t buff_usb_size[AUDIO_FRAMES_IN_BUFFER];
+static uint32_t buff_usb[(UAC_DATA_SZ + 3) / sizeof(uint32_t)];
+static uint32_t buff_i2s[AUDIO_RING_SIZE / sizeof(uint32_t)];
+static audio_ring_t ring;
+// The master mute and volume, the EQ and the limiter set by the application
+static audio_fx_t fx;
 // UAC_CTRL_BUFF_SZ must not be less than the UAC2 control parameter block of the maximum length
 #define UAC_CTRL_BUFF_SZ 16
 static uint32_t buff_uac_ctrl[(UAC_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
@@ -458,42 +528,15 @@ static uint32_t buff_uac_ctrl[(UAC_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
 #endif
 
 //--------------------------------------------
+// The measured rate is corrected by the PI controller of the ring fill (audio-rate.h),
+// the controller is not changed till the playback is started
 static void mclk_callback(uint32_t mclk)
 {
 	uint32_t feedback_iiff;
+	uint32_t mclk_count;
 
-	feedback.mclk_count_measured = mclk;
-	if (audio.total_cnt_usb > audio.total_cnt_i2s)
-	{
-		++feedback.flagU;
-		if (audio.total_cnt_usb - audio.total_cnt_i2s >= AUDIO_FRAMES_IN_BUFFER - AUDIO_FRAMES_IN_BUFFER / 8)
-		{
-			feedback.mclk_count_measured -= feedback.mclk_count_correction * 2;
-			++feedback.flagU4;
-		}
-		if (audio.total_cnt_usb - audio.total_cnt_i2s >= AUDIO_FRAMES_IN_BUFFER - AUDIO_FRAMES_IN_BUFFER / 4)
-		{
-			feedback.mclk_count_measured -= feedback.mclk_count_correction;
-			++feedback.flagU3;
-		}
-		if (audio.total_cnt_usb - audio.total_cnt_i2s <= AUDIO_FRAMES_IN_BUFFER / 4)
-		{
-			feedback.mclk_count_measured += feedback.mclk_count_correction;
-			++feedback.flagU2;
-		}
-		if (audio.total_cnt_usb - audio.total_cnt_i2s <= AUDIO_FRAMES_IN_BUFFER / 8)
-		{
-			feedback.mclk_count_measured += feedback.mclk_count_correction * 2;
-			++feedback.flagU1;
-		}
-	}
-	else
-	{
-		++feedback.flagO;
-		feedback.mclk_count_measured += feedback.mclk_count_correction * 4;
-	}
-
-	feedback_iiff = AUDIO_MCLK_FEEDBACK_iiff(feedback.mclk_count_measured);
+	mclk_count = audio_rate_update(&feedback.rate, mclk, audio.playback ? audio_ring_get_fill(&ring) : AUDIO_RING_START);
+	feedback_iiff = AUDIO_MCLK_FEEDBACK_iiff(mclk_count);
 	feedback.feedback_data[0] = feedback_iiff & 0xFF;
 	feedback.feedback_data[1] = (feedback_iiff >> 8) & 0xFF;
 	feedback.feedback_data[2] = (feedback_iiff >> 16) & 0xFF;
@@ -506,7 +549,9 @@ static void mclk_callback(uint32_t mclk)
 static void start_mclk_count(void)
 {
 	feedback.mclk_count_expected = (uint32_t)(audio_out_drv.get_mclk() / 1000 * (1 << AUDIO_FMCLK_MEASUREINT_MS_POWER_OF_TWO));
-	feedback.mclk_count_correction = feedback.mclk_count_expected / 2048;
+	audio_rate_init(&feedback.rate, feedback.mclk_count_expected,
+		(uint32_t)(audio_out_drv.get_mclk() / AUDIO_SAMPLE_RATE + 0.5),
+		AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE, AUDIO_RING_START);
 	audio.feedback = false;
 	audio_out_drv.mclk_set_sof((1 << AUDIO_FMCLK_MEASUREINT_FR_POWER_OF_TWO) - 1);
 	audio_out_drv.mclk_start_count(mclk_callback);
@@ -519,6 +564,72 @@ static void stop_mclk_count(void)
 	audio.feedback = false;
 }
 
+//--------------------------------------------
+static void reset_latency(void)
+{
+	latency.rx_valid = false;
+	latency.last_us = 0;
+	latency.min_us = UINT32_MAX;
+	latency.max_us = 0;
+}
+
+//--------------------------------------------
+// USB interrupt context: pos is the ring position of the first byte of the packet
+static void timestamp_packet(uint32_t pos)
+{
+	latency.seq++;
+	latency.rx_time = DWT->CYCCNT;
+	latency.rx_pos = pos;
+	latency.rx_valid = true;
+	latency.seq++;
+}
+
+//--------------------------------------------
+// DMA interrupt context: the DMA has started the half at ring.rd at the moment time,
+// the first sample of the last packet is output (ring.rd - rx_pos) bytes before or after it
+static void measure_latency(uint32_t time)
+{
+	uint32_t seq;
+	uint32_t rx_time;
+	int32_t distance;
+	int32_t latency_us;
+
+	seq = latency.seq;
+	if ((seq & 1) || !latency.rx_valid)
+	{
+		return;
+	}
+	rx_time = latency.rx_time;
+	distance = (int32_t)(latency.rx_pos - ring.rd);
+	if (seq != latency.seq || (int32_t)(time - rx_time) < 0)
+	{
+		return;
+	}
+	if (distance > (int32_t)(ring.wrap / 2))
+	{
+		distance -= (int32_t)ring.wrap;
+	}
+	if (distance < -(int32_t)(ring.wrap / 2))
+	{
+		distance += (int32_t)ring.wrap;
+	}
+	latency_us = (int32_t)((time - rx_time) / (SystemCoreClock / 1000000)) +
+		(int32_t)((int64_t)distance * 1000000 / (AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * BYTES_PER_AUDIO_SAMPLE));
+	if (latency_us < 0)
+	{
+		return;
+	}
+	latency.last_us = (uint32_t)latency_us;
+	if (latency.last_us < latency.min_us)
+	{
+		latency.min_us = latency.last_us;
+	}
+	if (latency.last_us > latency.max_us)
+	{
+		latency.max_us = latency.last_us;
+	}
+}
+
 
 //--------------------------------------------
 static usbd_respond uac_getdesc(usbd_ctlreq *req, void **address, uint16_t *length)
@@ -592,10 +703,66 @@ static usbd_respond uac_feature_control(usbd_device *dev, usbd_ctlreq *req)
 				else
 				{
 					audio.mute[cn] = req->data[0];
+					if (!cn)
+					{
+						audio_fx_set_mute(&fx, audio.mute[0]);
+					}
 				}
 				return usbd_ack;
 			}
 		}
+		break;
+	case USB_UAC2_FU_VOLUME_CONTROL:
+		{
+			// Volume Control (ADC-2 5.2.5.7.2)
+			// The master channel only, 1/256 dB
+			if (cn)
+			{
+				break;
+			}
+			switch (req->bRequest)
+			{
+			case USB_UAC2_CUR:
+				if (get_request)
+				{
+					struct usb_uac2_layout_2_CUR_parameter_block *block = (struct usb_uac2_layout_2_CUR_parameter_block *)&buff_uac_ctrl[0];
+					block->wCUR = CPU_TO_LE16((uint16_t)audio.volume);
+					length = sizeof(struct usb_uac2_layout_2_CUR_parameter_block);
+
+					dev->status.data_ptr = &buff_uac_ctrl[0];
+					dev->status.data_count = length < req->wLength ? length : req->wLength;
+				}
+				else
+				{
+					audio.volume = (int16_t)(req->data[0] | (req->data[1] << 8));
+					if (audio.volume < UAC_VOLUME_MIN)
+					{
+						audio.volume = UAC_VOLUME_MIN;
+					}
+					if (audio.volume > UAC_VOLUME_MAX)
+					{
+						audio.volume = UAC_VOLUME_MAX;
+					}
+					audio_fx_set_volume(&fx, audio.volume);
+				}
+				return usbd_ack;
+			case USB_UAC2_RANGE:
+				if (get_request)
+				{
+					struct usb_uac2_layout_2_RANGE_parameter_sz3x16_block *block = (struct usb_uac2_layout_2_RANGE_parameter_sz3x16_block *)&buff_uac_ctrl[0];
+					block->wNumSubRanges = CPU_TO_LE16(1);
+					block->wMIN = CPU_TO_LE16((uint16_t)UAC_VOLUME_MIN);
+					block->wMAX = CPU_TO_LE16(UAC_VOLUME_MAX);
+					block->wRES = CPU_TO_LE16(UAC_VOLUME_RES);
+					length = sizeof(struct usb_uac2_layout_2_RANGE_parameter_sz3x16_block);
+
+					dev->status.data_ptr = &buff_uac_ctrl[0];
+					dev->status.data_count = length < req->wLength ? length : req->wLength;
+					return usbd_ack;
+				}
+			}
+		}
+		break;
 	}
 	return usbd_fail;
 }
@@ -696,24 +863,25 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 			iface_num = req->wIndex;
 			if (iface_num == 1 && altset_num == 1)
 			{
-				if (!audio.playback)
+				if (!audio.playback && !audio.start_i2s)
 				{
-					audio.cnt_i2s = 0;
-					audio.cnt_usb = 0;
-					audio.total_cnt_i2s = 0;
-					audio.total_cnt_usb = 0;
+					audio_ring_init(&ring, AUDIO_RING_TX, buff_i2s, BYTES_PER_AUDIO_FRAME * profile_frames, audio_out_drv.get_dma_txbuf_remain);
+					reset_latency();
+					audio_fx_reset(&fx);
 					audio.start_i2s = true;
-					audio.start_usb = true;
 					start_mclk_count();
 					usbd_ep_write(dev, UAC_TXD_EP, (void *)0, 0);
 				}
 			}
 			if (iface_num == 1 && altset_num == 0)
 			{
-				if (audio.playback)
+				if (audio.playback || audio.start_i2s)
 				{
 					stop_mclk_count();
+					// the DMA plays silence till the end of the buffer and is stopped by i2s_tx_half_callback
 					audio.playback = false;
+					audio.start_i2s = false;
+					audio_ring_reset(&ring);
 				}
 			}
 			return usbd_ack;
@@ -742,43 +910,50 @@ static usbd_respond uac_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 	return usbd_fail;
 }
 
+//--------------------------------------------
+// The USB samples are processed by the effects chain (the master mute and volume, the EQ, the limiter)
+// and prepared for the I2S DMA transfer in place
+static void convert_usb_to_i2s(uint32_t *usb, uint32_t length)
+{
+#if BYTES_PER_AUDIO_SAMPLE == 4
+	audio_fx_process(&fx, (int32_t *)usb, length / (sizeof(uint32_t) * AUDIO_CHANNELS));
+	audio_out_drv.convert(usb, usb, length / sizeof(uint32_t));
+#else
+	audio_fx_process16(&fx, (int16_t *)usb, length / (sizeof(int16_t) * AUDIO_CHANNELS));
+#endif
+}
+
 //--------------------------------------------
 static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 {
 	switch (event)
 	{
 	case usbd_evt_eprx:
-		if (!audio.start_usb)
+	{
+		int32_t length = usbd_ep_read(dev, UAC_RXD_EP, &buff_usb[0], UAC_DATA_SZ);
+		uint32_t written;
+		if (length <= 0 || (!audio.playback && !audio.start_i2s))
 		{
-			audio.playback = true;
-			++audio.total_cnt_usb;
-			++audio.cnt_usb;
-			if (audio.cnt_usb == AUDIO_FRAMES_IN_BUFFER)
-			{
-				audio.cnt_usb = 0;
-			}
+			break;
 		}
-		audio.start_usb = false;
-		buff_usb_size[audio.cnt_usb] = usbd_ep_read(dev, UAC_RXD_EP, &buff_usb[audio.cnt_usb][0], UAC_DATA_SZ);
 
-#if BYTES_PER_AUDIO_SAMPLE == 4
-		// The I2S interface converts the 16-bit LSB data received in SPIx_DR to
-		// the serial transmission of 16 bits with the MSB (most significant bit) first.
-		// But, since all 32 bits are received in LSB, it is necessary to swap 16-bit words.
-		uint32_t *buf32;
-		buf32 = (uint32_t *)&buff_usb[audio.cnt_usb][0];
-		for (uint32_t cnt = 0; cnt < buff_usb_size[audio.cnt_usb] / sizeof(uint32_t); cnt++)
+		convert_usb_to_i2s(&buff_usb[0], length);
+
+		// the data that does not fit is dropped, the feedback slows the host down
+		written = audio_ring_write(&ring, &buff_usb[0], length);
+		feedback.dropped += length - written;
+		if (written)
 		{
-			audio_out_drv.convert(&buf32[cnt], &buf32[cnt]);
+			timestamp_packet(ring.wr - written);
 		}
-#endif
-
-		if (audio.start_i2s && audio.cnt_usb >= AUDIO_FRAMES_IN_BUFFER / 2)
+		if (audio.start_i2s && audio_ring_get_fill(&ring) >= AUDIO_RING_START)
 		{
 			audio.start_i2s = false;
-			audio_out_drv.write_dma_txbuf(&buff_usb[audio.cnt_i2s][0], buff_usb_size[audio.cnt_i2s]);
+			audio.playback = true;
+			audio_out_drv.write_dma_txbuf(&buff_i2s[0], ring.size);
 		}
 		break;
+	}
 	case usbd_evt_eptx:
 		if (audio.feedback)
 		{
@@ -796,25 +971,19 @@ static void uac_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 }
 
 //--------------------------------------------
-static void i2s_tx_complete_callback(void)
+// The missing data is replaced by silence (ring.underruns)
+static void i2s_tx_half_callback(uint8_t half)
 {
-	if (audio.playback)
+	if (!audio.playback)
 	{
-		if (audio.total_cnt_i2s < audio.total_cnt_usb)
+		if (half)
 		{
-			++audio.total_cnt_i2s;
-			++audio.cnt_i2s;
-			if (audio.cnt_i2s == AUDIO_FRAMES_IN_BUFFER)
-			{
-				audio.cnt_i2s = 0;
-			}
-		}
-		else
-		{
-			++feedback.flagE;
+			audio_out_drv.stop_dma_txbuf();
 		}
-		audio_out_drv.write_dma_txbuf(&buff_usb[audio.cnt_i2s][0], buff_usb_size[audio.cnt_i2s]);
+		return;
 	}
+	audio_ring_dma_callback(&ring, half);
+	measure_latency(DWT->CYCCNT);
 }
 
 //--------------------------------------------
@@ -845,7 +1014,9 @@ static usbd_respond uac_setconf(usbd_device *dev, uint8_t cfg)
 void usb_uac_i2s_init(void)
 {
 	audio_out_drv.init();
-	audio_out_drv.init_dma_txbuf(i2s_tx_complete_callback);
+	audio_out_drv.init_dma_txbuf_cycle(i2s_tx_half_callback);
+	audio_ring_init(&ring, AUDIO_RING_TX, buff_i2s, sizeof(buff_i2s), audio_out_drv.get_dma_txbuf_remain);
+	audio_fx_init(&fx, AUDIO_SAMPLE_RATE, AUDIO_CHANNELS);
 
 	usbd_hw_init(&udev);
 	usbd_init(&udev, &usbd_hw, UAC_EP0_SIZE, ubuf, sizeof(ubuf));
@@ -854,6 +1025,26 @@ void usb_uac_i2s_init(void)
 	usbd_reg_descr(&udev, uac_getdesc);
 }
 
+//--------------------------------------------
+void usb_uac_i2s_set_profile(uint8_t profile)
+{
+	profile_frames = (profile == USB_UAC_PROFILE_LOW_LATENCY) ? AUDIO_FRAMES_LOW_LATENCY : AUDIO_FRAMES_IN_BUFFER;
+}
+
+//--------------------------------------------
+void usb_uac_i2s_get_latency(uint32_t *last, uint32_t *min, uint32_t *max)
+{
+	*last = latency.last_us;
+	*min = (latency.min_us == UINT32_MAX) ? 0 : latency.min_us;
+	*max = latency.max_us;
+}
+
+//--------------------------------------------
+audio_fx_t *usb_uac_i2s_get_fx(void)
+{
+	return &fx;
+}
+
 //--------------------------------------------
 void usb_uac_i2s_loop(void)
 {
@@ -23,7 +23,15 @@
 #include "hal-usbd-init.h"
 #include "usb-uvc.h"
 #include "imgsensor-drv.h"
+#include "uvc-camera.h"
+#if defined UVC_FRAMEBUF_POOL
+#include "fb-pool.h"
+#endif
+#if defined UVC_MOTION_THRESHOLD
+#include "img-motion.h"
+#endif
 #include <string.h>
+#include <stdio.h>
 
 //--------------------------------------------
 extern const imgsensor_drv_t cam_drv;
@@ -34,19 +42,84 @@ extern const struct usbd_driver usbd_otghs;
 #endif
 
 //--------------------------------------------
-#define VF_HEIGHT                   240
-#define VF_WIDTH                    320
+// The video format, frame size and frame interval are selected by the host
+// (the PROBE and COMMIT controls).
+// UVC_MJPEG: the camera (OV2640) JPEG frames are sent in the MJPEG format,
+// otherwise the uncompressed YUY2 and RGB565 frames are sent.
+// The frame buffers are in the internal RAM, the uncompressed VGA frames
+// are available if the frame buffers are acquired from the frame buffer pool
+// in the external memory (UVC_FRAMEBUF_POOL, lib/image/fb-pool): the application
+// initializes the pool with the blocks of VF_FRAMEBUF_SIZE bytes at least
+// before usb_uvc_camera_init.
+// UVC_STAT_PERIOD: the period in ms the streaming and camera statistics
+// are printed with by the main loop, not printed if not defined.
+// UVC_MOTION_THRESHOLD: the uncompressed frames without motion are not sent
+// (lib/image/img-motion), the value is the mean absolute luma difference
+// of the changed block, a frame is sent once a second at least anyway.
+// The detection reads every 4th row of the frame in the USB interrupt
+// before the first payload of the frame.
+#if defined UVC_MJPEG && defined UVC_MOTION_THRESHOLD
+#error "The motion detection does not support MJPEG frames"
+#endif
+#if defined UVC_MJPEG
+#define VF_FORMAT_NUM               1
+#define VF_FORMAT_MJPEG             1
+#define VF_FRAME_NUM                3     // QVGA, VGA, SVGA
+#define VF_FRAME_DEF                3
+#define VF_JPEG_QUALITY             12
+// The maximum JPEG frame size (the compression ratio is 8 at least),
+// the bigger frames are dropped
+#define VF_SIZE_IN_BYTES(w, h)      ((w) * (h) * 2 / 8)
+#define VF_FRAMEBUF_SIZE            VF_SIZE_IN_BYTES(800, 600)
+// The JPEG frame is captured by a single DMA transfer (65535 32-bit words)
+#if VF_FRAMEBUF_SIZE > 65535 * 4
+#error "The JPEG frame buffer exceeds the DMA transfer length"
+#endif
+#else
+#define VF_FORMAT_NUM               2
+#define VF_FORMAT_YUY2              1
+#define VF_FORMAT_RGB565            2
+#if defined UVC_FRAMEBUF_POOL
+#define VF_FRAME_NUM                3     // QQVGA, QVGA, VGA
+#define VF_FRAMEBUF_SIZE            VF_SIZE_IN_BYTES(640, 480)
+#define VF_MOTION_BUF_SIZE          IMG_MOTION_BUF_SIZE(640, 480)
+#else
+#define VF_FRAME_NUM                2     // QQVGA, QVGA
+#define VF_FRAMEBUF_SIZE            VF_SIZE_IN_BYTES(320, 240)
+#define VF_MOTION_BUF_SIZE          IMG_MOTION_BUF_SIZE(320, 240)
+#endif
+#define VF_FRAME_DEF                2
 #define VF_BITS_PER_PIXEL           16
-#define VF_SIZE_IN_BITS             (VF_HEIGHT * VF_WIDTH * VF_BITS_PER_PIXEL)
-#define VF_SIZE_IN_BYTES            (VF_SIZE_IN_BITS / 8)
-#define VF_FPS                      30
-#define VF_BITRATE                  (VF_SIZE_IN_BITS * VF_FPS)
-#define VF_INTERVAL                 (10000000 / VF_FPS)
+#define VF_SIZE_IN_BYTES(w, h)      ((w) * (h) * VF_BITS_PER_PIXEL / 8)
+#endif
+// 30, 15 and 5 fps for each frame size,
+// the camera frames are skipped to get the lower frame rates
+#define VF_INTERVAL(fps)            (10000000 / (fps))
+#define VF_INTERVAL_NUM             3
+#define VF_BITRATE(w, h, fps)       (VF_SIZE_IN_BYTES(w, h) * 8 * (fps))
+// The number of frame buffers captured in turn:
+// 2 frames (of both formats) fit into the internal RAM, no frame is skipped
+// as long as a frame is sent to the host within the frame period,
+// 3 frames of the pool never skip a frame
+#if defined UVC_FRAMEBUF_POOL
+#define VF_FRAMES                   3
+#else
+#define VF_FRAMES                   2
+#endif
 
 //--------------------------------------------
 #define UVC_EP0_SIZE                64
 #define UVC_TXD_EP                  0x81
-#define UVC_DATA_SZ                 1024
+// The high-bandwidth isochronous endpoint alternate settings of the video streaming interface:
+// up to 3 packets (one payload) per microframe, the host selects the setting
+// with enough bandwidth for the dwMaxPayloadTransferSize
+#define UVC_EP_SIZE(size, mult)     ((size) | (((mult) - 1) << 11))
+#define UVC_DATA_SZ(epsize)         (((epsize) & 0x7FF) * ((((epsize) >> 11) & 0x03) + 1))
+#define UVC_ALT1_EP_SIZE            UVC_EP_SIZE(1024, 1)  // 8 MB/s
+#define UVC_ALT2_EP_SIZE            UVC_EP_SIZE(1024, 2)  // 16 MB/s
+// 3 x 1024 bytes don't fit into the 4 KB OTG HS FIFO with the RX FIFO
+#define UVC_ALT3_EP_SIZE            UVC_EP_SIZE(960, 3)   // 23 MB/s
+#define UVC_ALT_NUM                 3
 
 //--------------------------------------------
 #pragma pack(push, 1)
@@ -59,12 +132,24 @@ typedef struct uvc_config
 	struct usb_uvc_input_terminal_camera_sz3_desc       vc_itcd;
 	struct usb_uvc_output_terminal_desc                 vc_otd;
 	struct usb_interface_descriptor                     vs_0;
+#if defined UVC_MJPEG
 	struct usb_uvc_vs_input_header_sz1_desc             vs_input_hdr;
-	struct usb_uvc_vs_format_uncompressed_desc          vs_format_uncmp;
-	struct usb_uvc_vs_frame_uncompressed_cont_desc      vs_frame_uncmp;
+	struct usb_uvc_vs_format_mjpeg_desc                 vs_format_mjpeg;
+	struct usb_uvc_vs_frame_mjpeg_disc3_desc            vs_frame_mjpeg[VF_FRAME_NUM];
+#else
+	struct usb_uvc_vs_input_header_sz1_fmt2_desc        vs_input_hdr;
+	struct usb_uvc_vs_format_uncompressed_desc          vs_format_yuy2;
+	struct usb_uvc_vs_frame_uncompressed_disc3_desc     vs_frame_yuy2[VF_FRAME_NUM];
+	struct usb_uvc_vs_format_uncompressed_desc          vs_format_rgb565;
+	struct usb_uvc_vs_frame_uncompressed_disc3_desc     vs_frame_rgb565[VF_FRAME_NUM];
+#endif
 	struct usb_uvc_vs_color_matching_desc               vs_color;
 	struct usb_interface_descriptor                     vs_1;
-	struct usb_endpoint_descriptor                      data_eptx;
+	struct usb_endpoint_descriptor                      data_eptx_1;
+	struct usb_interface_descriptor                     vs_2;
+	struct usb_endpoint_descriptor                      data_eptx_2;
+	struct usb_interface_descriptor                     vs_3;
+	struct usb_endpoint_descriptor                      data_eptx_3;
 } uvc_config_t;
 #pragma pack(pop)
 
@@ -87,6 +172,33 @@ static const struct usb_device_descriptor device_desc =
 	.bNumConfigurations = 1,
 };
 
+//--------------------------------------------
+#define VS_FRAME_DESC(type, subtype, index, width, height) \
+	{ \
+		.bLength                   = sizeof(type), \
+		.bDescriptorType           = USB_DTYPE_CS_INTERFACE, \
+		.bDescriptorSubType        = subtype, \
+		.bFrameIndex               = index, \
+		.bmCapabilities            = 0, \
+		.wWidth                    = CPU_TO_LE16(width), \
+		.wHeight                   = CPU_TO_LE16(height), \
+		.dwMinBitRate              = CPU_TO_LE32(VF_BITRATE(width, height, 5)), \
+		.dwMaxBitRate              = CPU_TO_LE32(VF_BITRATE(width, height, 30)), \
+		.dwMaxVideoFrameBufferSize = CPU_TO_LE32(VF_SIZE_IN_BYTES(width, height)), \
+		.dwDefaultFrameInterval    = CPU_TO_LE32(VF_INTERVAL(30)), \
+		.bFrameIntervalType        = VF_INTERVAL_NUM, \
+		.dwFrameInterval           = \
+		{ \
+			CPU_TO_LE32(VF_INTERVAL(30)), \
+			CPU_TO_LE32(VF_INTERVAL(15)), \
+			CPU_TO_LE32(VF_INTERVAL(5)), \
+		}, \
+	}
+#define VS_FRAME_UNCOMPRESSED(index, width, height) \
+	VS_FRAME_DESC(struct usb_uvc_vs_frame_uncompressed_disc3_desc, USB_DTYPE_UVC_VS_FRAME_UNCOMPRESSED, index, width, height)
+#define VS_FRAME_MJPEG(index, width, height) \
+	VS_FRAME_DESC(struct usb_uvc_vs_frame_mjpeg_disc3_desc, USB_DTYPE_UVC_VS_FRAME_MJPEG, index, width, height)
+
 //--------------------------------------------
 static const uvc_config_t config_desc =
 {
@@ -177,15 +289,16 @@ static const uvc_config_t config_desc =
 		.bInterfaceProtocol        = USB_PROTO_NONE,
 		.iInterface                = NO_DESCRIPTOR,
 	},
+#if defined UVC_MJPEG
 	.vs_input_hdr =
 	{
 		.bLength                   = sizeof(struct usb_uvc_vs_input_header_sz1_desc),
 		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
 		.bDescriptorSubType        = USB_DTYPE_UVC_VS_INPUT_HEADER,
-		.bNumFormats               = 1,
+		.bNumFormats               = VF_FORMAT_NUM,
 		.wTotalLength              = CPU_TO_LE16(sizeof(struct usb_uvc_vs_input_header_sz1_desc) +
-	                                             sizeof(struct usb_uvc_vs_format_uncompressed_desc) +
-	                                             sizeof(struct usb_uvc_vs_frame_uncompressed_cont_desc) +
+	                                             sizeof(struct usb_uvc_vs_format_mjpeg_desc) +
+	                                             sizeof(struct usb_uvc_vs_frame_mjpeg_disc3_desc) * VF_FRAME_NUM +
 	                                             sizeof(struct usb_uvc_vs_color_matching_desc)),
 		.bEndpointAddress          = UVC_TXD_EP,
 		.bmInfo                    = 0x00,
@@ -196,42 +309,100 @@ static const uvc_config_t config_desc =
 		.bControlSize              = 1,
 		.bmaControls[0]            = 0,
 	},
-	.vs_format_uncmp =
+	.vs_format_mjpeg =
+	{
+		.bLength                   = sizeof(struct usb_uvc_vs_format_mjpeg_desc),
+		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
+		.bDescriptorSubType        = USB_DTYPE_UVC_VS_FORMAT_MJPEG,
+		.bFormatIndex              = VF_FORMAT_MJPEG,
+		.bNumFrameDescriptors      = VF_FRAME_NUM,
+		.bmFlags                   = 0x00, // variable size samples
+		.bDefaultFrameIndex        = VF_FRAME_DEF,
+		.bAspectRatioX             = 0,
+		.bAspectRatioY             = 0,
+		.bmInterlaceFlags          = 0,
+		.bCopyProtect              = 0,
+	},
+	.vs_frame_mjpeg =
+	{
+		VS_FRAME_MJPEG(1, 320, 240),
+		VS_FRAME_MJPEG(2, 640, 480),
+		VS_FRAME_MJPEG(3, 800, 600),
+	},
+#else
+	.vs_input_hdr =
+	{
+		.bLength                   = sizeof(struct usb_uvc_vs_input_header_sz1_fmt2_desc),
+		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
+		.bDescriptorSubType        = USB_DTYPE_UVC_VS_INPUT_HEADER,
+		.bNumFormats               = VF_FORMAT_NUM,
+		.wTotalLength              = CPU_TO_LE16(sizeof(struct usb_uvc_vs_input_header_sz1_fmt2_desc) +
+	                                             (sizeof(struct usb_uvc_vs_format_uncompressed_desc) +
+	                                              sizeof(struct usb_uvc_vs_frame_uncompressed_disc3_desc) * VF_FRAME_NUM) * VF_FORMAT_NUM +
+	                                             sizeof(struct usb_uvc_vs_color_matching_desc)),
+		.bEndpointAddress          = UVC_TXD_EP,
+		.bmInfo                    = 0x00,
+		.bTerminalLink             = 2,
+		.bStillCaptureMethod       = 0,
+		.bTriggerSupport           = 1,
+		.bTriggerUsage             = 0,
+		.bControlSize              = 1,
+		.bmaControls[0]            = 0,
+		.bmaControls[1]            = 0,
+	},
+	.vs_format_yuy2 =
 	{
 		.bLength                   = sizeof(struct usb_uvc_vs_format_uncompressed_desc),
 		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
 		.bDescriptorSubType        = USB_DTYPE_UVC_VS_FORMAT_UNCOMPRESSED,
-		.bFormatIndex              = 1,
-		.bNumFrameDescriptors      = 1,
+		.bFormatIndex              = VF_FORMAT_YUY2,
+		.bNumFrameDescriptors      = VF_FRAME_NUM,
 		.guidFormat                =
 		{
 			0x59, 0x55, 0x59, 0x32, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71, // yuy2
 		},
 		.bBitsPerPixel             = VF_BITS_PER_PIXEL,
-		.bDefaultFrameIndex        = 1,
+		.bDefaultFrameIndex        = VF_FRAME_DEF,
 		.bAspectRatioX             = 0,
 		.bAspectRatioY             = 0,
 		.bmInterlaceFlags          = 0,
 		.bCopyProtect              = 0,
 	},
-	.vs_frame_uncmp =
+	.vs_frame_yuy2 =
 	{
-		.bLength                   = sizeof(struct usb_uvc_vs_frame_uncompressed_cont_desc),
+		VS_FRAME_UNCOMPRESSED(1, 160, 120),
+		VS_FRAME_UNCOMPRESSED(2, 320, 240),
+#if VF_FRAME_NUM > 2
+		VS_FRAME_UNCOMPRESSED(3, 640, 480),
+#endif
+	},
+	.vs_format_rgb565 =
+	{
+		.bLength                   = sizeof(struct usb_uvc_vs_format_uncompressed_desc),
 		.bDescriptorType           = USB_DTYPE_CS_INTERFACE,
-		.bDescriptorSubType        = USB_DTYPE_UVC_VS_FRAME_UNCOMPRESSED,
-		.bFrameIndex               = 1,
-		.bmCapabilities            = 0,
-		.wWidth                    = CPU_TO_LE16(VF_WIDTH),
-		.wHeight                   = CPU_TO_LE16(VF_HEIGHT),
-		.dwMinBitRate              = CPU_TO_LE32(VF_BITRATE),
-		.dwMaxBitRate              = CPU_TO_LE32(VF_BITRATE),
-		.dwMaxVideoFrameBufferSize = CPU_TO_LE32(VF_SIZE_IN_BYTES),
-		.dwDefaultFrameInterval    = CPU_TO_LE32(VF_INTERVAL),
-		.bFrameIntervalType        = 0,
-		.dwMinFrameInterval        = CPU_TO_LE32(VF_INTERVAL),
-		.dwMaxFrameInterval        = CPU_TO_LE32(VF_INTERVAL),
-		.dwFrameIntervalStep       = CPU_TO_LE32(0),
+		.bDescriptorSubType        = USB_DTYPE_UVC_VS_FORMAT_UNCOMPRESSED,
+		.bFormatIndex              = VF_FORMAT_RGB565,
+		.bNumFrameDescriptors      = VF_FRAME_NUM,
+		.guidFormat                =
+		{
+			0x52, 0x47, 0x42, 0x50, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71, // rgbp (rgb565)
+		},
+		.bBitsPerPixel             = VF_BITS_PER_PIXEL,
+		.bDefaultFrameIndex        = VF_FRAME_DEF,
+		.bAspectRatioX             = 0,
+		.bAspectRatioY             = 0,
+		.bmInterlaceFlags          = 0,
+		.bCopyProtect              = 0,
 	},
+	.vs_frame_rgb565 =
+	{
+		VS_FRAME_UNCOMPRESSED(1, 160, 120),
+		VS_FRAME_UNCOMPRESSED(2, 320, 240),
+#if VF_FRAME_NUM > 2
+		VS_FRAME_UNCOMPRESSED(3, 640, 480),
+#endif
+	},
+#endif
 	.vs_color =
 	{
 		.bLength                   = sizeof(struct usb_uvc_vs_color_matching_desc),
@@ -253,13 +424,55 @@ static const uvc_config_t config_desc =
 		.bInterfaceProtocol        = USB_PROTO_NONE,
 		.iInterface                = NO_DESCRIPTOR,
 	},
-	.data_eptx =
+	.data_eptx_1 =
+	{
+		.bLength                   = sizeof(struct usb_endpoint_descriptor),
+		.bDescriptorType           = USB_DTYPE_ENDPOINT,
+		.bEndpointAddress          = UVC_TXD_EP,
+		.bmAttributes              = USB_EPTYPE_ISOCHRONOUS,
+		.wMaxPacketSize            = CPU_TO_LE16(UVC_ALT1_EP_SIZE),
+		.bInterval                 = 1,
+	},
+	.vs_2 =
+	{
+		.bLength                   = sizeof(struct usb_interface_descriptor),
+		.bDescriptorType           = USB_DTYPE_INTERFACE,
+		.bInterfaceNumber          = 1,
+		.bAlternateSetting         = 2,
+		.bNumEndpoints             = 1,
+		.bInterfaceClass           = USB_CLASS_VIDEO,
+		.bInterfaceSubClass        = USB_SUBCLASS_VIDEOSTREAMING,
+		.bInterfaceProtocol        = USB_PROTO_NONE,
+		.iInterface                = NO_DESCRIPTOR,
+	},
+	.data_eptx_2 =
+	{
+		.bLength                   = sizeof(struct usb_endpoint_descriptor),
+		.bDescriptorType           = USB_DTYPE_ENDPOINT,
+		.bEndpointAddress          = UVC_TXD_EP,
+		.bmAttributes              = USB_EPTYPE_ISOCHRONOUS,
+		.wMaxPacketSize            = CPU_TO_LE16(UVC_ALT2_EP_SIZE),
+		.bInterval                 = 1,
+	},
+	.vs_3 =
+	{
+		.bLength                   = sizeof(struct usb_interface_descriptor),
+		.bDescriptorType           = USB_DTYPE_INTERFACE,
+		.bInterfaceNumber          = 1,
+		.bAlternateSetting         = 3,
+		.bNumEndpoints             = 1,
+		.bInterfaceClass           = USB_CLASS_VIDEO,
+		.bInterfaceSubClass        = USB_SUBCLASS_VIDEOSTREAMING,
+		.bInterfaceProtocol        = USB_PROTO_NONE,
+		.iInterface                = NO_DESCRIPTOR,
+	},
+	.data_eptx_3 =
 	{
 		.bLength                   = sizeof(struct usb_endpoint_descriptor),
 		.bDescriptorType           = USB_DTYPE_ENDPOINT,
 		.bEndpointAddress          = UVC_TXD_EP,
 		.bmAttributes              = USB_EPTYPE_ISOCHRONOUS,
-		.wMaxPacketSize            = CPU_TO_LE16(UVC_DATA_SZ),
+		.wMaxPacketSize            = CPU_TO_LE16(UVC_ALT3_EP_SIZE),
 		.bInterval                 = 1,
 	},
 };
@@ -276,45 +489,104 @@ static const struct usb_string_descriptor *const dtable[] =
 };
 
 //--------------------------------------------
-static struct usb_uvc_vs_control vs_probe_ctrl =
+// The default format, frame and interval,
+// the sizes are filled by vs_control_fix()
+static const struct usb_uvc_vs_control vs_def_ctrl =
 {
 	.bmHint                   = 0,
 	.bFormatIndex             = 1,
-	.bFrameIndex              = 1,
-	.dwFrameInterval          = CPU_TO_LE32(VF_INTERVAL),
+	.bFrameIndex              = VF_FRAME_DEF,
+	.dwFrameInterval          = CPU_TO_LE32(VF_INTERVAL(30)),
 	.wKeyFrameRate            = CPU_TO_LE16(0),
 	.wPFrameRate              = CPU_TO_LE16(0),
 	.wCompQuality             = CPU_TO_LE16(0),
 	.wCompWindowSize          = CPU_TO_LE16(0),
 	.wDelay                   = CPU_TO_LE16(0),
-	.dwMaxVideoFrameSize      = CPU_TO_LE32(VF_SIZE_IN_BYTES),
+	.dwMaxVideoFrameSize      = CPU_TO_LE32(0),
 	.dwMaxPayloadTransferSize = CPU_TO_LE32(0),
 };
-static struct usb_uvc_vs_control vs_commit_ctrl =
+static struct usb_uvc_vs_control vs_probe_ctrl;
+static struct usb_uvc_vs_control vs_commit_ctrl;
+// The frame sizes (the frame index is the array index + 1)
+static const uint16_t vf_sizes[VF_FRAME_NUM][2] =
 {
-	.bmHint                   = 0,
-	.bFormatIndex             = 1,
-	.bFrameIndex              = 1,
-	.dwFrameInterval          = CPU_TO_LE32(VF_INTERVAL),
-	.wKeyFrameRate            = CPU_TO_LE16(0),
-	.wPFrameRate              = CPU_TO_LE16(0),
-	.wCompQuality             = CPU_TO_LE16(0),
-	.wCompWindowSize          = CPU_TO_LE16(0),
-	.wDelay                   = CPU_TO_LE16(0),
-	.dwMaxVideoFrameSize      = CPU_TO_LE32(VF_SIZE_IN_BYTES),
-	.dwMaxPayloadTransferSize = CPU_TO_LE32(0),
+#if defined UVC_MJPEG
+	{ 320, 240 },
+	{ 640, 480 },
+	{ 800, 600 },
+#else
+	{ 160, 120 },
+	{ 320, 240 },
+#if VF_FRAME_NUM > 2
+	{ 640, 480 },
+#endif
+#endif
+};
+// The frame intervals in ascending order
+static const uint32_t vf_intervals[VF_INTERVAL_NUM] =
+{
+	VF_INTERVAL(30),
+	VF_INTERVAL(15),
+	VF_INTERVAL(5),
+};
+static const uint16_t vs_ep_size[UVC_ALT_NUM + 1] =
+{
+	0,
+	UVC_ALT1_EP_SIZE,
+	UVC_ALT2_EP_SIZE,
+	UVC_ALT3_EP_SIZE,
 };
 
 //--------------------------------------------
 static usbd_device udev;
 static uint8_t iface_num;
 static uint8_t altset_num;
-static volatile bool lock;
+static uint8_t *frame;
+static uint32_t frame_length;
+static uint32_t payload_size;
+// The committed frame size (the maximum JPEG frame size) and frame interval in microframes
+static uint32_t vf_size;
+static uint32_t vf_interval;
+// The microframe counter and the microframe to start the next frame at
+static uint32_t sof_cnt;
+static uint32_t frame_sof;
+// The sensor is reprogrammed in the main loop:
+// every COMMIT increments vf_commits, vf_formats is set to it when the sensor is reprogrammed
+static volatile uint8_t vf_commits;
+static volatile uint8_t vf_formats;
+// The capture is running; the capture waiting for the sensor to be reprogrammed
+// is started by the SOF callback (vs_start_pending)
+static uint8_t vs_capturing;
+static uint8_t vs_start_pending;
+static uint32_t stat_frames;
+static uint32_t stat_packets;
+static uint32_t stat_bytes;
+static uint32_t stat_copied_bytes;
+#if defined UVC_MOTION_THRESHOLD
+// 1 s in microframes
+#define MOTION_IDLE_INTERVAL        8000
+// The microframe to send the next frame at without motion
+static uint32_t motion_sof;
+static uint32_t stat_skipped_frames;
+static uint32_t motion_buf[VF_MOTION_BUF_SIZE / sizeof(uint32_t)];
+// The frame is checked for motion in the main loop, it is too slow for the USB interrupt:
+// the interrupt holds the frame in motion_frame and increments motion_seq,
+// the main loop sets motion_changed and then motion_checked_seq to the checked motion_seq
+static uint8_t *volatile motion_frame;
+static volatile uint8_t motion_seq;
+static volatile uint8_t motion_checked_seq;
+static volatile uint8_t motion_changed;
+static volatile uint8_t motion_reset;
+#endif
 // Due to use with USB FIFO and/or DMA, the data buffers below must be 32-bit aligned:
 #define USB_CTRL_BUFF_SZ 128
 static uint32_t ubuf[(USB_CTRL_BUFF_SZ + 3) / sizeof(uint32_t)];
-static uint32_t buff_usb[UVC_DATA_SZ / sizeof(uint32_t)];
-static uint32_t framebuf[(VF_SIZE_IN_BYTES + 3) / sizeof(uint32_t)];
+static uint32_t ctrl_buf[(sizeof(struct usb_uvc_vs_control) + 3) / sizeof(uint32_t)];
+#if defined UVC_FRAMEBUF_POOL
+static uint32_t *framebuf;
+#else
+static uint32_t framebuf[VF_FRAMES][(VF_FRAMEBUF_SIZE + 3) / sizeof(uint32_t)];
+#endif
 
 //--------------------------------------------
 static usbd_respond uvc_getdesc(usbd_ctlreq *req, void **address, uint16_t *length)
@@ -388,61 +660,252 @@ static void vs_control_encode(struct usb_uvc_vs_control *ctrl, uint8_t *data)
 }
 
 //--------------------------------------------
+// Fits the control requested by the host to the supported format, frame and interval
+// and fills the fields set by the device
+static void vs_control_fix(struct usb_uvc_vs_control *ctrl)
+{
+	uint32_t cnt;
+	uint32_t size;
+
+	if (ctrl->bFormatIndex < 1 || ctrl->bFormatIndex > VF_FORMAT_NUM)
+	{
+		ctrl->bFormatIndex = vs_def_ctrl.bFormatIndex;
+	}
+	if (ctrl->bFrameIndex < 1 || ctrl->bFrameIndex > VF_FRAME_NUM)
+	{
+		ctrl->bFrameIndex = vs_def_ctrl.bFrameIndex;
+	}
+	// the nearest supported interval that is not shorter than the requested one
+	for (cnt = 0; cnt < VF_INTERVAL_NUM - 1; cnt++)
+	{
+		if (ctrl->dwFrameInterval <= vf_intervals[cnt])
+		{
+			break;
+		}
+	}
+	ctrl->dwFrameInterval = vf_intervals[cnt];
+	size = VF_SIZE_IN_BYTES(vf_sizes[ctrl->bFrameIndex - 1][0], vf_sizes[ctrl->bFrameIndex - 1][1]);
+	ctrl->dwMaxVideoFrameSize = size;
+	// the payload size needed to transfer the frames at the frame rate (8000 microframes per second),
+	// the host selects the alternate setting by it
+	size = (size * 1250 + ctrl->dwFrameInterval - 1) / ctrl->dwFrameInterval + 2;
+	if (size > UVC_DATA_SZ(UVC_ALT3_EP_SIZE))
+	{
+		size = UVC_DATA_SZ(UVC_ALT3_EP_SIZE);
+	}
+	ctrl->dwMaxPayloadTransferSize = size;
+}
+
+//--------------------------------------------
+// Reprograms the sensor for the committed format and frame
+static void vs_set_format(const struct usb_uvc_vs_control *ctrl)
+{
+	uint16_t width = vf_sizes[ctrl->bFrameIndex - 1][0];
+	uint16_t height = vf_sizes[ctrl->bFrameIndex - 1][1];
+
+#if defined UVC_MJPEG
+	cam_drv.set_jpeg(width, height, VF_JPEG_QUALITY);
+#else
+	cam_drv.set_format(width, height, ctrl->bFormatIndex == VF_FORMAT_RGB565 ? IMGSENSOR_FORMAT_RGB565 : IMGSENSOR_FORMAT_YUV422);
+#if defined UVC_MOTION_THRESHOLD
+	img_motion_init((uint8_t *)motion_buf, width, height,
+		ctrl->bFormatIndex == VF_FORMAT_RGB565 ? IMG_MOTION_FORMAT_RGB565 : IMG_MOTION_FORMAT_YUV422, UVC_MOTION_THRESHOLD);
+#endif
+#endif
+}
+
+//--------------------------------------------
+// Starts to capture video frames of the committed format,
+// returns 0 if the frame size is not supported by the camera DMA
+static uint8_t vs_capture_start(void)
+{
+	frame = NULL;
+	frame_sof = sof_cnt;
+#if defined UVC_MOTION_THRESHOLD
+	// the first frame is sent
+	motion_frame = NULL;
+	motion_reset = 1;
+#endif
+	vs_start_pending = 0;
+	vs_capturing = cam_drv.start_dma_frames((uint8_t *)framebuf, vf_size, VF_FRAMES);
+	return vs_capturing;
+}
+
+//--------------------------------------------
+// The frame being sent is abandoned
+static void vs_capture_stop(void)
+{
+	cam_drv.stop_dma();
+	vs_capturing = 0;
+	vs_start_pending = 0;
+	frame = NULL;
+}
+
+//--------------------------------------------
+static void vs_commit(void)
+{
+	vf_size = vs_commit_ctrl.dwMaxVideoFrameSize;
+	vf_interval = vs_commit_ctrl.dwFrameInterval / 1250;
+	vf_commits++;
+	if (vs_capturing)
+	{
+		// the stream is committed without SET_INTERFACE:
+		// the capture of the new frame size is started after the sensor is reprogrammed
+		vs_capture_stop();
+		vs_start_pending = 1;
+	}
+}
+
+//--------------------------------------------
+// Returns the latest captured frame to send, NULL - no frame is ready yet
+static uint8_t *vs_frame_get(void)
+{
+	uint8_t *captured;
+
+#if defined UVC_MOTION_THRESHOLD
+	if (motion_frame)
+	{
+		if (motion_checked_seq != motion_seq)
+		{
+			// the main loop is checking the frame
+			return NULL;
+		}
+		captured = motion_frame;
+		motion_frame = NULL;
+		if (!motion_changed && (int32_t)(sof_cnt - motion_sof) < 0)
+		{
+			// nothing has changed, the next captured frame is checked
+			cam_drv.release_frame();
+			stat_skipped_frames++;
+			return NULL;
+		}
+		motion_sof = sof_cnt + MOTION_IDLE_INTERVAL;
+		return captured;
+	}
+#endif
+	// the latest captured frame
+	captured = cam_drv.get_frame(&frame_length);
+	if (!captured)
+	{
+		return NULL;
+	}
+#if defined UVC_FRAMEBUF_POOL
+	// the frame has been written by DMA
+	fb_pool_invalidate(captured, frame_length);
+#endif
+#if defined UVC_MOTION_THRESHOLD
+	// the frame is held till the main loop checks it
+	motion_frame = captured;
+	motion_seq++;
+	return NULL;
+#else
+	return captured;
+#endif
+}
+
+//--------------------------------------------
+// The payloads are sent straight from the frame buffer:
+// the 2-byte payload header is written in place of the last frame bytes
+// of the previous payload, which are already in the endpoint FIFO.
+// There is no room for the header before the frame data,
+// so only the first payload of the frame (the header and 2 frame bytes) is built
+// in a separate buffer. The payload is not 32-bit aligned,
+// it is fine as the OTG driver writes the FIFO byte by byte.
 static void vs_data_send(usbd_device *dev)
 {
-	static uint32_t packets_cnt;
-	static uint32_t last_packet_num;
-	static uint32_t last_data_size;
 	static uint32_t picture_pos;
+	// MJPEG payload header has the same format
 	static struct usb_uvc_vs_data_uncompressed_header hdr = { 2 , 0 };
+	static uint32_t first_payload[1];
+	uint8_t *payload;
+	uint32_t size;
 
-	if (packets_cnt == 0)
+	if (!frame)
 	{
+		// the frame rate is limited by the committed frame interval
+		if ((int32_t)(sof_cnt - frame_sof) < 0)
+		{
+			return;
+		}
+		frame = vs_frame_get();
+		if (!frame)
+		{
+			return;
+		}
+		frame_sof += vf_interval;
+		if ((int32_t)(sof_cnt - frame_sof) >= 0)
+		{
+			// the camera is slower
+			frame_sof = sof_cnt;
+		}
 		hdr.BFH &= ~USB_UVC_VS_DATA_UNCOMPRESSED_HEADER_EOF;
 		hdr.BFH ^= USB_UVC_VS_DATA_UNCOMPRESSED_HEADER_FID;
 		picture_pos = 0;
-		last_packet_num = VF_SIZE_IN_BYTES % (UVC_DATA_SZ - 2) ? VF_SIZE_IN_BYTES / (UVC_DATA_SZ - 2) : VF_SIZE_IN_BYTES / (UVC_DATA_SZ - 2) - 1;
-		last_data_size = VF_SIZE_IN_BYTES - ((UVC_DATA_SZ - 2) * last_packet_num);
 	}
-	memcpy((uint8_t *)buff_usb, &hdr, sizeof(hdr));
-	if (packets_cnt < last_packet_num)
+	if (!picture_pos)
 	{
-		memcpy((uint8_t *)buff_usb + sizeof(hdr), (uint8_t *)framebuf + picture_pos, UVC_DATA_SZ - sizeof(hdr));
-		if (usbd_ep_write(dev, UVC_TXD_EP, (uint8_t *)buff_usb, UVC_DATA_SZ) != -1)
-		{
-			picture_pos += UVC_DATA_SZ - sizeof(hdr);
-			packets_cnt++;
-		}
+		size = sizeof(hdr);
+		payload = (uint8_t *)first_payload;
+		memcpy(payload, &hdr, sizeof(hdr));
+		memcpy(payload + sizeof(hdr), frame, size);
+		stat_copied_bytes += sizeof(hdr) + size;
 	}
 	else
 	{
-		hdr.BFH |= USB_UVC_VS_DATA_UNCOMPRESSED_HEADER_EOF;
-		memcpy((uint8_t *)buff_usb + sizeof(hdr), (uint8_t *)framebuf + picture_pos, last_data_size);
-		if (usbd_ep_write(dev, UVC_TXD_EP, (uint8_t *)buff_usb, last_data_size + sizeof(hdr)) != -1)
+		size = frame_length - picture_pos;
+		if (size > payload_size - sizeof(hdr))
 		{
-			packets_cnt = 0;
+			size = payload_size - sizeof(hdr);
 		}
+		else
+		{
+			hdr.BFH |= USB_UVC_VS_DATA_UNCOMPRESSED_HEADER_EOF;
+		}
+		payload = frame + picture_pos - sizeof(hdr);
+		memcpy(payload, &hdr, sizeof(hdr));
+		stat_copied_bytes += sizeof(hdr);
+	}
+	if (usbd_ep_write(dev, UVC_TXD_EP, payload, (uint16_t)(size + sizeof(hdr))) == -1)
+	{
+		// the header is written again on the next try
+		return;
+	}
+	picture_pos += size;
+	stat_packets++;
+	stat_bytes += size + sizeof(hdr);
+	if (picture_pos >= frame_length)
+	{
+		// the frame buffer can be captured again
+#if defined UVC_FRAMEBUF_POOL
+		// the payload headers have been written to the frame by the CPU
+		fb_pool_flush(frame, frame_length);
+#endif
+		cam_drv.release_frame();
+		frame = NULL;
+		stat_frames++;
 	}
 }
 
 //--------------------------------------------
 static void uvc_sof_callback(usbd_device *dev, uint8_t event, uint8_t ep)
 {
-	static uint32_t start_ticks;
-	if (!start_ticks)
+	// one payload per microframe
+	sof_cnt++;
+	if (vs_start_pending)
 	{
-		start_ticks = get_platform_counter();
-	}
-	else
-	{
-		// 15 ms pause
-		if (get_platform_counter() - start_ticks > 15)
+		// the sensor is still being reprogrammed for the committed format
+		if (vf_commits != vf_formats)
 		{
-			// start
-			lock = true;
-			vs_data_send(dev);
+			return;
+		}
+		if (!vs_capture_start())
+		{
+			// the frame size is not supported by the camera DMA
+			usbd_reg_event(dev, usbd_evt_sof, NULL);
+			return;
 		}
 	}
+	vs_data_send(dev);
 }
 
 //--------------------------------------------
@@ -461,19 +924,43 @@ static usbd_respond uvc_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 		}
 		if (req->bRequest == USB_STD_SET_INTERFACE)
 		{
-			altset_num = req->wValue;
-			iface_num = req->wIndex;
-			if (iface_num == 1 && altset_num == 1)
+			if (req->wIndex == 1 && req->wValue > UVC_ALT_NUM)
 			{
-				// start to send video data to the isochronous endpoint
-				usbd_reg_event(dev, usbd_evt_sof, uvc_sof_callback);
-				lock = false;
+				return usbd_fail;
 			}
-			if (iface_num == 1 && altset_num == 0)
+			altset_num = req->wValue;
+			iface_num = req->wIndex;
+			if (iface_num == 1)
 			{
 				// stop to send video data to the isochronous endpoint
 				usbd_reg_event(dev, usbd_evt_sof, NULL);
-				lock = true;
+				// stop to capture video frames
+				vs_capture_stop();
+				usbd_ep_deconfig(dev, UVC_TXD_EP);
+			}
+			if (iface_num == 1 && altset_num)
+			{
+				// the endpoint FIFO holds the payload of the microframe
+				if (!usbd_ep_config(dev, UVC_TXD_EP, USB_EPTYPE_ISOCHRONOUS, vs_ep_size[altset_num]))
+				{
+					return usbd_fail;
+				}
+				payload_size = UVC_DATA_SZ(vs_ep_size[altset_num]);
+				// start to capture video frames
+				if (vf_commits != vf_formats)
+				{
+					// the sensor still outputs the previous format,
+					// the capture is started by the SOF callback after it is reprogrammed
+					vs_start_pending = 1;
+				}
+				else if (!vs_capture_start())
+				{
+					// the frame size is not supported by the camera DMA
+					usbd_ep_deconfig(dev, UVC_TXD_EP);
+					return usbd_fail;
+				}
+				// start to send video data to the isochronous endpoint
+				usbd_reg_event(dev, usbd_evt_sof, uvc_sof_callback);
 			}
 			return usbd_ack;
 		}
@@ -485,52 +972,59 @@ static usbd_respond uvc_control(usbd_device *dev, usbd_ctlreq *req, usbd_rqc_cal
 		if ((req->wValue >> 8) == USB_UVC_VS_PROBE_CONTROL)
 		{
 			vs_control_decode(req->data, &vs_probe_ctrl);
+			vs_control_fix(&vs_probe_ctrl);
 		}
 		else if ((req->wValue >> 8) == USB_UVC_VS_COMMIT_CONTROL)
 		{
 			vs_control_decode(req->data, &vs_commit_ctrl);
+			vs_control_fix(&vs_commit_ctrl);
+			vs_commit();
 		}
 		return usbd_ack;
 	case USB_UVC_GET_CUR:
 		if ((req->wValue >> 8) == USB_UVC_VS_PROBE_CONTROL)
 		{
-			vs_control_encode(&vs_probe_ctrl, (uint8_t *)buff_usb);
+			vs_control_encode(&vs_probe_ctrl, (uint8_t *)ctrl_buf);
 		}
 		else if ((req->wValue >> 8) == USB_UVC_VS_COMMIT_CONTROL)
 		{
-			vs_control_encode(&vs_commit_ctrl, (uint8_t *)buff_usb);
+			vs_control_encode(&vs_commit_ctrl, (uint8_t *)ctrl_buf);
 		}
-		dev->status.data_ptr = buff_usb;
+		dev->status.data_ptr = ctrl_buf;
 		dev->status.data_count = sizeof(struct usb_uvc_vs_control);
 		return usbd_ack;
 	case USB_UVC_GET_MIN:
-		return usbd_ack;
 	case USB_UVC_GET_MAX:
+	case USB_UVC_GET_DEF:
+	{
+		// the default format and frame with the shortest (min, def) or the longest (max) interval
+		struct usb_uvc_vs_control ctrl = vs_def_ctrl;
+		if (req->bRequest == USB_UVC_GET_MAX)
+		{
+			ctrl.dwFrameInterval = vf_intervals[VF_INTERVAL_NUM - 1];
+		}
+		vs_control_fix(&ctrl);
+		vs_control_encode(&ctrl, (uint8_t *)ctrl_buf);
+		dev->status.data_ptr = ctrl_buf;
+		dev->status.data_count = sizeof(struct usb_uvc_vs_control);
 		return usbd_ack;
+	}
 	case USB_UVC_GET_LEN:
+		*(uint16_t *)ctrl_buf = cpu_to_le16(sizeof(struct usb_uvc_vs_control));
+		dev->status.data_ptr = ctrl_buf;
+		dev->status.data_count = 2;
 		return usbd_ack;
 	case USB_UVC_GET_INFO:
-		return usbd_ack;
-	case USB_UVC_GET_DEF:
+		// GET and SET requests are supported
+		*(uint8_t *)ctrl_buf = 0x03;
+		dev->status.data_ptr = ctrl_buf;
+		dev->status.data_count = 1;
 		return usbd_ack;
 	default:
 		return usbd_fail;
 	}
 }
 
-//--------------------------------------------
-static void uvc_callback(usbd_device *dev, uint8_t event, uint8_t ep)
-{
-	switch (event)
-	{
-	case usbd_evt_eptx:
-		lock = false;
-		break;
-	default:
-		break;
-	}
-}
-
 //--------------------------------------------
 static usbd_respond uvc_setconf(usbd_device *dev, uint8_t cfg)
 {
@@ -542,9 +1036,9 @@ static usbd_respond uvc_setconf(usbd_device *dev, uint8_t cfg)
 		usbd_reg_endpoint(dev, UVC_TXD_EP, NULL);
 		return usbd_ack;
 	case 1:
-        // configuring device
-		usbd_ep_config(dev, UVC_TXD_EP, USB_EPTYPE_ISOCHRONOUS, UVC_DATA_SZ);
-		usbd_reg_endpoint(dev, UVC_TXD_EP, uvc_callback);
+		// configuring device:
+		// the endpoint is configured by the alternate setting of the video streaming interface
+		usbd_reg_endpoint(dev, UVC_TXD_EP, NULL);
 		return usbd_ack;
 	default:
 		return usbd_fail;
@@ -554,8 +1048,16 @@ static usbd_respond uvc_setconf(usbd_device *dev, uint8_t cfg)
 //--------------------------------------------
 void usb_uvc_camera_init(void)
 {
+#if defined UVC_FRAMEBUF_POOL
+	framebuf = (uint32_t *)fb_pool_acquire(VF_FRAMES);
+#endif
 	cam_drv.init(1);
-	cam_drv.init_dma_buf();
+	vs_probe_ctrl = vs_def_ctrl;
+	vs_control_fix(&vs_probe_ctrl);
+	vs_commit_ctrl = vs_probe_ctrl;
+	vs_commit();
+	// camera => (by DMA) => memory frame buffers
+	cam_drv.init_dma_frames(NULL);
 
 	usbd_hw_init(&udev);
 	usbd_init(&udev, &usbd_hw, UVC_EP0_SIZE, ubuf, sizeof(ubuf));
@@ -564,18 +1066,101 @@ void usb_uvc_camera_init(void)
 	usbd_reg_descr(&udev, uvc_getdesc);
 }
 
+//--------------------------------------------
+void usb_uvc_camera_get_stat(uvc_camera_stat_t *stat)
+{
+	stat->frames = stat_frames;
+	stat->packets = stat_packets;
+	stat->bytes = stat_bytes;
+	stat->copied_bytes = stat_copied_bytes;
+#if defined UVC_MOTION_THRESHOLD
+	stat->skipped_frames = stat_skipped_frames;
+#else
+	stat->skipped_frames = 0;
+#endif
+}
+
+#if defined UVC_MOTION_THRESHOLD
+//--------------------------------------------
+// The frame held by the USB interrupt is checked for motion,
+// the motion detector is initialized (vs_set_format) and reset in the main loop only
+static void motion_check(void)
+{
+	uint8_t seq = motion_seq;
+	uint8_t *checked = motion_frame;
+
+	if (motion_reset)
+	{
+		motion_reset = 0;
+		img_motion_reset();
+	}
+	if (checked && seq != motion_checked_seq)
+	{
+		// the result of the frame dropped by the interrupt meanwhile is ignored by seq
+		motion_changed = img_motion_process(checked) ? 1 : 0;
+		motion_checked_seq = seq;
+	}
+}
+#endif
+
+#if defined UVC_STAT_PERIOD
+//--------------------------------------------
+static void print_stat(void)
+{
+	imgsensor_stat_t stat;
+	uint8_t bin;
+
+	cam_drv.get_stat(&stat);
+	printf("uvc frames: %lu, packets: %lu, bytes: %lu, copied bytes: %lu\n",
+		stat_frames, stat_packets, stat_bytes, stat_copied_bytes);
+#if defined UVC_MOTION_THRESHOLD
+	printf("frames without motion: %lu, motion score: %u%%\n", stat_skipped_frames, img_motion_get_score());
+#endif
+	printf("camera fps: %lu.%lu, period: %lu us, frames: %lu, consumed: %lu, skipped: %lu, recaptured: %lu, dropped: %lu, overwritten: %lu\n",
+		stat.fps_x10 / 10, stat.fps_x10 % 10, stat.frame_period / (SystemCoreClock / 1000000),
+		stat.frames, stat.consumed_frames, stat.skipped_frames, stat.recaptured_frames, stat.dropped_frames, stat.overwritten_frames);
+	printf("overruns: %lu, sync errors: %lu, dma errors: %lu, fifo errors: %lu\n",
+		stat.overruns, stat.sync_errors, stat.dma_errors, stat.fifo_errors);
+	printf("latency, ms <1 <2 <4 <8 <16 <32 <64 >=64:");
+	for (bin = 0; bin < IMGSENSOR_LATENCY_BINS; bin++)
+	{
+		printf(" %lu", stat.latency[bin]);
+	}
+	printf("\n");
+}
+#endif
+
 //--------------------------------------------
 void usb_uvc_camera_loop(void)
 {
-	lock = true;
+	uint8_t commits;
+#if defined UVC_STAT_PERIOD
+	uint32_t time = get_platform_counter();
+#endif
+
 	usbd_enable(&udev, true);
 	usbd_connect(&udev, true);
 	while (1)
 	{
-		if (!lock)
+		commits = vf_commits;
+		if (commits != vf_formats)
 		{
-			// camera => (by DMA) => memory frame buffer
-			cam_drv.read_dma_buf((uint8_t *)framebuf, VF_SIZE_IN_BYTES);
+			// the sensor registers are written over I2C,
+			// it is too slow for the USB interrupt
+			vs_set_format(&vs_commit_ctrl);
+			vf_formats = commits;
 		}
+#if defined UVC_MOTION_THRESHOLD
+		motion_check();
+#endif
+#if defined UVC_STAT_PERIOD
+		if (get_platform_counter() - time >= UVC_STAT_PERIOD)
+		{
+			// the frames are consumed in the USB interrupt,
+			// the UART output does not delay them
+			time = get_platform_counter();
+			print_stat();
+		}
+#endif
 	}
 }
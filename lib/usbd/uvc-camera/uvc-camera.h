@@ -15,8 +15,21 @@
 #ifndef USB_UVC_STATIC_H_
 #define USB_UVC_STATIC_H_
 
+// Video streaming statistics since the start:
+// the frame data is sent to the endpoint without copying,
+// so copied_bytes / frames is about 2 bytes (payload header) per packet
+typedef struct uvc_camera_stat
+{
+	uint32_t frames;          // frames sent
+	uint32_t packets;         // payloads sent
+	uint32_t bytes;           // payload bytes sent (headers included)
+	uint32_t copied_bytes;    // bytes copied by the CPU to build the payloads
+	uint32_t skipped_frames;  // frames without motion not sent (UVC_MOTION_THRESHOLD)
+} uvc_camera_stat_t;
+
 void usb_uvc_camera_init(void);
 void usb_uvc_camera_loop(void);
+void usb_uvc_camera_get_stat(uvc_camera_stat_t *stat);
 
 #endif // USB_UVC_STATIC_H_
 
@@ -18,6 +18,13 @@
 #include "cpu.h"
 #include "project-conf.h"
 
+#ifdef EXT_SDRAM
+// The external SDRAM is initialized by platform_init (stm32f746ig only),
+// the FMC SDRAM bank 2 is remapped to the cacheable memory region
+#define EXT_SDRAM_ADDR   0x70000000UL
+#define EXT_SDRAM_SIZE   (8UL * 1024 * 1024)
+#endif
+
 void platform_init(void);
 void delay_ms(uint32_t delay_ms);
 void delay_us(uint32_t delay_us);
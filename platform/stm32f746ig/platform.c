@@ -109,6 +109,122 @@ static void DWTInit(void)
 
 
 
+//--------------------------------------------
+#ifdef EXT_SDRAM
+//--------------------------------------------
+// FMC(AHB3)
+// GPIO_AF12_FMC
+// SDRAM IS42S16400J (1M x 16 bit x 4 banks, 8 MB): SDRAM bank 2 (SDNE1, SDCKE1)
+// A0..A11:  PF0 PF1 PF2 PF3 PF4 PF5 PF12 PF13 PF14 PF15 PG0 PG1
+// D0..D15:  PD14 PD15 PD0 PD1 PE7 PE8 PE9 PE10 PE11 PE12 PE13 PE14 PE15 PD8 PD9 PD10
+// BA0, BA1: PG4 PG5
+// NBL0, NBL1: PE0 PE1
+// SDNE1: PH6, SDCKE1: PH7, SDNWE: PH5, SDNRAS: PF11, SDNCAS: PG15, SDCLK: PG8
+#define SDRAM_PINS_D    ((1 << 0) | (1 << 1) | (1 << 8) | (1 << 9) | (1 << 10) | (1 << 14) | (1 << 15))
+#define SDRAM_PINS_E    ((1 << 0) | (1 << 1) | (1 << 7) | (1 << 8) | (1 << 9) | (1 << 10) | (1 << 11) | \
+                         (1 << 12) | (1 << 13) | (1 << 14) | (1 << 15))
+#define SDRAM_PINS_F    ((1 << 0) | (1 << 1) | (1 << 2) | (1 << 3) | (1 << 4) | (1 << 5) | (1 << 11) | \
+                         (1 << 12) | (1 << 13) | (1 << 14) | (1 << 15))
+#define SDRAM_PINS_G    ((1 << 0) | (1 << 1) | (1 << 4) | (1 << 5) | (1 << 8) | (1 << 15))
+#define SDRAM_PINS_H    ((1 << 5) | (1 << 6) | (1 << 7))
+
+//--------------------------------------------
+// SDCLK = HCLK / 2 = 108 MHz (9.26 ns), CAS latency = 3
+// tMRD = 2 clk, tXSR = 70 ns, tRAS = 42 ns, tRC = 63 ns, tRP = 15 ns, tRCD = 15 ns,
+// tWR >= tRAS - tRCD and tWR >= tRC - tRCD - tRP
+#define SDRAM_TMRD      2
+#define SDRAM_TXSR      8
+#define SDRAM_TRAS      5
+#define SDRAM_TRC       7
+#define SDRAM_TWR       3
+#define SDRAM_TRP       2
+#define SDRAM_TRCD      2
+// The refresh rate: 64 ms / 4096 rows = 15.625 us
+// COUNT = 15.625 us * 108 MHz - 20 = 1667
+#define SDRAM_REFRESH_COUNT    1667
+// The mode register: burst length 1, sequential, CAS latency 3, single location write access
+#define SDRAM_MODE_REGISTER    ((3 << 4) | (1 << 9))
+
+//--------------------------------------------
+static void sdram_pins_init(GPIO_TypeDef *gpio, uint16_t pins)
+{
+	uint8_t pin;
+
+	for (pin = 0; pin < 16; pin++)
+	{
+		if (pins & (1 << pin))
+		{
+			hw_cfg_pin(gpio, pin, GPIOCFG_MODE_ALT | GPIO_AF12_FMC | GPIOCFG_OSPEED_VHIGH | GPIOCFG_OTYPE_PUPD | GPIOCFG_PUPD_NONE);
+		}
+	}
+}
+
+//--------------------------------------------
+static void sdram_command(uint32_t command)
+{
+	// the command is issued to the SDRAM bank 2
+	FMC_Bank5_6->SDCMR = command | FMC_SDCMR_CTB2;
+	while (FMC_Bank5_6->SDSR & FMC_SDSR_BUSY);
+}
+
+//--------------------------------------------
+static void SDRAMInit(void)
+{
+	// SYSCFG clock enable
+	RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+	// Remap from 0xC0000000/0xD0000000 to 0x60000000/0x70000000:
+	// the default memory type of the SDRAM banks is Device (not cacheable, no unaligned access),
+	// the memory type of the region 0x60000000-0x7FFFFFFF is Normal (cacheable, WBWA)
+	SYSCFG->MEMRMP |= SYSCFG_MEMRMP_SWP_FMC_0;
+
+	// IO port D, E, F, G, H clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIODEN | RCC_AHB1ENR_GPIOEEN | RCC_AHB1ENR_GPIOFEN | RCC_AHB1ENR_GPIOGEN | RCC_AHB1ENR_GPIOHEN;
+	// FMC clock enable
+	RCC->AHB3ENR |= RCC_AHB3ENR_FMCEN;
+
+	sdram_pins_init(GPIOx(GPIO_D), SDRAM_PINS_D);
+	sdram_pins_init(GPIOx(GPIO_E), SDRAM_PINS_E);
+	sdram_pins_init(GPIOx(GPIO_F), SDRAM_PINS_F);
+	sdram_pins_init(GPIOx(GPIO_G), SDRAM_PINS_G);
+	sdram_pins_init(GPIOx(GPIO_H), SDRAM_PINS_H);
+
+	// SDCLK, RBURST and RPIPE are common to both banks, they are in FMC_SDCR1
+	FMC_Bank5_6->SDCR[0] = FMC_SDCR1_SDCLK_1 |  // SDRAM clock configuration: (10) SDCLK = 2 x HCLK periods
+	                       FMC_SDCR1_RBURST;    // Burst read: (1) single read requests are managed as bursts
+	                                            // Read pipe: (00) no HCLK clock cycle delay
+	FMC_Bank5_6->SDCR[1] =                      // Number of column address bits: (00) 8 bits
+	                       FMC_SDCR1_NR_0     | // Number of row address bits: (01) 12 bits
+	                       FMC_SDCR1_MWID_0   | // Memory data bus width: (01) 16 bits
+	                       FMC_SDCR1_NB       | // Number of internal banks: (1) four internal banks
+	                       FMC_SDCR1_CAS_0 | FMC_SDCR1_CAS_1; // CAS latency: (11) 3 cycles
+	                                            // Write protection: (0) write accesses allowed
+
+	// TRC and TRP are common to both banks, they are in FMC_SDTR1
+	FMC_Bank5_6->SDTR[0] = ((SDRAM_TRC - 1) << FMC_SDTR1_TRC_Pos) |
+	                       ((SDRAM_TRP - 1) << FMC_SDTR1_TRP_Pos);
+	FMC_Bank5_6->SDTR[1] = ((SDRAM_TMRD - 1) << FMC_SDTR1_TMRD_Pos) |
+	                       ((SDRAM_TXSR - 1) << FMC_SDTR1_TXSR_Pos) |
+	                       ((SDRAM_TRAS - 1) << FMC_SDTR1_TRAS_Pos) |
+	                       ((SDRAM_TWR - 1) << FMC_SDTR1_TWR_Pos) |
+	                       ((SDRAM_TRCD - 1) << FMC_SDTR1_TRCD_Pos);
+
+	// The SDRAM initialization sequence:
+	// clock configuration enable, 100 us delay (the power-up delay of the memory)
+	sdram_command(FMC_SDCMR_MODE_0);
+	delay_us(100);
+	// all banks precharge
+	sdram_command(FMC_SDCMR_MODE_1);
+	// 8 auto-refresh cycles
+	sdram_command(FMC_SDCMR_MODE_0 | FMC_SDCMR_MODE_1 | ((8 - 1) << FMC_SDCMR_NRFS_Pos));
+	// load mode register
+	sdram_command(FMC_SDCMR_MODE_2 | (SDRAM_MODE_REGISTER << FMC_SDCMR_MRD_Pos));
+
+	FMC_Bank5_6->SDRTR = SDRAM_REFRESH_COUNT << FMC_SDRTR_COUNT_Pos;
+}
+#endif
+
+
+
 //--------------------------------------------
 #ifdef UART_TERMINAL
 //--------------------------------------------
@@ -291,6 +407,9 @@ void platform_init(void)
 	// Changing the SysTick_IRQn priority level in the new group
 	NVIC_SetPriority(SysTick_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
 	DWTInit();
+#ifdef EXT_SDRAM
+	SDRAMInit();
+#endif
 #ifdef UART_TERMINAL
 #if UART_TERMINAL == 1
 	UART1Init();